@@ -0,0 +1,74 @@
+#!/bin/bash
+
+# Measures the planning overhead that the extension adds to small OLTP-style
+# queries on regular tables. The same pgbench workload is run against a
+# database with the extension and one without it. The query protocol is
+# "simple", so that every statement is parsed and planned. The workload
+# includes queries with subqueries and CTEs, for which the planner has to check
+# every referenced table against the hypertable cache.
+#
+# Usage: benchmark_planning.sh [duration_secs] [clients]
+
+set -u
+set -e
+
+DURATION=${1:-30}
+CLIENTS=${2:-1}
+
+export PGUSER=${PGUSER:-postgres}
+export PGHOST=${PGHOST:-localhost}
+
+DB_PLAIN=${DB_PLAIN:-bench_planning_plain}
+DB_TIMESCALE=${DB_TIMESCALE:-bench_planning_timescaledb}
+SCRIPT=$(mktemp)
+
+trap "rm -f $SCRIPT" EXIT
+
+cat > $SCRIPT << EOS
+\set aid random(1, 100000)
+SELECT abalance FROM accounts WHERE aid = :aid;
+UPDATE accounts SET abalance = abalance + 1 WHERE aid = :aid;
+SELECT a.aid, a.abalance FROM accounts a WHERE a.aid BETWEEN :aid AND :aid + 10 ORDER BY a.aid;
+SELECT abalance FROM accounts WHERE aid IN (SELECT aid FROM branches WHERE bid = :aid % 100);
+WITH b AS (SELECT aid FROM branches WHERE bid = :aid % 100) SELECT count(*) FROM accounts a JOIN b USING (aid);
+EOS
+
+setup_db() {
+    local db=$1
+    local extension=$2
+
+    psql -q -X -v ON_ERROR_STOP=1 -d postgres -c "DROP DATABASE IF EXISTS $db" -c "CREATE DATABASE $db"
+
+    if [[ $extension == "true" ]]; then
+        psql -q -X -v ON_ERROR_STOP=1 -d $db << EOS
+\o /dev/null
+CREATE EXTENSION IF NOT EXISTS timescaledb CASCADE;
+SELECT setup_timescaledb(hostname => 'fakehost');
+CREATE TABLE metrics (time TIMESTAMPTZ NOT NULL, device_id INT, value DOUBLE PRECISION);
+SELECT create_hypertable('metrics', 'time');
+EOS
+    fi
+
+    psql -q -X -v ON_ERROR_STOP=1 -d $db << EOS
+CREATE TABLE accounts (aid INT PRIMARY KEY, abalance INT NOT NULL DEFAULT 0);
+INSERT INTO accounts (aid) SELECT generate_series(1, 100000);
+CREATE TABLE branches (bid INT, aid INT);
+INSERT INTO branches SELECT i % 100, i FROM generate_series(1, 1000) i;
+CREATE INDEX ON branches (bid);
+VACUUM ANALYZE accounts, branches;
+EOS
+}
+
+run_bench() {
+    local db=$1
+
+    pgbench -n -M simple -c $CLIENTS -j $CLIENTS -T $DURATION -f $SCRIPT $db | grep -E "^(tps|latency)"
+}
+
+setup_db $DB_PLAIN false
+setup_db $DB_TIMESCALE true
+
+echo "Without extension:"
+run_bench $DB_PLAIN
+echo "With extension:"
+run_bench $DB_TIMESCALE
@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# Measures the cost of a catalog lookup through the extension's scanner, with
+# relations opened for every lookup, kept open across lookups, and with
+# lookups batched into array scans. Creates a hypertable with the given
+# number of chunks to look up.
+#
+# Usage: benchmark_scanner.sh [iterations] [chunks]
+
+set -u
+set -e
+
+ITERATIONS=${1:-100000}
+CHUNKS=${2:-100}
+
+export PGUSER=${PGUSER:-postgres}
+export PGHOST=${PGHOST:-localhost}
+
+DB=${DB:-bench_scanner}
+
+psql -q -X -v ON_ERROR_STOP=1 -d postgres -c "DROP DATABASE IF EXISTS $DB" -c "CREATE DATABASE $DB"
+psql -q -X -v ON_ERROR_STOP=1 -d $DB << EOS
+\o /dev/null
+CREATE EXTENSION IF NOT EXISTS timescaledb CASCADE;
+SELECT setup_timescaledb(hostname => 'fakehost');
+CREATE TABLE metrics (time BIGINT NOT NULL, value DOUBLE PRECISION);
+SELECT create_hypertable('metrics', 'time', chunk_time_interval => 10);
+INSERT INTO metrics SELECT t, t FROM generate_series(0, $CHUNKS * 10 - 1) t;
+EOS
+
+for mode in single keep_open batch; do
+    echo -n "$mode: "
+    psql -q -X -t -A -d $DB -c "SELECT round(_timescaledb_internal.scanner_benchmark($ITERATIONS, '$mode')::numeric, 3) || ' us/lookup'"
+done
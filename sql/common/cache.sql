@@ -21,25 +21,191 @@ CREATE OR REPLACE FUNCTION _timescaledb_cache.invalidate_relcache_trigger()
 CREATE OR REPLACE FUNCTION _timescaledb_cache.invalidate_relcache(proxy_oid OID)
  RETURNS BOOLEAN AS '$libdir/timescaledb', 'invalidate_relcache' LANGUAGE C;
 
-CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.hypertable
+--invalidates the cache entries for a relation; with a NULL relation, only
+--the caches shared across backends are invalidated
+CREATE OR REPLACE FUNCTION _timescaledb_cache.invalidate_cache_entry(proxy_name NAME, relation REGCLASS)
+ RETURNS VOID AS '$libdir/timescaledb', 'invalidate_cache_entry' LANGUAGE C;
+
+-- Statistics of the metadata caches of the current backend or, with shared
+-- set, of all backends
+CREATE OR REPLACE FUNCTION cache_stats(
+    shared            BOOLEAN = FALSE,
+    OUT cache_name    NAME,
+    OUT entries       BIGINT,
+    OUT memory_bytes  BIGINT,
+    OUT hits          BIGINT,
+    OUT misses        BIGINT,
+    OUT hit_ratio     DOUBLE PRECISION,
+    OUT evictions     BIGINT,
+    OUT invalidations BIGINT,
+    OUT create_time   DOUBLE PRECISION
+)
+    RETURNS SETOF RECORD AS '$libdir/timescaledb', 'cache_stats' LANGUAGE C STRICT VOLATILE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_cache.hypertable_main_table(hypertable_id INTEGER)
+    RETURNS REGCLASS LANGUAGE SQL STABLE AS
+$BODY$
+    SELECT to_regclass(format('%I.%I', h.schema_name, h.table_name))
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = hypertable_id;
+$BODY$;
+
+-- Invalidates the hypertable cache entry of the hypertable that a changed
+-- catalog row belongs to. Entries are keyed by the hypertable's main table.
+CREATE OR REPLACE FUNCTION _timescaledb_cache.invalidate_hypertable_cache_trigger()
+    RETURNS TRIGGER LANGUAGE PLPGSQL AS
+$BODY$
+DECLARE
+    main_tables REGCLASS[] = '{}';
+    main_table  REGCLASS;
+BEGIN
+    IF TG_TABLE_NAME = 'hypertable' THEN
+        IF TG_OP <> 'INSERT' THEN
+            main_tables := main_tables || to_regclass(format('%I.%I', OLD.schema_name, OLD.table_name));
+        END IF;
+        IF TG_OP <> 'DELETE' THEN
+            main_tables := main_tables || to_regclass(format('%I.%I', NEW.schema_name, NEW.table_name));
+        END IF;
+    ELSIF TG_TABLE_NAME = 'partition' THEN
+        IF TG_OP <> 'INSERT' THEN
+            main_tables := main_tables || _timescaledb_cache.hypertable_main_table(
+                (SELECT e.hypertable_id FROM _timescaledb_catalog.partition_epoch e WHERE e.id = OLD.epoch_id));
+        END IF;
+        IF TG_OP <> 'DELETE' THEN
+            main_tables := main_tables || _timescaledb_cache.hypertable_main_table(
+                (SELECT e.hypertable_id FROM _timescaledb_catalog.partition_epoch e WHERE e.id = NEW.epoch_id));
+        END IF;
+    ELSE
+        IF TG_OP <> 'INSERT' THEN
+            main_tables := main_tables || _timescaledb_cache.hypertable_main_table(OLD.hypertable_id);
+        END IF;
+        IF TG_OP <> 'DELETE' THEN
+            main_tables := main_tables || _timescaledb_cache.hypertable_main_table(NEW.hypertable_id);
+        END IF;
+    END IF;
+
+    --a main table that no longer exists was dropped or renamed, which
+    --already invalidated its entry
+    FOREACH main_table IN ARRAY main_tables LOOP
+        PERFORM _timescaledb_cache.invalidate_cache_entry('cache_inval_hypertable', main_table);
+    END LOOP;
+
+    RETURN NULL;
+END
+$BODY$;
+
+-- Invalidates the chunk cache entries of the chunk tables that a changed
+-- catalog row belongs to.
+CREATE OR REPLACE FUNCTION _timescaledb_cache.invalidate_chunk_cache_trigger()
+    RETURNS TRIGGER LANGUAGE PLPGSQL AS
+$BODY$
+DECLARE
+    chunk_tables REGCLASS[];
+    chunk_table  REGCLASS;
+BEGIN
+    IF TG_TABLE_NAME = 'chunk' THEN
+        chunk_tables := ARRAY(
+            SELECT to_regclass(format('%I.%I', crn.schema_name, crn.table_name))
+            FROM _timescaledb_catalog.chunk_replica_node crn
+            WHERE crn.chunk_id = OLD.id);
+    ELSIF TG_TABLE_NAME = 'chunk_compression' THEN
+        IF TG_OP = 'DELETE' THEN
+            chunk_tables := ARRAY(
+                SELECT to_regclass(format('%I.%I', crn.schema_name, crn.table_name))
+                FROM _timescaledb_catalog.chunk_replica_node crn
+                WHERE crn.chunk_id = OLD.chunk_id AND crn.database_name = OLD.database_name);
+        ELSE
+            chunk_tables := ARRAY(
+                SELECT to_regclass(format('%I.%I', crn.schema_name, crn.table_name))
+                FROM _timescaledb_catalog.chunk_replica_node crn
+                WHERE crn.chunk_id = NEW.chunk_id AND crn.database_name = NEW.database_name);
+        END IF;
+    ELSIF TG_TABLE_NAME IN ('chunk_zone_map', 'chunk_zone_map_delta', 'chunk_seal') THEN
+        --zone maps and seals are kept for local chunks only
+        IF TG_OP = 'DELETE' THEN
+            chunk_tables := ARRAY(
+                SELECT to_regclass(format('%I.%I', crn.schema_name, crn.table_name))
+                FROM _timescaledb_catalog.chunk_replica_node crn
+                WHERE crn.chunk_id = OLD.chunk_id AND crn.database_name = current_database());
+        ELSE
+            chunk_tables := ARRAY(
+                SELECT to_regclass(format('%I.%I', crn.schema_name, crn.table_name))
+                FROM _timescaledb_catalog.chunk_replica_node crn
+                WHERE crn.chunk_id = NEW.chunk_id AND crn.database_name = current_database());
+        END IF;
+    ELSE
+        chunk_tables := ARRAY[to_regclass(format('%I.%I', OLD.schema_name, OLD.table_name))];
+        IF TG_OP = 'UPDATE' THEN
+            chunk_tables := chunk_tables || to_regclass(format('%I.%I', NEW.schema_name, NEW.table_name));
+        END IF;
+    END IF;
+
+    IF array_length(chunk_tables, 1) IS NULL THEN
+        chunk_tables := ARRAY[NULL::REGCLASS];
+    END IF;
+
+    FOREACH chunk_table IN ARRAY chunk_tables LOOP
+        PERFORM _timescaledb_cache.invalidate_cache_entry('cache_inval_chunk', chunk_table);
+    END LOOP;
+
+    RETURN NULL;
+END
+$BODY$;
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE ON _timescaledb_catalog.hypertable
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_hypertable_cache_trigger();
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE ON _timescaledb_catalog.partition_epoch
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_hypertable_cache_trigger();
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE ON _timescaledb_catalog.partition
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_hypertable_cache_trigger();
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE ON _timescaledb_catalog.hypertable_replica
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_hypertable_cache_trigger();
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.default_replica_node
+FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_hypertable');
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.monotonic_function
 FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_hypertable');
 
-CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.partition_epoch
+CREATE TRIGGER "0_cache_inval" AFTER UPDATE OR DELETE ON _timescaledb_catalog.chunk
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_chunk_cache_trigger();
+
+CREATE TRIGGER "0_cache_inval_1" AFTER UPDATE OR DELETE ON _timescaledb_catalog.chunk_replica_node
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_chunk_cache_trigger();
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE ON _timescaledb_catalog.chunk_compression
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_chunk_cache_trigger();
+
+--any change to the chunk table makes the catalog snapshot of chunks stale
+CREATE OR REPLACE FUNCTION _timescaledb_cache.invalidate_catalog_snapshot_trigger()
+ RETURNS TRIGGER AS '$libdir/timescaledb', 'invalidate_catalog_snapshot_trigger' LANGUAGE C;
+
+CREATE TRIGGER "0_catalog_snapshot_inval" AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.chunk
+FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_catalog_snapshot_trigger();
+
+--truncating a catalog table invalidates the whole cache
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.hypertable
 FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_hypertable');
 
-CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.partition
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.partition_epoch
 FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_hypertable');
 
-CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.hypertable_replica
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.partition
 FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_hypertable');
 
-CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.default_replica_node
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.hypertable_replica
 FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_hypertable');
 
-CREATE TRIGGER "0_cache_inval" AFTER UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.chunk
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.chunk
+FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_chunk');
+
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.chunk_replica_node
 FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_chunk');
 
-CREATE TRIGGER "0_cache_inval_1" AFTER UPDATE OR DELETE OR TRUNCATE ON _timescaledb_catalog.chunk_replica_node
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.chunk_compression
 FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_chunk');
 
 CREATE OR REPLACE FUNCTION _timescaledb_cache.extension_event_trigger()
@@ -11,6 +11,8 @@
 --IO110 - hypertable already exists
 --I0120 - node already exists
 --I0130 - user already exists
+--IO140 - policy already exists
+--IO150 - chunk is sealed
 --IO500 - GROUP: internal error
 --IO501 - unexpected state/event
 --IO502 - communication/remote error
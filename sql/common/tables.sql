@@ -210,6 +210,23 @@ CREATE TABLE IF NOT EXISTS _timescaledb_catalog.chunk_replica_node (
 );
 SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.chunk_replica_node', '');
 
+-- The compressed data of a chunk replica. A compressed chunk's table only
+-- holds rows inserted after compression; the rest are stored in the
+-- compressed table, one row per group of rows (see compress_chunk()).
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.chunk_compression (
+    chunk_id               INT    NOT NULL REFERENCES _timescaledb_catalog.chunk(id) ON DELETE CASCADE,
+    database_name          NAME   NOT NULL REFERENCES _timescaledb_catalog.node(database_name),
+    compressed_schema_name NAME   NOT NULL,
+    compressed_table_name  NAME   NOT NULL,
+    segment_by             NAME   NULL,
+    uncompressed_rows      BIGINT NOT NULL,
+    uncompressed_bytes     BIGINT NOT NULL,
+    compressed_bytes       BIGINT NOT NULL,
+    PRIMARY KEY (chunk_id, database_name),
+    UNIQUE (compressed_schema_name, compressed_table_name)
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.chunk_compression', '');
+
 -- Represents a hypertable column.
 CREATE TABLE IF NOT EXISTS _timescaledb_catalog.hypertable_column (
     hypertable_id   INTEGER             NOT NULL REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
@@ -249,3 +266,17 @@ CREATE TABLE IF NOT EXISTS _timescaledb_catalog.deleted_hypertable_index (
   deleted_on NAME
 );
 SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.deleted_hypertable_index', '');
+
+-- Functions that preserve the ordering of one of their arguments, i.e.,
+-- f(..., x1, ...) > f(..., x2, ...) implies x1 > x2 when all other arguments
+-- are held constant. The planner uses this to satisfy an ORDER BY or GROUP BY
+-- on the function's result with an index on the ordering argument.
+--
+-- order_argument is the (1-based) position of the ordering argument. Rows
+-- added by the extension itself are marked as builtin and are not dumped.
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.monotonic_function (
+    function_id     REGPROCEDURE NOT NULL PRIMARY KEY,
+    order_argument  SMALLINT     NOT NULL CHECK (order_argument > 0),
+    builtin         BOOLEAN      NOT NULL DEFAULT false
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.monotonic_function', 'WHERE NOT builtin');
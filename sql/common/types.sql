@@ -1 +1,2 @@
 CREATE TYPE _timescaledb_catalog.chunk_placement_type AS ENUM ('RANDOM', 'STICKY');
+CREATE TYPE _timescaledb_catalog.bgw_policy_type AS ENUM ('retention', 'compression', 'chunk_precreation', 'reorder', 'tiering', 'sealing', 'refresh', 'index');
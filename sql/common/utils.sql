@@ -1,2 +1,7 @@
 CREATE OR REPLACE FUNCTION gethostname() RETURNS TEXT
 	AS '$libdir/timescaledb', 'pg_gethostname' LANGUAGE C IMMUTABLE STRICT;
+
+--for benchmarking: average time in microseconds of a catalog lookup through
+--the scanner, with mode 'single', 'keep_open' or 'batch'
+CREATE OR REPLACE FUNCTION _timescaledb_internal.scanner_benchmark(iterations INTEGER, mode TEXT)
+    RETURNS DOUBLE PRECISION AS '$libdir/timescaledb', 'scanner_benchmark' LANGUAGE C STRICT VOLATILE;
@@ -0,0 +1,35 @@
+-- This file contains the first() and last() aggregates, which return the value
+-- of one column ordered by another. E.g., last(temperature, time) returns the
+-- most recent temperature. Rows where the ordering column is NULL are ignored.
+--
+-- Queries that only compute first() and last() aggregates over a hypertable
+-- are planned as ordered index scans (see src/agg_bookend.c).
+
+CREATE OR REPLACE FUNCTION _timescaledb_internal.first_sfunc(internal, anyelement, "any")
+RETURNS internal
+AS '$libdir/timescaledb', 'first_sfunc'
+LANGUAGE C IMMUTABLE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_internal.last_sfunc(internal, anyelement, "any")
+RETURNS internal
+AS '$libdir/timescaledb', 'last_sfunc'
+LANGUAGE C IMMUTABLE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_internal.bookend_finalfunc(internal, anyelement, "any")
+RETURNS anyelement
+AS '$libdir/timescaledb', 'bookend_finalfunc'
+LANGUAGE C IMMUTABLE;
+
+CREATE AGGREGATE first(anyelement, "any") (
+    SFUNC = _timescaledb_internal.first_sfunc,
+    STYPE = internal,
+    FINALFUNC = _timescaledb_internal.bookend_finalfunc,
+    FINALFUNC_EXTRA
+);
+
+CREATE AGGREGATE last(anyelement, "any") (
+    SFUNC = _timescaledb_internal.last_sfunc,
+    STYPE = internal,
+    FINALFUNC = _timescaledb_internal.bookend_finalfunc,
+    FINALFUNC_EXTRA
+);
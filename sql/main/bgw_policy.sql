@@ -0,0 +1,670 @@
+-- Adds a background job policy to a hypertable. The first run of the policy
+-- is due right away. The policy's jobs run as the current user, who must own
+-- the hypertable.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.add_policy(
+    hypertable         REGCLASS,
+    policy_type        _timescaledb_catalog.bgw_policy_type,
+    schedule_interval  INTERVAL,
+    max_jitter         INTERVAL,
+    older_than         INTERVAL = NULL,
+    ahead              INTERVAL = NULL,
+    segment_by         NAME = NULL,
+    index_name         NAME = NULL,
+    tablespace         NAME = NULL,
+    index_method       NAME = NULL
+)
+    RETURNS INTEGER LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    hypertable_row _timescaledb_catalog.hypertable;
+    policy_id      INTEGER;
+BEGIN
+    SELECT h.*
+    INTO hypertable_row
+    FROM _timescaledb_catalog.hypertable h
+    INNER JOIN pg_namespace n ON (n.nspname = h.schema_name)
+    INNER JOIN pg_class c ON (c.relname = h.table_name AND c.relnamespace = n.oid)
+    WHERE c.oid = hypertable;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Table % is not a hypertable', hypertable
+        USING ERRCODE = 'IO001';
+    END IF;
+
+    IF NOT pg_has_role(current_user, (SELECT c.relowner FROM pg_class c WHERE c.oid = hypertable), 'USAGE') THEN
+        RAISE EXCEPTION 'Must be owner of hypertable %', hypertable
+        USING ERRCODE = 'insufficient_privilege';
+    END IF;
+
+    --policies work on chunks relative to the current time
+    IF hypertable_row.time_column_type NOT IN ('TIMESTAMP', 'TIMESTAMPTZ') THEN
+        RAISE EXCEPTION 'Cannot add % policy to hypertable % with time column of type %',
+            policy_type, hypertable, hypertable_row.time_column_type
+        USING ERRCODE = 'IO101',
+        HINT = 'Policies require a time column of type TIMESTAMP or TIMESTAMPTZ.';
+    END IF;
+
+    BEGIN
+        INSERT INTO _timescaledb_catalog.bgw_policy (hypertable_id, policy_type, owner, schedule_interval,
+                                                     max_jitter, next_start, older_than, ahead, segment_by,
+                                                     index_name, tablespace, index_method)
+        VALUES (hypertable_row.id, policy_type, current_user, schedule_interval,
+                max_jitter, now(), older_than, ahead, segment_by, index_name, tablespace, index_method)
+        RETURNING id INTO policy_id;
+    EXCEPTION
+        WHEN unique_violation THEN
+            RAISE EXCEPTION 'Hypertable % already has a % policy', hypertable, policy_type
+            USING ERRCODE = 'IO140';
+    END;
+
+    RETURN policy_id;
+END
+$BODY$;
+
+-- Drops chunks of the hypertable that are older than older_than.
+CREATE OR REPLACE FUNCTION add_retention_policy(
+    hypertable         REGCLASS,
+    older_than         INTERVAL,
+    schedule_interval  INTERVAL = '1 day',
+    max_jitter         INTERVAL = '0'
+)
+    RETURNS INTEGER LANGUAGE SQL VOLATILE AS
+$BODY$
+    SELECT _timescaledb_internal.add_policy(hypertable, 'retention', schedule_interval, max_jitter,
+                                            older_than => older_than);
+$BODY$;
+
+-- Compresses chunks of the hypertable that are older than older_than.
+CREATE OR REPLACE FUNCTION add_compression_policy(
+    hypertable         REGCLASS,
+    older_than         INTERVAL,
+    segment_by         NAME = NULL,
+    schedule_interval  INTERVAL = '1 day',
+    max_jitter         INTERVAL = '0'
+)
+    RETURNS INTEGER LANGUAGE SQL VOLATILE AS
+$BODY$
+    SELECT _timescaledb_internal.add_policy(hypertable, 'compression', schedule_interval, max_jitter,
+                                            older_than => older_than, segment_by => segment_by);
+$BODY$;
+
+-- Creates the chunks of the hypertable up to ahead into the future, so that
+-- inserts do not wait for chunk creation.
+CREATE OR REPLACE FUNCTION add_chunk_precreation_policy(
+    hypertable         REGCLASS,
+    ahead              INTERVAL,
+    schedule_interval  INTERVAL = '1 hour',
+    max_jitter         INTERVAL = '0'
+)
+    RETURNS INTEGER LANGUAGE SQL VOLATILE AS
+$BODY$
+    SELECT _timescaledb_internal.add_policy(hypertable, 'chunk_precreation', schedule_interval, max_jitter,
+                                            ahead => ahead);
+$BODY$;
+
+-- Gets the name of an index on a hypertable, for policies on the chunks'
+-- copies of the index.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.hypertable_index_name(
+    hypertable  REGCLASS,
+    index       REGCLASS
+)
+    RETURNS NAME LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+    index_name NAME;
+BEGIN
+    SELECT c.relname
+    INTO index_name
+    FROM pg_index i
+    INNER JOIN pg_class c ON (c.oid = i.indexrelid)
+    WHERE i.indexrelid = index AND i.indrelid = hypertable;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Index % is not an index on hypertable %', index, hypertable
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    RETURN index_name;
+END
+$BODY$;
+
+-- Reorders closed chunks of the hypertable by an index of the hypertable,
+-- like reorder_chunk(). Each chunk is reordered once.
+CREATE OR REPLACE FUNCTION add_reorder_policy(
+    hypertable         REGCLASS,
+    index              REGCLASS,
+    schedule_interval  INTERVAL = '1 day',
+    max_jitter         INTERVAL = '0'
+)
+    RETURNS INTEGER LANGUAGE SQL VOLATILE AS
+$BODY$
+    SELECT _timescaledb_internal.add_policy(hypertable, 'reorder', schedule_interval, max_jitter,
+                                            index_name => _timescaledb_internal.hypertable_index_name(hypertable, index));
+$BODY$;
+
+-- Moves chunks of the hypertable that are older than older_than to another
+-- tablespace, like move_chunk(), e.g., to keep old data on slower storage.
+CREATE OR REPLACE FUNCTION add_tiering_policy(
+    hypertable         REGCLASS,
+    older_than         INTERVAL,
+    tablespace         NAME,
+    schedule_interval  INTERVAL = '1 day',
+    max_jitter         INTERVAL = '0'
+)
+    RETURNS INTEGER LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+BEGIN
+    IF NOT EXISTS (SELECT 1 FROM pg_tablespace t WHERE t.spcname = tablespace) THEN
+        RAISE EXCEPTION 'No tablespace % in database %', tablespace, current_database()
+        USING ERRCODE = 'IO501';
+    END IF;
+
+    RETURN _timescaledb_internal.add_policy(hypertable, 'tiering', schedule_interval, max_jitter,
+                                            older_than => older_than, tablespace => tablespace);
+END
+$BODY$;
+
+-- Seals closed chunks of the hypertable that ended more than lag before the
+-- start of its newest chunk, like seal_chunk().
+CREATE OR REPLACE FUNCTION add_sealing_policy(
+    hypertable         REGCLASS,
+    lag                INTERVAL,
+    schedule_interval  INTERVAL = '1 hour',
+    max_jitter         INTERVAL = '0'
+)
+    RETURNS INTEGER LANGUAGE SQL VOLATILE AS
+$BODY$
+    SELECT _timescaledb_internal.add_policy(hypertable, 'sealing', schedule_interval, max_jitter,
+                                            older_than => lag);
+$BODY$;
+
+-- Refreshes a continuous aggregate, like refresh_continuous_aggregate(). The
+-- policy runs on the aggregate's materialization hypertable.
+CREATE OR REPLACE FUNCTION add_refresh_policy(
+    continuous_aggregate  REGCLASS,
+    schedule_interval     INTERVAL = '1 hour',
+    max_jitter            INTERVAL = '0'
+)
+    RETURNS INTEGER LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    agg_row _timescaledb_catalog.continuous_agg;
+BEGIN
+    agg_row := _timescaledb_internal.continuous_agg_for_view(continuous_aggregate);
+
+    RETURN _timescaledb_internal.add_policy(
+        (SELECT format('%I.%I', h.schema_name, h.table_name)::REGCLASS
+         FROM _timescaledb_catalog.hypertable h
+         WHERE h.id = agg_row.mat_hypertable_id),
+        'refresh', schedule_interval, max_jitter);
+END
+$BODY$;
+
+-- Rebuilds the chunks' copies of an index of the hypertable with another
+-- access method once the chunks are older than older_than, like
+-- set_chunk_index_method(). Newer chunks keep the hypertable's index.
+CREATE OR REPLACE FUNCTION add_index_policy(
+    hypertable         REGCLASS,
+    index              REGCLASS,
+    older_than         INTERVAL,
+    method             NAME = 'brin',
+    schedule_interval  INTERVAL = '1 day',
+    max_jitter         INTERVAL = '0'
+)
+    RETURNS INTEGER LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    index_name NAME;
+BEGIN
+    index_name := _timescaledb_internal.hypertable_index_name(hypertable, index);
+
+    IF NOT EXISTS (SELECT 1 FROM pg_am am WHERE am.amname = method AND am.amtype = 'i') THEN
+        RAISE EXCEPTION 'No index access method %', method
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    IF EXISTS (SELECT 1 FROM pg_index i WHERE i.indexrelid = index AND i.indisunique) THEN
+        RAISE EXCEPTION 'Cannot rebuild unique index % with access method %', index, method
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    RETURN _timescaledb_internal.add_policy(hypertable, 'index', schedule_interval, max_jitter,
+                                            older_than => older_than, index_name => index_name,
+                                            index_method => method);
+END
+$BODY$;
+
+CREATE OR REPLACE FUNCTION remove_policy(
+    policy_id INTEGER
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+BEGIN
+    DELETE FROM _timescaledb_catalog.bgw_policy p
+    WHERE p.id = remove_policy.policy_id;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Policy % does not exist', policy_id
+        USING ERRCODE = 'IO101';
+    END IF;
+END
+$BODY$;
+
+-- Changes the schedule of a policy. NULL arguments keep the current values.
+CREATE OR REPLACE FUNCTION alter_policy_schedule(
+    policy_id          INTEGER,
+    schedule_interval  INTERVAL = NULL,
+    max_jitter         INTERVAL = NULL,
+    next_start         TIMESTAMPTZ = NULL
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+BEGIN
+    UPDATE _timescaledb_catalog.bgw_policy p
+    SET schedule_interval = COALESCE(alter_policy_schedule.schedule_interval, p.schedule_interval),
+        max_jitter = COALESCE(alter_policy_schedule.max_jitter, p.max_jitter),
+        next_start = COALESCE(alter_policy_schedule.next_start, p.next_start)
+    WHERE p.id = alter_policy_schedule.policy_id;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Policy % does not exist', policy_id
+        USING ERRCODE = 'IO101';
+    END IF;
+END
+$BODY$;
+
+-- Gets a policy that the current user may run, i.e., one owned by a role
+-- that the user is a member of.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.policy_for_id(
+    policy_id INTEGER
+)
+    RETURNS _timescaledb_catalog.bgw_policy LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+    policy_row _timescaledb_catalog.bgw_policy;
+BEGIN
+    SELECT *
+    INTO policy_row
+    FROM _timescaledb_catalog.bgw_policy p
+    WHERE p.id = policy_for_id.policy_id;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Policy % does not exist', policy_id
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    IF NOT pg_has_role(current_user, policy_row.owner, 'MEMBER') THEN
+        RAISE EXCEPTION 'Must be a member of role % to run policy %', policy_row.owner, policy_id
+        USING ERRCODE = 'insufficient_privilege';
+    END IF;
+
+    RETURN policy_row;
+END
+$BODY$;
+
+-- Gets the chunks that a compression, reorder, tiering, sealing or index
+-- policy still has to process, oldest chunks first. chunk_index is the
+-- chunk's copy of the policy's index for reorder and index policies.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.policy_chunks(
+    policy_row _timescaledb_catalog.bgw_policy
+)
+    RETURNS TABLE(chunk REGCLASS, chunk_index REGCLASS) LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+    hypertable_row  _timescaledb_catalog.hypertable;
+    frontier        BIGINT;
+BEGIN
+    SELECT *
+    INTO STRICT hypertable_row
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = policy_row.hypertable_id;
+
+    CASE policy_row.policy_type
+    WHEN 'compression' THEN
+        RETURN QUERY
+        SELECT format('%I.%I', crn.schema_name, crn.table_name)::REGCLASS, NULL::REGCLASS
+        FROM _timescaledb_catalog.chunk c
+        INNER JOIN _timescaledb_catalog.chunk_replica_node crn ON (crn.chunk_id = c.id)
+        INNER JOIN _timescaledb_catalog.partition p ON (p.id = c.partition_id)
+        INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id)
+        WHERE pe.hypertable_id = hypertable_row.id
+        AND crn.database_name = current_database()
+        AND c.end_time < _timescaledb_internal.to_unix_microseconds(now() - policy_row.older_than)
+        AND NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_compression cc
+                        WHERE cc.chunk_id = c.id AND cc.database_name = crn.database_name)
+        AND NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_seal cs WHERE cs.chunk_id = c.id)
+        ORDER BY c.end_time, c.id;
+    WHEN 'reorder' THEN
+        --chunks that ended before now and were not reordered by the index yet
+        RETURN QUERY
+        SELECT format('%I.%I', crn.schema_name, crn.table_name)::REGCLASS,
+               format('%I.%I', crni.schema_name, crni.index_name)::REGCLASS
+        FROM _timescaledb_catalog.chunk c
+        INNER JOIN _timescaledb_catalog.chunk_replica_node crn ON (crn.chunk_id = c.id)
+        INNER JOIN _timescaledb_catalog.chunk_replica_node_index crni
+                   ON (crni.schema_name = crn.schema_name AND crni.table_name = crn.table_name)
+        INNER JOIN _timescaledb_catalog.partition p ON (p.id = c.partition_id)
+        INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id)
+        WHERE pe.hypertable_id = hypertable_row.id
+        AND crn.database_name = current_database()
+        AND crni.main_schema_name = hypertable_row.schema_name
+        AND crni.main_index_name = policy_row.index_name
+        AND c.end_time < _timescaledb_internal.to_unix_microseconds(now())
+        AND NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_compression cc
+                        WHERE cc.chunk_id = c.id AND cc.database_name = crn.database_name)
+        AND NOT EXISTS (SELECT 1 FROM pg_index i
+                        WHERE i.indexrelid = format('%I.%I', crni.schema_name, crni.index_name)::REGCLASS
+                        AND i.indisclustered)
+        --copies rebuilt by index policies cannot be clustered on
+        AND EXISTS (SELECT 1 FROM pg_class ic INNER JOIN pg_am am ON (am.oid = ic.relam)
+                    WHERE ic.oid = format('%I.%I', crni.schema_name, crni.index_name)::REGCLASS
+                    AND am.amname = 'btree')
+        ORDER BY c.end_time, c.id;
+    WHEN 'tiering' THEN
+        RETURN QUERY
+        SELECT format('%I.%I', crn.schema_name, crn.table_name)::REGCLASS, NULL::REGCLASS
+        FROM _timescaledb_catalog.chunk c
+        INNER JOIN _timescaledb_catalog.chunk_replica_node crn ON (crn.chunk_id = c.id)
+        INNER JOIN _timescaledb_catalog.partition p ON (p.id = c.partition_id)
+        INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id)
+        WHERE pe.hypertable_id = hypertable_row.id
+        AND crn.database_name = current_database()
+        AND c.end_time < _timescaledb_internal.to_unix_microseconds(now() - policy_row.older_than)
+        AND NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_tablespace ct
+                        WHERE ct.chunk_id = c.id AND ct.tablespace_name = policy_row.tablespace)
+        ORDER BY c.end_time, c.id;
+    WHEN 'sealing' THEN
+        --inserts go to the newest chunk
+        SELECT max(c.start_time)
+        INTO frontier
+        FROM _timescaledb_catalog.chunk c
+        INNER JOIN _timescaledb_catalog.partition p ON (p.id = c.partition_id)
+        INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id)
+        WHERE pe.hypertable_id = hypertable_row.id;
+
+        RETURN QUERY
+        SELECT format('%I.%I', crn.schema_name, crn.table_name)::REGCLASS, NULL::REGCLASS
+        FROM _timescaledb_catalog.chunk c
+        INNER JOIN _timescaledb_catalog.chunk_replica_node crn ON (crn.chunk_id = c.id)
+        INNER JOIN _timescaledb_catalog.partition p ON (p.id = c.partition_id)
+        INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id)
+        WHERE pe.hypertable_id = hypertable_row.id
+        AND crn.database_name = current_database()
+        AND c.end_time < frontier - _timescaledb_internal.interval_to_usec(policy_row.older_than)
+        AND NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_seal cs WHERE cs.chunk_id = c.id)
+        ORDER BY c.end_time, c.id;
+    WHEN 'index' THEN
+        RETURN QUERY
+        SELECT format('%I.%I', crn.schema_name, crn.table_name)::REGCLASS,
+               format('%I.%I', crni.schema_name, crni.index_name)::REGCLASS
+        FROM _timescaledb_catalog.chunk c
+        INNER JOIN _timescaledb_catalog.chunk_replica_node crn ON (crn.chunk_id = c.id)
+        INNER JOIN _timescaledb_catalog.chunk_replica_node_index crni
+                   ON (crni.schema_name = crn.schema_name AND crni.table_name = crn.table_name)
+        INNER JOIN _timescaledb_catalog.partition p ON (p.id = c.partition_id)
+        INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id)
+        WHERE pe.hypertable_id = hypertable_row.id
+        AND crn.database_name = current_database()
+        AND crni.main_schema_name = hypertable_row.schema_name
+        AND crni.main_index_name = policy_row.index_name
+        AND c.end_time < _timescaledb_internal.to_unix_microseconds(now() - policy_row.older_than)
+        AND NOT EXISTS (SELECT 1 FROM pg_class ic INNER JOIN pg_am am ON (am.oid = ic.relam)
+                        WHERE ic.oid = format('%I.%I', crni.schema_name, crni.index_name)::REGCLASS
+                        AND am.amname = policy_row.index_method)
+        ORDER BY c.end_time, c.id;
+    ELSE
+        RETURN;
+    END CASE;
+END
+$BODY$;
+
+-- Processes one chunk returned by policy_chunks().
+CREATE OR REPLACE FUNCTION _timescaledb_internal.run_policy_chunk(
+    policy_row   _timescaledb_catalog.bgw_policy,
+    chunk        REGCLASS,
+    chunk_index  REGCLASS
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+BEGIN
+    CASE policy_row.policy_type
+    WHEN 'compression' THEN
+        PERFORM compress_chunk(chunk, policy_row.segment_by);
+    WHEN 'reorder' THEN
+        PERFORM reorder_chunk(chunk, chunk_index);
+    WHEN 'tiering' THEN
+        PERFORM move_chunk(chunk, policy_row.tablespace);
+    WHEN 'sealing' THEN
+        PERFORM seal_chunk(chunk);
+    WHEN 'index' THEN
+        PERFORM set_chunk_index_method(chunk_index, policy_row.index_method);
+    END CASE;
+END
+$BODY$;
+
+-- Runs the parts of a policy that do not work chunk by chunk, i.e.,
+-- retention, chunk precreation and refresh policies.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.run_policy_whole(
+    policy_row _timescaledb_catalog.bgw_policy
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    hypertable_row  _timescaledb_catalog.hypertable;
+    now_internal    BIGINT;
+    time_point      BIGINT;
+BEGIN
+    SELECT *
+    INTO STRICT hypertable_row
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = policy_row.hypertable_id;
+
+    now_internal := _timescaledb_internal.to_unix_microseconds(now());
+
+    CASE policy_row.policy_type
+    WHEN 'retention' THEN
+        PERFORM drop_chunks(policy_row.older_than, hypertable_row.table_name, hypertable_row.schema_name);
+    WHEN 'chunk_precreation' THEN
+        --one point in each chunk interval, plus the end of the range
+        FOR time_point IN
+        SELECT generate_series(now_internal,
+                               _timescaledb_internal.to_unix_microseconds(now() + policy_row.ahead),
+                               hypertable_row.chunk_time_interval)
+        UNION
+        SELECT _timescaledb_internal.to_unix_microseconds(now() + policy_row.ahead)
+        LOOP
+            PERFORM get_or_create_chunk(p.id, time_point)
+            FROM _timescaledb_catalog.partition p
+            INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id)
+            WHERE pe.hypertable_id = hypertable_row.id
+            AND (pe.start_time IS NULL OR pe.start_time <= time_point)
+            AND (pe.end_time IS NULL OR pe.end_time >= time_point);
+        END LOOP;
+    WHEN 'refresh' THEN
+        PERFORM refresh_continuous_aggregate(format('%I.%I', ca.view_schema, ca.view_name)::REGCLASS)
+        FROM _timescaledb_catalog.continuous_agg ca
+        WHERE ca.mat_hypertable_id = hypertable_row.id;
+    ELSE
+        RETURN;
+    END CASE;
+END
+$BODY$;
+
+-- Runs a policy once, in the current transaction. The current user must be a
+-- member of the policy's owner.
+CREATE OR REPLACE FUNCTION run_policy(
+    policy_id INTEGER
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    policy_row   _timescaledb_catalog.bgw_policy;
+    chunk_table  REGCLASS;
+    chunk_index  REGCLASS;
+BEGIN
+    policy_row := _timescaledb_internal.policy_for_id(policy_id);
+
+    PERFORM _timescaledb_internal.run_policy_whole(policy_row);
+
+    FOR chunk_table, chunk_index IN
+    SELECT * FROM _timescaledb_internal.policy_chunks(policy_row)
+    LOOP
+        PERFORM _timescaledb_internal.run_policy_chunk(policy_row, chunk_table, chunk_index);
+    END LOOP;
+END
+$BODY$;
+
+-- Runs the next step of a policy: the whole policy if it does not work chunk
+-- by chunk, otherwise the oldest chunk it still has to process. Returns
+-- whether there may be more chunks to process. Background jobs call this in a
+-- transaction per step, so that the work done so far is kept if a later chunk
+-- fails and locks on processed chunks are released early.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.run_policy_next(
+    policy_id INTEGER
+)
+    RETURNS BOOLEAN LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    policy_row   _timescaledb_catalog.bgw_policy;
+    chunk_table  REGCLASS;
+    chunk_index  REGCLASS;
+BEGIN
+    policy_row := _timescaledb_internal.policy_for_id(policy_id);
+
+    IF policy_row.policy_type IN ('retention', 'chunk_precreation', 'refresh') THEN
+        PERFORM _timescaledb_internal.run_policy_whole(policy_row);
+        RETURN false;
+    END IF;
+
+    SELECT *
+    INTO chunk_table, chunk_index
+    FROM _timescaledb_internal.policy_chunks(policy_row)
+    LIMIT 1;
+
+    IF NOT FOUND THEN
+        RETURN false;
+    END IF;
+
+    PERFORM _timescaledb_internal.run_policy_chunk(policy_row, chunk_table, chunk_index);
+    RETURN true;
+END
+$BODY$;
+
+-- Records the start of a background job run. Returns the ID of the run.
+-- Jobs run as the policy's owner, who may not write the catalog, so this runs
+-- as the extension owner once the session user is known to own the policy.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.bgw_job_start(
+    policy_id INTEGER
+)
+    RETURNS INTEGER LANGUAGE PLPGSQL VOLATILE SECURITY DEFINER AS
+$BODY$
+DECLARE
+    run_id INTEGER;
+BEGIN
+    IF NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.bgw_policy p
+                   WHERE p.id = bgw_job_start.policy_id
+                   AND pg_catalog.pg_has_role(session_user, p.owner, 'MEMBER')) THEN
+        RAISE EXCEPTION 'Must be a member of the owner of policy % to record its runs', policy_id
+        USING ERRCODE = 'insufficient_privilege';
+    END IF;
+
+    INSERT INTO _timescaledb_catalog.bgw_job_run (policy_id, start_time)
+    VALUES (policy_id, pg_catalog.clock_timestamp())
+    RETURNING id INTO run_id;
+
+    RETURN run_id;
+END
+$BODY$;
+
+-- Records the end of a background job run and removes all but the 100 most
+-- recent runs of the policy. Runs as the extension owner, like
+-- bgw_job_start().
+CREATE OR REPLACE FUNCTION _timescaledb_internal.bgw_job_finish(
+    run_id     INTEGER,
+    succeeded  BOOLEAN,
+    message    TEXT
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE SECURITY DEFINER AS
+$BODY$
+DECLARE
+    run_row _timescaledb_catalog.bgw_job_run;
+BEGIN
+    IF EXISTS (SELECT 1 FROM _timescaledb_catalog.bgw_job_run r
+               INNER JOIN _timescaledb_catalog.bgw_policy p ON (p.id = r.policy_id)
+               WHERE r.id = run_id
+               AND NOT pg_catalog.pg_has_role(session_user, p.owner, 'MEMBER')) THEN
+        RAISE EXCEPTION 'Must be a member of the owner of the policy of run % to record it', run_id
+        USING ERRCODE = 'insufficient_privilege';
+    END IF;
+
+    UPDATE _timescaledb_catalog.bgw_job_run r
+    SET finish_time = pg_catalog.clock_timestamp(),
+        succeeded = bgw_job_finish.succeeded,
+        message = bgw_job_finish.message
+    WHERE r.id = run_id
+    RETURNING * INTO run_row;
+
+    --the policy was removed while the job ran
+    IF NOT FOUND THEN
+        RETURN;
+    END IF;
+
+    DELETE FROM _timescaledb_catalog.bgw_job_run r
+    WHERE r.policy_id = run_row.policy_id AND r.id <= (
+        SELECT old.id
+        FROM _timescaledb_catalog.bgw_job_run old
+        WHERE old.policy_id = run_row.policy_id
+        ORDER BY old.id DESC
+        OFFSET 100
+        LIMIT 1
+    );
+END
+$BODY$;
+
+-- Gets the policies that are due, in the order they should run, and sets
+-- their next start time, randomly delayed by up to max_jitter to spread out
+-- jobs with the same schedule. Called by the background job scheduler, which
+-- passes the policies whose jobs are still running and starts their jobs as
+-- the policies' owners. The owner is NULL if the role no longer exists.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.bgw_policies_due(
+    running    INTEGER[],
+    max_count  INTEGER
+)
+    RETURNS TABLE(id INTEGER, owner OID) LANGUAGE SQL VOLATILE AS
+$BODY$
+    UPDATE _timescaledb_catalog.bgw_policy p
+    SET next_start = now() + p.schedule_interval + random() * p.max_jitter
+    WHERE p.id IN (
+        SELECT due.id
+        FROM _timescaledb_catalog.bgw_policy due
+        WHERE due.next_start <= now() AND due.id <> ALL (running)
+        ORDER BY due.next_start, due.id
+        LIMIT max_count
+        FOR UPDATE SKIP LOCKED
+    )
+    RETURNING p.id, (SELECT r.oid FROM pg_roles r WHERE r.rolname = p.owner);
+$BODY$;
+
+-- Gets the time when the next policy is due, or NULL if there are no
+-- policies.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.bgw_next_start()
+    RETURNS TIMESTAMPTZ LANGUAGE SQL STABLE AS
+$BODY$
+    SELECT min(p.next_start) FROM _timescaledb_catalog.bgw_policy p;
+$BODY$;
+
+-- The runs of background jobs, most recent first.
+CREATE OR REPLACE VIEW policy_job_history AS
+SELECT r.policy_id,
+       p.policy_type,
+       h.schema_name AS hypertable_schema,
+       h.table_name AS hypertable_name,
+       r.start_time,
+       r.finish_time,
+       r.finish_time - r.start_time AS duration,
+       r.succeeded,
+       r.message
+FROM _timescaledb_catalog.bgw_job_run r
+INNER JOIN _timescaledb_catalog.bgw_policy p ON (p.id = r.policy_id)
+INNER JOIN _timescaledb_catalog.hypertable h ON (h.id = p.hypertable_id)
+ORDER BY r.start_time DESC, r.id DESC;
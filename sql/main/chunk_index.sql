@@ -0,0 +1,391 @@
+-- Rebuilds a closed chunk's copy of a hypertable index with another index
+-- access method, e.g., as a small BRIN index instead of a B-tree once the
+-- chunk no longer gets inserts. The new index is built before the old one is
+-- dropped, so queries on the chunk can use one of them throughout. Rebuilding
+-- with the access method of the hypertable's index restores the hypertable's
+-- definition. Returns the new index.
+CREATE OR REPLACE FUNCTION set_chunk_index_method(
+    chunk_index  REGCLASS,
+    method       NAME = 'brin'
+)
+    RETURNS REGCLASS LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    crni_row            _timescaledb_catalog.chunk_replica_node_index;
+    chunk_row           _timescaledb_catalog.chunk;
+    index_row           pg_index;
+    index_method        NAME;
+    index_tablespace    NAME;
+    main_method         NAME;
+    def                 TEXT;
+    default_tablespace  TEXT;
+    new_index_name      NAME;
+BEGIN
+    SELECT crni.*
+    INTO crni_row
+    FROM _timescaledb_catalog.chunk_replica_node_index crni
+    INNER JOIN pg_namespace n ON (n.nspname = crni.schema_name)
+    INNER JOIN pg_class c ON (c.relname = crni.index_name AND c.relnamespace = n.oid)
+    WHERE c.oid = chunk_index;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Index % is not an index on a chunk', chunk_index
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    IF NOT EXISTS (SELECT 1 FROM pg_am am WHERE am.amname = method AND am.amtype = 'i') THEN
+        RAISE EXCEPTION 'No index access method %', method
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    SELECT c.*
+    INTO STRICT chunk_row
+    FROM _timescaledb_catalog.chunk c
+    INNER JOIN _timescaledb_catalog.chunk_replica_node crn ON (crn.chunk_id = c.id)
+    WHERE crn.schema_name = crni_row.schema_name AND crn.table_name = crni_row.table_name;
+
+    IF chunk_row.end_time IS NULL THEN
+        RAISE EXCEPTION 'Cannot change index % since its chunk is not closed', chunk_index
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    SELECT i.*
+    INTO STRICT index_row
+    FROM pg_index i
+    WHERE i.indexrelid = chunk_index;
+
+    SELECT am.amname, t.spcname
+    INTO STRICT index_method, index_tablespace
+    FROM pg_class c
+    INNER JOIN pg_am am ON (am.oid = c.relam)
+    LEFT JOIN pg_tablespace t ON (t.oid = c.reltablespace)
+    WHERE c.oid = chunk_index;
+
+    IF index_method = method THEN
+        RETURN chunk_index;
+    END IF;
+
+    SELECT am.amname
+    INTO STRICT main_method
+    FROM pg_class c
+    INNER JOIN pg_namespace n ON (n.oid = c.relnamespace)
+    INNER JOIN pg_am am ON (am.oid = c.relam)
+    WHERE n.nspname = crni_row.main_schema_name AND c.relname = crni_row.main_index_name;
+
+    IF method = main_method THEN
+        SELECT hi.definition
+        INTO STRICT def
+        FROM _timescaledb_catalog.hypertable_index hi
+        WHERE hi.main_schema_name = crni_row.main_schema_name AND hi.main_index_name = crni_row.main_index_name;
+    ELSE
+        IF index_row.indisunique THEN
+            RAISE EXCEPTION 'Cannot rebuild unique index % with access method %', chunk_index, method
+            USING ERRCODE = 'IO101';
+        END IF;
+
+        --same columns and predicate, without the B-tree's sort options
+        SELECT format('CREATE INDEX /*INDEX_NAME*/ ON /*TABLE_NAME*/ USING %I (%s)', method,
+                      string_agg(pg_get_indexdef(chunk_index, k, true), ', ' ORDER BY k))
+        INTO STRICT def
+        FROM generate_series(1, index_row.indnatts) k;
+
+        IF index_row.indpred IS NOT NULL THEN
+            def := def || format(' WHERE (%s)', pg_get_expr(index_row.indpred, index_row.indrelid, true));
+        END IF;
+    END IF;
+
+    --the new index goes where the old one is
+    default_tablespace := current_setting('default_tablespace');
+    PERFORM set_config('default_tablespace', COALESCE(index_tablespace, ''), true);
+
+    new_index_name := _timescaledb_internal.create_chunk_replica_node_index(crni_row.schema_name, crni_row.table_name,
+                                                                            crni_row.main_schema_name,
+                                                                            crni_row.main_index_name, def);
+
+    PERFORM set_config('default_tablespace', default_tablespace, true);
+
+    DELETE FROM _timescaledb_catalog.chunk_replica_node_index crni
+    WHERE crni.schema_name = crni_row.schema_name AND crni.table_name = crni_row.table_name AND
+          crni.index_name = crni_row.index_name;
+
+    RETURN format('%I.%I', crni_row.schema_name, new_index_name)::REGCLASS;
+END
+$BODY$;
+
+-- Gets the catalog row of an index on a hypertable.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.hypertable_index_for_index(
+    index  REGCLASS
+)
+    RETURNS _timescaledb_catalog.hypertable_index LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+    hypertable_index_row _timescaledb_catalog.hypertable_index;
+BEGIN
+    SELECT hi.*
+    INTO hypertable_index_row
+    FROM _timescaledb_catalog.hypertable_index hi
+    INNER JOIN pg_namespace n ON (n.nspname = hi.main_schema_name)
+    INNER JOIN pg_class c ON (c.relname = hi.main_index_name AND c.relnamespace = n.oid)
+    WHERE c.oid = index;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Index % is not an index on a hypertable', index
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    RETURN hypertable_index_row;
+END
+$BODY$;
+
+-- The local chunks of each hypertable index and how many of them have a copy
+-- of the index, e.g., to follow build_chunk_indexes().
+CREATE OR REPLACE VIEW chunk_index_progress AS
+SELECT hi.main_schema_name AS index_schema,
+       hi.main_index_name AS index_name,
+       h.schema_name AS hypertable_schema,
+       h.table_name AS hypertable_name,
+       count(crn.chunk_id) AS chunks,
+       count(crni.index_name) AS chunks_done
+FROM _timescaledb_catalog.hypertable_index hi
+INNER JOIN _timescaledb_catalog.hypertable h ON (h.id = hi.hypertable_id)
+INNER JOIN _timescaledb_catalog.partition_replica pr ON (pr.hypertable_id = h.id)
+LEFT JOIN _timescaledb_catalog.chunk_replica_node crn
+          ON (crn.partition_replica_id = pr.id AND crn.database_name = current_database())
+LEFT JOIN _timescaledb_catalog.chunk_replica_node_index crni
+          ON (crni.schema_name = crn.schema_name AND crni.table_name = crn.table_name AND
+              crni.main_schema_name = hi.main_schema_name AND crni.main_index_name = hi.main_index_name)
+GROUP BY hi.main_schema_name, hi.main_index_name, h.schema_name, h.table_name;
+
+-- Counts the local chunks that lack a copy of a hypertable index.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.chunks_without_index(
+    hypertable_index_row  _timescaledb_catalog.hypertable_index
+)
+    RETURNS INTEGER LANGUAGE SQL STABLE AS
+$BODY$
+    SELECT count(*)::INTEGER
+    FROM _timescaledb_catalog.partition_replica pr
+    INNER JOIN _timescaledb_catalog.chunk_replica_node crn ON (crn.partition_replica_id = pr.id)
+    WHERE pr.hypertable_id = hypertable_index_row.hypertable_id
+    AND crn.database_name = current_database()
+    AND NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_replica_node_index crni
+                    WHERE crni.schema_name = crn.schema_name AND crni.table_name = crn.table_name
+                    AND crni.main_schema_name = hypertable_index_row.main_schema_name
+                    AND crni.main_index_name = hypertable_index_row.main_index_name);
+$BODY$;
+
+-- Claims the newest local chunk that lacks a copy of a hypertable index for a
+-- build worker of build_chunk_indexes(), with an advisory lock on the chunk
+-- and index that other workers skip. The lock is held until the end of the
+-- transaction, or of the session for concurrent builds. Returns NULL when all
+-- chunks have the index or are claimed.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.chunk_index_build_claim(
+    hypertable_index_row  _timescaledb_catalog.hypertable_index,
+    session_lock          BOOLEAN
+)
+    RETURNS _timescaledb_catalog.chunk_replica_node LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    crn_row   _timescaledb_catalog.chunk_replica_node;
+    lock_key  INTEGER;
+    locked    BOOLEAN;
+BEGIN
+    lock_key := hashtext(format('%I.%I', hypertable_index_row.main_schema_name, hypertable_index_row.main_index_name));
+
+    FOR crn_row IN
+    SELECT crn.*
+    FROM _timescaledb_catalog.partition_replica pr
+    INNER JOIN _timescaledb_catalog.chunk_replica_node crn ON (crn.partition_replica_id = pr.id)
+    WHERE pr.hypertable_id = hypertable_index_row.hypertable_id
+    AND crn.database_name = current_database()
+    AND NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_replica_node_index crni
+                    WHERE crni.schema_name = crn.schema_name AND crni.table_name = crn.table_name
+                    AND crni.main_schema_name = hypertable_index_row.main_schema_name
+                    AND crni.main_index_name = hypertable_index_row.main_index_name)
+    ORDER BY crn.chunk_id DESC
+    LOOP
+        IF session_lock THEN
+            locked := pg_try_advisory_lock(lock_key, crn_row.chunk_id);
+        ELSE
+            locked := pg_try_advisory_xact_lock(lock_key, crn_row.chunk_id);
+        END IF;
+
+        --another worker may have built the index since the chunks were looked up
+        IF locked AND NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_replica_node_index crni
+                                  WHERE crni.schema_name = crn_row.schema_name AND crni.table_name = crn_row.table_name
+                                  AND crni.main_schema_name = hypertable_index_row.main_schema_name
+                                  AND crni.main_index_name = hypertable_index_row.main_index_name) THEN
+            RETURN crn_row;
+        END IF;
+
+        IF locked AND session_lock THEN
+            PERFORM pg_advisory_unlock(lock_key, crn_row.chunk_id);
+        END IF;
+    END LOOP;
+
+    RETURN NULL;
+END
+$BODY$;
+
+-- Builds a hypertable index on the next chunk that lacks it in the current
+-- transaction. Returns the chunk, or NULL when there is none. Called by the
+-- build workers of build_chunk_indexes().
+CREATE OR REPLACE FUNCTION _timescaledb_internal.chunk_index_build_next(
+    index  REGCLASS
+)
+    RETURNS REGCLASS LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    hypertable_index_row  _timescaledb_catalog.hypertable_index;
+    crn_row               _timescaledb_catalog.chunk_replica_node;
+BEGIN
+    hypertable_index_row := _timescaledb_internal.hypertable_index_for_index(index);
+    crn_row := _timescaledb_internal.chunk_index_build_claim(hypertable_index_row, false);
+
+    IF crn_row IS NULL THEN
+        RETURN NULL;
+    END IF;
+
+    PERFORM _timescaledb_internal.create_chunk_replica_node_index(crn_row.schema_name, crn_row.table_name,
+                                                                  hypertable_index_row.main_schema_name,
+                                                                  hypertable_index_row.main_index_name,
+                                                                  hypertable_index_row.definition);
+
+    RETURN format('%I.%I', crn_row.schema_name, crn_row.table_name)::REGCLASS;
+END
+$BODY$;
+
+-- Claims the next chunk that lacks a hypertable index for a build worker
+-- that builds concurrently. Returns the catalog row of the chunk's index to
+-- be, with the CREATE INDEX CONCURRENTLY statement that builds it as its
+-- definition, or NULL when there is no chunk left. The worker records the
+-- index and releases the chunk with chunk_index_build_finish().
+CREATE OR REPLACE FUNCTION _timescaledb_internal.chunk_index_build_claim_concurrently(
+    index  REGCLASS
+)
+    RETURNS _timescaledb_catalog.chunk_replica_node_index LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    hypertable_index_row  _timescaledb_catalog.hypertable_index;
+    crn_row               _timescaledb_catalog.chunk_replica_node;
+    crni_row              _timescaledb_catalog.chunk_replica_node_index;
+BEGIN
+    hypertable_index_row := _timescaledb_internal.hypertable_index_for_index(index);
+    crn_row := _timescaledb_internal.chunk_index_build_claim(hypertable_index_row, true);
+
+    IF crn_row IS NULL THEN
+        RETURN NULL;
+    END IF;
+
+    --named like in create_chunk_replica_node_index()
+    crni_row.schema_name := crn_row.schema_name;
+    crni_row.table_name := crn_row.table_name;
+    crni_row.index_name := format('%s-%s', nextval('_timescaledb_catalog.chunk_replica_node_index_name_prefix'),
+                                  hypertable_index_row.main_index_name);
+    crni_row.main_schema_name := hypertable_index_row.main_schema_name;
+    crni_row.main_index_name := hypertable_index_row.main_index_name;
+    crni_row.definition := regexp_replace(
+        _timescaledb_internal.get_index_definition_for_table(crn_row.schema_name, crn_row.table_name,
+                                                             crni_row.index_name, hypertable_index_row.definition),
+        '^CREATE (UNIQUE )?INDEX', 'CREATE \1INDEX CONCURRENTLY');
+
+    RETURN crni_row;
+END
+$BODY$;
+
+-- Records the index that a build worker built concurrently on a chunk, or
+-- drops what a failed build left of it, and releases the chunk once the
+-- transaction commits.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.chunk_index_build_finish(
+    index        REGCLASS,
+    schema_name  NAME,
+    table_name   NAME,
+    index_name   NAME,
+    succeeded    BOOLEAN
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    hypertable_index_row  _timescaledb_catalog.hypertable_index;
+    lock_key              INTEGER;
+    claimed_chunk_id      INTEGER;
+BEGIN
+    hypertable_index_row := _timescaledb_internal.hypertable_index_for_index(index);
+
+    IF succeeded THEN
+        --the trigger does not create the index again
+        INSERT INTO _timescaledb_catalog.chunk_replica_node_index (schema_name, table_name, index_name, main_schema_name, main_index_name, definition)
+        VALUES (schema_name, table_name, index_name, hypertable_index_row.main_schema_name, hypertable_index_row.main_index_name,
+                _timescaledb_internal.get_index_definition_for_table(schema_name, table_name, index_name,
+                                                                     hypertable_index_row.definition));
+    ELSE
+        EXECUTE format('DROP INDEX IF EXISTS %I.%I', schema_name, index_name);
+    END IF;
+
+    SELECT crn.chunk_id
+    INTO STRICT claimed_chunk_id
+    FROM _timescaledb_catalog.chunk_replica_node crn
+    WHERE crn.schema_name = chunk_index_build_finish.schema_name AND
+          crn.table_name = chunk_index_build_finish.table_name AND
+          crn.database_name = current_database();
+
+    --other workers see the index before they can claim the chunk
+    lock_key := hashtext(format('%I.%I', hypertable_index_row.main_schema_name, hypertable_index_row.main_index_name));
+    PERFORM pg_advisory_xact_lock(lock_key, claimed_chunk_id);
+    PERFORM pg_advisory_unlock(lock_key, claimed_chunk_id);
+END
+$BODY$;
+
+CREATE OR REPLACE FUNCTION _timescaledb_internal.chunk_index_build_start(
+    index         REGCLASS,
+    workers       INTEGER,
+    concurrently  BOOLEAN
+)
+    RETURNS INTEGER AS '$libdir/timescaledb', 'chunk_index_build_start' LANGUAGE C VOLATILE;
+
+-- Builds a hypertable index on the local chunks that lack it, e.g., after
+-- creating it with timescaledb.defer_chunk_indexes, in background workers
+-- that build one chunk at a time, newest first, and commit each chunk. Waits
+-- for the workers, unless they build concurrently, since CREATE INDEX
+-- CONCURRENTLY waits for older transactions, including this one. Returns the
+-- number of chunks that lacked the index.
+CREATE OR REPLACE FUNCTION build_chunk_indexes(
+    index         REGCLASS,
+    workers       INTEGER = 2,
+    concurrently  BOOLEAN = false
+)
+    RETURNS INTEGER LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    hypertable_index_row  _timescaledb_catalog.hypertable_index;
+    chunks                INTEGER;
+    failed_chunks         INTEGER;
+BEGIN
+    hypertable_index_row := _timescaledb_internal.hypertable_index_for_index(index);
+
+    IF workers IS NULL OR workers < 1 THEN
+        RAISE EXCEPTION 'Invalid number of workers %', workers
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    chunks := _timescaledb_internal.chunks_without_index(hypertable_index_row);
+
+    IF chunks = 0 THEN
+        RETURN 0;
+    END IF;
+
+    PERFORM _timescaledb_internal.chunk_index_build_start(index, LEAST(workers, chunks), concurrently);
+
+    IF NOT concurrently THEN
+        --the workers committed what they built
+        failed_chunks := _timescaledb_internal.chunks_without_index(hypertable_index_row);
+
+        IF failed_chunks > 0 THEN
+            RAISE EXCEPTION 'Could not build index % on % chunks', index, failed_chunks
+            USING ERRCODE = 'IO500',
+            HINT = 'The errors of the build workers are in the server log.';
+        END IF;
+    END IF;
+
+    RETURN chunks;
+END
+$BODY$;
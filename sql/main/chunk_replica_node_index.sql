@@ -1,5 +1,5 @@
 /*
-  creates an index on a chunk replica node.
+  creates an index on a chunk replica node. Returns the name of the index.
 */
 CREATE OR REPLACE FUNCTION _timescaledb_internal.create_chunk_replica_node_index(
     schema_name NAME,
@@ -8,7 +8,7 @@ CREATE OR REPLACE FUNCTION _timescaledb_internal.create_chunk_replica_node_index
     main_index_name NAME,
     def TEXT
 )
-    RETURNS VOID LANGUAGE PLPGSQL AS
+    RETURNS NAME LANGUAGE PLPGSQL AS
 $BODY$
 DECLARE
     index_name NAME;
@@ -22,5 +22,7 @@ BEGIN
 
     INSERT INTO _timescaledb_catalog.chunk_replica_node_index (schema_name, table_name, index_name, main_schema_name, main_index_name, definition)
     VALUES (schema_name, table_name, index_name,main_schema_name, main_index_name, sql_code);
+
+    RETURN index_name;
 END
 $BODY$;
@@ -7,7 +7,10 @@ $BODY$
 DECLARE
 BEGIN
     IF TG_OP = 'INSERT' THEN
-        EXECUTE NEW.definition;
+        --indexes built concurrently exist already (see build_chunk_indexes())
+        IF to_regclass(format('%I.%I', NEW.schema_name, NEW.index_name)) IS NULL THEN
+            EXECUTE NEW.definition;
+        END IF;
         RETURN NEW;
     ELSIF TG_OP = 'DELETE' THEN
         EXECUTE format('DROP INDEX IF EXISTS %I.%I', OLD.schema_name, OLD.index_name);
@@ -7,6 +7,8 @@ DECLARE
     partition             _timescaledb_catalog.partition;
     chunk_row             _timescaledb_catalog.chunk;
     kind                  pg_class.relkind%type;
+    new_tablespace        NAME;
+    default_tablespace    TEXT;
 BEGIN
     IF TG_OP = 'INSERT' THEN
         SELECT *
@@ -25,15 +27,38 @@ BEGIN
         WHERE c.id = NEW.chunk_id;
 
         IF NEW.database_name = current_database() THEN
+            --chunks of hypertables with tablespaces are placed round-robin,
+            --with their indexes
+            new_tablespace := _timescaledb_internal.next_chunk_tablespace(partition_replica_row.hypertable_id);
+            default_tablespace := current_setting('default_tablespace');
+
+            IF new_tablespace IS NOT NULL THEN
+                PERFORM set_config('default_tablespace', new_tablespace, true);
+            ELSE
+                new_tablespace := partition.tablespace;
+            END IF;
+
             PERFORM _timescaledb_internal.create_local_data_table(NEW.schema_name, NEW.table_name,
                                                          partition_replica_row.schema_name,
                                                          partition_replica_row.table_name,
-                                                         partition.tablespace);
+                                                         new_tablespace);
 
             PERFORM _timescaledb_internal.create_chunk_replica_node_index(NEW.schema_name, NEW.table_name,
                                     h.main_schema_name, h.main_index_name, h.definition)
             FROM _timescaledb_catalog.hypertable_index h
             WHERE h.hypertable_id = partition_replica_row.hypertable_id;
+
+            PERFORM set_config('default_tablespace', default_tablespace, true);
+
+            INSERT INTO _timescaledb_catalog.chunk_tablespace (chunk_id, hypertable_id, tablespace_name)
+            VALUES (NEW.chunk_id, partition_replica_row.hypertable_id, new_tablespace);
+
+            --the new chunk is empty, so its zone maps only need to be widened
+            --by inserts
+            INSERT INTO _timescaledb_catalog.chunk_zone_map (chunk_id, hypertable_id, column_name, null_count)
+            SELECT NEW.chunk_id, z.hypertable_id, z.column_name, 0
+            FROM _timescaledb_catalog.hypertable_zone_map_column z
+            WHERE z.hypertable_id = partition_replica_row.hypertable_id;
         ELSE
             PERFORM _timescaledb_internal.create_remote_table(NEW.schema_name, NEW.table_name,
                                                      partition_replica_row.schema_name, partition_replica_row.table_name,
@@ -0,0 +1,190 @@
+CREATE OR REPLACE FUNCTION _timescaledb_internal.compress_chunk_data(
+    chunk        REGCLASS,
+    compressed   REGCLASS,
+    segment_by   NAME,
+    time_column  NAME
+)
+    RETURNS BIGINT AS '$libdir/timescaledb', 'compress_chunk_data' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_internal.decompress_chunk_data(
+    chunk        REGCLASS,
+    compressed   REGCLASS
+)
+    RETURNS BIGINT AS '$libdir/timescaledb', 'decompress_chunk_data' LANGUAGE C VOLATILE STRICT;
+
+-- Gets the chunk_replica_node row of a chunk table on this node.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.chunk_replica_node_for_table(
+    chunk REGCLASS
+)
+    RETURNS _timescaledb_catalog.chunk_replica_node LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+    crn_row _timescaledb_catalog.chunk_replica_node;
+BEGIN
+    SELECT crn.*
+    INTO crn_row
+    FROM _timescaledb_catalog.chunk_replica_node crn
+    INNER JOIN pg_namespace n ON (n.nspname = crn.schema_name)
+    INNER JOIN pg_class c ON (c.relname = crn.table_name AND c.relnamespace = n.oid)
+    WHERE c.oid = chunk AND crn.database_name = current_database();
+
+    IF crn_row IS NULL THEN
+        RAISE EXCEPTION 'Table % is not a chunk', chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    RETURN crn_row;
+END
+$BODY$;
+
+-- Compresses the rows of a closed chunk into a companion table with one row
+-- per group of up to 1000 rows, optionally grouped by a segment_by column.
+-- Writes to the chunk are blocked while its rows are compressed. The chunk is
+-- then emptied with TRUNCATE, which holds an ACCESS EXCLUSIVE lock on the
+-- chunk until the calling transaction commits, so also reads of the chunk and
+-- of its hypertable wait for the end of that transaction.
+CREATE OR REPLACE FUNCTION compress_chunk(
+    chunk       REGCLASS,
+    segment_by  NAME = NULL
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    crn_row            _timescaledb_catalog.chunk_replica_node;
+    chunk_row          _timescaledb_catalog.chunk;
+    time_column_name   NAME;
+    compressed_name    NAME;
+    column_defs        TEXT;
+    uncompressed_rows  BIGINT;
+    uncompressed_bytes BIGINT;
+BEGIN
+    crn_row := _timescaledb_internal.chunk_replica_node_for_table(chunk);
+
+    SELECT *
+    INTO STRICT chunk_row
+    FROM _timescaledb_catalog.chunk c
+    WHERE c.id = crn_row.chunk_id;
+
+    IF chunk_row.end_time IS NULL THEN
+        RAISE EXCEPTION 'Cannot compress chunk % since it is not closed', chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    IF EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_compression cc
+               WHERE cc.chunk_id = crn_row.chunk_id AND cc.database_name = crn_row.database_name) THEN
+        RAISE EXCEPTION 'Chunk % is already compressed', chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    IF _timescaledb_internal.chunk_is_sealed(crn_row.chunk_id) THEN
+        RAISE EXCEPTION 'Cannot compress chunk % since it is sealed', chunk
+        USING ERRCODE = 'IO150';
+    END IF;
+
+    SELECT h.time_column_name
+    INTO STRICT time_column_name
+    FROM _timescaledb_catalog.partition_replica pr
+    INNER JOIN _timescaledb_catalog.hypertable h ON (h.id = pr.hypertable_id)
+    WHERE pr.id = crn_row.partition_replica_id;
+
+    IF segment_by IS NOT NULL AND NOT EXISTS (
+        SELECT 1 FROM pg_attribute a
+        WHERE a.attrelid = chunk AND a.attname = segment_by AND a.attnum > 0
+        AND NOT a.attisdropped AND a.atttypid <> 'bytea'::regtype) THEN
+        RAISE EXCEPTION 'Cannot segment chunk % by column %', chunk, segment_by
+        USING ERRCODE = 'IO101',
+        HINT = 'The segment_by column must exist and cannot be of type bytea.';
+    END IF;
+
+    --block writes to the chunk while its rows move
+    EXECUTE format('LOCK TABLE %s IN EXCLUSIVE MODE', chunk);
+
+    --the segment_by column keeps its type, all other columns hold compressed
+    --values of many rows
+    SELECT string_agg(format('%I %s', a.attname,
+                             CASE WHEN a.attname = segment_by
+                                  THEN format_type(a.atttypid, a.atttypmod)
+                                  ELSE 'BYTEA' END), ', ' ORDER BY a.attnum)
+    INTO column_defs
+    FROM pg_attribute a
+    WHERE a.attrelid = chunk AND a.attnum > 0 AND NOT a.attisdropped;
+
+    compressed_name := format('_compressed_chunk_%s', crn_row.chunk_id);
+
+    EXECUTE format('CREATE TABLE %I.%I (_ts_count INT NOT NULL, %s)',
+                   crn_row.schema_name, compressed_name, column_defs);
+
+    uncompressed_bytes := pg_total_relation_size(chunk);
+    uncompressed_rows := _timescaledb_internal.compress_chunk_data(
+        chunk, format('%I.%I', crn_row.schema_name, compressed_name)::REGCLASS,
+        segment_by, time_column_name);
+
+    --takes an ACCESS EXCLUSIVE lock on the chunk until commit
+    EXECUTE format('TRUNCATE %s', chunk);
+
+    INSERT INTO _timescaledb_catalog.chunk_compression
+    VALUES (crn_row.chunk_id, crn_row.database_name, crn_row.schema_name, compressed_name, segment_by,
+            uncompressed_rows, uncompressed_bytes,
+            pg_total_relation_size(format('%I.%I', crn_row.schema_name, compressed_name)::REGCLASS));
+END
+$BODY$;
+
+-- Moves the rows of a compressed chunk back into the chunk table.
+CREATE OR REPLACE FUNCTION decompress_chunk(
+    chunk REGCLASS
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    crn_row          _timescaledb_catalog.chunk_replica_node;
+    compression_row  _timescaledb_catalog.chunk_compression;
+BEGIN
+    crn_row := _timescaledb_internal.chunk_replica_node_for_table(chunk);
+
+    SELECT *
+    INTO compression_row
+    FROM _timescaledb_catalog.chunk_compression cc
+    WHERE cc.chunk_id = crn_row.chunk_id AND cc.database_name = crn_row.database_name;
+
+    IF compression_row IS NULL THEN
+        RAISE EXCEPTION 'Chunk % is not compressed', chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    IF _timescaledb_internal.chunk_is_sealed(crn_row.chunk_id) THEN
+        RAISE EXCEPTION 'Cannot decompress chunk % since it is sealed', chunk
+        USING ERRCODE = 'IO150';
+    END IF;
+
+    EXECUTE format('LOCK TABLE %s IN EXCLUSIVE MODE', chunk);
+
+    PERFORM _timescaledb_internal.decompress_chunk_data(
+        chunk, format('%I.%I', compression_row.compressed_schema_name,
+                      compression_row.compressed_table_name)::REGCLASS);
+
+    --drops the compressed table
+    DELETE FROM _timescaledb_catalog.chunk_compression cc
+    WHERE cc.chunk_id = compression_row.chunk_id AND cc.database_name = compression_row.database_name;
+END
+$BODY$;
+
+-- Drops the compressed table of a chunk when the chunk is decompressed or
+-- dropped.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.on_change_chunk_compression()
+    RETURNS TRIGGER LANGUAGE PLPGSQL AS
+$BODY$
+BEGIN
+    IF TG_OP = 'DELETE' THEN
+        IF OLD.database_name = current_database() THEN
+            EXECUTE format(
+                $$
+                DROP TABLE IF EXISTS %I.%I
+                $$, OLD.compressed_schema_name, OLD.compressed_table_name
+            );
+        END IF;
+        RETURN OLD;
+    END IF;
+
+    PERFORM _timescaledb_internal.on_trigger_error(TG_OP, TG_TABLE_SCHEMA, TG_TABLE_NAME);
+END
+$BODY$;
@@ -0,0 +1,371 @@
+-- Continuous aggregates are aggregates of a hypertable by time_bucket() that
+-- are materialized into a hypertable of their own and refreshed
+-- incrementally. A continuous aggregate is queried through its view, which
+-- combines the materialized buckets below the aggregate's watermark with the
+-- buckets above it, aggregated from the raw data at query time.
+--
+-- A refresh materializes the buckets between the watermark and the bucket of
+-- the newest raw data, which becomes the new watermark, and recomputes the
+-- materialized buckets that inserts below the watermark changed since the
+-- last refresh. Inserts through the hypertable log those changes (see
+-- src/continuous_agg.c); updates and deletes of the raw data, including
+-- dropped chunks, leave the materialized buckets as they are.
+--
+-- The aggregates are pasted into the queries that create and refresh a
+-- continuous aggregate, so they are checked to be a select list when it is
+-- created, and only the owner of the continuous aggregate may refresh it.
+
+CREATE OR REPLACE FUNCTION _timescaledb_internal.continuous_agg_check_aggregates(
+    aggregates TEXT
+)
+    RETURNS VOID AS '$libdir/timescaledb', 'continuous_agg_check_aggregates' LANGUAGE C IMMUTABLE STRICT;
+
+-- Gets the watermark of a continuous aggregate, in the internal time
+-- representation.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.continuous_agg_watermark(
+    continuous_agg_id INTEGER
+)
+    RETURNS BIGINT LANGUAGE SQL STABLE AS
+$BODY$
+    SELECT ca.watermark
+    FROM _timescaledb_catalog.continuous_agg ca
+    WHERE ca.id = continuous_agg_id;
+$BODY$;
+
+-- Gets the sql code of the query that aggregates the raw data of a continuous
+-- aggregate that matches the time condition.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.continuous_agg_query_sql(
+    agg_row         _timescaledb_catalog.continuous_agg,
+    time_condition  TEXT
+)
+    RETURNS TEXT LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+    raw_row _timescaledb_catalog.hypertable;
+BEGIN
+    SELECT *
+    INTO STRICT raw_row
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = agg_row.raw_hypertable_id;
+
+    RETURN format('SELECT %s AS %I%s, %s FROM %I.%I WHERE %s GROUP BY %s',
+        _timescaledb_internal.time_bucket_sql(agg_row.bucket_width, quote_ident(raw_row.time_column_name),
+                                              raw_row.time_column_type),
+        raw_row.time_column_name,
+        (SELECT string_agg(format(', %I', g), '') FROM unnest(agg_row.group_by) g),
+        agg_row.aggregates,
+        raw_row.schema_name, raw_row.table_name,
+        time_condition,
+        (SELECT string_agg(n::TEXT, ', ') FROM generate_series(1, cardinality(agg_row.group_by) + 1) n));
+END
+$BODY$;
+
+-- Replaces the materialized buckets of a continuous aggregate from
+-- range_start to range_end (exclusive), both bucket starts in the internal
+-- time representation, with the buckets aggregated from the raw data.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.continuous_agg_materialize(
+    agg_row      _timescaledb_catalog.continuous_agg,
+    range_start  BIGINT,
+    range_end    BIGINT
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    raw_row       _timescaledb_catalog.hypertable;
+    mat_row       _timescaledb_catalog.hypertable;
+    start_sql     TEXT;
+    end_sql       TEXT;
+BEGIN
+    SELECT *
+    INTO STRICT raw_row
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = agg_row.raw_hypertable_id;
+
+    SELECT *
+    INTO STRICT mat_row
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = agg_row.mat_hypertable_id;
+
+    --literals, so that chunks outside the range are excluded
+    start_sql := _timescaledb_internal.time_literal_sql(range_start, raw_row.time_column_type);
+    end_sql := _timescaledb_internal.time_literal_sql(range_end, raw_row.time_column_type);
+
+    EXECUTE format('DELETE FROM %I.%I WHERE %3$I >= %4$s AND %3$I < %5$s',
+        mat_row.schema_name, mat_row.table_name, mat_row.time_column_name, start_sql, end_sql);
+
+    EXECUTE format('INSERT INTO %I.%I %s', mat_row.schema_name, mat_row.table_name,
+        _timescaledb_internal.continuous_agg_query_sql(agg_row,
+            format('%1$I >= %2$s AND %1$I < %3$s', raw_row.time_column_name, start_sql, end_sql)));
+END
+$BODY$;
+
+-- Creates a continuous aggregate of a hypertable, queried through the view
+-- view_name, with a column of the time_bucket() of the hypertable's time
+-- column, named like that column, the group_by columns and the aggregates.
+-- The bucket width is in the internal time representation (microseconds for
+-- TIMESTAMP and TIMESTAMPTZ time columns). The buckets of the existing data
+-- are materialized right away.
+CREATE OR REPLACE FUNCTION create_continuous_aggregate(
+    view_name     NAME,
+    hypertable    REGCLASS,
+    bucket_width  BIGINT,
+    aggregates    TEXT,
+    group_by      NAME[] = '{}',
+    view_schema   NAME = NULL
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    hypertable_row  _timescaledb_catalog.hypertable;
+    agg_row         _timescaledb_catalog.continuous_agg;
+    mat_table       REGCLASS;
+    mat_table_name  NAME;
+    oldest          BIGINT;
+    watermark_sql   TEXT;
+BEGIN
+    SELECT *
+    INTO STRICT hypertable_row
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = _timescaledb_internal.hypertable_id_for_table(hypertable);
+
+    IF bucket_width <= 0 THEN
+        RAISE EXCEPTION 'Invalid bucket width % for continuous aggregate %', bucket_width, view_name
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    PERFORM _timescaledb_internal.continuous_agg_check_aggregates(aggregates);
+
+    agg_row.view_schema := COALESCE(view_schema, current_schema());
+
+    IF EXISTS (SELECT 1 FROM _timescaledb_catalog.continuous_agg ca
+               WHERE ca.view_schema = agg_row.view_schema AND ca.view_name = create_continuous_aggregate.view_name) THEN
+        RAISE EXCEPTION 'Continuous aggregate %.% already exists', agg_row.view_schema, view_name
+        USING ERRCODE = 'IO110';
+    END IF;
+
+    agg_row.id := nextval(pg_get_serial_sequence('_timescaledb_catalog.continuous_agg', 'id'));
+    agg_row.view_name := view_name;
+    agg_row.raw_hypertable_id := hypertable_row.id;
+    agg_row.bucket_width := bucket_width;
+    agg_row.group_by := group_by;
+    agg_row.aggregates := aggregates;
+
+    --an empty materialization hypertable with the columns of the view
+    mat_table_name := format('_materialized_hypertable_%s', agg_row.id);
+    EXECUTE format('CREATE TABLE %I.%I AS %s WITH NO DATA', '_timescaledb_internal', mat_table_name,
+        _timescaledb_internal.continuous_agg_query_sql(agg_row, 'false'));
+    mat_table := format('%I.%I', '_timescaledb_internal', mat_table_name)::REGCLASS;
+    EXECUTE format('CREATE INDEX ON %s (%I)', mat_table, hypertable_row.time_column_name);
+    PERFORM create_hypertable(mat_table, hypertable_row.time_column_name,
+                              chunk_time_interval => hypertable_row.chunk_time_interval);
+
+    SELECT h.id
+    INTO STRICT agg_row.mat_hypertable_id
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.schema_name = '_timescaledb_internal' AND h.table_name = mat_table_name;
+
+    --everything is materialized up to the bucket of the oldest raw data, so
+    --that refreshing materializes the rest
+    EXECUTE format('SELECT %s FROM %I.%I',
+        _timescaledb_internal.extract_time_sql(format('min(%I)', hypertable_row.time_column_name),
+                                               hypertable_row.time_column_type),
+        hypertable_row.schema_name, hypertable_row.table_name)
+    INTO oldest;
+
+    agg_row.watermark := _timescaledb_internal.time_bucket_internal(bucket_width, COALESCE(oldest, 0),
+                                                                    hypertable_row.time_column_type);
+
+    INSERT INTO _timescaledb_catalog.continuous_agg
+    SELECT agg_row.*;
+
+    --the watermark is read once per query
+    watermark_sql := format('(SELECT %s)', _timescaledb_internal.time_from_internal_sql(
+        format('_timescaledb_internal.continuous_agg_watermark(%s)', agg_row.id),
+        hypertable_row.time_column_type));
+
+    EXECUTE format('CREATE VIEW %I.%I AS SELECT * FROM %s WHERE %I < %s UNION ALL %s',
+        agg_row.view_schema, view_name, mat_table, hypertable_row.time_column_name, watermark_sql,
+        _timescaledb_internal.continuous_agg_query_sql(agg_row,
+            format('%I >= %s', hypertable_row.time_column_name, watermark_sql)));
+
+    PERFORM refresh_continuous_aggregate(format('%I.%I', agg_row.view_schema, view_name)::REGCLASS);
+END
+$BODY$;
+
+-- Creates a continuous aggregate of a hypertable with a TIMESTAMP or
+-- TIMESTAMPTZ time column, with buckets of the given width.
+CREATE OR REPLACE FUNCTION create_continuous_aggregate(
+    view_name     NAME,
+    hypertable    REGCLASS,
+    bucket_width  INTERVAL,
+    aggregates    TEXT,
+    group_by      NAME[] = '{}',
+    view_schema   NAME = NULL
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    time_column_type REGTYPE;
+BEGIN
+    SELECT h.time_column_type
+    INTO STRICT time_column_type
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = _timescaledb_internal.hypertable_id_for_table(hypertable);
+
+    IF time_column_type NOT IN ('TIMESTAMP', 'TIMESTAMPTZ') THEN
+        RAISE EXCEPTION 'Cannot bucket time column of type % of hypertable % by an interval',
+            time_column_type, hypertable
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    PERFORM create_continuous_aggregate(view_name, hypertable,
+                                        _timescaledb_internal.interval_to_usec(bucket_width),
+                                        aggregates, group_by, view_schema);
+END
+$BODY$;
+
+-- Gets the catalog row of the continuous aggregate with the given view.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.continuous_agg_for_view(
+    continuous_aggregate  REGCLASS,
+    for_update            BOOLEAN = FALSE
+)
+    RETURNS _timescaledb_catalog.continuous_agg LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    agg_row _timescaledb_catalog.continuous_agg;
+BEGIN
+    IF for_update THEN
+        SELECT ca.*
+        INTO agg_row
+        FROM _timescaledb_catalog.continuous_agg ca
+        INNER JOIN pg_namespace n ON (n.nspname = ca.view_schema)
+        INNER JOIN pg_class c ON (c.relname = ca.view_name AND c.relnamespace = n.oid)
+        WHERE c.oid = continuous_aggregate
+        FOR NO KEY UPDATE OF ca;
+    ELSE
+        SELECT ca.*
+        INTO agg_row
+        FROM _timescaledb_catalog.continuous_agg ca
+        INNER JOIN pg_namespace n ON (n.nspname = ca.view_schema)
+        INNER JOIN pg_class c ON (c.relname = ca.view_name AND c.relnamespace = n.oid)
+        WHERE c.oid = continuous_aggregate;
+    END IF;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Relation % is not a continuous aggregate', continuous_aggregate
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    RETURN agg_row;
+END
+$BODY$;
+
+-- Refreshes a continuous aggregate: recomputes the materialized buckets that
+-- inserts changed since the last refresh and materializes the buckets below
+-- the bucket of the newest raw data. Inserts into the hypertable wait for the
+-- refresh to finish. Only the owner of the continuous aggregate's view may
+-- refresh it, which is also who its refresh policy runs as.
+CREATE OR REPLACE FUNCTION refresh_continuous_aggregate(
+    continuous_aggregate REGCLASS
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    agg_row        _timescaledb_catalog.continuous_agg;
+    raw_row        _timescaledb_catalog.hypertable;
+    newest         BIGINT;
+    new_watermark  BIGINT;
+    inval_start    BIGINT;
+    inval_end      BIGINT;
+    range_start    BIGINT;
+    range_end      BIGINT;
+BEGIN
+    IF NOT pg_has_role(current_user, (SELECT c.relowner FROM pg_class c WHERE c.oid = continuous_aggregate),
+                       'USAGE') THEN
+        RAISE EXCEPTION 'Must be owner of continuous aggregate %', continuous_aggregate
+        USING ERRCODE = 'insufficient_privilege';
+    END IF;
+
+    --inserts lock the row to read the watermark, so locking it first makes
+    --the data of all inserts that used the old watermark visible below
+    agg_row := _timescaledb_internal.continuous_agg_for_view(continuous_aggregate, for_update => true);
+
+    SELECT *
+    INTO STRICT raw_row
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = agg_row.raw_hypertable_id;
+
+    --merge the invalidated ranges into ranges of whole buckets
+    FOR inval_start, inval_end IN
+    SELECT i.lowest_modified_value, i.greatest_modified_value
+    FROM _timescaledb_catalog.continuous_agg_invalidation i
+    WHERE i.continuous_agg_id = agg_row.id
+    ORDER BY i.lowest_modified_value
+    LOOP
+        inval_start := _timescaledb_internal.time_bucket_internal(agg_row.bucket_width, inval_start,
+                                                                  raw_row.time_column_type);
+        inval_end := _timescaledb_internal.time_bucket_internal(agg_row.bucket_width, inval_end,
+                                                                raw_row.time_column_type) + agg_row.bucket_width;
+
+        IF range_end IS NOT NULL AND inval_start <= range_end THEN
+            range_end := GREATEST(range_end, inval_end);
+        ELSE
+            IF range_end IS NOT NULL THEN
+                PERFORM _timescaledb_internal.continuous_agg_materialize(agg_row, range_start, range_end);
+            END IF;
+            range_start := inval_start;
+            range_end := inval_end;
+        END IF;
+    END LOOP;
+
+    IF range_end IS NOT NULL THEN
+        PERFORM _timescaledb_internal.continuous_agg_materialize(agg_row, range_start, range_end);
+    END IF;
+
+    DELETE FROM _timescaledb_catalog.continuous_agg_invalidation i
+    WHERE i.continuous_agg_id = agg_row.id;
+
+    --the bucket of the newest data can still change
+    EXECUTE format('SELECT %s FROM %I.%I',
+        _timescaledb_internal.extract_time_sql(format('max(%I)', raw_row.time_column_name),
+                                               raw_row.time_column_type),
+        raw_row.schema_name, raw_row.table_name)
+    INTO newest;
+
+    new_watermark := _timescaledb_internal.time_bucket_internal(agg_row.bucket_width, newest,
+                                                                raw_row.time_column_type);
+
+    IF new_watermark > agg_row.watermark THEN
+        PERFORM _timescaledb_internal.continuous_agg_materialize(agg_row, agg_row.watermark, new_watermark);
+
+        UPDATE _timescaledb_catalog.continuous_agg ca
+        SET watermark = new_watermark
+        WHERE ca.id = agg_row.id;
+    END IF;
+END
+$BODY$;
+
+-- Drops a continuous aggregate, along with its view and materialized data.
+CREATE OR REPLACE FUNCTION drop_continuous_aggregate(
+    continuous_aggregate REGCLASS
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    agg_row  _timescaledb_catalog.continuous_agg;
+    mat_row  _timescaledb_catalog.hypertable;
+BEGIN
+    agg_row := _timescaledb_internal.continuous_agg_for_view(continuous_aggregate, for_update => true);
+
+    SELECT *
+    INTO STRICT mat_row
+    FROM _timescaledb_catalog.hypertable h
+    WHERE h.id = agg_row.mat_hypertable_id;
+
+    DELETE FROM _timescaledb_catalog.continuous_agg ca
+    WHERE ca.id = agg_row.id;
+
+    EXECUTE format('DROP VIEW %s', continuous_aggregate);
+    EXECUTE format('DROP TABLE %I.%I', mat_row.schema_name, mat_row.table_name);
+END
+$BODY$;
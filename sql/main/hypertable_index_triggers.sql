@@ -65,8 +65,10 @@ BEGIN
         PERFORM _timescaledb_internal.on_trigger_error(TG_OP, TG_TABLE_SCHEMA, TG_TABLE_NAME);
     END IF;
 
-    --create index on all chunks
-    PERFORM _timescaledb_internal.create_index_on_all_chunk_replica_nodes(NEW.hypertable_id, NEW.main_schema_name, NEW.main_index_name, NEW.definition);
+    --create index on all chunks, unless deferred to build_chunk_indexes()
+    IF COALESCE(current_setting('timescaledb.defer_chunk_indexes', true), 'off')::BOOLEAN IS NOT TRUE THEN
+        PERFORM _timescaledb_internal.create_index_on_all_chunk_replica_nodes(NEW.hypertable_id, NEW.main_schema_name, NEW.main_index_name, NEW.definition);
+    END IF;
 
     IF new.created_on <> current_database() THEN
       --create index on main table
@@ -0,0 +1,69 @@
+-- This file contains functions for declaring functions as monotonic (order
+-- preserving), along with the functions that are registered by default.
+--
+-- The planner uses this information to implement an ORDER BY or GROUP BY on
+-- the result of a monotonic function with an ordered scan on the function's
+-- ordering argument, e.g., an ORDER BY time_bucket('1 minute', time) with an
+-- index on time. All other arguments of the function must be constants in the
+-- query for the transform to apply.
+
+-- Declare a function as monotonic.
+--
+-- function_id - The function, e.g., 'my_bucket(interval, timestamptz)'
+-- order_argument - (Optional) Position of the argument whose order is preserved
+CREATE OR REPLACE FUNCTION register_monotonic_function(
+    function_id    REGPROCEDURE,
+    order_argument SMALLINT = 1
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    num_args SMALLINT;
+BEGIN
+    SELECT pronargs
+    INTO STRICT num_args
+    FROM pg_proc
+    WHERE oid = function_id;
+
+    IF order_argument < 1 OR order_argument > num_args THEN
+        RAISE EXCEPTION 'invalid order argument % for function %', order_argument, function_id
+        USING ERRCODE = 'invalid_parameter_value';
+    END IF;
+
+    INSERT INTO _timescaledb_catalog.monotonic_function (function_id, order_argument)
+    VALUES (function_id, order_argument)
+    ON CONFLICT (function_id) DO UPDATE SET order_argument = EXCLUDED.order_argument;
+END
+$BODY$;
+
+-- Remove the monotonicity declaration of a function.
+CREATE OR REPLACE FUNCTION unregister_monotonic_function(
+    function_id REGPROCEDURE
+)
+    RETURNS VOID LANGUAGE SQL VOLATILE AS
+$BODY$
+    DELETE FROM _timescaledb_catalog.monotonic_function m
+    WHERE m.function_id = unregister_monotonic_function.function_id;
+$BODY$;
+
+-- Functions registered by the extension. Note that timezone(text, ...), i.e.,
+-- AT TIME ZONE, is only order preserving for time zones with a fixed UTC
+-- offset. The planner checks the zone argument before using it.
+INSERT INTO _timescaledb_catalog.monotonic_function (function_id, order_argument, builtin) VALUES
+    ('pg_catalog.date_trunc(text, timestamp)', 2, true),
+    ('pg_catalog.date_trunc(text, timestamptz)', 2, true),
+    ('pg_catalog.timestamp(timestamptz)', 1, true),
+    ('pg_catalog.to_timestamp(double precision)', 1, true),
+    ('pg_catalog.timezone(interval, timestamp)', 2, true),
+    ('pg_catalog.timezone(interval, timestamptz)', 2, true),
+    ('pg_catalog.timezone(text, timestamp)', 2, true),
+    ('pg_catalog.timezone(text, timestamptz)', 2, true);
+
+-- All variants of time_bucket() preserve the order of their time argument.
+-- They are looked up as members of the extension rather than by schema.
+INSERT INTO _timescaledb_catalog.monotonic_function (function_id, order_argument, builtin)
+SELECT p.oid, 2, true
+FROM pg_proc p
+INNER JOIN pg_depend d ON (d.classid = 'pg_proc'::regclass AND d.objid = p.oid AND d.deptype = 'e')
+INNER JOIN pg_extension e ON (e.oid = d.refobjid)
+WHERE e.extname = 'timescaledb' AND p.proname = 'time_bucket';
@@ -0,0 +1,141 @@
+CREATE OR REPLACE FUNCTION _timescaledb_internal.reorder_chunk_copy(
+    chunk       REGCLASS,
+    index       REGCLASS,
+    tablespace  OID,
+    freeze      BOOLEAN
+)
+    RETURNS REGCLASS AS '$libdir/timescaledb', 'reorder_chunk_copy' LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION _timescaledb_internal.reorder_chunk_swap(
+    chunk          REGCLASS,
+    new_heap       REGCLASS,
+    indexes        REGCLASS[],
+    new_indexes    REGCLASS[],
+    cluster_index  REGCLASS
+)
+    RETURNS VOID AS '$libdir/timescaledb', 'reorder_chunk_swap' LANGUAGE C VOLATILE;
+
+-- Rewrites a chunk, in the order of one of its indexes if index is not NULL,
+-- in another tablespace if tablespace is not NULL, and with its rows frozen
+-- if freeze is true. Reads of the chunk are only blocked while the rewritten
+-- chunk replaces the old one at the end; writes are blocked throughout.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.rewrite_chunk(
+    chunk       REGCLASS,
+    index       REGCLASS,
+    tablespace  NAME,
+    freeze      BOOLEAN
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    chunk_schema        NAME;
+    new_heap            REGCLASS;
+    tablespace_oid      OID;
+    index_oid           REGCLASS;
+    index_name          TEXT;
+    index_def           TEXT;
+    index_tablespace    NAME;
+    default_tablespace  TEXT;
+    indexes             REGCLASS[] = '{}';
+    new_indexes         REGCLASS[] = '{}';
+BEGIN
+    SELECT n.nspname
+    INTO STRICT chunk_schema
+    FROM pg_class c
+    INNER JOIN pg_namespace n ON (n.oid = c.relnamespace)
+    WHERE c.oid = chunk;
+
+    IF tablespace IS NOT NULL THEN
+        SELECT t.oid
+        INTO tablespace_oid
+        FROM pg_tablespace t
+        WHERE t.spcname = tablespace;
+
+        IF NOT FOUND THEN
+            RAISE EXCEPTION 'No tablespace % in database %', tablespace, current_database()
+            USING ERRCODE = 'IO501';
+        END IF;
+    END IF;
+
+    --block writes to the chunk while its rows are copied
+    EXECUTE format('LOCK TABLE %s IN EXCLUSIVE MODE', chunk);
+
+    new_heap := _timescaledb_internal.reorder_chunk_copy(chunk, index, tablespace_oid, freeze);
+
+    --build copies of the chunk's indexes on the new heap, in the new
+    --tablespace or the tablespaces of the originals
+    default_tablespace := current_setting('default_tablespace');
+
+    FOR index_oid, index_tablespace IN
+    SELECT i.indexrelid, t.spcname
+    FROM pg_index i
+    INNER JOIN pg_class c ON (c.oid = i.indexrelid)
+    LEFT JOIN pg_tablespace t ON (t.oid = c.reltablespace)
+    WHERE i.indrelid = chunk
+    ORDER BY i.indexrelid
+    LOOP
+        SELECT format('%I', c.relname) INTO STRICT index_name FROM pg_class c WHERE c.oid = index_oid;
+
+        index_def := replace(pg_get_indexdef(index_oid), 'ON ' || chunk::TEXT || ' USING',
+                             'ON ' || new_heap::TEXT || ' USING');
+        index_def := replace(index_def, 'INDEX ' || index_name || ' ON',
+                             format('INDEX %I ON', 'pg_temp_' || index_oid::OID));
+
+        PERFORM set_config('default_tablespace', COALESCE(tablespace, index_tablespace, ''), true);
+        EXECUTE index_def;
+
+        indexes := indexes || index_oid;
+        new_indexes := new_indexes || format('%I.%I', chunk_schema, 'pg_temp_' || index_oid::OID)::REGCLASS;
+    END LOOP;
+
+    PERFORM set_config('default_tablespace', default_tablespace, true);
+
+    --readers only wait for the swap
+    EXECUTE format('LOCK TABLE %s IN ACCESS EXCLUSIVE MODE', chunk);
+
+    PERFORM _timescaledb_internal.reorder_chunk_swap(chunk, new_heap, indexes, new_indexes, index);
+
+    --drops the old storage of the chunk
+    EXECUTE format('DROP TABLE %s', new_heap);
+END
+$BODY$;
+
+-- Rewrites a closed chunk in the order of one of its indexes.
+CREATE OR REPLACE FUNCTION reorder_chunk(
+    chunk  REGCLASS,
+    index  REGCLASS
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    crn_row    _timescaledb_catalog.chunk_replica_node;
+    chunk_row  _timescaledb_catalog.chunk;
+BEGIN
+    crn_row := _timescaledb_internal.chunk_replica_node_for_table(chunk);
+
+    SELECT *
+    INTO STRICT chunk_row
+    FROM _timescaledb_catalog.chunk c
+    WHERE c.id = crn_row.chunk_id;
+
+    IF chunk_row.end_time IS NULL THEN
+        RAISE EXCEPTION 'Cannot reorder chunk % since it is not closed', chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    IF EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_compression cc
+               WHERE cc.chunk_id = crn_row.chunk_id AND cc.database_name = crn_row.database_name) THEN
+        RAISE EXCEPTION 'Cannot reorder chunk % since it is compressed', chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    IF NOT EXISTS (SELECT 1 FROM pg_index i WHERE i.indexrelid = index AND i.indrelid = chunk) THEN
+        RAISE EXCEPTION 'Index % is not an index on chunk %', index, chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    --sealed chunks stay frozen
+    PERFORM _timescaledb_internal.rewrite_chunk(chunk, index, NULL,
+                                                _timescaledb_internal.chunk_is_sealed(crn_row.chunk_id));
+END
+$BODY$;
@@ -106,6 +106,32 @@ $BODY$
     WHERE c.OID = table_oid;
 $BODY$;
 
+-- Get the ID of a hypertable given its main table OID. Fails if the table is
+-- not a hypertable.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.hypertable_id_for_table(
+    hypertable  REGCLASS
+)
+    RETURNS INTEGER LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+    hypertable_id INTEGER;
+BEGIN
+    SELECT h.id
+    INTO hypertable_id
+    FROM _timescaledb_catalog.hypertable h
+    INNER JOIN pg_namespace n ON (n.nspname = h.schema_name)
+    INNER JOIN pg_class c ON (c.relname = h.table_name AND c.relnamespace = n.oid)
+    WHERE c.oid = hypertable;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Table % is not a hypertable', hypertable
+        USING ERRCODE = 'IO001';
+    END IF;
+
+    RETURN hypertable_id;
+END
+$BODY$;
+
 -- Get the name of the time column for a chunk_replica_node.
 --
 -- schema_name, table_name - name of the schema and table for the table represented by the crn.
@@ -0,0 +1,86 @@
+CREATE OR REPLACE FUNCTION _timescaledb_internal.chunk_is_sealed(
+    chunk_id  INTEGER
+)
+    RETURNS BOOLEAN LANGUAGE SQL STABLE AS
+$BODY$
+    SELECT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_seal cs
+                   WHERE cs.chunk_id = chunk_is_sealed.chunk_id);
+$BODY$;
+
+-- Seals a closed local chunk: its rows, and those of its compressed table if
+-- it is compressed, are rewritten frozen, so that VACUUM never has to freeze
+-- them, and inserts, updates and deletes of the chunk through the hypertable
+-- fail until the chunk is unsealed. Reads of the chunk are only blocked at
+-- the end of the rewrite.
+CREATE OR REPLACE FUNCTION seal_chunk(
+    chunk REGCLASS
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    crn_row     _timescaledb_catalog.chunk_replica_node;
+    chunk_row   _timescaledb_catalog.chunk;
+    compressed  REGCLASS;
+BEGIN
+    crn_row := _timescaledb_internal.chunk_replica_node_for_table(chunk);
+
+    SELECT *
+    INTO STRICT chunk_row
+    FROM _timescaledb_catalog.chunk c
+    WHERE c.id = crn_row.chunk_id;
+
+    IF chunk_row.end_time IS NULL THEN
+        RAISE EXCEPTION 'Cannot seal chunk % since it is not closed', chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    IF _timescaledb_internal.chunk_is_sealed(crn_row.chunk_id) THEN
+        RAISE EXCEPTION 'Chunk % is already sealed', chunk
+        USING ERRCODE = 'IO150';
+    END IF;
+
+    --inserts waiting for the rewrite see the seal once they get the chunk
+    INSERT INTO _timescaledb_catalog.chunk_seal (chunk_id, hypertable_id, sealed_at)
+    SELECT crn_row.chunk_id, pr.hypertable_id, now()
+    FROM _timescaledb_catalog.partition_replica pr
+    WHERE pr.id = crn_row.partition_replica_id;
+
+    PERFORM _timescaledb_internal.rewrite_chunk(chunk, NULL, NULL, true);
+
+    FOR compressed IN
+    SELECT format('%I.%I', cc.compressed_schema_name, cc.compressed_table_name)::REGCLASS
+    FROM _timescaledb_catalog.chunk_compression cc
+    WHERE cc.chunk_id = crn_row.chunk_id AND cc.database_name = crn_row.database_name
+    LOOP
+        PERFORM _timescaledb_internal.rewrite_chunk(compressed, NULL, NULL, true);
+    END LOOP;
+END
+$BODY$;
+
+-- Makes a sealed chunk writable again. Its rows stay frozen until they are
+-- updated or deleted.
+CREATE OR REPLACE FUNCTION unseal_chunk(
+    chunk REGCLASS
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    crn_row _timescaledb_catalog.chunk_replica_node;
+BEGIN
+    crn_row := _timescaledb_internal.chunk_replica_node_for_table(chunk);
+
+    DELETE FROM _timescaledb_catalog.chunk_seal cs
+    WHERE cs.chunk_id = crn_row.chunk_id;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Chunk % is not sealed', chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+END
+$BODY$;
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE ON _timescaledb_catalog.chunk_seal
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_chunk_cache_trigger();
+
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.chunk_seal
+FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_chunk');
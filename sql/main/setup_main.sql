@@ -25,6 +25,13 @@ BEGIN
     AFTER UPDATE ON _timescaledb_catalog.chunk
     FOR EACH ROW EXECUTE PROCEDURE _timescaledb_internal.on_change_chunk();
 
+    -- only DELETE: compress_chunk() creates the compressed tables
+    DROP TRIGGER IF EXISTS trigger_main_on_change_chunk_compression
+    ON _timescaledb_catalog.chunk_compression;
+    CREATE TRIGGER trigger_main_on_change_chunk_compression
+    AFTER DELETE ON _timescaledb_catalog.chunk_compression
+    FOR EACH ROW EXECUTE PROCEDURE _timescaledb_internal.on_change_chunk_compression();
+
     DROP TRIGGER IF EXISTS trigger_main_on_change_cluster_user
     ON _timescaledb_catalog.cluster_user;
     CREATE TRIGGER trigger_main_on_change_cluster_user
@@ -16,3 +16,165 @@ CREATE TABLE IF NOT EXISTS _timescaledb_catalog.chunk_replica_node_index (
     FOREIGN KEY (main_schema_name, main_index_name) REFERENCES _timescaledb_catalog.hypertable_index (main_schema_name, main_index_name) ON DELETE CASCADE
 );
 SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.chunk_replica_node_index', '');
+
+/*
+  Background job policies of local hypertables, run by the background job
+  scheduler of the database (see src/bgw_scheduler.c). Which of the optional
+  columns a policy uses depends on its type.
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.bgw_policy (
+    id                 SERIAL                                NOT NULL PRIMARY KEY,
+    hypertable_id      INTEGER                               NOT NULL REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    policy_type        _timescaledb_catalog.bgw_policy_type  NOT NULL,
+    owner              NAME                                  NOT NULL, --role that the policy's jobs run as
+    schedule_interval  INTERVAL                              NOT NULL CHECK (schedule_interval > '0'),
+    max_jitter         INTERVAL                              NOT NULL CHECK (max_jitter >= '0'),
+    next_start         TIMESTAMPTZ                           NOT NULL,
+    older_than         INTERVAL                              NULL, --age of the chunks to drop, compress, move or re-index, or lag of the chunks to seal
+    ahead              INTERVAL                              NULL, --how far ahead of now to create chunks
+    segment_by         NAME                                  NULL, --segment_by column of compressed chunks
+    index_name         NAME                                  NULL, --hypertable index to reorder chunks by or rebuild
+    tablespace         NAME                                  NULL, --tablespace to move chunks to
+    index_method       NAME                                  NULL, --access method to rebuild chunk indexes with
+    UNIQUE (hypertable_id, policy_type)
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.bgw_policy', '');
+SELECT pg_catalog.pg_extension_config_dump(pg_get_serial_sequence('_timescaledb_catalog.bgw_policy','id'), '');
+
+/*
+  Runs of background jobs, most recent ones only (see bgw_job_finish()).
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.bgw_job_run (
+    id           SERIAL       NOT NULL PRIMARY KEY,
+    policy_id    INTEGER      NOT NULL REFERENCES _timescaledb_catalog.bgw_policy(id) ON DELETE CASCADE,
+    start_time   TIMESTAMPTZ  NOT NULL,
+    finish_time  TIMESTAMPTZ  NULL,
+    succeeded    BOOLEAN      NULL,
+    message      TEXT         NULL
+);
+CREATE INDEX ON _timescaledb_catalog.bgw_job_run(policy_id, id);
+
+/*
+  Columns of local hypertables whose chunks keep zone maps (see
+  sql/main/zone_map.sql). Dropping or renaming the column cascades.
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.hypertable_zone_map_column (
+    hypertable_id  INTEGER  NOT NULL,
+    column_name    NAME     NOT NULL,
+    PRIMARY KEY (hypertable_id, column_name),
+    FOREIGN KEY (hypertable_id, column_name) REFERENCES _timescaledb_catalog.hypertable_column (hypertable_id, name)
+        ON DELETE CASCADE ON UPDATE CASCADE
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.hypertable_zone_map_column', '');
+
+/*
+  Zone maps of local chunks: the smallest and largest value of a column in a
+  chunk, in the text form of the column's type, and the number of NULLs.
+  min_value and max_value are NULL if the chunk has no non-NULL values in the
+  column. Widened by inserts through the hypertable and used by the planner
+  to exclude chunks (see src/zone_map.c).
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.chunk_zone_map (
+    chunk_id       INTEGER  NOT NULL REFERENCES _timescaledb_catalog.chunk(id) ON DELETE CASCADE,
+    hypertable_id  INTEGER  NOT NULL,
+    column_name    NAME     NOT NULL,
+    min_value      TEXT     NULL,
+    max_value      TEXT     NULL,
+    null_count     BIGINT   NOT NULL,
+    PRIMARY KEY (chunk_id, column_name),
+    FOREIGN KEY (hypertable_id, column_name) REFERENCES _timescaledb_catalog.hypertable_zone_map_column (hypertable_id, column_name)
+        ON DELETE CASCADE ON UPDATE CASCADE
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.chunk_zone_map', '');
+
+/*
+  Widenings of zone maps by inserts that could not lock the zone map's row in
+  chunk_zone_map without waiting, at most one per transaction, chunk and
+  column. A zone map covers the values of its row and of its deltas. Folded
+  into the row by later inserts and by update_chunk_zone_maps() (see
+  src/zone_map.c).
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.chunk_zone_map_delta (
+    chunk_id       INTEGER  NOT NULL REFERENCES _timescaledb_catalog.chunk(id) ON DELETE CASCADE,
+    hypertable_id  INTEGER  NOT NULL,
+    column_name    NAME     NOT NULL,
+    min_value      TEXT     NULL,
+    max_value      TEXT     NULL,
+    null_count     BIGINT   NOT NULL,
+    FOREIGN KEY (hypertable_id, column_name) REFERENCES _timescaledb_catalog.hypertable_zone_map_column (hypertable_id, column_name)
+        ON DELETE CASCADE ON UPDATE CASCADE
+);
+CREATE INDEX ON _timescaledb_catalog.chunk_zone_map_delta(chunk_id, column_name);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.chunk_zone_map_delta', '');
+
+/*
+  Tablespaces that new chunks of local hypertables are placed in, round-robin
+  in the order of position (see sql/main/tablespace.sql). Chunks of
+  hypertables without tablespaces go to the tablespace of their partition.
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.hypertable_tablespace (
+    hypertable_id    INTEGER  NOT NULL REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    tablespace_name  NAME     NOT NULL,
+    position         INTEGER  NOT NULL,
+    PRIMARY KEY (hypertable_id, tablespace_name),
+    UNIQUE (hypertable_id, position)
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.hypertable_tablespace', '');
+
+/*
+  Tablespaces of local chunks, NULL for the database's default tablespace.
+  Updated when chunks are moved (see move_chunk()).
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.chunk_tablespace (
+    chunk_id         INTEGER  NOT NULL PRIMARY KEY REFERENCES _timescaledb_catalog.chunk(id) ON DELETE CASCADE,
+    hypertable_id    INTEGER  NOT NULL REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    tablespace_name  NAME     NULL
+);
+CREATE INDEX ON _timescaledb_catalog.chunk_tablespace(hypertable_id, chunk_id);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.chunk_tablespace', '');
+
+/*
+  Local chunks that are sealed: their rows are frozen and inserts, updates and
+  deletes through the hypertable fail (see sql/main/seal.sql).
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.chunk_seal (
+    chunk_id       INTEGER      NOT NULL PRIMARY KEY REFERENCES _timescaledb_catalog.chunk(id) ON DELETE CASCADE,
+    hypertable_id  INTEGER      NOT NULL REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    sealed_at      TIMESTAMPTZ  NOT NULL
+);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.chunk_seal', '');
+
+/*
+  Continuous aggregates of local hypertables: aggregates by time_bucket() of
+  the raw hypertable that are materialized into the materialization hypertable
+  and queried through the view (see sql/main/continuous_agg.sql). Buckets
+  below the watermark, in the internal time representation, are materialized.
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.continuous_agg (
+    id                 SERIAL   NOT NULL PRIMARY KEY,
+    view_schema        NAME     NOT NULL,
+    view_name          NAME     NOT NULL,
+    raw_hypertable_id  INTEGER  NOT NULL REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    mat_hypertable_id  INTEGER  NOT NULL UNIQUE REFERENCES _timescaledb_catalog.hypertable(id) ON DELETE CASCADE,
+    bucket_width       BIGINT   NOT NULL CHECK (bucket_width > 0),
+    group_by           NAME[]   NOT NULL, --columns grouped by besides the bucket
+    aggregates         TEXT     NOT NULL, --select list of the aggregates
+    watermark          BIGINT   NOT NULL,
+    UNIQUE (view_schema, view_name)
+);
+CREATE INDEX ON _timescaledb_catalog.continuous_agg(raw_hypertable_id);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.continuous_agg', '');
+SELECT pg_catalog.pg_extension_config_dump(pg_get_serial_sequence('_timescaledb_catalog.continuous_agg','id'), '');
+
+/*
+  Ranges of time below the watermark of a continuous aggregate that inserts
+  into its raw hypertable changed since its last refresh (see
+  src/continuous_agg.c).
+*/
+CREATE TABLE IF NOT EXISTS _timescaledb_catalog.continuous_agg_invalidation (
+    continuous_agg_id        INTEGER  NOT NULL REFERENCES _timescaledb_catalog.continuous_agg(id) ON DELETE CASCADE,
+    lowest_modified_value    BIGINT   NOT NULL,
+    greatest_modified_value  BIGINT   NOT NULL
+);
+CREATE INDEX ON _timescaledb_catalog.continuous_agg_invalidation(continuous_agg_id);
+SELECT pg_catalog.pg_extension_config_dump('_timescaledb_catalog.continuous_agg_invalidation', '');
@@ -0,0 +1,108 @@
+-- Places new chunks of a hypertable in the given tablespaces, round-robin in
+-- the given order, to spread the writes of the hypertable over several
+-- volumes. An empty array places new chunks in the tablespace of their
+-- partition again. Existing chunks are not moved (see move_chunk()).
+CREATE OR REPLACE FUNCTION set_chunk_tablespaces(
+    hypertable   REGCLASS,
+    tablespaces  NAME[]
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    ht_id            INTEGER;
+    tablespace_name  NAME;
+BEGIN
+    ht_id := _timescaledb_internal.hypertable_id_for_table(hypertable);
+
+    FOREACH tablespace_name IN ARRAY tablespaces
+    LOOP
+        IF NOT EXISTS (SELECT 1 FROM pg_tablespace t WHERE t.spcname = tablespace_name) THEN
+            RAISE EXCEPTION 'No tablespace % in database %', tablespace_name, current_database()
+            USING ERRCODE = 'IO501';
+        END IF;
+    END LOOP;
+
+    DELETE FROM _timescaledb_catalog.hypertable_tablespace t
+    WHERE t.hypertable_id = ht_id;
+
+    BEGIN
+        INSERT INTO _timescaledb_catalog.hypertable_tablespace (hypertable_id, tablespace_name, position)
+        SELECT ht_id, t.name, t.position
+        FROM unnest(tablespaces) WITH ORDINALITY AS t(name, position);
+    EXCEPTION
+        WHEN unique_violation THEN
+            RAISE EXCEPTION 'Tablespaces % of hypertable % are not distinct', tablespaces, hypertable
+            USING ERRCODE = 'IO101';
+    END;
+END
+$BODY$;
+
+-- Gets the tablespace of a new chunk of a hypertable: the tablespace after the
+-- one that the hypertable's most recently created chunk was placed in, or the
+-- first one. NULL if the hypertable has no tablespaces.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.next_chunk_tablespace(
+    hypertable_id  INTEGER
+)
+    RETURNS NAME LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+    last_position    INTEGER;
+    next_tablespace  NAME;
+BEGIN
+    --chunks moved to other tablespaces do not count
+    SELECT t.position
+    INTO last_position
+    FROM _timescaledb_catalog.chunk_tablespace ct
+    INNER JOIN _timescaledb_catalog.hypertable_tablespace t
+               ON (t.hypertable_id = ct.hypertable_id AND t.tablespace_name = ct.tablespace_name)
+    WHERE ct.hypertable_id = next_chunk_tablespace.hypertable_id
+    ORDER BY ct.chunk_id DESC
+    LIMIT 1;
+
+    SELECT t.tablespace_name
+    INTO next_tablespace
+    FROM _timescaledb_catalog.hypertable_tablespace t
+    WHERE t.hypertable_id = next_chunk_tablespace.hypertable_id
+    ORDER BY t.position <= COALESCE(last_position, 0), t.position
+    LIMIT 1;
+
+    RETURN next_tablespace;
+END
+$BODY$;
+
+-- Moves a local chunk, and its compressed data if it is compressed, to
+-- another tablespace, along with its indexes. Reads of the chunk are only
+-- blocked at the end of the move; writes are blocked throughout.
+CREATE OR REPLACE FUNCTION move_chunk(
+    chunk       REGCLASS,
+    tablespace  NAME
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    crn_row     _timescaledb_catalog.chunk_replica_node;
+    compressed  REGCLASS;
+    sealed      BOOLEAN;
+BEGIN
+    crn_row := _timescaledb_internal.chunk_replica_node_for_table(chunk);
+
+    --sealed chunks stay frozen
+    sealed := _timescaledb_internal.chunk_is_sealed(crn_row.chunk_id);
+
+    PERFORM _timescaledb_internal.rewrite_chunk(chunk, NULL, tablespace, sealed);
+
+    FOR compressed IN
+    SELECT format('%I.%I', cc.compressed_schema_name, cc.compressed_table_name)::REGCLASS
+    FROM _timescaledb_catalog.chunk_compression cc
+    WHERE cc.chunk_id = crn_row.chunk_id AND cc.database_name = crn_row.database_name
+    LOOP
+        PERFORM _timescaledb_internal.rewrite_chunk(compressed, NULL, tablespace, sealed);
+    END LOOP;
+
+    INSERT INTO _timescaledb_catalog.chunk_tablespace (chunk_id, hypertable_id, tablespace_name)
+    SELECT crn_row.chunk_id, pr.hypertable_id, move_chunk.tablespace
+    FROM _timescaledb_catalog.partition_replica pr
+    WHERE pr.id = crn_row.partition_replica_id
+    ON CONFLICT (chunk_id) DO UPDATE SET tablespace_name = EXCLUDED.tablespace_name;
+END
+$BODY$;
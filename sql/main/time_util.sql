@@ -117,6 +117,66 @@ BEGIN
 END
 $BODY$;
 
+-- Gets the sql code for converting the sql expression of a time value in the internal representation to the column_type.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.time_from_internal_sql(
+    expression      text,
+    column_type     REGTYPE
+)
+    RETURNS text LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+BEGIN
+    CASE column_type
+      WHEN 'BIGINT'::regtype, 'INTEGER'::regtype, 'SMALLINT'::regtype THEN
+        RETURN expression;
+      WHEN 'TIMESTAMP'::regtype, 'TIMESTAMPTZ'::regtype THEN
+        RETURN format('_timescaledb_internal.to_timestamp(%s)::%s', expression, column_type);
+    END CASE;
+END
+$BODY$;
+
+-- Gets the sql code for the time_bucket() of the identifier with the given column_type, for a bucket_width in the
+-- internal representation.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.time_bucket_sql(
+    bucket_width    BIGINT,
+    identifier      text,
+    column_type     REGTYPE
+)
+    RETURNS text LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+BEGIN
+    CASE column_type
+      WHEN 'BIGINT'::regtype, 'INTEGER'::regtype, 'SMALLINT'::regtype THEN
+        RETURN format('public.time_bucket(%L::%s, %s)', bucket_width, column_type, identifier);
+      WHEN 'TIMESTAMP'::regtype, 'TIMESTAMPTZ'::regtype THEN
+        RETURN format('public.time_bucket(%L::interval, %s)', bucket_width * interval '1 microsecond', identifier);
+    END CASE;
+END
+$BODY$;
+
+-- Gets the start of the time_bucket() bucket that the time value falls into, both in the internal representation.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.time_bucket_internal(
+    bucket_width    BIGINT,
+    time_value      BIGINT,
+    column_type     REGTYPE
+)
+    RETURNS BIGINT LANGUAGE PLPGSQL STABLE AS
+$BODY$
+DECLARE
+    bucket BIGINT;
+BEGIN
+    EXECUTE format('SELECT %s',
+        _timescaledb_internal.extract_time_sql(
+            _timescaledb_internal.time_bucket_sql(bucket_width,
+                _timescaledb_internal.time_literal_sql(time_value, column_type), column_type),
+            column_type))
+    INTO bucket;
+
+    RETURN bucket;
+END
+$BODY$;
+
 --Convert a interval to microseconds.
 CREATE OR REPLACE FUNCTION _timescaledb_internal.interval_to_usec(
        chunk_interval INTERVAL
@@ -0,0 +1,186 @@
+-- Computes the zone map of a column of a local chunk from the chunk's rows,
+-- using the ordering of the column's type. Values are in the text form of
+-- the type's output function, which the planner reads them back with. The
+-- settings make the text independent of the session's settings.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.compute_chunk_zone_map(
+    chunk          REGCLASS,
+    chunk_id       INTEGER,
+    hypertable_id  INTEGER,
+    column_name    NAME
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE
+    SET DateStyle = 'ISO' SET IntervalStyle = 'postgres' SET extra_float_digits = 3 AS
+$BODY$
+DECLARE
+    min_value   TEXT;
+    max_value   TEXT;
+    null_count  BIGINT;
+BEGIN
+    EXECUTE format($$SELECT format('%%s', %1$I) FROM %2$s WHERE %1$I IS NOT NULL ORDER BY %1$I LIMIT 1$$,
+                   column_name, chunk)
+    INTO min_value;
+
+    EXECUTE format($$SELECT format('%%s', %1$I) FROM %2$s WHERE %1$I IS NOT NULL ORDER BY %1$I DESC LIMIT 1$$,
+                   column_name, chunk)
+    INTO max_value;
+
+    EXECUTE format('SELECT count(*) FROM %2$s WHERE %1$I IS NULL', column_name, chunk)
+    INTO null_count;
+
+    INSERT INTO _timescaledb_catalog.chunk_zone_map (chunk_id, hypertable_id, column_name,
+                                                     min_value, max_value, null_count)
+    VALUES (chunk_id, hypertable_id, column_name, min_value, max_value, null_count)
+    ON CONFLICT ON CONSTRAINT chunk_zone_map_pkey DO UPDATE
+    SET min_value = EXCLUDED.min_value, max_value = EXCLUDED.max_value, null_count = EXCLUDED.null_count;
+
+    --the zone map's row is now locked, which keeps inserts from folding the
+    --deltas concurrently (see src/zone_map.c)
+    DELETE FROM _timescaledb_catalog.chunk_zone_map_delta d
+    WHERE d.chunk_id = compute_chunk_zone_map.chunk_id AND d.column_name = compute_chunk_zone_map.column_name;
+END
+$BODY$;
+
+-- Recomputes the zone maps of a local chunk, e.g., after rows of the chunk
+-- were deleted or updated. Blocks writes to the chunk while the zone maps are
+-- computed.
+CREATE OR REPLACE FUNCTION update_chunk_zone_maps(
+    chunk  REGCLASS
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    crn_row        _timescaledb_catalog.chunk_replica_node;
+    hypertable_id  INTEGER;
+    column_name    NAME;
+BEGIN
+    crn_row := _timescaledb_internal.chunk_replica_node_for_table(chunk);
+
+    --the rows of a compressed chunk are not in the chunk's table
+    IF EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_compression cc
+               WHERE cc.chunk_id = crn_row.chunk_id AND cc.database_name = crn_row.database_name) THEN
+        RAISE EXCEPTION 'Cannot update zone maps of chunk % since it is compressed', chunk
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    EXECUTE format('LOCK TABLE %s IN SHARE MODE', chunk);
+
+    FOR hypertable_id, column_name IN
+    SELECT z.hypertable_id, z.column_name
+    FROM _timescaledb_catalog.chunk c
+    INNER JOIN _timescaledb_catalog.partition p ON (p.id = c.partition_id)
+    INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id)
+    INNER JOIN _timescaledb_catalog.hypertable_zone_map_column z ON (z.hypertable_id = pe.hypertable_id)
+    WHERE c.id = crn_row.chunk_id
+    LOOP
+        PERFORM _timescaledb_internal.compute_chunk_zone_map(chunk, crn_row.chunk_id, hypertable_id, column_name);
+    END LOOP;
+END
+$BODY$;
+
+-- Recomputes the zone maps of all local chunks of a hypertable that are not
+-- compressed.
+CREATE OR REPLACE FUNCTION update_zone_maps(
+    hypertable  REGCLASS
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    ht_id  INTEGER;
+    chunk  REGCLASS;
+BEGIN
+    ht_id := _timescaledb_internal.hypertable_id_for_table(hypertable);
+
+    FOR chunk IN
+    SELECT format('%I.%I', crn.schema_name, crn.table_name)::REGCLASS
+    FROM _timescaledb_catalog.chunk_replica_node crn
+    INNER JOIN _timescaledb_catalog.chunk c ON (c.id = crn.chunk_id)
+    INNER JOIN _timescaledb_catalog.partition p ON (p.id = c.partition_id)
+    INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id)
+    WHERE pe.hypertable_id = ht_id
+          AND crn.database_name = current_database()
+          AND NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.chunk_compression cc
+                          WHERE cc.chunk_id = crn.chunk_id AND cc.database_name = crn.database_name)
+    ORDER BY crn.chunk_id
+    LOOP
+        PERFORM update_chunk_zone_maps(chunk);
+    END LOOP;
+END
+$BODY$;
+
+-- Keeps zone maps of a column for the chunks of a hypertable, so that the
+-- planner can exclude chunks whose range of values in the column does not
+-- match a query's conditions. The zone maps of existing chunks are computed
+-- right away, except for compressed chunks.
+CREATE OR REPLACE FUNCTION add_zone_map_column(
+    hypertable   REGCLASS,
+    column_name  NAME
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+DECLARE
+    ht_id        INTEGER;
+    column_type  REGTYPE;
+BEGIN
+    ht_id := _timescaledb_internal.hypertable_id_for_table(hypertable);
+
+    SELECT hc.data_type
+    INTO column_type
+    FROM _timescaledb_catalog.hypertable_column hc
+    WHERE hc.hypertable_id = ht_id AND hc.name = column_name;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Column % does not exist in hypertable %', column_name, hypertable
+        USING ERRCODE = 'IO101';
+    END IF;
+
+    --zone maps use the default btree ordering of the column's type
+    BEGIN
+        EXECUTE format('SELECT NULL::%s AS v ORDER BY v', column_type);
+    EXCEPTION
+        WHEN undefined_function THEN
+            RAISE EXCEPTION 'Cannot add zone map on column % since type % has no ordering', column_name, column_type
+            USING ERRCODE = 'IO101';
+    END;
+
+    BEGIN
+        INSERT INTO _timescaledb_catalog.hypertable_zone_map_column (hypertable_id, column_name)
+        VALUES (ht_id, column_name);
+    EXCEPTION
+        WHEN unique_violation THEN
+            RAISE EXCEPTION 'Hypertable % already has a zone map on column %', hypertable, column_name
+            USING ERRCODE = 'IO140';
+    END;
+
+    PERFORM update_zone_maps(hypertable);
+END
+$BODY$;
+
+CREATE OR REPLACE FUNCTION remove_zone_map_column(
+    hypertable   REGCLASS,
+    column_name  NAME
+)
+    RETURNS VOID LANGUAGE PLPGSQL VOLATILE AS
+$BODY$
+BEGIN
+    DELETE FROM _timescaledb_catalog.hypertable_zone_map_column z
+    WHERE z.hypertable_id = _timescaledb_internal.hypertable_id_for_table(hypertable)
+          AND z.column_name = remove_zone_map_column.column_name;
+
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Hypertable % has no zone map on column %', hypertable, column_name
+        USING ERRCODE = 'IO101';
+    END IF;
+END
+$BODY$;
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE ON _timescaledb_catalog.chunk_zone_map
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_chunk_cache_trigger();
+
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.chunk_zone_map
+FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_chunk');
+
+CREATE TRIGGER "0_cache_inval" AFTER INSERT OR UPDATE OR DELETE ON _timescaledb_catalog.chunk_zone_map_delta
+FOR EACH ROW EXECUTE PROCEDURE _timescaledb_cache.invalidate_chunk_cache_trigger();
+
+CREATE TRIGGER "0_cache_inval_truncate" AFTER TRUNCATE ON _timescaledb_catalog.chunk_zone_map_delta
+FOR EACH STATEMENT EXECUTE PROCEDURE _timescaledb_cache.invalidate_relcache_trigger('cache_inval_chunk');
@@ -213,6 +213,16 @@ $BODY$
           h.table_name = drop_hypertable.table_name
 $BODY$;
 
+-- Drops chunks older than the given time in a single pass over the catalog,
+-- without firing the catalog triggers. Only valid when this database is the
+-- only node. Returns the number of chunks dropped.
+CREATE OR REPLACE FUNCTION _timescaledb_internal.drop_chunks_older_than(
+    older_than_time  BIGINT,
+    table_name  NAME = NULL,
+    schema_name NAME = NULL
+)
+    RETURNS INTEGER AS '$libdir/timescaledb', 'drop_chunks_older_than' LANGUAGE C VOLATILE;
+
 -- Drop chunks older than the given timestamp. If a hypertable name is given,
 -- drop only chunks associated with this table.
 CREATE OR REPLACE FUNCTION _timescaledb_meta.drop_chunks_older_than(
@@ -224,6 +234,13 @@ CREATE OR REPLACE FUNCTION _timescaledb_meta.drop_chunks_older_than(
 $BODY$
 DECLARE
 BEGIN
+    --other nodes hold copies of the catalog that only the triggers keep in sync
+    IF NOT EXISTS (SELECT 1 FROM _timescaledb_catalog.node n
+                   WHERE n.database_name <> current_database()) THEN
+        PERFORM _timescaledb_internal.drop_chunks_older_than(older_than_time, table_name, schema_name);
+        RETURN;
+    END IF;
+
     EXECUTE format(
         $$
         DELETE FROM _timescaledb_catalog.chunk c
@@ -0,0 +1,578 @@
+#include <postgres.h>
+#include <fmgr.h>
+#include <access/htup_details.h>
+#include <access/stratnum.h>
+#include <catalog/pg_aggregate.h>
+#include <catalog/pg_attribute.h>
+#include <catalog/pg_type.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/clauses.h>
+#include <optimizer/tlist.h>
+#include <parser/parsetree.h>
+#include <rewrite/rewriteManip.h>
+#include <utils/builtins.h>
+#include <utils/datum.h>
+#include <utils/lsyscache.h>
+#include <utils/syscache.h>
+#include <utils/typcache.h>
+
+#include "catalog.h"
+#include "hypertable_cache.h"
+
+/*
+ * Bookend aggregates first() and last().
+ *
+ * first(value, time) returns the value of the row with the smallest time and
+ * last(value, time) the value of the row with the greatest time. Rows with a
+ * NULL time are ignored.
+ *
+ * Like min() and max(), these aggregates can be computed by fetching a single
+ * row from an ordered index scan. Postgres' own min/max optimization
+ * (planagg.c) only handles single-argument aggregates, so queries that only
+ * compute first() and last() over a hypertable are instead rewritten before
+ * planning. Each aggregate is replaced with a subquery of the form:
+ *
+ *	 (SELECT value FROM hypertable WHERE <quals> AND time IS NOT NULL
+ *	  ORDER BY time DESC LIMIT 1)
+ *
+ * The ordered scan over the hypertable's chunks is then planned as an
+ * ordered append (see ordered_append.c), which walks the chunks from newest to
+ * oldest and stops at the first matching row.
+ *
+ * Grouped queries, e.g., the last value per device, are rewritten the same
+ * way per group. The groups are enumerated by a DISTINCT subquery, which can
+ * use a skip scan (see skip_scan.c), and each aggregate becomes a subquery
+ * that is correlated with the group:
+ *
+ *	 SELECT device, (SELECT value FROM hypertable WHERE <quals> AND
+ *					 time IS NOT NULL AND device = groups.device
+ *					 ORDER BY time DESC LIMIT 1)
+ *	 FROM (SELECT DISTINCT device FROM hypertable WHERE <quals>
+ *		   ORDER BY device) groups
+ *
+ * Groups are matched by equality, which never matches a NULL group, so only
+ * queries that group by columns that cannot be NULL are rewritten.
+ */
+
+typedef struct BookendState
+{
+	int16		value_typlen;
+	bool		value_typbyval;
+	int16		cmp_typlen;
+	bool		cmp_typbyval;
+	FmgrInfo	cmp_proc;
+	bool		has_row;
+	Datum		value;
+	bool		value_isnull;
+	Datum		cmp;
+} BookendState;
+
+static BookendState *
+bookend_state_create(FunctionCallInfo fcinfo, MemoryContext aggcontext, StrategyNumber strategy)
+{
+	BookendState *state = MemoryContextAllocZero(aggcontext, sizeof(BookendState));
+	Oid			value_type = get_fn_expr_argtype(fcinfo->flinfo, 1);
+	Oid			cmp_type = get_fn_expr_argtype(fcinfo->flinfo, 2);
+	TypeCacheEntry *tce;
+	Oid			cmp_op;
+
+	get_typlenbyval(value_type, &state->value_typlen, &state->value_typbyval);
+	get_typlenbyval(cmp_type, &state->cmp_typlen, &state->cmp_typbyval);
+
+	tce = lookup_type_cache(cmp_type, TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
+	cmp_op = (strategy == BTLessStrategyNumber) ? tce->lt_opr : tce->gt_opr;
+
+	if (!OidIsValid(cmp_op))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_FUNCTION),
+				 errmsg("could not identify an ordering operator for type %s",
+						format_type_be(cmp_type))));
+
+	fmgr_info_cxt(get_opcode(cmp_op), &state->cmp_proc, aggcontext);
+
+	return state;
+}
+
+/*
+ * Transition function for first() and last(). Keeps the row whose comparison
+ * value compares according to the given strategy with all other rows.
+ */
+static Datum
+bookend_sfunc(FunctionCallInfo fcinfo, StrategyNumber strategy)
+{
+	BookendState *state = PG_ARGISNULL(0) ? NULL : (BookendState *) PG_GETARG_POINTER(0);
+	MemoryContext aggcontext,
+				old;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "bookend_sfunc called in non-aggregate context");
+
+	if (NULL == state)
+		state = bookend_state_create(fcinfo, aggcontext, strategy);
+
+	if (PG_ARGISNULL(2))
+		PG_RETURN_POINTER(state);
+
+	if (state->has_row &&
+		!DatumGetBool(FunctionCall2Coll(&state->cmp_proc, PG_GET_COLLATION(),
+										PG_GETARG_DATUM(2), state->cmp)))
+		PG_RETURN_POINTER(state);
+
+	old = MemoryContextSwitchTo(aggcontext);
+
+	if (state->has_row)
+	{
+		if (!state->cmp_typbyval)
+			pfree(DatumGetPointer(state->cmp));
+
+		if (!state->value_typbyval && !state->value_isnull)
+			pfree(DatumGetPointer(state->value));
+	}
+
+	state->cmp = datumCopy(PG_GETARG_DATUM(2), state->cmp_typbyval, state->cmp_typlen);
+	state->value_isnull = PG_ARGISNULL(1);
+
+	if (!state->value_isnull)
+		state->value = datumCopy(PG_GETARG_DATUM(1), state->value_typbyval, state->value_typlen);
+
+	state->has_row = true;
+
+	MemoryContextSwitchTo(old);
+
+	PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(first_sfunc);
+
+/* first(internal internal_state, anyelement value, "any" comparison_element) */
+Datum
+first_sfunc(PG_FUNCTION_ARGS)
+{
+	return bookend_sfunc(fcinfo, BTLessStrategyNumber);
+}
+
+PG_FUNCTION_INFO_V1(last_sfunc);
+
+/* last(internal internal_state, anyelement value, "any" comparison_element) */
+Datum
+last_sfunc(PG_FUNCTION_ARGS)
+{
+	return bookend_sfunc(fcinfo, BTGreaterStrategyNumber);
+}
+
+PG_FUNCTION_INFO_V1(bookend_finalfunc);
+
+Datum
+bookend_finalfunc(PG_FUNCTION_ARGS)
+{
+	BookendState *state;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "bookend_finalfunc called in non-aggregate context");
+
+	state = PG_ARGISNULL(0) ? NULL : (BookendState *) PG_GETARG_POINTER(0);
+
+	if (NULL == state || !state->has_row || state->value_isnull)
+		PG_RETURN_NULL();
+
+	PG_RETURN_DATUM(state->value);
+}
+
+extern bool agg_bookend_optimization(Query *parse, Hypertable *ht);
+
+typedef struct BookendAggCtx
+{
+	Catalog    *catalog;
+	Query	   *orig;
+	bool		found_other;
+	int			num_bookends;
+	/* The hypertable's range table index */
+	Index		rti;
+	/* Grouping columns, the groups subquery and the qual matching a group */
+	List	   *group_vars;
+	Index		group_rti;
+	Node	   *group_qual;
+} BookendAggCtx;
+
+/*
+ * Check if an aggregate is first() or last() and can be computed from an
+ * ordered scan.
+ */
+static bool
+is_bookend_aggregate(Catalog *catalog, Aggref *aggref, bool *is_first)
+{
+	HeapTuple	tuple;
+	Oid			transfn;
+	TypeCacheEntry *tce;
+
+	if (aggref->agglevelsup != 0 ||
+		aggref->aggstar ||
+		aggref->aggdistinct != NIL ||
+		aggref->aggorder != NIL ||
+		aggref->aggfilter != NULL ||
+		aggref->aggkind != AGGKIND_NORMAL ||
+		list_length(aggref->args) != 2)
+		return false;
+
+	tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(aggref->aggfnoid));
+
+	if (!HeapTupleIsValid(tuple))
+		return false;
+
+	transfn = ((Form_pg_aggregate) GETSTRUCT(tuple))->aggtransfn;
+	ReleaseSysCache(tuple);
+
+	if (transfn == catalog_get_function_id(catalog, FIRST_SFUNC))
+		*is_first = true;
+	else if (transfn == catalog_get_function_id(catalog, LAST_SFUNC))
+		*is_first = false;
+	else
+		return false;
+
+	if (contain_volatile_functions((Node *) aggref->args))
+		return false;
+
+	tce = lookup_type_cache(exprType((Node *) ((TargetEntry *) lsecond(aggref->args))->expr),
+							TYPECACHE_LT_OPR | TYPECACHE_GT_OPR | TYPECACHE_EQ_OPR);
+
+	return OidIsValid(tce->lt_opr) && OidIsValid(tce->gt_opr) && OidIsValid(tce->eq_opr);
+}
+
+/*
+ * Get the position of a column among the grouping columns, or 0 if the query
+ * does not group by it.
+ */
+static AttrNumber
+group_var_position(List *group_vars, Var *var)
+{
+	ListCell   *lc;
+	AttrNumber	pos = 1;
+
+	foreach(lc, group_vars)
+	{
+		if (((Var *) lfirst(lc))->varattno == var->varattno)
+			return pos;
+		pos++;
+	}
+
+	return 0;
+}
+
+static bool
+find_bookend_aggs_walker(Node *node, BookendAggCtx *ctx)
+{
+	if (node == NULL)
+		return false;
+
+	/* Outside of aggregates, a grouped query may only use grouping columns */
+	if (IsA(node, Var) && ctx->group_vars != NIL)
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varno == ctx->rti && var->varlevelsup == 0 &&
+			group_var_position(ctx->group_vars, var) == 0)
+		{
+			ctx->found_other = true;
+			return true;
+		}
+
+		return false;
+	}
+
+	if (IsA(node, Aggref))
+	{
+		bool		is_first;
+
+		if (!is_bookend_aggregate(ctx->catalog, (Aggref *) node, &is_first))
+		{
+			ctx->found_other = true;
+			return true;
+		}
+
+		ctx->num_bookends++;
+
+		/* no need to look at the aggregate's arguments */
+		return false;
+	}
+
+	return expression_tree_walker(node, find_bookend_aggs_walker, ctx);
+}
+
+/*
+ * Create the subquery that replaces a first() or last() aggregate, i.e., a
+ * copy of the original query that fetches the value of the first row in the
+ * aggregate's order. In a grouped query, group_qual restricts the rows to
+ * those of the current group.
+ */
+static Query *
+make_bookend_subquery(Query *orig, Aggref *aggref, bool is_first, Node *group_qual)
+{
+	Query	   *subquery = copyObject(orig);
+	TargetEntry *value_te = linitial(aggref->args);
+	Expr	   *cmp = copyObject(((TargetEntry *) lsecond(aggref->args))->expr);
+	Oid			cmp_type = exprType((Node *) cmp);
+	TypeCacheEntry *tce = lookup_type_cache(cmp_type,
+				  TYPECACHE_LT_OPR | TYPECACHE_GT_OPR | TYPECACHE_EQ_OPR);
+	SortGroupClause *sortcl = makeNode(SortGroupClause);
+	NullTest   *ntest = makeNode(NullTest);
+	TargetEntry *sort_te;
+
+	sort_te = makeTargetEntry(cmp, 2, NULL, true);
+	sort_te->ressortgroupref = 1;
+
+	sortcl->tleSortGroupRef = 1;
+	sortcl->eqop = tce->eq_opr;
+	sortcl->sortop = is_first ? tce->lt_opr : tce->gt_opr;
+	sortcl->nulls_first = !is_first;
+	sortcl->hashable = op_hashjoinable(tce->eq_opr, cmp_type);
+
+	ntest->arg = copyObject(cmp);
+	ntest->nulltesttype = IS_NOT_NULL;
+	ntest->argisrow = false;
+	ntest->location = -1;
+
+	subquery->targetList = list_make2(makeTargetEntry(copyObject(value_te->expr), 1, NULL, false),
+									  sort_te);
+	subquery->hasAggs = false;
+	subquery->havingQual = NULL;
+	subquery->sortClause = list_make1(sortcl);
+	subquery->limitOffset = NULL;
+	subquery->limitCount = (Node *) makeConst(INT8OID, -1, InvalidOid, sizeof(int64),
+											  Int64GetDatum(1), false, FLOAT8PASSBYVAL);
+	subquery->jointree->quals = make_and_qual(subquery->jointree->quals, (Node *) ntest);
+
+	if (NULL != group_qual)
+		subquery->jointree->quals = make_and_qual(subquery->jointree->quals,
+												  copyObject(group_qual));
+
+	return subquery;
+}
+
+static Node *
+replace_bookend_aggs_mutator(Node *node, BookendAggCtx *ctx)
+{
+	if (node == NULL)
+		return NULL;
+
+	if (IsA(node, Aggref))
+	{
+		Aggref	   *aggref = (Aggref *) node;
+		SubLink    *sublink = makeNode(SubLink);
+		bool		is_first;
+
+		if (!is_bookend_aggregate(ctx->catalog, aggref, &is_first))
+			elog(ERROR, "unexpected aggregate in bookend optimization");
+
+		sublink->subLinkType = EXPR_SUBLINK;
+		sublink->subLinkId = 0;
+		sublink->testexpr = NULL;
+		sublink->operName = NIL;
+		sublink->subselect = (Node *) make_bookend_subquery(ctx->orig, aggref, is_first,
+															ctx->group_qual);
+		sublink->location = -1;
+
+		return (Node *) sublink;
+	}
+
+	/* Grouping columns are read from the groups subquery */
+	if (IsA(node, Var) && ctx->group_vars != NIL)
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varno == ctx->rti && var->varlevelsup == 0)
+			return (Node *) makeVar(ctx->group_rti, group_var_position(ctx->group_vars, var),
+									var->vartype, var->vartypmod, var->varcollid, 0);
+
+		return copyObject(node);
+	}
+
+	return expression_tree_mutator(node, replace_bookend_aggs_mutator, ctx);
+}
+
+static bool
+column_is_not_null(Oid relid, AttrNumber attno)
+{
+	HeapTuple	tuple = SearchSysCache2(ATTNUM, ObjectIdGetDatum(relid), Int16GetDatum(attno));
+	bool		notnull;
+
+	if (!HeapTupleIsValid(tuple))
+		return false;
+
+	notnull = ((Form_pg_attribute) GETSTRUCT(tuple))->attnotnull;
+	ReleaseSysCache(tuple);
+
+	return notnull;
+}
+
+/*
+ * Get the grouping columns of a query, if it only groups by columns of the
+ * hypertable that cannot be NULL.
+ */
+static bool
+get_group_vars(Query *parse, RangeTblEntry *rte, Index rti, List **group_vars)
+{
+	ListCell   *lc;
+
+	foreach(lc, parse->groupClause)
+	{
+		SortGroupClause *sgc = lfirst(lc);
+		Var		   *var = (Var *) get_sortgroupclause_expr(sgc, parse->targetList);
+
+		if (!IsA(var, Var) ||
+			var->varno != rti ||
+			var->varlevelsup != 0 ||
+			var->varattno <= 0 ||
+			!OidIsValid(sgc->eqop) ||
+			!OidIsValid(sgc->sortop) ||
+			!column_is_not_null(rte->relid, var->varattno))
+			return false;
+
+		*group_vars = lappend(*group_vars, var);
+	}
+
+	return true;
+}
+
+/*
+ * Create the subquery that enumerates the groups of a grouped query, along
+ * with the qual that matches the rows of a group in the subqueries that
+ * replace the aggregates.
+ */
+static RangeTblEntry *
+make_groups_rte(Query *parse, RangeTblEntry *rte, BookendAggCtx *ctx)
+{
+	Query	   *groups = copyObject(ctx->orig);
+	RangeTblEntry *groups_rte = makeNode(RangeTblEntry);
+	List	   *colnames = NIL;
+	ListCell   *lc_sgc,
+			   *lc_var;
+	AttrNumber	pos = 1;
+
+	groups->targetList = NIL;
+	groups->distinctClause = NIL;
+
+	forboth(lc_sgc, parse->groupClause, lc_var, ctx->group_vars)
+	{
+		SortGroupClause *sgc = copyObject(lfirst(lc_sgc));
+		Var		   *var = lfirst(lc_var);
+		char	   *colname = get_rte_attribute_name(rte, var->varattno);
+		TargetEntry *tle = makeTargetEntry((Expr *) copyObject(var), pos, pstrdup(colname), false);
+		Var		   *group_var = makeVar(ctx->group_rti, pos, var->vartype, var->vartypmod,
+										var->varcollid, 1);
+
+		tle->ressortgroupref = pos;
+		sgc->tleSortGroupRef = pos;
+		groups->targetList = lappend(groups->targetList, tle);
+		groups->distinctClause = lappend(groups->distinctClause, sgc);
+		colnames = lappend(colnames, makeString(pstrdup(colname)));
+
+		ctx->group_qual = make_and_qual(ctx->group_qual,
+										(Node *) make_opclause(sgc->eqop, BOOLOID, false,
+															   (Expr *) copyObject(var),
+															   (Expr *) group_var,
+															   InvalidOid, var->varcollid));
+		pos++;
+	}
+
+	/* Ordered, so that the groups can be found with a skip scan */
+	groups->sortClause = copyObject(groups->distinctClause);
+	groups->groupClause = NIL;
+	groups->havingQual = NULL;
+	groups->hasAggs = false;
+	groups->limitOffset = NULL;
+	groups->limitCount = NULL;
+
+	groups_rte->rtekind = RTE_SUBQUERY;
+	groups_rte->subquery = groups;
+	groups_rte->eref = makeAlias("groups", colnames);
+	groups_rte->inFromCl = true;
+
+	return groups_rte;
+}
+
+/*
+ * Rewrite a query that only computes first() and last() aggregates over a
+ * hypertable into ordered LIMIT 1 subqueries, per group if the query is
+ * grouped. Returns true if the query was rewritten.
+ */
+bool
+agg_bookend_optimization(Query *parse, Hypertable *ht)
+{
+	BookendAggCtx ctx = {
+		.catalog = catalog_get(),
+	};
+	RangeTblRef *rtr;
+	RangeTblEntry *rte;
+
+	if (parse->commandType != CMD_SELECT ||
+		parse->utilityStmt != NULL ||
+		!parse->hasAggs ||
+		parse->groupingSets != NIL ||
+		parse->hasWindowFuncs ||
+		parse->hasSubLinks ||
+		parse->cteList != NIL ||
+		parse->rowMarks != NIL ||
+		parse->setOperations != NULL ||
+		parse->distinctClause != NIL ||
+		list_length(parse->rtable) != 1 ||
+		list_length(parse->jointree->fromlist) != 1 ||
+		expression_returns_set((Node *) parse->targetList))
+		return false;
+
+	rtr = linitial(parse->jointree->fromlist);
+
+	if (!IsA(rtr, RangeTblRef))
+		return false;
+
+	rte = rt_fetch(rtr->rtindex, parse->rtable);
+
+	if (rte->rtekind != RTE_RELATION ||
+		!rte->inh ||
+		rte->tablesample != NULL ||
+		rte->relid != ht->replica_table)
+		return false;
+
+	ctx.rti = rtr->rtindex;
+
+	if (!get_group_vars(parse, rte, ctx.rti, &ctx.group_vars))
+		return false;
+
+	if (find_bookend_aggs_walker((Node *) parse->targetList, &ctx) ||
+		find_bookend_aggs_walker(parse->havingQual, &ctx) ||
+		ctx.found_other ||
+		ctx.num_bookends == 0)
+		return false;
+
+	ctx.orig = copyObject(parse);
+
+	/*
+	 * An aggregate query without GROUP BY always returns exactly one row, so
+	 * the outer query no longer needs to scan anything. A grouped query
+	 * instead scans the groups subquery. The HAVING clause becomes a filter on
+	 * the rows of the outer query. The hypertable stays in the range table so
+	 * that it is still locked and permission checked, but it is not expanded
+	 * into chunks.
+	 */
+	if (ctx.group_vars != NIL)
+	{
+		RangeTblRef *groups_rtr = makeNode(RangeTblRef);
+
+		ctx.group_rti = list_length(parse->rtable) + 1;
+		parse->rtable = lappend(parse->rtable, make_groups_rte(parse, rte, &ctx));
+		groups_rtr->rtindex = ctx.group_rti;
+		parse->jointree->fromlist = list_make1(groups_rtr);
+	}
+	else
+		parse->jointree->fromlist = NIL;
+
+	parse->targetList = (List *) replace_bookend_aggs_mutator((Node *) parse->targetList, &ctx);
+	parse->jointree->quals = replace_bookend_aggs_mutator(parse->havingQual, &ctx);
+	parse->groupClause = NIL;
+	parse->havingQual = NULL;
+	parse->hasAggs = false;
+	parse->hasSubLinks = true;
+	rte->inh = false;
+
+	return true;
+}
@@ -0,0 +1,529 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <catalog/pg_database.h>
+#include <catalog/pg_type.h>
+#include <commands/extension.h>
+#include <executor/spi.h>
+#include <miscadmin.h>
+#include <pgstat.h>
+#include <postmaster/bgworker.h>
+#include <storage/ipc.h>
+#include <storage/latch.h>
+#include <storage/proc.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/guc.h>
+#include <utils/memutils.h>
+#include <utils/snapmgr.h>
+#include <utils/timestamp.h>
+
+#include "bgw_scheduler.h"
+#include "catalog.h"
+#include "guc.h"
+
+/*
+ * Background jobs.
+ *
+ * Policies in _timescaledb_catalog.bgw_policy (see sql/main/bgw_policy.sql)
+ * run as background jobs. Three kinds of background workers are involved:
+ *
+ * - The launcher starts with the server and starts a scheduler for each
+ *   database that accepts connections. It checks for new or stopped
+ *   schedulers every minute. Schedulers of databases without the extension
+ *   exit right away, so the extension can be created at any time.
+ *
+ * - The scheduler of a database starts a job for each policy that is due, up
+ *   to timescaledb.max_background_workers jobs at a time, and sets the next
+ *   start time of the policy. It sleeps until the next policy is due or a job
+ *   finishes.
+ *
+ * - A job runs a single policy as the policy's owner and records the run in
+ *   _timescaledb_catalog.bgw_job_run. Policies that work chunk by chunk
+ *   process each chunk in its own transaction (see run_policy_next()).
+ *
+ * Background jobs require timescaledb in shared_preload_libraries.
+ */
+
+/* How often the launcher looks for new databases */
+#define BGW_LAUNCHER_RESCAN_MS (60 * 1000)
+/* Bounds on how long the scheduler sleeps between checks for due policies */
+#define BGW_SCHEDULER_MIN_WAIT_MS 1000
+#define BGW_SCHEDULER_MAX_WAIT_MS (60 * 1000)
+
+extern void bgw_launcher_main(Datum main_arg);
+extern void bgw_scheduler_main(Datum main_arg);
+extern void bgw_job_main(Datum main_arg);
+
+typedef struct BgwScheduler
+{
+	Oid			dboid;
+	BackgroundWorkerHandle *handle;
+} BgwScheduler;
+
+typedef struct BgwJob
+{
+	int32		policy_id;
+	BackgroundWorkerHandle *handle;
+} BgwJob;
+
+/* Passed to the jobs in bgw_extra */
+typedef struct BgwJobArgs
+{
+	Oid			dboid;
+	Oid			useroid;
+} BgwJobArgs;
+
+static volatile sig_atomic_t got_sigterm = false;
+static volatile sig_atomic_t got_sighup = false;
+
+static void
+bgw_sigterm(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_sigterm = true;
+	SetLatch(MyLatch);
+	errno = save_errno;
+}
+
+static void
+bgw_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_sighup = true;
+	SetLatch(MyLatch);
+	errno = save_errno;
+}
+
+/* Sleep until the timeout, the latch is set or a signal arrives */
+static void
+bgw_wait(long timeout_ms)
+{
+	int			rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+							   timeout_ms);
+
+	ResetLatch(MyLatch);
+
+	if (rc & WL_POSTMASTER_DEATH)
+		proc_exit(1);
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (got_sighup)
+	{
+		got_sighup = false;
+		ProcessConfigFile(PGC_SIGHUP);
+	}
+}
+
+/* Set up a background worker that runs a function of the extension */
+void
+bgw_worker_init(BackgroundWorker *worker, const char *name,
+				const char *function_name, Datum main_arg)
+{
+	memset(worker, 0, sizeof(BackgroundWorker));
+	snprintf(worker->bgw_name, BGW_MAXLEN, "%s", name);
+	worker->bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker->bgw_start_time = BgWorkerStart_RecoveryFinished;
+	worker->bgw_restart_time = BGW_NEVER_RESTART;
+	worker->bgw_main = NULL;
+	snprintf(worker->bgw_library_name, BGW_MAXLEN, EXTENSION_NAME);
+	snprintf(worker->bgw_function_name, BGW_MAXLEN, "%s", function_name);
+	worker->bgw_main_arg = main_arg;
+}
+
+static bool
+bgw_is_running(BackgroundWorkerHandle *handle)
+{
+	pid_t		pid;
+
+	return handle != NULL && GetBackgroundWorkerPid(handle, &pid) != BGWH_STOPPED;
+}
+
+/*
+ * Get the databases that accept connections. The list is allocated in the
+ * caller's memory context.
+ */
+static List *
+bgw_launcher_get_databases(void)
+{
+	MemoryContext resultcxt = CurrentMemoryContext;
+	List	   *databases = NIL;
+	Relation	rel;
+	HeapScanDesc scan;
+	HeapTuple	tuple;
+
+	StartTransactionCommand();
+	(void) GetTransactionSnapshot();
+
+	rel = heap_open(DatabaseRelationId, AccessShareLock);
+	scan = heap_beginscan_catalog(rel, 0, NULL);
+
+	while (HeapTupleIsValid(tuple = heap_getnext(scan, ForwardScanDirection)))
+	{
+		Form_pg_database form = (Form_pg_database) GETSTRUCT(tuple);
+		MemoryContext oldcxt;
+
+		if (!form->datallowconn || form->datistemplate)
+			continue;
+
+		oldcxt = MemoryContextSwitchTo(resultcxt);
+		databases = lappend_oid(databases, HeapTupleGetOid(tuple));
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	heap_endscan(scan);
+	heap_close(rel, AccessShareLock);
+	CommitTransactionCommand();
+
+	return databases;
+}
+
+/* Start a scheduler for each database that does not have a running one */
+static void
+bgw_launcher_start_schedulers(List **schedulers)
+{
+	List	   *databases = bgw_launcher_get_databases();
+	ListCell   *lc;
+
+	foreach(lc, databases)
+	{
+		Oid			dboid = lfirst_oid(lc);
+		BgwScheduler *scheduler = NULL;
+		BackgroundWorker worker;
+		ListCell   *slc;
+
+		foreach(slc, *schedulers)
+		{
+			if (((BgwScheduler *) lfirst(slc))->dboid == dboid)
+				scheduler = lfirst(slc);
+		}
+
+		if (scheduler == NULL)
+		{
+			scheduler = MemoryContextAllocZero(TopMemoryContext, sizeof(BgwScheduler));
+			scheduler->dboid = dboid;
+			*schedulers = lappend(*schedulers, scheduler);
+		}
+		else if (bgw_is_running(scheduler->handle))
+			continue;
+
+		if (scheduler->handle != NULL)
+			pfree(scheduler->handle);
+
+		scheduler->handle = NULL;
+
+		bgw_worker_init(&worker, "timescaledb background job scheduler",
+						"bgw_scheduler_main", ObjectIdGetDatum(dboid));
+
+		if (!RegisterDynamicBackgroundWorker(&worker, &scheduler->handle))
+			ereport(LOG,
+					(errmsg("could not start background job scheduler for database %u", dboid),
+					 errhint("Consider increasing max_worker_processes.")));
+	}
+
+	list_free(databases);
+}
+
+void
+bgw_launcher_main(Datum main_arg)
+{
+	List	   *schedulers = NIL;
+
+	pqsignal(SIGTERM, bgw_sigterm);
+	pqsignal(SIGHUP, bgw_sighup);
+	BackgroundWorkerUnblockSignals();
+
+	/* Only connect to the shared catalogs */
+	BackgroundWorkerInitializeConnection(NULL, NULL);
+
+	while (!got_sigterm)
+	{
+		bgw_launcher_start_schedulers(&schedulers);
+		bgw_wait(BGW_LAUNCHER_RESCAN_MS);
+	}
+
+	proc_exit(0);
+}
+
+static bool
+bgw_extension_exists(void)
+{
+	return OidIsValid(get_extension_oid(EXTENSION_NAME, true));
+}
+
+/*
+ * Start a job for each policy that is due, as long as there are free job
+ * slots. Returns false if the extension does not exist in the database, and
+ * otherwise sets the time to sleep until the next check.
+ */
+static bool
+bgw_scheduler_start_jobs(BgwJob *jobs, long *timeout_ms)
+{
+	int			max_jobs = guc_max_background_workers;
+	BgwJobArgs	args;
+	Datum	   *running;
+	int			num_running = 0;
+	Oid			argtypes[2] = {INT4ARRAYOID, INT4OID};
+	Datum		values[2];
+	bool		isnull;
+	Datum		next_start;
+	int			num_started = 0;
+	int			i;
+	uint64		j;
+	bool		registered;
+	MemoryContext oldcxt;
+
+	StartTransactionCommand();
+
+	if (!bgw_extension_exists())
+	{
+		CommitTransactionCommand();
+		return false;
+	}
+
+	/* Allocated in the transaction's memory, which is freed on commit */
+	running = palloc(sizeof(Datum) * max_jobs);
+
+	for (i = 0; i < max_jobs; i++)
+	{
+		if (jobs[i].handle != NULL && !bgw_is_running(jobs[i].handle))
+		{
+			pfree(jobs[i].handle);
+			jobs[i].handle = NULL;
+		}
+
+		if (jobs[i].handle != NULL)
+			running[num_running++] = Int32GetDatum(jobs[i].policy_id);
+	}
+
+	SPI_connect();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, "scheduling background jobs");
+
+	*timeout_ms = BGW_SCHEDULER_MAX_WAIT_MS;
+
+	if (num_running < max_jobs)
+	{
+		values[0] = PointerGetDatum(construct_array(running, num_running, INT4OID,
+													sizeof(int32), true, 'i'));
+		values[1] = Int32GetDatum(max_jobs - num_running);
+
+		if (SPI_execute_with_args("SELECT * FROM _timescaledb_internal.bgw_policies_due($1, $2)",
+								  2, argtypes, values, NULL, false, 0) != SPI_OK_SELECT)
+			elog(ERROR, "could not get the due background job policies");
+
+		for (j = 0; j < SPI_processed; j++)
+		{
+			int32		policy_id = DatumGetInt32(SPI_getbinval(SPI_tuptable->vals[j],
+															 SPI_tuptable->tupdesc, 1, &isnull));
+			Datum		owner = SPI_getbinval(SPI_tuptable->vals[j],
+											  SPI_tuptable->tupdesc, 2, &isnull);
+			BackgroundWorker worker;
+			BgwJob	   *job = NULL;
+
+			if (isnull)
+			{
+				ereport(LOG,
+						(errmsg("skipping background job for policy %d, its owner does not exist",
+								policy_id)));
+				continue;
+			}
+
+			for (i = 0; i < max_jobs && job == NULL; i++)
+			{
+				if (jobs[i].handle == NULL)
+					job = &jobs[i];
+			}
+
+			Assert(job != NULL);
+
+			bgw_worker_init(&worker, "timescaledb background job", "bgw_job_main",
+							Int32GetDatum(policy_id));
+			memset(&args, 0, sizeof(BgwJobArgs));
+			args.dboid = MyDatabaseId;
+			args.useroid = DatumGetObjectId(owner);
+			memcpy(worker.bgw_extra, &args, sizeof(BgwJobArgs));
+			worker.bgw_notify_pid = MyProcPid;
+
+			/* The handle must outlive the transaction */
+			oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+			registered = RegisterDynamicBackgroundWorker(&worker, &job->handle);
+			MemoryContextSwitchTo(oldcxt);
+
+			/* The policy runs again on its next schedule */
+			if (!registered)
+			{
+				ereport(LOG,
+						(errmsg("could not start background job for policy %d", policy_id),
+						 errhint("Consider increasing max_worker_processes.")));
+				job->handle = NULL;
+				break;
+			}
+
+			job->policy_id = policy_id;
+			num_started++;
+		}
+	}
+
+	/* With all slots taken, wait for a job to finish */
+	if (num_running + num_started < max_jobs)
+	{
+		if (SPI_execute("SELECT _timescaledb_internal.bgw_next_start()", true, 0) != SPI_OK_SELECT)
+			elog(ERROR, "could not get the next start of background job policies");
+
+		next_start = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+
+		if (!isnull)
+		{
+			long		secs;
+			int			usecs;
+
+			TimestampDifference(GetCurrentTimestamp(), DatumGetTimestampTz(next_start),
+								&secs, &usecs);
+			*timeout_ms = Max(BGW_SCHEDULER_MIN_WAIT_MS,
+							  Min(*timeout_ms, secs * 1000 + usecs / 1000));
+		}
+	}
+
+	SPI_finish();
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	return true;
+}
+
+void
+bgw_scheduler_main(Datum main_arg)
+{
+	BgwJob	   *jobs = MemoryContextAllocZero(TopMemoryContext,
+								 sizeof(BgwJob) * guc_max_background_workers);
+
+	pqsignal(SIGTERM, bgw_sigterm);
+	pqsignal(SIGHUP, bgw_sighup);
+	BackgroundWorkerUnblockSignals();
+	BackgroundWorkerInitializeConnectionByOid(DatumGetObjectId(main_arg), InvalidOid);
+
+	while (!got_sigterm)
+	{
+		long		timeout_ms;
+
+		if (!bgw_scheduler_start_jobs(jobs, &timeout_ms))
+			break;
+
+		bgw_wait(timeout_ms);
+	}
+
+	proc_exit(0);
+}
+
+/*
+ * Run a query in its own transaction and return the first column of the
+ * first row. Only by-value results survive the end of the transaction.
+ */
+static Datum
+bgw_job_exec(const char *sql, int nargs, Oid *argtypes, Datum *values,
+			 const char *nulls, bool *isnull)
+{
+	Datum		result = (Datum) 0;
+
+	StartTransactionCommand();
+	SPI_connect();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, sql);
+
+	if (SPI_execute_with_args(sql, nargs, argtypes, values, nulls, false, 0) != SPI_OK_SELECT)
+		elog(ERROR, "could not execute \"%s\"", sql);
+
+	*isnull = true;
+
+	if (SPI_processed > 0)
+		result = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, isnull);
+
+	SPI_finish();
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	return result;
+}
+
+void
+bgw_job_main(Datum main_arg)
+{
+	MemoryContext jobcxt = CurrentMemoryContext;
+	Oid			argtypes[3] = {INT4OID, BOOLOID, TEXTOID};
+	Datum		values[3] = {main_arg, (Datum) 0, (Datum) 0};
+	char		nulls[3] = {' ', ' ', 'n'};
+	BgwJobArgs	args;
+	Datum		more;
+	bool		isnull;
+
+	memcpy(&args, MyBgworkerEntry->bgw_extra, sizeof(BgwJobArgs));
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+	BackgroundWorkerInitializeConnectionByOid(args.dboid, args.useroid);
+
+	/* Policies call the extension's functions without a schema */
+	bgw_job_exec("SELECT set_config('search_path', quote_ident(n.nspname), false) "
+				 "FROM pg_extension e INNER JOIN pg_namespace n ON (n.oid = e.extnamespace) "
+				 "WHERE e.extname = '" EXTENSION_NAME "'",
+				 0, NULL, NULL, NULL, &isnull);
+
+	/* The run ID replaces the policy ID as the first argument from here on */
+	values[0] = bgw_job_exec("SELECT _timescaledb_internal.bgw_job_start($1)",
+							 1, argtypes, values, nulls, &isnull);
+
+	PG_TRY();
+	{
+		/* Commit after each chunk, so that the chunks done so far are kept */
+		do
+		{
+			more = bgw_job_exec("SELECT _timescaledb_internal.run_policy_next($1)",
+								1, argtypes, &main_arg, nulls, &isnull);
+		} while (!isnull && DatumGetBool(more));
+		values[1] = BoolGetDatum(true);
+	}
+	PG_CATCH();
+	{
+		ErrorData  *edata;
+
+		MemoryContextSwitchTo(jobcxt);
+		edata = CopyErrorData();
+		FlushErrorState();
+		AbortCurrentTransaction();
+
+		ereport(LOG,
+				(errmsg("background job for policy %d failed: %s",
+						DatumGetInt32(main_arg), edata->message)));
+
+		values[1] = BoolGetDatum(false);
+		values[2] = CStringGetTextDatum(edata->message);
+		nulls[2] = ' ';
+	}
+	PG_END_TRY();
+
+	bgw_job_exec("SELECT _timescaledb_internal.bgw_job_finish($1, $2, $3)",
+				 3, argtypes, values, nulls, &isnull);
+
+	proc_exit(0);
+}
+
+void
+_bgw_scheduler_init(void)
+{
+	BackgroundWorker worker;
+
+	if (!process_shared_preload_libraries_in_progress || guc_max_background_workers == 0)
+		return;
+
+	bgw_worker_init(&worker, "timescaledb background job launcher",
+					"bgw_launcher_main", (Datum) 0);
+	worker.bgw_restart_time = 60;
+	RegisterBackgroundWorker(&worker);
+}
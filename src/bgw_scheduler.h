@@ -0,0 +1,12 @@
+#ifndef TIMESCALEDB_BGW_SCHEDULER_H
+#define TIMESCALEDB_BGW_SCHEDULER_H
+
+#include <postgres.h>
+#include <postmaster/bgworker.h>
+
+extern void bgw_worker_init(BackgroundWorker *worker, const char *name,
+				const char *function_name, Datum main_arg);
+
+void		_bgw_scheduler_init(void);
+
+#endif   /* TIMESCALEDB_BGW_SCHEDULER_H */
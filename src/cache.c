@@ -1,4 +1,8 @@
+#include <postgres.h>
+#include <portability/instr_time.h>
+
 #include "cache.h"
+#include "cache_stats.h"
 
 void
 cache_init(Cache *cache)
@@ -12,6 +16,11 @@ cache_init(Cache *cache)
 	cache->htab = hash_create(cache->name, cache->numelements,
 							  &cache->hctl, cache->flags);
 	cache->refcount = 1;
+	cache->invalidated = false;
+	dlist_init(&cache->lru);
+	cache->stale = NIL;
+	cache->retired = NIL;
+	cache_stats_attach(cache);
 }
 
 static void
@@ -26,6 +35,8 @@ cache_destroy(Cache *cache)
 	if (cache->pre_destroy_hook != NULL)
 		cache->pre_destroy_hook(cache);
 
+	cache_stats_detach(cache);
+
 	hash_destroy(cache->htab);
 	cache->htab = NULL;
 	MemoryContextDelete(cache->hctl.hcxt);
@@ -37,6 +48,8 @@ cache_invalidate(Cache *cache)
 {
 	if (cache == NULL)
 		return;
+	cache->invalidated = true;
+	cache_stats_invalidated(cache);
 	cache->refcount--;
 	cache_destroy(cache);
 }
@@ -57,11 +70,19 @@ cache_pin(Cache *cache)
 	return cache;
 }
 
+static void cache_evict(Cache *cache, void *keep);
+static void cache_drop_stale(Cache *cache);
+
 extern void
 cache_release(Cache *cache)
 {
 	Assert(cache->refcount > 0);
 	cache->refcount--;
+
+	if (!cache_is_pinned(cache) && !cache->invalidated)
+		cache_drop_stale(cache);
+
+	cache_evict(cache, NULL);
 	cache_destroy(cache);
 }
 
@@ -78,6 +99,209 @@ cache_switch_to_memory_context(Cache *cache)
 	return MemoryContextSwitchTo(cache->hctl.hcxt);
 }
 
+#define cache_is_bounded(cache) ((cache)->get_max_size != NULL)
+#define cache_entry_lru_node(cache, entry) \
+	((CacheLruNode *) ((char *) (entry) + (cache)->lru_offset))
+#define cache_lru_node_entry(cache, node) \
+	((void *) ((char *) (node) - (cache)->lru_offset))
+
+/*
+ * Pin an entry of a cache with a memory budget, so that it is not evicted
+ * while in use. Each call to cache_pin_entry MUST BE paired with a call to
+ * cache_release_entry.
+ */
+void
+cache_pin_entry(Cache *cache, void *entry)
+{
+	if (cache_is_bounded(cache))
+		cache_entry_lru_node(cache, entry)->refcount++;
+}
+
+static void cache_remove_entry(Cache *cache, void *entry);
+
+void
+cache_release_entry(Cache *cache, void *entry)
+{
+	CacheLruNode *lru;
+
+	if (!cache_is_bounded(cache))
+		return;
+
+	lru = cache_entry_lru_node(cache, entry);
+	Assert(lru->refcount > 0);
+	lru->refcount--;
+
+	/* A stale entry is removed once the last pin on it is released */
+	if (lru->refcount == 0 && !cache->invalidated && cache_entry_is_stale(cache, entry))
+		cache_remove_entry(cache, entry);
+
+	cache_evict(cache, NULL);
+}
+
+static Size
+cache_entry_size(Cache *cache, void *entry)
+{
+	if (cache->get_entry_size == NULL)
+		return 0;
+
+	return cache->get_entry_size(entry);
+}
+
+static void *
+cache_stale_key(Cache *cache, void *key)
+{
+	ListCell   *lc;
+
+	foreach(lc, cache->stale)
+	{
+		if (memcmp(lfirst(lc), key, cache->hctl.keysize) == 0)
+			return lfirst(lc);
+	}
+
+	return NULL;
+}
+
+/*
+ * Check whether the entry with the given key was invalidated while it was in
+ * use.
+ */
+bool
+cache_entry_is_stale(Cache *cache, void *key)
+{
+	return cache->stale != NIL && cache_stale_key(cache, key) != NULL;
+}
+
+static void
+cache_unmark_stale(Cache *cache, void *key)
+{
+	void	   *stale_key;
+
+	if (cache->stale == NIL)
+		return;
+
+	stale_key = cache_stale_key(cache, key);
+
+	if (stale_key != NULL)
+	{
+		cache->stale = list_delete_ptr(cache->stale, stale_key);
+		pfree(stale_key);
+	}
+}
+
+/*
+ * Remove an entry. The key of a hash table entry is at the start of the entry,
+ * so the entry itself serves as the key.
+ */
+static void
+cache_remove_entry(Cache *cache, void *entry)
+{
+	cache_unmark_stale(cache, entry);
+	cache->stats.bytes -= cache_entry_size(cache, entry);
+
+	if (cache->free_entry != NULL)
+		cache->free_entry(cache, entry);
+
+	if (cache_is_bounded(cache))
+		dlist_delete(&cache_entry_lru_node(cache, entry)->node);
+
+	hash_search(cache->htab, entry, HASH_REMOVE, NULL);
+	cache->stats.numelements--;
+}
+
+/*
+ * Remove a stale entry from the hash table, so that the next fetch creates a
+ * new one, but keep a copy of it until the cache is released. Holders of the
+ * cache may still use the memory that the entry points to, which is only freed
+ * along with the copy.
+ */
+static void
+cache_retire_entry(Cache *cache, void *entry)
+{
+	MemoryContext old = cache_switch_to_memory_context(cache);
+	void	   *copy = palloc(cache->hctl.entrysize);
+
+	memcpy(copy, entry, cache->hctl.entrysize);
+	cache->retired = lappend(cache->retired, copy);
+	MemoryContextSwitchTo(old);
+
+	cache_unmark_stale(cache, entry);
+	cache->stats.bytes -= cache_entry_size(cache, entry);
+	hash_search(cache->htab, entry, HASH_REMOVE, NULL);
+	cache->stats.numelements--;
+}
+
+/*
+ * Free retired entries and remove stale entries once the cache is no longer
+ * pinned. Stale entries that are pinned themselves are left to
+ * cache_release_entry.
+ */
+static void
+cache_drop_stale(Cache *cache)
+{
+	List	   *stale;
+	ListCell   *lc;
+
+	foreach(lc, cache->retired)
+	{
+		if (cache->free_entry != NULL)
+			cache->free_entry(cache, lfirst(lc));
+		pfree(lfirst(lc));
+	}
+
+	list_free(cache->retired);
+	cache->retired = NIL;
+
+	if (cache->stale == NIL)
+		return;
+
+	stale = list_copy(cache->stale);
+
+	foreach(lc, stale)
+	{
+		void	   *entry = hash_search(cache->htab, lfirst(lc), HASH_FIND, NULL);
+
+		if (entry == NULL)
+			cache_unmark_stale(cache, lfirst(lc));
+		else if (!cache_is_bounded(cache) ||
+				 cache_entry_lru_node(cache, entry)->refcount == 0)
+			cache_remove_entry(cache, entry);
+	}
+
+	list_free(stale);
+}
+
+/*
+ * Evict least recently used entries until the cache is within its memory
+ * budget. Pinned entries and the entry given in keep are skipped. Entries of
+ * an invalidated cache are left to be freed along with the cache.
+ */
+static void
+cache_evict(Cache *cache, void *keep)
+{
+	Size		max_size;
+	dlist_node *node;
+
+	if (!cache_is_bounded(cache) || cache->invalidated)
+		return;
+
+	max_size = cache->get_max_size();
+	node = cache->lru.head.prev;
+
+	while (cache->stats.bytes > max_size && node != &cache->lru.head)
+	{
+		CacheLruNode *lru = dlist_container(CacheLruNode, node, node);
+		void	   *entry = cache_lru_node_entry(cache, lru);
+
+		node = node->prev;
+
+		if (entry == keep || lru->refcount > 0)
+			continue;
+
+		cache_remove_entry(cache, entry);
+		cache->stats.evictions++;
+	}
+}
+
 void *
 cache_fetch(Cache *cache, CacheQuery *query)
 {
@@ -89,6 +313,23 @@ cache_fetch(Cache *cache, CacheQuery *query)
 		elog(ERROR, "Hash %s not initialized", cache->name);
 	}
 
+	/*
+	 * A stale entry is replaced by a new one. Holders of pinned entries keep
+	 * pointers into the entries themselves, however, so those are only
+	 * removed when released.
+	 */
+	if (cache_entry_is_stale(cache, cache->get_key(query)))
+	{
+		void	   *entry = hash_search(cache->htab, cache->get_key(query), HASH_FIND, NULL);
+
+		if (entry == NULL)
+			cache_unmark_stale(cache, cache->get_key(query));
+		else if (!cache_is_bounded(cache))
+			cache_retire_entry(cache, entry);
+		else if (cache_entry_lru_node(cache, entry)->refcount == 0)
+			cache_remove_entry(cache, entry);
+	}
+
 	query->result = hash_search(cache->htab, cache->get_key(query), action, &found);
 
 	if (found)
@@ -99,9 +340,14 @@ cache_fetch(Cache *cache, CacheQuery *query)
 		{
 			MemoryContext old = cache_switch_to_memory_context(cache);
 
+			cache->stats.bytes -= cache_entry_size(cache, query->result);
 			query->result = cache->update_entry(cache, query);
+			cache->stats.bytes += cache_entry_size(cache, query->result);
 			MemoryContextSwitchTo(old);
 		}
+
+		if (cache_is_bounded(cache))
+			dlist_move_head(&cache->lru, &cache_entry_lru_node(cache, query->result)->node);
 	}
 	else
 	{
@@ -110,13 +356,52 @@ cache_fetch(Cache *cache, CacheQuery *query)
 		if (cache->create_entry != NULL)
 		{
 			MemoryContext old = cache_switch_to_memory_context(cache);
+			instr_time	start,
+						duration;
+
+			INSTR_TIME_SET_CURRENT(start);
+
+			/*
+			 * The hash table entry exists before it is filled in, so remove it
+			 * again if creating the entry fails. The entry is only added to
+			 * the LRU list once it is complete, and is pinned until then so
+			 * that invalidations only mark it stale.
+			 */
+			if (cache_is_bounded(cache))
+				cache_entry_lru_node(cache, query->result)->refcount = 1;
 
-			query->result = cache->create_entry(cache, query);
+			PG_TRY();
+			{
+				query->result = cache->create_entry(cache, query);
+			}
+			PG_CATCH();
+			{
+				MemoryContextSwitchTo(old);
+				hash_search(cache->htab, cache->get_key(query), HASH_REMOVE, NULL);
+				PG_RE_THROW();
+			}
+			PG_END_TRY();
+
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start);
 			MemoryContextSwitchTo(old);
+			cache->stats.create_time += INSTR_TIME_GET_MICROSEC(duration);
 			cache->stats.numelements++;
+			cache->stats.bytes += cache_entry_size(cache, query->result);
+
+			if (cache_is_bounded(cache))
+			{
+				CacheLruNode *lru = cache_entry_lru_node(cache, query->result);
+
+				lru->refcount = 0;
+				dlist_push_head(&cache->lru, &lru->node);
+			}
 		}
 	}
 
+	if (query->result != NULL)
+		cache_evict(cache, query->result);
+
 	return query->result;
 }
 
@@ -124,12 +409,52 @@ bool
 cache_remove(Cache *cache, void *key)
 {
 	bool		found;
-
-	hash_search(cache->htab, key, HASH_REMOVE, &found);
+	void	   *entry = hash_search(cache->htab, key, HASH_FIND, &found);
 
 	if (found)
 	{
-		cache->stats.numelements--;
+		cache_remove_entry(cache, entry);
 	}
 	return found;
 }
+
+/*
+ * A cache is pinned if anyone but the cache's owner holds a reference to it,
+ * in which case its entries may be in use.
+ */
+bool
+cache_is_pinned(Cache *cache)
+{
+	return cache->refcount > 1;
+}
+
+/*
+ * Invalidate a single cache entry. Entries of a pinned cache may be in use and
+ * cannot be removed right away, except for the unpinned entries of a cache
+ * with a memory budget, which cache_evict() removes as well. An entry in use
+ * is instead marked stale, replaced on the next fetch and removed once the
+ * cache or the entry is released, while the other entries stay cached.
+ */
+void
+cache_invalidate_entry(Cache *cache, void *key)
+{
+	void	   *entry = hash_search(cache->htab, key, HASH_FIND, NULL);
+	MemoryContext old;
+	void	   *stale_key;
+
+	if (entry == NULL || cache_entry_is_stale(cache, key))
+		return;
+
+	if (!cache_is_pinned(cache) ||
+		(cache_is_bounded(cache) && cache_entry_lru_node(cache, entry)->refcount == 0))
+	{
+		cache_remove_entry(cache, entry);
+		return;
+	}
+
+	old = cache_switch_to_memory_context(cache);
+	stale_key = palloc(cache->hctl.keysize);
+	memcpy(stale_key, key, cache->hctl.keysize);
+	cache->stale = lappend(cache->stale, stale_key);
+	MemoryContextSwitchTo(old);
+}
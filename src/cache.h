@@ -4,6 +4,8 @@
 #include <postgres.h>
 #include <utils/memutils.h>
 #include <utils/hsearch.h>
+#include <lib/ilist.h>
+#include <nodes/pg_list.h>
 
 typedef struct CacheQuery
 {
@@ -11,11 +13,27 @@ typedef struct CacheQuery
 	void	   *data[0];
 } CacheQuery;
 
+/*
+ * LRU list node of an entry in a cache with a memory budget. An entry with
+ * pins is never evicted.
+ */
+typedef struct CacheLruNode
+{
+	dlist_node	node;
+	int			refcount;
+} CacheLruNode;
+
 typedef struct CacheStats
 {
 	long		numelements;
 	uint64		hits;
 	uint64		misses;
+	uint64		evictions;
+	/* Memory used by entries, if the cache has get_entry_size */
+	Size		bytes;
+	uint64		invalidations;
+	/* Time spent creating entries, in microseconds */
+	uint64		create_time;
 } CacheStats;
 
 typedef struct Cache
@@ -31,17 +49,52 @@ typedef struct Cache
 	void	   *(*create_entry) (struct Cache *, CacheQuery *);
 	void	   *(*update_entry) (struct Cache *, CacheQuery *);
 	void		(*pre_destroy_hook) (struct Cache *);
+
+	/*
+	 * Optional memory accounting. get_entry_size returns the memory used by an
+	 * entry, including memory that the entry points to, and free_entry frees
+	 * that memory when the entry is removed.
+	 */
+	Size		(*get_entry_size) (void *entry);
+	void		(*free_entry) (struct Cache *, void *entry);
+
+	/*
+	 * Optional memory budget in bytes. If get_max_size is set, entries are
+	 * kept in LRU order through a CacheLruNode at lru_offset in each entry,
+	 * and the least recently used entries are evicted while the cache is over
+	 * budget. Pinning the cache does not keep its entries from being evicted,
+	 * so an entry that is used across fetches must be pinned itself with
+	 * cache_pin_entry.
+	 */
+	Size		(*get_max_size) (void);
+	Size		lru_offset;
+	dlist_head	lru;
+	bool		invalidated;
+
+	/*
+	 * Entries invalidated while they may be in use. The keys of stale entries
+	 * are kept until the entries are replaced on the next fetch or removed
+	 * when no longer in use, and replaced entries are kept until the cache is
+	 * released.
+	 */
+	List	   *stale;
+	List	   *retired;
 } Cache;
 
 extern void cache_init(Cache *cache);
 extern void cache_invalidate(Cache *cache);
 extern void *cache_fetch(Cache *cache, CacheQuery *ctx);
 extern bool cache_remove(Cache *cache, void *key);
+extern bool cache_is_pinned(Cache *cache);
+extern void cache_invalidate_entry(Cache *cache, void *key);
+extern bool cache_entry_is_stale(Cache *cache, void *key);
 
 extern MemoryContext cache_memory_ctx(Cache *cache);
 extern MemoryContext cache_switch_to_memory_context(Cache *cache);
 
 extern Cache *cache_pin(Cache *cache);
 extern void cache_release(Cache *cache);
+extern void cache_pin_entry(Cache *cache, void *entry);
+extern void cache_release_entry(Cache *cache, void *entry);
 
 #endif   /* TIMESCALEDB_CACHE_H */
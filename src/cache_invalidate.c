@@ -15,6 +15,11 @@
  *	tables whose changes should invalidate the cache. This trigger will
  *	invalidate the relcache for the proxy table specified as the first argument
  *	to the trigger (see cache.sql).
+ *
+ *	Most catalog changes only affect a single hypertable or chunk, however.
+ *	For those, row triggers instead invalidate the relcache of the affected
+ *	hypertable's main table or the affected chunk tables, and the callback
+ *	only drops the cache entries for those relations.
  */
 
 #include <postgres.h>
@@ -30,8 +35,11 @@
 
 #include "hypertable_cache.h"
 #include "chunk_cache.h"
+#include "monotonic_function_cache.h"
 #include "catalog.h"
 #include "extension.h"
+#include "shared_cache.h"
+#include "catalog_snapshot.h"
 
 void		_cache_invalidate_init(void);
 void		_cache_invalidate_fini(void);
@@ -52,7 +60,15 @@ inval_cache_callback(Datum arg, Oid relid)
 	if (!OidIsValid(relid) || extension_is_being_dropped(relid))
 	{
 		/* Extension was dropped or entire cache invalidated. Reset state. */
+		if (OidIsValid(relid))
+		{
+			shared_cache_invalidate_at_commit(CACHE_TYPE_HYPERTABLE);
+			shared_cache_invalidate_at_commit(CACHE_TYPE_CHUNK);
+			catalog_snapshot_invalidate_at_commit();
+		}
+
 		hypertable_cache_invalidate_callback();
+		monotonic_function_cache_invalidate_callback();
 		chunk_cache_invalidate_callback();
 		extension_reset();
 		return;
@@ -61,10 +77,39 @@ inval_cache_callback(Datum arg, Oid relid)
 	if (relid == catalog_get_cache_proxy_id(catalog, CACHE_TYPE_HYPERTABLE))
 	{
 		hypertable_cache_invalidate_callback();
+		monotonic_function_cache_invalidate_callback();
+		return;
 	}
 
 	if (relid == catalog_get_cache_proxy_id(catalog, CACHE_TYPE_CHUNK))
+	{
 		chunk_cache_invalidate_callback();
+		return;
+	}
+
+	/*
+	 * Any other relation may be the main table of a hypertable or a chunk
+	 * table, whose entries are invalidated individually (see
+	 * invalidate_cache_entry()).
+	 */
+	hypertable_cache_invalidate_entry(relid);
+	chunk_cache_invalidate_table(relid);
+}
+
+/*
+ * Invalidate the shared cache of the given proxy table when the transaction
+ * commits.
+ */
+static void
+shared_cache_invalidate_proxy(Catalog *catalog, Oid proxy_oid)
+{
+	int			i;
+
+	for (i = 0; i < _MAX_CACHE_TYPES; i++)
+	{
+		if (catalog_get_cache_proxy_id(catalog, i) == proxy_oid)
+			shared_cache_invalidate_at_commit(i);
+	}
 }
 
 PG_FUNCTION_INFO_V1(invalidate_relcache_trigger);
@@ -90,6 +135,8 @@ invalidate_relcache_trigger(PG_FUNCTION_ARGS)
 	proxy_oid = catalog_get_cache_proxy_id_by_name(catalog, trigdata->tg_trigger->tgargs[0]);
 	CacheInvalidateRelcacheByRelid(proxy_oid);
 
+	shared_cache_invalidate_proxy(catalog, proxy_oid);
+
 	/* tuple to return to executor */
 	if (TRIGGER_FIRED_BY_UPDATE(trigdata->tg_event))
 		return PointerGetDatum(trigdata->tg_newtuple);
@@ -97,6 +144,30 @@ invalidate_relcache_trigger(PG_FUNCTION_ARGS)
 		return PointerGetDatum(trigdata->tg_trigtuple);
 }
 
+PG_FUNCTION_INFO_V1(invalidate_cache_entry);
+
+/*
+ * Invalidate the cache entries associated with a relation (arg 1), e.g., the
+ * main table of a hypertable or a chunk table, instead of the whole cache of
+ * the proxy table named by arg 0. The relcache invalidation of the relation
+ * reaches all backends, which drop only the entries for that relation in
+ * inval_cache_callback(). A NULL relation only invalidates the shared cache.
+ */
+Datum
+invalidate_cache_entry(PG_FUNCTION_ARGS)
+{
+	Catalog    *catalog = catalog_get();
+	Oid			proxy_oid = catalog_get_cache_proxy_id_by_name(catalog,
+											  NameStr(*PG_GETARG_NAME(0)));
+
+	shared_cache_invalidate_proxy(catalog, proxy_oid);
+
+	if (!PG_ARGISNULL(1))
+		CacheInvalidateRelcacheByRelid(PG_GETARG_OID(1));
+
+	PG_RETURN_VOID();
+}
+
 PG_FUNCTION_INFO_V1(invalidate_relcache);
 
 /*
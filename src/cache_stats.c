@@ -0,0 +1,411 @@
+#include <postgres.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <storage/spin.h>
+#include <utils/builtins.h>
+
+#include "cache_stats.h"
+
+/*
+ * Cache statistics.
+ *
+ * Each cache instance counts its hits, misses and evictions in Cache.stats.
+ * A cache is replaced by a new instance when it is invalidated, so the
+ * counters of invalidated instances are added to totals that live as long as
+ * the backend, along with the number of invalidations. The number of entries
+ * and the memory used are those of the current instance.
+ *
+ * When the extension is in shared_preload_libraries, each backend also adds
+ * its statistics to totals in shared memory at the end of each transaction.
+ * The number of entries and the memory used are added as the difference to the
+ * previously added values, and subtracted again when the backend exits.
+ */
+
+#define CACHE_STATS_MAX_CACHES 8
+
+typedef struct CacheStatsEntry
+{
+	const char *name;
+	/* The current instance of the cache, if any */
+	Cache	   *current;
+	/* Counters of invalidated instances, and the number of invalidations */
+	CacheStats	totals;
+	/* The statistics last added to shared memory */
+	CacheStats	published;
+} CacheStatsEntry;
+
+static CacheStatsEntry backend_stats[CACHE_STATS_MAX_CACHES];
+static int	num_backend_stats = 0;
+
+typedef struct SharedCacheStatsEntry
+{
+	NameData	name;
+	CacheStats	stats;
+} SharedCacheStatsEntry;
+
+typedef struct SharedCacheStats
+{
+	slock_t		mutex;
+	int			num_caches;
+	SharedCacheStatsEntry caches[CACHE_STATS_MAX_CACHES];
+} SharedCacheStats;
+
+static SharedCacheStats *shared_stats = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+static bool exit_callback_registered = false;
+
+static CacheStatsEntry *
+cache_stats_entry(const char *name)
+{
+	CacheStatsEntry *entry;
+	int			i;
+
+	for (i = 0; i < num_backend_stats; i++)
+	{
+		if (strcmp(backend_stats[i].name, name) == 0)
+			return &backend_stats[i];
+	}
+
+	if (num_backend_stats >= CACHE_STATS_MAX_CACHES)
+		elog(ERROR, "Too many caches to keep statistics for");
+
+	entry = &backend_stats[num_backend_stats++];
+	memset(entry, 0, sizeof(CacheStatsEntry));
+	entry->name = name;
+
+	return entry;
+}
+
+/* Add counters, but not the number of entries and the memory used */
+static void
+cache_stats_add_counters(CacheStats *totals, CacheStats *stats)
+{
+	totals->hits += stats->hits;
+	totals->misses += stats->misses;
+	totals->evictions += stats->evictions;
+	totals->invalidations += stats->invalidations;
+	totals->create_time += stats->create_time;
+}
+
+static void
+cache_stats_reset_counters(CacheStats *stats)
+{
+	stats->hits = 0;
+	stats->misses = 0;
+	stats->evictions = 0;
+	stats->invalidations = 0;
+	stats->create_time = 0;
+}
+
+static void
+cache_stats_get(CacheStatsEntry *entry, CacheStats *stats)
+{
+	*stats = entry->totals;
+
+	if (entry->current != NULL)
+	{
+		cache_stats_add_counters(stats, &entry->current->stats);
+		stats->numelements = entry->current->stats.numelements;
+		stats->bytes = entry->current->stats.bytes;
+	}
+}
+
+/* Called when a new instance of a cache is created */
+void
+cache_stats_attach(Cache *cache)
+{
+	cache_stats_entry(cache->name)->current = cache;
+}
+
+/*
+ * Called when a cache is invalidated. The instance may live on while it is
+ * pinned, so its counters are moved to the totals and it keeps counting from
+ * zero until it is destroyed.
+ */
+void
+cache_stats_invalidated(Cache *cache)
+{
+	CacheStatsEntry *entry = cache_stats_entry(cache->name);
+
+	cache_stats_add_counters(&entry->totals, &cache->stats);
+	cache_stats_reset_counters(&cache->stats);
+	entry->totals.invalidations++;
+
+	if (entry->current == cache)
+		entry->current = NULL;
+}
+
+/* Called when a cache is destroyed */
+void
+cache_stats_detach(Cache *cache)
+{
+	CacheStatsEntry *entry = cache_stats_entry(cache->name);
+
+	cache_stats_add_counters(&entry->totals, &cache->stats);
+
+	if (entry->current == cache)
+		entry->current = NULL;
+}
+
+/* Find or add the shared statistics of a cache. Requires the mutex. */
+static CacheStats *
+shared_cache_stats_entry(const char *name)
+{
+	SharedCacheStatsEntry *entry;
+	int			i;
+
+	for (i = 0; i < shared_stats->num_caches; i++)
+	{
+		if (strcmp(NameStr(shared_stats->caches[i].name), name) == 0)
+			return &shared_stats->caches[i].stats;
+	}
+
+	if (shared_stats->num_caches >= CACHE_STATS_MAX_CACHES)
+		return NULL;
+
+	entry = &shared_stats->caches[shared_stats->num_caches++];
+	namestrcpy(&entry->name, name);
+	memset(&entry->stats, 0, sizeof(CacheStats));
+
+	return &entry->stats;
+}
+
+static void
+cache_stats_shmem_exit(int code, Datum arg)
+{
+	int			i;
+
+	SpinLockAcquire(&shared_stats->mutex);
+
+	for (i = 0; i < num_backend_stats; i++)
+	{
+		CacheStatsEntry *entry = &backend_stats[i];
+		CacheStats *shared = shared_cache_stats_entry(entry->name);
+
+		if (NULL == shared)
+			continue;
+
+		shared->numelements -= entry->published.numelements;
+		shared->bytes -= entry->published.bytes;
+	}
+
+	SpinLockRelease(&shared_stats->mutex);
+}
+
+/* Add the changes since the last call to the statistics in shared memory */
+static void
+cache_stats_publish(void)
+{
+	int			i;
+
+	if (NULL == shared_stats)
+		return;
+
+	if (!exit_callback_registered)
+	{
+		before_shmem_exit(cache_stats_shmem_exit, (Datum) 0);
+		exit_callback_registered = true;
+	}
+
+	for (i = 0; i < num_backend_stats; i++)
+	{
+		CacheStatsEntry *entry = &backend_stats[i];
+		CacheStats	stats;
+		CacheStats *shared;
+
+		cache_stats_get(entry, &stats);
+
+		if (stats.numelements == entry->published.numelements &&
+			stats.bytes == entry->published.bytes &&
+			stats.hits == entry->published.hits &&
+			stats.misses == entry->published.misses &&
+			stats.evictions == entry->published.evictions &&
+			stats.invalidations == entry->published.invalidations)
+			continue;
+
+		SpinLockAcquire(&shared_stats->mutex);
+
+		shared = shared_cache_stats_entry(entry->name);
+
+		if (NULL != shared)
+		{
+			shared->numelements += stats.numelements - entry->published.numelements;
+			shared->bytes += stats.bytes - entry->published.bytes;
+			shared->hits += stats.hits - entry->published.hits;
+			shared->misses += stats.misses - entry->published.misses;
+			shared->evictions += stats.evictions - entry->published.evictions;
+			shared->invalidations += stats.invalidations - entry->published.invalidations;
+			shared->create_time += stats.create_time - entry->published.create_time;
+		}
+
+		SpinLockRelease(&shared_stats->mutex);
+
+		entry->published = stats;
+	}
+}
+
+static void
+cache_stats_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_ABORT:
+			cache_stats_publish();
+			break;
+		default:
+			break;
+	}
+}
+
+typedef struct CacheStatsRow
+{
+	NameData	name;
+	CacheStats	stats;
+} CacheStatsRow;
+
+#define Natts_cache_stats 9
+
+PG_FUNCTION_INFO_V1(cache_stats);
+
+/*
+ * Get the statistics of the caches, either of the current backend or, if arg 0
+ * is true, summed over all backends.
+ */
+Datum
+cache_stats(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	CacheStatsRow *rows;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		bool		shared = PG_GETARG_BOOL(0);
+		MemoryContext old;
+		TupleDesc	tupdesc;
+		int			i;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+		old = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR, "Function returning record called in context that cannot accept type record");
+
+		funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+		rows = palloc0(sizeof(CacheStatsRow) * CACHE_STATS_MAX_CACHES);
+
+		if (!shared)
+		{
+			for (i = 0; i < num_backend_stats; i++)
+			{
+				namestrcpy(&rows[i].name, backend_stats[i].name);
+				cache_stats_get(&backend_stats[i], &rows[i].stats);
+			}
+			funcctx->max_calls = num_backend_stats;
+		}
+		else
+		{
+			if (NULL == shared_stats)
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						 errmsg("shared cache statistics are not available"),
+						 errhint("Add timescaledb to shared_preload_libraries.")));
+
+			cache_stats_publish();
+
+			SpinLockAcquire(&shared_stats->mutex);
+			for (i = 0; i < shared_stats->num_caches; i++)
+			{
+				rows[i].name = shared_stats->caches[i].name;
+				rows[i].stats = shared_stats->caches[i].stats;
+			}
+			funcctx->max_calls = shared_stats->num_caches;
+			SpinLockRelease(&shared_stats->mutex);
+		}
+
+		funcctx->user_fctx = rows;
+		MemoryContextSwitchTo(old);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	rows = funcctx->user_fctx;
+
+	if (funcctx->call_cntr < funcctx->max_calls)
+	{
+		CacheStatsRow *row = &rows[funcctx->call_cntr];
+		CacheStats *stats = &row->stats;
+		Datum		values[Natts_cache_stats];
+		bool		nulls[Natts_cache_stats] = {false};
+		HeapTuple	tuple;
+
+		values[0] = NameGetDatum(&row->name);
+		values[1] = Int64GetDatum(stats->numelements);
+		values[2] = Int64GetDatum(stats->bytes);
+		values[3] = Int64GetDatum(stats->hits);
+		values[4] = Int64GetDatum(stats->misses);
+
+		if (stats->hits + stats->misses > 0)
+			values[5] = Float8GetDatum((double) stats->hits / (stats->hits + stats->misses));
+		else
+			nulls[5] = true;
+
+		values[6] = Int64GetDatum(stats->evictions);
+		values[7] = Int64GetDatum(stats->invalidations);
+		values[8] = Float8GetDatum(stats->create_time / 1000.0);
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+static void
+cache_stats_shmem_startup(void)
+{
+	bool		found;
+
+	if (prev_shmem_startup_hook != NULL)
+		prev_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	shared_stats = ShmemInitStruct("timescaledb cache stats",
+								   sizeof(SharedCacheStats), &found);
+
+	if (!found)
+	{
+		SpinLockInit(&shared_stats->mutex);
+		shared_stats->num_caches = 0;
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+void
+_cache_stats_init(void)
+{
+	RegisterXactCallback(cache_stats_xact_callback, NULL);
+
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	RequestAddinShmemSpace(sizeof(SharedCacheStats));
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = cache_stats_shmem_startup;
+}
+
+void
+_cache_stats_fini(void)
+{
+	UnregisterXactCallback(cache_stats_xact_callback, NULL);
+
+	if (shmem_startup_hook == cache_stats_shmem_startup)
+		shmem_startup_hook = prev_shmem_startup_hook;
+}
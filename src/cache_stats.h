@@ -0,0 +1,15 @@
+#ifndef TIMESCALEDB_CACHE_STATS_H
+#define TIMESCALEDB_CACHE_STATS_H
+
+#include <postgres.h>
+
+#include "cache.h"
+
+extern void cache_stats_attach(Cache *cache);
+extern void cache_stats_invalidated(Cache *cache);
+extern void cache_stats_detach(Cache *cache);
+
+extern void _cache_stats_init(void);
+extern void _cache_stats_fini(void);
+
+#endif   /* TIMESCALEDB_CACHE_STATS_H */
@@ -3,6 +3,9 @@
 #include <utils/lsyscache.h>
 #include <miscadmin.h>
 #include <commands/dbcommands.h>
+#include <catalog/pg_type.h>
+#include <nodes/makefuncs.h>
+#include <parser/parse_func.h>
 
 #include "catalog.h"
 #include "extension.h"
@@ -15,6 +18,15 @@ static const char *catalog_table_names[_MAX_CATALOG_TABLES] = {
 	[PARTITION_EPOCH] = PARTITION_EPOCH_TABLE_NAME,
 	[CHUNK] = CHUNK_TABLE_NAME,
 	[CHUNK_REPLICA_NODE] = CHUNK_REPLICA_NODE_TABLE_NAME,
+	[MONOTONIC_FUNCTION] = MONOTONIC_FUNCTION_TABLE_NAME,
+	[CHUNK_COMPRESSION] = CHUNK_COMPRESSION_TABLE_NAME,
+	[CHUNK_REPLICA_NODE_INDEX] = CHUNK_REPLICA_NODE_INDEX_TABLE_NAME,
+	[CHUNK_ZONE_MAP] = CHUNK_ZONE_MAP_TABLE_NAME,
+	[CHUNK_ZONE_MAP_DELTA] = CHUNK_ZONE_MAP_DELTA_TABLE_NAME,
+	[CHUNK_TABLESPACE] = CHUNK_TABLESPACE_TABLE_NAME,
+	[CHUNK_SEAL] = CHUNK_SEAL_TABLE_NAME,
+	[CONTINUOUS_AGG] = CONTINUOUS_AGG_TABLE_NAME,
+	[CONTINUOUS_AGG_INVALIDATION] = CONTINUOUS_AGG_INVALIDATION_TABLE_NAME,
 };
 
 typedef struct TableIndexDef
@@ -68,6 +80,62 @@ const static TableIndexDef catalog_table_index_definitions[_MAX_CATALOG_TABLES]
 		.length = _MAX_CHUNK_REPLICA_NODE_INDEX,
 		.names = (char *[]) {
 			[CHUNK_REPLICA_NODE_ID_INDEX] = "chunk_replica_node_pkey",
+			[CHUNK_REPLICA_NODE_SCHEMA_TABLE_INDEX] = "chunk_replica_node_schema_name_table_name_key",
+		}
+	},
+	[MONOTONIC_FUNCTION] = {
+		.length = _MAX_MONOTONIC_FUNCTION_INDEX,
+		.names = (char *[]) {
+			[MONOTONIC_FUNCTION_ID_INDEX] = "monotonic_function_pkey",
+		}
+	},
+	[CHUNK_COMPRESSION] = {
+		.length = _MAX_CHUNK_COMPRESSION_INDEX,
+		.names = (char *[]) {
+			[CHUNK_COMPRESSION_ID_INDEX] = "chunk_compression_pkey",
+		}
+	},
+	[CHUNK_REPLICA_NODE_INDEX] = {
+		.length = _MAX_CHUNK_REPLICA_NODE_INDEX_INDEX,
+		.names = (char *[]) {
+			[CHUNK_REPLICA_NODE_INDEX_ID_INDEX] = "chunk_replica_node_index_pkey",
+		}
+	},
+	[CHUNK_ZONE_MAP] = {
+		.length = _MAX_CHUNK_ZONE_MAP_INDEX,
+		.names = (char *[]) {
+			[CHUNK_ZONE_MAP_ID_INDEX] = "chunk_zone_map_pkey",
+		}
+	},
+	[CHUNK_ZONE_MAP_DELTA] = {
+		.length = _MAX_CHUNK_ZONE_MAP_DELTA_INDEX,
+		.names = (char *[]) {
+			[CHUNK_ZONE_MAP_DELTA_ID_INDEX] = "chunk_zone_map_delta_chunk_id_column_name_idx",
+		}
+	},
+	[CHUNK_TABLESPACE] = {
+		.length = _MAX_CHUNK_TABLESPACE_INDEX,
+		.names = (char *[]) {
+			[CHUNK_TABLESPACE_ID_INDEX] = "chunk_tablespace_pkey",
+		}
+	},
+	[CHUNK_SEAL] = {
+		.length = _MAX_CHUNK_SEAL_INDEX,
+		.names = (char *[]) {
+			[CHUNK_SEAL_ID_INDEX] = "chunk_seal_pkey",
+		}
+	},
+	[CONTINUOUS_AGG] = {
+		.length = _MAX_CONTINUOUS_AGG_INDEX,
+		.names = (char *[]) {
+			[CONTINUOUS_AGG_ID_INDEX] = "continuous_agg_pkey",
+			[CONTINUOUS_AGG_RAW_HYPERTABLE_INDEX] = "continuous_agg_raw_hypertable_id_idx",
+		}
+	},
+	[CONTINUOUS_AGG_INVALIDATION] = {
+		.length = _MAX_CONTINUOUS_AGG_INVALIDATION_INDEX,
+		.names = (char *[]) {
+			[CONTINUOUS_AGG_INVALIDATION_ID_INDEX] = "continuous_agg_invalidation_continuous_agg_id_idx",
 		}
 	},
 };
@@ -79,6 +147,28 @@ static const char *cache_proxy_table_names[_MAX_CACHE_TYPES] = {
 	[CACHE_TYPE_CHUNK] = "cache_inval_chunk",
 };
 
+typedef struct FunctionDef
+{
+	const char *name;
+	int			nargs;
+	Oid			argtypes[3];
+} FunctionDef;
+
+/* Internal functions looked up by C code. Must match definitions in
+ * sql/main/agg_bookend.sql */
+static const FunctionDef catalog_function_definitions[_MAX_CATALOG_FUNCTIONS] = {
+	[FIRST_SFUNC] = {
+		.name = "first_sfunc",
+		.nargs = 3,
+		.argtypes = {INTERNALOID, ANYELEMENTOID, ANYOID},
+	},
+	[LAST_SFUNC] = {
+		.name = "last_sfunc",
+		.nargs = 3,
+		.argtypes = {INTERNALOID, ANYELEMENTOID, ANYOID},
+	},
+};
+
 /* Catalog information for the current database. */
 static Catalog catalog = {
 	.database_id = InvalidOid,
@@ -156,6 +246,17 @@ catalog_get(void)
 													catalog.cache_schema_id);
 	}
 
+	catalog.internal_schema_id = get_namespace_oid(INTERNAL_SCHEMA_NAME, false);
+
+	for (i = 0; i < _MAX_CATALOG_FUNCTIONS; i++)
+	{
+		const FunctionDef *def = &catalog_function_definitions[i];
+		List	   *funcname = list_make2(makeString(INTERNAL_SCHEMA_NAME),
+										  makeString((char *) def->name));
+
+		catalog.functions[i].id = LookupFuncName(funcname, def->nargs, def->argtypes, false);
+	}
+
 	return &catalog;
 }
 
@@ -196,3 +297,9 @@ catalog_get_cache_proxy_id_by_name(Catalog *catalog, const char *relname)
 
 	return catalog->caches[i].inval_proxy_id;
 }
+
+Oid
+catalog_get_function_id(Catalog *catalog, CatalogFunction func)
+{
+	return catalog->functions[func].id;
+}
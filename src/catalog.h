@@ -27,11 +27,21 @@ enum CatalogTable
 	PARTITION,
 	CHUNK,
 	CHUNK_REPLICA_NODE,
+	MONOTONIC_FUNCTION,
+	CHUNK_COMPRESSION,
+	CHUNK_REPLICA_NODE_INDEX,
+	CHUNK_ZONE_MAP,
+	CHUNK_ZONE_MAP_DELTA,
+	CHUNK_TABLESPACE,
+	CHUNK_SEAL,
+	CONTINUOUS_AGG,
+	CONTINUOUS_AGG_INVALIDATION,
 	_MAX_CATALOG_TABLES,
 };
 
 #define CATALOG_SCHEMA_NAME "_timescaledb_catalog"
 #define CACHE_SCHEMA_NAME "_timescaledb_cache"
+#define INTERNAL_SCHEMA_NAME "_timescaledb_internal"
 #define EXTENSION_NAME "timescaledb"
 
 /******************************
@@ -280,6 +290,15 @@ enum Anum_chunk
 #define Natts_chunk \
 	(_Anum_chunk_max - 1)
 
+enum Anum_chunk_pkey_idx
+{
+	Anum_chunk_pkey_idx_id = 1,
+	_Anum_chunk_pkey_idx_max,
+};
+
+#define Natts_chunk_pkey_idx \
+	(_Anum_chunk_pkey_idx_max - 1)
+
 enum Anum_chunk_partition_start_time_end_time_idx
 {
 	Anum_chunk_partition_start_time_end_time_idx_partition_id = 1,
@@ -302,6 +321,7 @@ enum Anum_chunk_partition_start_time_end_time_idx
 enum
 {
 	CHUNK_REPLICA_NODE_ID_INDEX = 0,
+	CHUNK_REPLICA_NODE_SCHEMA_TABLE_INDEX,
 	_MAX_CHUNK_REPLICA_NODE_INDEX,
 };
 
@@ -327,7 +347,327 @@ enum Anum_chunk_replica_node_pkey_idx
 #define Natts_chunk_replica_node_pkey_idx \
 	(_Anum_chunk_replica_node_pkey_idx_max - 1)
 
+enum Anum_chunk_replica_node_schema_table_idx
+{
+	Anum_chunk_replica_node_schema_table_idx_schema_name = 1,
+	Anum_chunk_replica_node_schema_table_idx_table_name,
+	_Anum_chunk_replica_node_schema_table_idx_max,
+};
+
+#define Natts_chunk_replica_node_schema_table_idx \
+	(_Anum_chunk_replica_node_schema_table_idx_max - 1)
+
+/**************************************
+ *
+ * Monotonic function table definitions
+ *
+ **************************************/
+
+#define MONOTONIC_FUNCTION_TABLE_NAME "monotonic_function"
+
+enum
+{
+	MONOTONIC_FUNCTION_ID_INDEX = 0,
+	_MAX_MONOTONIC_FUNCTION_INDEX,
+};
+
+enum Anum_monotonic_function
+{
+	Anum_monotonic_function_function_id = 1,
+	Anum_monotonic_function_order_argument,
+	Anum_monotonic_function_builtin,
+	_Anum_monotonic_function_max,
+};
+
+#define Natts_monotonic_function \
+	(_Anum_monotonic_function_max - 1)
+
+enum Anum_monotonic_function_pkey_idx
+{
+	Anum_monotonic_function_pkey_idx_function_id = 1,
+	_Anum_monotonic_function_pkey_idx_max,
+};
+
+#define Natts_monotonic_function_pkey_idx \
+	(_Anum_monotonic_function_pkey_idx_max - 1)
+
+
+/*************************************
+ *
+ * Chunk compression table definitions
+ *
+ *************************************/
+
+#define CHUNK_COMPRESSION_TABLE_NAME "chunk_compression"
 
+enum
+{
+	CHUNK_COMPRESSION_ID_INDEX = 0,
+	_MAX_CHUNK_COMPRESSION_INDEX,
+};
+
+enum Anum_chunk_compression
+{
+	Anum_chunk_compression_chunk_id = 1,
+	Anum_chunk_compression_database_name,
+	Anum_chunk_compression_compressed_schema_name,
+	Anum_chunk_compression_compressed_table_name,
+	Anum_chunk_compression_segment_by,
+	Anum_chunk_compression_uncompressed_rows,
+	Anum_chunk_compression_uncompressed_bytes,
+	Anum_chunk_compression_compressed_bytes,
+	_Anum_chunk_compression_max,
+};
+
+#define Natts_chunk_compression \
+	(_Anum_chunk_compression_max - 1)
+
+enum Anum_chunk_compression_pkey_idx
+{
+	Anum_chunk_compression_pkey_idx_chunk_id = 1,
+	Anum_chunk_compression_pkey_idx_database_name,
+	_Anum_chunk_compression_pkey_idx_max,
+};
+
+#define Natts_chunk_compression_pkey_idx \
+	(_Anum_chunk_compression_pkey_idx_max - 1)
+
+/********************************************
+ *
+ * Chunk replica node index table definitions
+ *
+ ********************************************/
+
+#define CHUNK_REPLICA_NODE_INDEX_TABLE_NAME "chunk_replica_node_index"
+
+enum
+{
+	CHUNK_REPLICA_NODE_INDEX_ID_INDEX = 0,
+	_MAX_CHUNK_REPLICA_NODE_INDEX_INDEX,
+};
+
+enum Anum_chunk_replica_node_index
+{
+	Anum_chunk_replica_node_index_schema_name = 1,
+	Anum_chunk_replica_node_index_table_name,
+	Anum_chunk_replica_node_index_index_name,
+	Anum_chunk_replica_node_index_main_schema_name,
+	Anum_chunk_replica_node_index_main_index_name,
+	Anum_chunk_replica_node_index_definition,
+	_Anum_chunk_replica_node_index_max,
+};
+
+#define Natts_chunk_replica_node_index \
+	(_Anum_chunk_replica_node_index_max - 1)
+
+enum Anum_chunk_replica_node_index_pkey_idx
+{
+	Anum_chunk_replica_node_index_pkey_idx_schema_name = 1,
+	Anum_chunk_replica_node_index_pkey_idx_table_name,
+	Anum_chunk_replica_node_index_pkey_idx_index_name,
+	_Anum_chunk_replica_node_index_pkey_idx_max,
+};
+
+#define Natts_chunk_replica_node_index_pkey_idx \
+	(_Anum_chunk_replica_node_index_pkey_idx_max - 1)
+
+/**********************************
+ *
+ * Chunk zone map table definitions
+ *
+ **********************************/
+
+#define CHUNK_ZONE_MAP_TABLE_NAME "chunk_zone_map"
+
+enum
+{
+	CHUNK_ZONE_MAP_ID_INDEX = 0,
+	_MAX_CHUNK_ZONE_MAP_INDEX,
+};
+
+enum Anum_chunk_zone_map
+{
+	Anum_chunk_zone_map_chunk_id = 1,
+	Anum_chunk_zone_map_hypertable_id,
+	Anum_chunk_zone_map_column_name,
+	Anum_chunk_zone_map_min_value,
+	Anum_chunk_zone_map_max_value,
+	Anum_chunk_zone_map_null_count,
+	_Anum_chunk_zone_map_max,
+};
+
+#define Natts_chunk_zone_map \
+	(_Anum_chunk_zone_map_max - 1)
+
+enum Anum_chunk_zone_map_pkey_idx
+{
+	Anum_chunk_zone_map_pkey_idx_chunk_id = 1,
+	Anum_chunk_zone_map_pkey_idx_column_name,
+	_Anum_chunk_zone_map_pkey_idx_max,
+};
+
+#define Natts_chunk_zone_map_pkey_idx \
+	(_Anum_chunk_zone_map_pkey_idx_max - 1)
+
+/****************************************
+ *
+ * Chunk zone map delta table definitions
+ *
+ ****************************************/
+
+#define CHUNK_ZONE_MAP_DELTA_TABLE_NAME "chunk_zone_map_delta"
+
+enum
+{
+	CHUNK_ZONE_MAP_DELTA_ID_INDEX = 0,
+	_MAX_CHUNK_ZONE_MAP_DELTA_INDEX,
+};
+
+/* The columns are the same as those of chunk_zone_map */
+
+enum Anum_chunk_zone_map_delta_idx
+{
+	Anum_chunk_zone_map_delta_idx_chunk_id = 1,
+	Anum_chunk_zone_map_delta_idx_column_name,
+	_Anum_chunk_zone_map_delta_idx_max,
+};
+
+#define Natts_chunk_zone_map_delta_idx \
+	(_Anum_chunk_zone_map_delta_idx_max - 1)
+
+/************************************
+ *
+ * Chunk tablespace table definitions
+ *
+ ************************************/
+
+#define CHUNK_TABLESPACE_TABLE_NAME "chunk_tablespace"
+
+enum
+{
+	CHUNK_TABLESPACE_ID_INDEX = 0,
+	_MAX_CHUNK_TABLESPACE_INDEX,
+};
+
+enum Anum_chunk_tablespace
+{
+	Anum_chunk_tablespace_chunk_id = 1,
+	Anum_chunk_tablespace_hypertable_id,
+	Anum_chunk_tablespace_tablespace_name,
+	_Anum_chunk_tablespace_max,
+};
+
+#define Natts_chunk_tablespace \
+	(_Anum_chunk_tablespace_max - 1)
+
+enum Anum_chunk_tablespace_pkey_idx
+{
+	Anum_chunk_tablespace_pkey_idx_chunk_id = 1,
+	_Anum_chunk_tablespace_pkey_idx_max,
+};
+
+#define Natts_chunk_tablespace_pkey_idx \
+	(_Anum_chunk_tablespace_pkey_idx_max - 1)
+
+/******************************
+ *
+ * Chunk seal table definitions
+ *
+ ******************************/
+
+#define CHUNK_SEAL_TABLE_NAME "chunk_seal"
+
+enum
+{
+	CHUNK_SEAL_ID_INDEX = 0,
+	_MAX_CHUNK_SEAL_INDEX,
+};
+
+enum Anum_chunk_seal
+{
+	Anum_chunk_seal_chunk_id = 1,
+	Anum_chunk_seal_hypertable_id,
+	Anum_chunk_seal_sealed_at,
+	_Anum_chunk_seal_max,
+};
+
+#define Natts_chunk_seal \
+	(_Anum_chunk_seal_max - 1)
+
+enum Anum_chunk_seal_pkey_idx
+{
+	Anum_chunk_seal_pkey_idx_chunk_id = 1,
+	_Anum_chunk_seal_pkey_idx_max,
+};
+
+#define Natts_chunk_seal_pkey_idx \
+	(_Anum_chunk_seal_pkey_idx_max - 1)
+
+/****************************************
+ *
+ * Continuous aggregate table definitions
+ *
+ ****************************************/
+
+#define CONTINUOUS_AGG_TABLE_NAME "continuous_agg"
+
+enum
+{
+	CONTINUOUS_AGG_ID_INDEX = 0,
+	CONTINUOUS_AGG_RAW_HYPERTABLE_INDEX,
+	_MAX_CONTINUOUS_AGG_INDEX,
+};
+
+enum Anum_continuous_agg
+{
+	Anum_continuous_agg_id = 1,
+	Anum_continuous_agg_view_schema,
+	Anum_continuous_agg_view_name,
+	Anum_continuous_agg_raw_hypertable_id,
+	Anum_continuous_agg_mat_hypertable_id,
+	Anum_continuous_agg_bucket_width,
+	Anum_continuous_agg_group_by,
+	Anum_continuous_agg_aggregates,
+	Anum_continuous_agg_watermark,
+	_Anum_continuous_agg_max,
+};
+
+#define Natts_continuous_agg \
+	(_Anum_continuous_agg_max - 1)
+
+enum Anum_continuous_agg_raw_hypertable_id_idx
+{
+	Anum_continuous_agg_raw_hypertable_id_idx_raw_hypertable_id = 1,
+	_Anum_continuous_agg_raw_hypertable_id_idx_max,
+};
+
+#define Natts_continuous_agg_raw_hypertable_id_idx \
+	(_Anum_continuous_agg_raw_hypertable_id_idx_max - 1)
+
+/*****************************************************
+ *
+ * Continuous aggregate invalidation table definitions
+ *
+ *****************************************************/
+
+#define CONTINUOUS_AGG_INVALIDATION_TABLE_NAME "continuous_agg_invalidation"
+
+enum
+{
+	CONTINUOUS_AGG_INVALIDATION_ID_INDEX = 0,
+	_MAX_CONTINUOUS_AGG_INVALIDATION_INDEX,
+};
+
+enum Anum_continuous_agg_invalidation
+{
+	Anum_continuous_agg_invalidation_continuous_agg_id = 1,
+	Anum_continuous_agg_invalidation_lowest_modified_value,
+	Anum_continuous_agg_invalidation_greatest_modified_value,
+	_Anum_continuous_agg_invalidation_max,
+};
+
+#define Natts_continuous_agg_invalidation \
+	(_Anum_continuous_agg_invalidation_max - 1)
 
 #define MAX(a, b) \
 	((long)(a) > (long)(b) ? (a) : (b))
@@ -337,7 +677,16 @@ enum Anum_chunk_replica_node_pkey_idx
 								   MAX(_MAX_PARTITION_INDEX, \
 									   MAX(_MAX_HYPERTABLE_REPLICA_INDEX, \
 										  MAX(_MAX_DEFAULT_REPLICA_NODE_INDEX, \
-											MAX(_MAX_CHUNK_INDEX, _MAX_CHUNK_REPLICA_NODE_INDEX))))))
+											MAX(_MAX_CHUNK_INDEX, \
+												MAX(_MAX_CHUNK_REPLICA_NODE_INDEX, \
+													MAX(_MAX_MONOTONIC_FUNCTION_INDEX, \
+														MAX(_MAX_CHUNK_COMPRESSION_INDEX, \
+															MAX(_MAX_CHUNK_REPLICA_NODE_INDEX_INDEX, \
+																MAX(_MAX_CHUNK_ZONE_MAP_INDEX, \
+																	MAX(_MAX_CHUNK_ZONE_MAP_DELTA_INDEX, \
+																		MAX(_MAX_CHUNK_TABLESPACE_INDEX, \
+																			MAX(_MAX_CHUNK_SEAL_INDEX, \
+																				MAX(_MAX_CONTINUOUS_AGG_INDEX, _MAX_CONTINUOUS_AGG_INVALIDATION_INDEX)))))))))))))))
 
 typedef enum CacheType
 {
@@ -346,6 +695,17 @@ typedef enum CacheType
 	_MAX_CACHE_TYPES
 } CacheType;
 
+/*
+ * Functions in the internal schema that C code needs to recognize, e.g., in
+ * query trees. Must match definitions in sql/.
+ */
+typedef enum CatalogFunction
+{
+	FIRST_SFUNC,
+	LAST_SFUNC,
+	_MAX_CATALOG_FUNCTIONS
+} CatalogFunction;
+
 typedef struct Catalog
 {
 	char		database_name[NAMEDATALEN];
@@ -363,6 +723,12 @@ typedef struct Catalog
 	{
 		Oid			inval_proxy_id;
 	}			caches[_MAX_CACHE_TYPES];
+
+	Oid			internal_schema_id;
+	struct
+	{
+		Oid			id;
+	}			functions[_MAX_CATALOG_FUNCTIONS];
 } Catalog;
 
 bool		catalog_is_valid(Catalog *catalog);
@@ -374,4 +740,6 @@ Oid			catalog_get_cache_proxy_id_by_name(Catalog *catalog, const char *relname);
 
 const char *catalog_get_cache_proxy_name(CacheType type);
 
+Oid			catalog_get_function_id(Catalog *catalog, CatalogFunction func);
+
 #endif   /* TIMESCALEDB_CATALOG_H */
@@ -0,0 +1,475 @@
+#include <postgres.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <commands/trigger.h>
+#include <miscadmin.h>
+#include <port/atomics.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+
+#include "catalog_snapshot.h"
+#include "catalog.h"
+#include "partitioning.h"
+#include "scanner.h"
+#include "guc.h"
+#include "utils.h"
+
+/*
+ * Catalog snapshot of chunks.
+ *
+ * Inserts look up the chunk of a partition and time point with an index scan
+ * on the chunk catalog table whenever a tuple falls outside the chunk they
+ * last inserted into. Each scan locks the table and its index, which under
+ * high concurrency shows up as contention on the lock manager.
+ *
+ * The catalog snapshot is a copy of the chunk catalog table in shared memory,
+ * sorted by partition and start time, that backends search without taking any
+ * locks. A snapshot is never modified after it is published. When the chunk
+ * table changes, the snapshot becomes stale, and the next backend that looks
+ * up a chunk builds a new snapshot with a single scan of the table.
+ *
+ * There are two snapshot buffers. A new snapshot is written to the buffer not
+ * in use and then published by switching the active buffer, so readers of the
+ * previous snapshot are not disturbed. A reader that is still searching a
+ * buffer when it is reused two snapshots later notices from the version
+ * counter of the buffer, which is odd while the buffer is being written, and
+ * falls back to scanning the catalog.
+ *
+ * Like the shared cache, the snapshot is versioned by a generation number.
+ * A statement trigger on the chunk table marks the generation for increment,
+ * which happens when the transaction commits. A snapshot is only valid if it
+ * was built from a scan that started under the current generation. A backend
+ * with pending changes to the chunk table does not use the snapshot, since it
+ * sees its own uncommitted changes.
+ *
+ * The snapshot holds the chunks of one database. Backends in other databases
+ * scan the catalog, unless the snapshot is stale, in which case they replace
+ * it with a snapshot of their own database.
+ */
+
+typedef struct SnapshotChunk
+{
+	int32		id;
+	int32		partition_id;
+	/* PG_INT64_MIN if the chunk has no start time */
+	int64		start_time;
+	int64		end_time;
+} SnapshotChunk;
+
+typedef struct SnapshotBuffer
+{
+	pg_atomic_uint32 version;
+	uint32		generation;
+	Oid			dbid;
+	Oid			chunk_table;
+	int			num_chunks;
+	SnapshotChunk chunks[FLEXIBLE_ARRAY_MEMBER];
+} SnapshotBuffer;
+
+typedef struct CatalogSnapshotControl
+{
+	pg_atomic_uint32 generation;
+	pg_atomic_uint32 active;
+	/* The generation for which the chunks did not fit in a snapshot */
+	pg_atomic_uint32 overflow_generation;
+	/* Set while a backend writes a snapshot */
+	pg_atomic_flag building;
+	int			max_chunks;
+	char		buffers[FLEXIBLE_ARRAY_MEMBER];
+} CatalogSnapshotControl;
+
+static CatalogSnapshotControl *snapshot_control = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+/* The current transaction has modified the chunk table */
+static bool pending_invalidation = false;
+
+static Size
+snapshot_buffer_size(void)
+{
+	return MAXALIGN(add_size(offsetof(SnapshotBuffer, chunks),
+						mul_size(guc_catalog_snapshot_chunks, sizeof(SnapshotChunk))));
+}
+
+static Size
+catalog_snapshot_shmem_size(void)
+{
+	return add_size(MAXALIGN(offsetof(CatalogSnapshotControl, buffers)),
+					mul_size(2, snapshot_buffer_size()));
+}
+
+static SnapshotBuffer *
+snapshot_buffer(uint32 index)
+{
+	return (SnapshotBuffer *) (snapshot_control->buffers + index * snapshot_buffer_size());
+}
+
+static void
+catalog_snapshot_shmem_startup(void)
+{
+	bool		found;
+	int			i;
+
+	if (prev_shmem_startup_hook != NULL)
+		prev_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	snapshot_control = ShmemInitStruct("timescaledb catalog snapshot",
+									   catalog_snapshot_shmem_size(), &found);
+
+	if (!found)
+	{
+		/* Generation 0 marks empty buffers, so start at 1 */
+		pg_atomic_init_u32(&snapshot_control->generation, 1);
+		pg_atomic_init_u32(&snapshot_control->active, 0);
+		pg_atomic_init_u32(&snapshot_control->overflow_generation, 0);
+		pg_atomic_init_flag(&snapshot_control->building);
+		snapshot_control->max_chunks = guc_catalog_snapshot_chunks;
+
+		for (i = 0; i < 2; i++)
+		{
+			SnapshotBuffer *buf = snapshot_buffer(i);
+
+			pg_atomic_init_u32(&buf->version, 0);
+			buf->generation = 0;
+			buf->dbid = InvalidOid;
+			buf->chunk_table = InvalidOid;
+			buf->num_chunks = 0;
+		}
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+static bool
+catalog_snapshot_enabled(void)
+{
+	return snapshot_control != NULL && !pending_invalidation;
+}
+
+static int
+snapshot_chunk_cmp(const void *left, const void *right)
+{
+	const SnapshotChunk *l = left;
+	const SnapshotChunk *r = right;
+
+	if (l->partition_id != r->partition_id)
+		return l->partition_id < r->partition_id ? -1 : 1;
+
+	if (l->start_time != r->start_time)
+		return l->start_time < r->start_time ? -1 : 1;
+
+	return 0;
+}
+
+typedef struct SnapshotBuildCtx
+{
+	SnapshotChunk *chunks;
+	int			num_chunks;
+	int			max_chunks;
+} SnapshotBuildCtx;
+
+static bool
+snapshot_chunk_tuple_found(TupleInfo *ti, void *data)
+{
+	SnapshotBuildCtx *ctx = data;
+	SnapshotChunk *chunk;
+	Datum		values[Natts_chunk];
+	bool		isnull[Natts_chunk];
+
+	/* Count the chunks that do not fit, but stop collecting them */
+	if (ctx->num_chunks++ >= ctx->max_chunks)
+		return false;
+
+	heap_deform_tuple(ti->tuple, ti->desc, values, isnull);
+
+	chunk = &ctx->chunks[ctx->num_chunks - 1];
+	chunk->id = DatumGetInt32(DATUM_GET(values, Anum_chunk_id));
+	chunk->partition_id = DatumGetInt32(DATUM_GET(values, Anum_chunk_partition_id));
+	chunk->start_time = isnull[Anum_chunk_start_time - 1] ?
+		PG_INT64_MIN : DatumGetInt64(DATUM_GET(values, Anum_chunk_start_time));
+	chunk->end_time = isnull[Anum_chunk_end_time - 1] ?
+		OPEN_END_TIME : DatumGetInt64(DATUM_GET(values, Anum_chunk_end_time));
+
+	return true;
+}
+
+/*
+ * Build a snapshot of the chunk table and publish it, unless another backend
+ * is already building one or the chunks do not fit.
+ */
+static void
+catalog_snapshot_build(void)
+{
+	Catalog    *catalog = catalog_get();
+	uint32		generation = pg_atomic_read_u32(&snapshot_control->generation);
+	SnapshotBuildCtx data = {
+		.max_chunks = snapshot_control->max_chunks,
+	};
+	ScannerCtx	ctx = {
+		.table = catalog->tables[CHUNK].id,
+		.scantype = ScannerTypeHeap,
+		.nkeys = 0,
+		.data = &data,
+		.tuple_found = snapshot_chunk_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+	SnapshotBuffer *buf;
+	uint32		next;
+
+	if (!pg_atomic_unlocked_test_flag(&snapshot_control->building))
+		return;
+
+	data.chunks = palloc(sizeof(SnapshotChunk) * data.max_chunks);
+	scanner_scan(&ctx);
+
+	if (data.num_chunks > data.max_chunks)
+	{
+		pg_atomic_write_u32(&snapshot_control->overflow_generation, generation);
+		pfree(data.chunks);
+		return;
+	}
+
+	qsort(data.chunks, data.num_chunks, sizeof(SnapshotChunk), snapshot_chunk_cmp);
+
+	/* Nothing below can fail, so the flag is always cleared again */
+	if (!pg_atomic_test_set_flag(&snapshot_control->building))
+	{
+		pfree(data.chunks);
+		return;
+	}
+
+	/* Another backend may have published a snapshot in the meantime */
+	buf = snapshot_buffer(pg_atomic_read_u32(&snapshot_control->active));
+
+	if (buf->generation != generation ||
+		buf->dbid != MyDatabaseId ||
+		buf->chunk_table != catalog->tables[CHUNK].id)
+	{
+		next = 1 - pg_atomic_read_u32(&snapshot_control->active);
+		buf = snapshot_buffer(next);
+
+		pg_atomic_fetch_add_u32(&buf->version, 1);
+		pg_write_barrier();
+
+		buf->generation = generation;
+		buf->dbid = MyDatabaseId;
+		buf->chunk_table = catalog->tables[CHUNK].id;
+		buf->num_chunks = data.num_chunks;
+		memcpy(buf->chunks, data.chunks, sizeof(SnapshotChunk) * data.num_chunks);
+
+		pg_write_barrier();
+		pg_atomic_fetch_add_u32(&buf->version, 1);
+		pg_atomic_write_u32(&snapshot_control->active, next);
+	}
+
+	pg_atomic_clear_flag(&snapshot_control->building);
+	pfree(data.chunks);
+}
+
+typedef enum SnapshotResult
+{
+	SNAPSHOT_FOUND,
+	SNAPSHOT_NOT_FOUND,
+	/* The snapshot is stale, or was overwritten while searching it */
+	SNAPSHOT_INVALID,
+	/* The snapshot holds the chunks of another database */
+	SNAPSHOT_OTHER_DATABASE,
+} SnapshotResult;
+
+/*
+ * Search the active snapshot for the chunk of a partition that covers the
+ * time point. The chunks of a partition do not overlap, so it is the last
+ * chunk that starts at or before the time point, if that chunk ends at or
+ * after it.
+ */
+static SnapshotResult
+catalog_snapshot_search(int32 partition_id, int64 timepoint, SnapshotChunk *result)
+{
+	SnapshotBuffer *buf = snapshot_buffer(pg_atomic_read_u32(&snapshot_control->active));
+	uint32		version = pg_atomic_read_u32(&buf->version);
+	SnapshotChunk key = {
+		.partition_id = partition_id,
+		.start_time = timepoint,
+	};
+	SnapshotChunk chunk = {0};
+	int			low = 0,
+				high;
+	bool		found = false;
+
+	if (version & 1)
+		return SNAPSHOT_INVALID;
+
+	pg_read_barrier();
+
+	if (buf->generation != pg_atomic_read_u32(&snapshot_control->generation))
+		return SNAPSHOT_INVALID;
+
+	if (buf->dbid != MyDatabaseId)
+		return SNAPSHOT_OTHER_DATABASE;
+
+	if (buf->chunk_table != catalog_get()->tables[CHUNK].id)
+		return SNAPSHOT_INVALID;
+
+	/* Bound the search even if the buffer is overwritten concurrently */
+	high = Min(buf->num_chunks, snapshot_control->max_chunks);
+
+	while (low < high)
+	{
+		int			mid = low + (high - low) / 2;
+
+		if (snapshot_chunk_cmp(&buf->chunks[mid], &key) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low > 0)
+	{
+		chunk = buf->chunks[low - 1];
+		found = chunk.partition_id == partition_id && timepoint <= chunk.end_time;
+	}
+
+	pg_read_barrier();
+
+	if (pg_atomic_read_u32(&buf->version) != version)
+		return SNAPSHOT_INVALID;
+
+	if (!found)
+		return SNAPSHOT_NOT_FOUND;
+
+	result->id = chunk.id;
+	result->partition_id = chunk.partition_id;
+	result->start_time = chunk.start_time == PG_INT64_MIN ? OPEN_START_TIME : chunk.start_time;
+	result->end_time = chunk.end_time;
+
+	return SNAPSHOT_FOUND;
+}
+
+/*
+ * Look up the chunk of a partition that covers a time point in the catalog
+ * snapshot, building a new snapshot if the current one is stale. Returns false
+ * if the snapshot cannot answer the lookup, in which case the caller scans
+ * the catalog. Otherwise, *found tells whether the chunk exists, and its
+ * fields are set in *chunk.
+ */
+bool
+catalog_snapshot_chunk_lookup(int32 partition_id, int64 timepoint, Chunk *chunk, bool *found)
+{
+	SnapshotChunk result;
+	SnapshotResult res;
+
+	if (!catalog_snapshot_enabled())
+		return false;
+
+	res = catalog_snapshot_search(partition_id, timepoint, &result);
+
+	if (res == SNAPSHOT_INVALID)
+	{
+		if (pg_atomic_read_u32(&snapshot_control->overflow_generation) ==
+			pg_atomic_read_u32(&snapshot_control->generation))
+			return false;
+
+		catalog_snapshot_build();
+		res = catalog_snapshot_search(partition_id, timepoint, &result);
+	}
+
+	switch (res)
+	{
+		case SNAPSHOT_FOUND:
+			chunk->id = result.id;
+			chunk->partition_id = result.partition_id;
+			chunk->start_time = result.start_time;
+			chunk->end_time = result.end_time;
+			*found = true;
+			return true;
+		case SNAPSHOT_NOT_FOUND:
+			*found = false;
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Make the snapshot stale when the current transaction commits. Until then,
+ * the backend does not use the snapshot.
+ */
+void
+catalog_snapshot_invalidate_at_commit(void)
+{
+	pending_invalidation = true;
+}
+
+PG_FUNCTION_INFO_V1(invalidate_catalog_snapshot_trigger);
+
+/*
+ * Statement trigger on the chunk catalog table that makes the catalog
+ * snapshot stale when the transaction commits.
+ */
+Datum
+invalidate_catalog_snapshot_trigger(PG_FUNCTION_ARGS)
+{
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		elog(ERROR, "not called by trigger manager");
+
+	catalog_snapshot_invalidate_at_commit();
+
+	return PointerGetDatum(NULL);
+}
+
+static void
+catalog_snapshot_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_ABORT:
+			if (pending_invalidation && event == XACT_EVENT_COMMIT && snapshot_control != NULL)
+				pg_atomic_fetch_add_u32(&snapshot_control->generation, 1);
+
+			pending_invalidation = false;
+			break;
+		case XACT_EVENT_PRE_PREPARE:
+
+			/*
+			 * COMMIT PREPARED would not bump the generation, as with the
+			 * shared cache, so refuse to prepare the transaction.
+			 */
+			if (pending_invalidation && snapshot_control != NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("cannot PREPARE a transaction that has modified TimescaleDB metadata")));
+			break;
+		case XACT_EVENT_PREPARE:
+			pending_invalidation = false;
+			break;
+		default:
+			break;
+	}
+}
+
+void
+_catalog_snapshot_init(void)
+{
+	RegisterXactCallback(catalog_snapshot_xact_callback, NULL);
+
+	if (!process_shared_preload_libraries_in_progress || guc_catalog_snapshot_chunks == 0)
+		return;
+
+	RequestAddinShmemSpace(catalog_snapshot_shmem_size());
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = catalog_snapshot_shmem_startup;
+}
+
+void
+_catalog_snapshot_fini(void)
+{
+	UnregisterXactCallback(catalog_snapshot_xact_callback, NULL);
+
+	if (shmem_startup_hook == catalog_snapshot_shmem_startup)
+		shmem_startup_hook = prev_shmem_startup_hook;
+}
@@ -0,0 +1,15 @@
+#ifndef TIMESCALEDB_CATALOG_SNAPSHOT_H
+#define TIMESCALEDB_CATALOG_SNAPSHOT_H
+
+#include <postgres.h>
+
+#include "chunk.h"
+
+extern bool catalog_snapshot_chunk_lookup(int32 partition_id, int64 timepoint,
+							  Chunk *chunk, bool *found);
+extern void catalog_snapshot_invalidate_at_commit(void);
+
+extern void _catalog_snapshot_init(void);
+extern void _catalog_snapshot_fini(void);
+
+#endif   /* TIMESCALEDB_CATALOG_SNAPSHOT_H */
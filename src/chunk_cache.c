@@ -6,6 +6,7 @@
 #include <access/xact.h>
 #include <storage/bufmgr.h>
 #include <catalog/namespace.h>
+#include <catalog/pg_type.h>
 
 #include "chunk_cache.h"
 #include "chunk.h"
@@ -16,6 +17,10 @@
 #include "metadata_queries.h"
 #include "partitioning.h"
 #include "scanner.h"
+#include "shared_cache.h"
+#include "catalog_snapshot.h"
+#include "guc.h"
+#include "zone_map.h"
 
 /*
  * Chunk cache.
@@ -28,13 +33,44 @@
  * the chunk ID for a specific tuple's time point and partition. The cache
  * therefore mostly serves to store information about a chunk's replicas, which
  * otherwise would require an additional table scan.
+ *
+ * The cache holds at most timescaledb.chunk_cache_size kilobytes of chunks and
+ * replicas. When it grows beyond that, the least recently used chunks that are
+ * not pinned with cache_pin_entry are evicted.
+ *
+ * The relids of the cached chunks' replica tables are mapped to their chunk
+ * IDs, so that a chunk can be invalidated by table without scanning the cache.
  */
+typedef struct ChunkCache
+{
+	Cache		cache;
+	HTAB	   *table_chunks;
+} ChunkCache;
+
+typedef struct ChunkTableRelidEntry
+{
+	Oid			table_relid;
+	int32		chunk_id;
+} ChunkTableRelidEntry;
+
 static Cache *chunk_cache_current = NULL;
 
+/*
+ * Chunk table cache.
+ *
+ * Maps the relids of chunk tables to their chunk's time range, e.g., for the
+ * planner to order chunks by time. Tables that are not chunks get a negative
+ * entry. This cache is invalidated along with the chunk cache. Zone maps are
+ * only read when first needed and are not kept in the shared cache.
+ */
+static Cache *chunk_table_cache_current = NULL;
+
 typedef struct ChunkCacheQuery
 {
 	CacheQuery	cq;
 	Chunk	   *stub_chunk;
+	/* Set if the replicas were already scanned, e.g., when prewarming */
+	ChunkReplica *replicas;
 } ChunkCacheQuery;
 
 
@@ -45,10 +81,77 @@ chunk_cache_get_key(CacheQuery *query)
 }
 
 /* Cache entry for chunk replicas */
+typedef struct ChunkCacheEntry
+{
+	/* The chunk ID at the start of the chunk is the hash key */
+	Chunk		chunk;
+	CacheLruNode lru;
+} ChunkCacheEntry;
 
 static void *chunk_cache_create_entry(Cache *cache, CacheQuery *ctx);
 static void *chunk_cache_update_entry(Cache *cache, CacheQuery *ctx);
 
+static Size
+chunk_cache_entry_size(void *entry)
+{
+	Chunk	   *chunk = entry;
+
+	if (chunk->replicas == NULL)
+		return sizeof(ChunkCacheEntry);
+
+	return sizeof(ChunkCacheEntry) + sizeof(ChunkReplica) * chunk->num_replicas;
+}
+
+static void
+chunk_cache_add_table_chunks(Cache *cache, Chunk *chunk)
+{
+	HTAB	   *table_chunks = ((ChunkCache *) cache)->table_chunks;
+	int			i;
+
+	for (i = 0; i < chunk->num_replicas; i++)
+	{
+		Oid			table_relid = chunk->replicas[i].table_id;
+		ChunkTableRelidEntry *entry;
+
+		if (!OidIsValid(table_relid))
+			continue;
+
+		entry = hash_search(table_chunks, &table_relid, HASH_ENTER, NULL);
+		entry->chunk_id = chunk->id;
+	}
+}
+
+static void
+chunk_cache_free_entry(Cache *cache, void *entry)
+{
+	HTAB	   *table_chunks = ((ChunkCache *) cache)->table_chunks;
+	Chunk	   *chunk = entry;
+	int			i;
+
+	if (chunk->replicas == NULL)
+		return;
+
+	for (i = 0; i < chunk->num_replicas; i++)
+	{
+		Oid			table_relid = chunk->replicas[i].table_id;
+		ChunkTableRelidEntry *relid_entry;
+
+		relid_entry = hash_search(table_chunks, &table_relid, HASH_FIND, NULL);
+
+		if (relid_entry != NULL && relid_entry->chunk_id == chunk->id)
+			hash_search(table_chunks, &table_relid, HASH_REMOVE, NULL);
+	}
+
+	pfree(chunk->replicas);
+	chunk->replicas = NULL;
+}
+
+static Size
+chunk_cache_max_size(void)
+{
+	return (Size) guc_chunk_cache_size * 1024L;
+}
+
 static Cache *
 chunk_cache_create()
 {
@@ -56,14 +159,20 @@ chunk_cache_create()
 							  catalog_get_cache_proxy_name(CACHE_TYPE_CHUNK),
 											  ALLOCSET_DEFAULT_SIZES);
 
-	Cache	   *cache = MemoryContextAlloc(ctx, sizeof(Cache));
+	ChunkCache *chunk_cache = MemoryContextAlloc(ctx, sizeof(ChunkCache));
+	Cache	   *cache = &chunk_cache->cache;
+	HASHCTL		hctl = {
+		.keysize = sizeof(Oid),
+		.entrysize = sizeof(ChunkTableRelidEntry),
+		.hcxt = ctx,
+	};
 
 	Cache		template =
 	{
 		.hctl =
 		{
 			.keysize = sizeof(int32),
-			.entrysize = sizeof(Chunk),
+			.entrysize = sizeof(ChunkCacheEntry),
 			.hcxt = ctx,
 		},
 		.name = "chunk_cache",
@@ -72,11 +181,17 @@ chunk_cache_create()
 		.get_key = chunk_cache_get_key,
 		.create_entry = chunk_cache_create_entry,
 		.update_entry = chunk_cache_update_entry,
+		.get_entry_size = chunk_cache_entry_size,
+		.free_entry = chunk_cache_free_entry,
+		.get_max_size = chunk_cache_max_size,
+		.lru_offset = offsetof(ChunkCacheEntry, lru),
 	};
 
 	*cache = template;
 
 	cache_init(cache);
+	chunk_cache->table_chunks = hash_create("chunk_cache table chunks", 16, &hctl,
+									 HASH_ELEM | HASH_CONTEXT | HASH_BLOBS);
 
 	return cache;
 }
@@ -88,16 +203,12 @@ typedef struct ReplicaScanCtx
 	int			num_replicas;
 } ReplicaScanCtx;
 
-static bool
-chunk_replica_tuple_found(TupleInfo *ti, void *arg)
+static void
+chunk_replica_from_tuple(TupleInfo *ti, ChunkReplica *cr)
 {
-	ReplicaScanCtx *ctx = arg;
-	ChunkReplica *cr;
 	Datum		values[Natts_chunk_replica_node];
 	bool		isnull[Natts_chunk_replica_node];
 
-	cr = &ctx->replicas[--ctx->num_replicas];
-
 	heap_deform_tuple(ti->tuple, ti->desc, values, isnull);
 
 	strncpy(cr->database_name,
@@ -112,6 +223,14 @@ chunk_replica_tuple_found(TupleInfo *ti, void *arg)
 
 	cr->schema_id = get_namespace_oid(cr->schema_name, false);
 	cr->table_id = get_relname_relid(cr->table_name, cr->schema_id);
+}
+
+static bool
+chunk_replica_tuple_found(TupleInfo *ti, void *arg)
+{
+	ReplicaScanCtx *ctx = arg;
+
+	chunk_replica_from_tuple(ti, &ctx->replicas[--ctx->num_replicas]);
 
 	if (ctx->num_replicas == 0)
 		return false;
@@ -165,8 +284,16 @@ chunk_cache_create_entry(Cache *cache, CacheQuery *query)
 	chunk->start_time = cq->stub_chunk->start_time;
 	chunk->end_time = cq->stub_chunk->end_time;
 	chunk->num_replicas = cq->stub_chunk->num_replicas;
-	chunk->replicas = chunk_replica_scan(chunk->id, chunk->num_replicas);
 
+	if (NULL != cq->replicas)
+	{
+		chunk->replicas = palloc(sizeof(ChunkReplica) * chunk->num_replicas);
+		memcpy(chunk->replicas, cq->replicas, sizeof(ChunkReplica) * chunk->num_replicas);
+	}
+	else
+		chunk->replicas = chunk_replica_scan(chunk->id, chunk->num_replicas);
+
+	chunk_cache_add_table_chunks(cache, chunk);
 	MemoryContextSwitchTo(old);
 
 	return chunk;
@@ -192,12 +319,17 @@ chunk_cache_update_entry(Cache *cache, CacheQuery *query)
 	chunk->id = cq->stub_chunk->id;
 	chunk->start_time = cq->stub_chunk->start_time;
 	chunk->end_time = cq->stub_chunk->end_time;
-	chunk->num_replicas = cq->stub_chunk->num_replicas;
 
-	if (chunk->replicas != NULL && chunk->num_replicas != cq->stub_chunk->num_replicas)
+	/*
+	 * The size of the replica array must match num_replicas for the memory
+	 * accounting, so compare before overwriting the count.
+	 */
+	if (chunk->replicas == NULL || chunk->num_replicas != cq->stub_chunk->num_replicas)
 	{
-		pfree(chunk->replicas);
+		chunk_cache_free_entry(cache, chunk);
+		chunk->num_replicas = cq->stub_chunk->num_replicas;
 		chunk->replicas = chunk_replica_scan(chunk->id, chunk->num_replicas);
+		chunk_cache_add_table_chunks(cache, chunk);
 	}
 
 	MemoryContextSwitchTo(old);
@@ -205,12 +337,870 @@ chunk_cache_update_entry(Cache *cache, CacheQuery *query)
 	return chunk;
 }
 
+typedef struct ChunkTableCacheQuery
+{
+	CacheQuery	cq;
+	Oid			table_relid;
+	/*
+	 * Set if the table's chunk is already known, e.g., when prewarming, along
+	 * with the chunk's compressed table and whether it is sealed.
+	 */
+	Chunk	   *chunk;
+	Oid			compressed_relid;
+	int64		compressed_rows;
+	bool		sealed;
+} ChunkTableCacheQuery;
+
+typedef struct ChunkTableCacheEntry
+{
+	Oid			table_relid;
+	/* Zone maps of the chunk, if zone_maps_loaded */
+	List	   *zone_maps;
+	/* The newest transaction that wrote the zone maps */
+	TransactionId zone_maps_xmin;
+	bool		zone_maps_loaded;
+	/* 0 if the table is not a chunk */
+	int32		chunk_id;
+	int64		start_time;
+	int64		end_time;
+	/* InvalidOid if the chunk is not compressed on this node */
+	Oid			compressed_relid;
+	int64		compressed_rows;
+	/* Whether the chunk is sealed on this node */
+	bool		sealed;
+} ChunkTableCacheEntry;
+
+static void *
+chunk_table_cache_get_key(CacheQuery *query)
+{
+	return &((ChunkTableCacheQuery *) query)->table_relid;
+}
+
+static void *chunk_table_cache_create_entry(Cache *cache, CacheQuery *query);
+
+static void
+chunk_table_cache_free_entry(Cache *cache, void *entry)
+{
+	ChunkTableCacheEntry *table_entry = entry;
+
+	zone_map_list_free(table_entry->zone_maps);
+	table_entry->zone_maps = NIL;
+}
+
+static Cache *
+chunk_table_cache_create()
+{
+	MemoryContext ctx = AllocSetContextCreate(CacheMemoryContext,
+											  "chunk_table_cache",
+											  ALLOCSET_DEFAULT_SIZES);
+
+	Cache	   *cache = MemoryContextAlloc(ctx, sizeof(Cache));
+
+	Cache		template =
+	{
+		.hctl =
+		{
+			.keysize = sizeof(Oid),
+			.entrysize = sizeof(ChunkTableCacheEntry),
+			.hcxt = ctx,
+		},
+		.name = "chunk_table_cache",
+		.numelements = 16,
+		.flags = HASH_ELEM | HASH_CONTEXT | HASH_BLOBS,
+		.get_key = chunk_table_cache_get_key,
+		.create_entry = chunk_table_cache_create_entry,
+		.free_entry = chunk_table_cache_free_entry,
+	};
+
+	*cache = template;
+
+	cache_init(cache);
+
+	return cache;
+}
+
+static bool
+chunk_replica_id_tuple_found(TupleInfo *ti, void *data)
+{
+	ChunkTableCacheEntry *entry = data;
+	bool		is_null;
+	Datum		chunk_id = heap_getattr(ti->tuple, Anum_chunk_replica_node_id, ti->desc, &is_null);
+
+	entry->chunk_id = DatumGetInt32(chunk_id);
+
+	return false;
+}
+
+static bool
+chunk_time_range_tuple_found(TupleInfo *ti, void *data)
+{
+	ChunkTableCacheEntry *entry = data;
+	bool		is_null;
+	Datum		datum;
+
+	datum = heap_getattr(ti->tuple, Anum_chunk_start_time, ti->desc, &is_null);
+	entry->start_time = is_null ? OPEN_START_TIME : DatumGetInt64(datum);
+	datum = heap_getattr(ti->tuple, Anum_chunk_end_time, ti->desc, &is_null);
+	entry->end_time = is_null ? OPEN_END_TIME : DatumGetInt64(datum);
+
+	return false;
+}
+
+static void
+chunk_compression_from_tuple(TupleInfo *ti, Oid *compressed_relid, int64 *compressed_rows)
+{
+	bool		is_null;
+	Datum		schema_name = heap_getattr(ti->tuple, Anum_chunk_compression_compressed_schema_name, ti->desc, &is_null);
+	Datum		table_name = heap_getattr(ti->tuple, Anum_chunk_compression_compressed_table_name, ti->desc, &is_null);
+	Datum		rows = heap_getattr(ti->tuple, Anum_chunk_compression_uncompressed_rows, ti->desc, &is_null);
+	Oid			namespace = get_namespace_oid(NameStr(*DatumGetName(schema_name)), true);
+
+	if (OidIsValid(namespace))
+		*compressed_relid = get_relname_relid(NameStr(*DatumGetName(table_name)), namespace);
+
+	*compressed_rows = DatumGetInt64(rows);
+}
+
+static bool
+chunk_compression_tuple_found(TupleInfo *ti, void *data)
+{
+	ChunkTableCacheEntry *entry = data;
+
+	chunk_compression_from_tuple(ti, &entry->compressed_relid, &entry->compressed_rows);
+
+	return false;
+}
+
+/*
+ * Look up the table that the chunk's rows are compressed into on this node.
+ */
+static void
+chunk_compression_scan(ChunkTableCacheEntry *entry)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[2];
+	ScannerCtx	ctx = {
+		.table = catalog->tables[CHUNK_COMPRESSION].id,
+		.index = catalog->tables[CHUNK_COMPRESSION].index_ids[CHUNK_COMPRESSION_ID_INDEX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 2,
+		.scankey = scankey,
+		.data = entry,
+		.tuple_found = chunk_compression_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	entry->compressed_relid = InvalidOid;
+	entry->compressed_rows = 0;
+
+	ScanKeyInit(&scankey[0], Anum_chunk_compression_pkey_idx_chunk_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(entry->chunk_id));
+	ScanKeyInit(&scankey[1], Anum_chunk_compression_pkey_idx_database_name,
+				BTEqualStrategyNumber, F_NAMEEQ, NameGetDatum(catalog->database_name));
+
+	scanner_scan(&ctx);
+}
+
+static bool
+chunk_seal_tuple_found(TupleInfo *ti, void *data)
+{
+	ChunkTableCacheEntry *entry = data;
+
+	entry->sealed = true;
+
+	return false;
+}
+
+/*
+ * Look up whether the chunk is sealed on this node.
+ */
+static void
+chunk_seal_scan(ChunkTableCacheEntry *entry)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[1];
+	ScannerCtx	ctx = {
+		.table = catalog->tables[CHUNK_SEAL].id,
+		.index = catalog->tables[CHUNK_SEAL].index_ids[CHUNK_SEAL_ID_INDEX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.data = entry,
+		.tuple_found = chunk_seal_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	entry->sealed = false;
+
+	ScanKeyInit(&scankey[0], Anum_chunk_seal_pkey_idx_chunk_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(entry->chunk_id));
+
+	scanner_scan(&ctx);
+}
+
+/*
+ * Scan the catalog for the chunk that a table belongs to, its time range, its
+ * compressed table and whether it is sealed.
+ */
+static void
+chunk_table_cache_scan(Oid table_relid, ChunkTableCacheEntry *entry)
+{
+	Catalog    *catalog = catalog_get();
+	char	   *schema_name = get_namespace_name(get_rel_namespace(table_relid));
+	char	   *table_name = get_rel_name(table_relid);
+	ScanKeyData scankey[2];
+	ScannerCtx	ctx = {
+		.table = catalog->tables[CHUNK_REPLICA_NODE].id,
+		.index = catalog->tables[CHUNK_REPLICA_NODE].index_ids[CHUNK_REPLICA_NODE_SCHEMA_TABLE_INDEX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 2,
+		.scankey = scankey,
+		.data = entry,
+		.tuple_found = chunk_replica_id_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	entry->chunk_id = 0;
+	entry->compressed_relid = InvalidOid;
+	entry->compressed_rows = 0;
+	entry->sealed = false;
+
+	if (NULL == schema_name || NULL == table_name)
+		return;
+
+	/* Find the chunk that the table is a replica of */
+	ScanKeyInit(&scankey[0], Anum_chunk_replica_node_schema_table_idx_schema_name,
+				BTEqualStrategyNumber, F_NAMEEQ, NameGetDatum(schema_name));
+	ScanKeyInit(&scankey[1], Anum_chunk_replica_node_schema_table_idx_table_name,
+				BTEqualStrategyNumber, F_NAMEEQ, NameGetDatum(table_name));
+
+	if (scanner_scan(&ctx) == 0)
+		return;
+
+	/* Look up the time range of the chunk */
+	ctx.table = catalog->tables[CHUNK].id;
+	ctx.index = catalog->tables[CHUNK].index_ids[CHUNK_ID_INDEX];
+	ctx.nkeys = 1;
+	ctx.tuple_found = chunk_time_range_tuple_found;
+
+	ScanKeyInit(&scankey[0], Anum_chunk_pkey_idx_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(entry->chunk_id));
+
+	if (scanner_scan(&ctx) == 0)
+	{
+		entry->chunk_id = 0;
+		return;
+	}
+
+	chunk_compression_scan(entry);
+	chunk_seal_scan(entry);
+}
+
+/* The part of a chunk table cache entry that is stored in the shared cache */
+#define CHUNK_TABLE_SHARED_OFFSET offsetof(ChunkTableCacheEntry, chunk_id)
+#define CHUNK_TABLE_SHARED_SIZE (sizeof(ChunkTableCacheEntry) - CHUNK_TABLE_SHARED_OFFSET)
+
+static void *
+chunk_table_cache_create_entry(Cache *cache, CacheQuery *query)
+{
+	ChunkTableCacheQuery *cq = (ChunkTableCacheQuery *) query;
+	ChunkTableCacheEntry *entry = query->result;
+	char	   *shared = (char *) entry + CHUNK_TABLE_SHARED_OFFSET;
+	uint32		generation = shared_cache_generation(CACHE_TYPE_CHUNK);
+
+	entry->zone_maps = NIL;
+	entry->zone_maps_xmin = InvalidTransactionId;
+	entry->zone_maps_loaded = false;
+
+	if (NULL != cq->chunk)
+	{
+		entry->chunk_id = cq->chunk->id;
+		entry->start_time = cq->chunk->start_time;
+		entry->end_time = cq->chunk->end_time;
+		entry->compressed_relid = cq->compressed_relid;
+		entry->compressed_rows = cq->compressed_rows;
+		entry->sealed = cq->sealed;
+		return entry;
+	}
+
+	if (shared_cache_lookup(CACHE_TYPE_CHUNK, cq->table_relid, shared, CHUNK_TABLE_SHARED_SIZE))
+		return entry;
+
+	chunk_table_cache_scan(cq->table_relid, entry);
+	shared_cache_insert(CACHE_TYPE_CHUNK, cq->table_relid, generation,
+						shared, CHUNK_TABLE_SHARED_SIZE);
+
+	return entry;
+}
+
+/*
+ * Get the time range of the chunk that the given table belongs to. Returns
+ * false if the table is not a chunk.
+ */
+bool
+chunk_cache_get_time_range(Oid table_relid, int64 *start_time, int64 *end_time)
+{
+	ChunkTableCacheQuery query = {
+		.table_relid = table_relid,
+	};
+	ChunkTableCacheEntry *entry;
+	Cache	   *cache = cache_pin(chunk_table_cache_current);
+	bool		is_chunk;
+
+	entry = cache_fetch(cache, &query.cq);
+	is_chunk = entry->chunk_id != 0;
+	*start_time = entry->start_time;
+	*end_time = entry->end_time;
+	cache_release(cache);
+
+	return is_chunk;
+}
+
+/*
+ * Get the table that the rows of the given chunk table are compressed into,
+ * along with the number of compressed rows. Returns false if the table is not
+ * a compressed chunk.
+ */
+bool
+chunk_cache_get_compression(Oid table_relid, Oid *compressed_relid, int64 *compressed_rows)
+{
+	ChunkTableCacheQuery query = {
+		.table_relid = table_relid,
+	};
+	ChunkTableCacheEntry *entry;
+	Cache	   *cache = cache_pin(chunk_table_cache_current);
+	bool		is_compressed;
+
+	entry = cache_fetch(cache, &query.cq);
+	is_compressed = entry->chunk_id != 0 && OidIsValid(entry->compressed_relid);
+	*compressed_relid = entry->compressed_relid;
+	*compressed_rows = entry->compressed_rows;
+	cache_release(cache);
+
+	return is_compressed;
+}
+
+/*
+ * Check whether the chunk that the given table belongs to is sealed. Returns
+ * false if the table is not a chunk.
+ */
+bool
+chunk_cache_is_sealed(Oid table_relid)
+{
+	ChunkTableCacheQuery query = {
+		.table_relid = table_relid,
+	};
+	ChunkTableCacheEntry *entry;
+	Cache	   *cache = cache_pin(chunk_table_cache_current);
+	bool		sealed;
+
+	entry = cache_fetch(cache, &query.cq);
+	sealed = entry->chunk_id != 0 && entry->sealed;
+	cache_release(cache);
+
+	return sealed;
+}
+
+/*
+ * Get a copy of the latest zone maps of the chunk that the given table
+ * belongs to, along with the chunk's ID and the newest transaction that wrote
+ * them. Returns NIL if the table is not a chunk or the chunk has no zone
+ * maps.
+ */
+List *
+chunk_cache_get_zone_maps(Oid table_relid, int32 *chunk_id, TransactionId *xmin)
+{
+	ChunkTableCacheQuery query = {
+		.table_relid = table_relid,
+	};
+	ChunkTableCacheEntry *entry;
+	Cache	   *cache = cache_pin(chunk_table_cache_current);
+	List	   *zone_maps = NIL;
+
+	entry = cache_fetch(cache, &query.cq);
+	*chunk_id = entry->chunk_id;
+	*xmin = InvalidTransactionId;
+
+	if (entry->chunk_id != 0)
+	{
+		if (!entry->zone_maps_loaded)
+		{
+			List	   *scanned = zone_map_scan(entry->table_relid, entry->chunk_id, NULL,
+										   &entry->zone_maps_xmin);
+			MemoryContext old = cache_switch_to_memory_context(cache);
+
+			entry->zone_maps = zone_map_list_copy(scanned);
+			entry->zone_maps_loaded = true;
+			MemoryContextSwitchTo(old);
+		}
+
+		zone_maps = zone_map_list_copy(entry->zone_maps);
+		*xmin = entry->zone_maps_xmin;
+	}
+
+	cache_release(cache);
+
+	return zone_maps;
+}
+
 void
 chunk_cache_invalidate_callback(void)
 {
 	CACHE1_elog(WARNING, "DESTROY chunk cache");
 	cache_invalidate(chunk_cache_current);
 	chunk_cache_current = chunk_cache_create();
+	cache_invalidate(chunk_table_cache_current);
+	chunk_table_cache_current = chunk_table_cache_create();
+}
+
+/*
+ * Invalidate the entries for a single chunk table, e.g., after the chunk's
+ * catalog rows changed.
+ */
+void
+chunk_cache_invalidate_table(Oid table_relid)
+{
+	HTAB	   *table_chunks = ((ChunkCache *) chunk_cache_current)->table_chunks;
+	ChunkTableRelidEntry *entry;
+	int32		chunk_id;
+
+	cache_invalidate_entry(chunk_table_cache_current, &table_relid);
+
+	/* The chunk cache is keyed by chunk ID, so look up the table's chunk */
+	entry = hash_search(table_chunks, &table_relid, HASH_FIND, NULL);
+
+	if (entry == NULL)
+		return;
+
+	chunk_id = entry->chunk_id;
+
+	cache_invalidate_entry(chunk_cache_current, &chunk_id);
+}
+
+/*
+ * Loading of chunks in bulk.
+ *
+ * Filling the chunk cache one chunk at a time takes index scans on the replica,
+ * compression and seal tables per chunk. When the cache is prewarmed, or on a
+ * cache miss, chunks are instead collected first and each of these tables is
+ * then read in a single scan.
+ */
+
+/* A chunk to load, its replicas, its compressed table and seal */
+typedef struct ChunkLoadEntry
+{
+	int32		chunk_id;
+	Chunk	   *chunk;
+	List	   *replicas;
+	Oid			compressed_relid;
+	int64		compressed_rows;
+	bool		sealed;
+} ChunkLoadEntry;
+
+/* The most recent chunks of a partition, when prewarming */
+typedef struct PrewarmPartition
+{
+	int32		partition_id;
+	int			num_chunks;
+	Chunk	   *chunks;
+} PrewarmPartition;
+
+typedef struct ChunkLoadCtx
+{
+	MemoryContext mcxt;
+	HTAB	   *chunks;
+	int			num_chunks;
+	/* Only when prewarming */
+	int			chunks_per_partition;
+	HTAB	   *partitions;
+	/* Only when loading a batch */
+	int			max_chunks;
+	Cache	   *cache;
+} ChunkLoadCtx;
+
+static HTAB *
+chunk_load_hash_create(const char *name, Size entrysize, MemoryContext mcxt)
+{
+	HASHCTL		hctl = {
+		.keysize = sizeof(int32),
+		.entrysize = entrysize,
+		.hcxt = mcxt,
+	};
+
+	return hash_create(name, 16, &hctl, HASH_ELEM | HASH_CONTEXT | HASH_BLOBS);
+}
+
+static void
+chunk_load_begin(ChunkLoadCtx *ctx)
+{
+	ctx->mcxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "chunk cache load",
+									  ALLOCSET_DEFAULT_SIZES);
+	ctx->chunks = chunk_load_hash_create("chunk cache load chunks",
+										 sizeof(ChunkLoadEntry), ctx->mcxt);
+	ctx->num_chunks = 0;
+}
+
+static void
+chunk_load_add(ChunkLoadCtx *ctx, Chunk *chunk)
+{
+	ChunkLoadEntry *entry = hash_search(ctx->chunks, &chunk->id, HASH_ENTER, NULL);
+
+	entry->chunk = chunk;
+	entry->replicas = NIL;
+	entry->compressed_relid = InvalidOid;
+	entry->compressed_rows = 0;
+	entry->sealed = false;
+	ctx->num_chunks++;
+}
+
+static void
+chunk_from_tuple(TupleInfo *ti, Chunk *chunk)
+{
+	Datum		values[Natts_chunk];
+	bool		isnull[Natts_chunk];
+
+	heap_deform_tuple(ti->tuple, ti->desc, values, isnull);
+
+	chunk->id = DatumGetInt32(DATUM_GET(values, Anum_chunk_id));
+	chunk->partition_id = DatumGetInt32(DATUM_GET(values, Anum_chunk_partition_id));
+	chunk->start_time = isnull[Anum_chunk_start_time - 1] ?
+		OPEN_START_TIME : DatumGetInt64(DATUM_GET(values, Anum_chunk_start_time));
+	chunk->end_time = isnull[Anum_chunk_end_time - 1] ?
+		OPEN_END_TIME : DatumGetInt64(DATUM_GET(values, Anum_chunk_end_time));
+	chunk->num_replicas = 0;
+	chunk->replicas = NULL;
+}
+
+static ChunkLoadEntry *
+chunk_load_find(ChunkLoadCtx *ctx, TupleInfo *ti, AttrNumber chunk_id_attno)
+{
+	bool		is_null;
+	int32		chunk_id = DatumGetInt32(heap_getattr(ti->tuple, chunk_id_attno,
+													  ti->desc, &is_null));
+
+	return hash_search(ctx->chunks, &chunk_id, HASH_FIND, NULL);
+}
+
+static bool
+chunk_load_replica_tuple_found(TupleInfo *ti, void *data)
+{
+	ChunkLoadCtx *ctx = data;
+	ChunkLoadEntry *entry = chunk_load_find(ctx, ti, Anum_chunk_replica_node_id);
+	ChunkReplica *cr;
+
+	if (NULL == entry)
+		return true;
+
+	cr = palloc(sizeof(ChunkReplica));
+	chunk_replica_from_tuple(ti, cr);
+	entry->replicas = lappend(entry->replicas, cr);
+
+	return true;
+}
+
+static bool
+chunk_load_compression_tuple_found(TupleInfo *ti, void *data)
+{
+	ChunkLoadCtx *ctx = data;
+	ChunkLoadEntry *entry = chunk_load_find(ctx, ti, Anum_chunk_compression_chunk_id);
+	bool		is_null;
+	Datum		database_name = heap_getattr(ti->tuple, Anum_chunk_compression_database_name,
+											 ti->desc, &is_null);
+
+	/* Only the compressed tables on this node are of interest */
+	if (NULL == entry ||
+		namestrcmp(DatumGetName(database_name), NameStr(catalog_get()->database_name)) != 0)
+		return true;
+
+	chunk_compression_from_tuple(ti, &entry->compressed_relid, &entry->compressed_rows);
+
+	return true;
+}
+
+static bool
+chunk_load_seal_tuple_found(TupleInfo *ti, void *data)
+{
+	ChunkLoadCtx *ctx = data;
+	ChunkLoadEntry *entry = chunk_load_find(ctx, ti, Anum_chunk_seal_chunk_id);
+
+	if (NULL != entry)
+		entry->sealed = true;
+
+	return true;
+}
+
+/*
+ * Read the rows of the collected chunks from a catalog table whose index
+ * starts with the chunk ID, either with a single index scan on all the chunk
+ * IDs or, when many chunks are loaded, a scan of the whole table.
+ */
+static void
+chunk_load_scan(ChunkLoadCtx *ctx, enum CatalogTable table, int index, bool index_scan,
+				bool (*tuple_found) (TupleInfo *ti, void *data))
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[1];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[table].id,
+		.index = catalog->tables[table].index_ids[index],
+		.scantype = index_scan ? ScannerTypeIndex : ScannerTypeHeap,
+		.nkeys = index_scan ? 1 : 0,
+		.scankey = scankey,
+		.data = ctx,
+		.tuple_found = tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	if (index_scan)
+	{
+		Datum	   *chunk_ids = palloc(sizeof(Datum) * ctx->num_chunks);
+		HASH_SEQ_STATUS status;
+		ChunkLoadEntry *entry;
+		int			i = 0;
+
+		hash_seq_init(&status, ctx->chunks);
+
+		while ((entry = hash_seq_search(&status)) != NULL)
+			chunk_ids[i++] = Int32GetDatum(entry->chunk_id);
+
+		/* The chunk ID is the first column of the index */
+		scanner_scankey_init_array(&scankey[0], 1, BTEqualStrategyNumber,
+								   F_INT4EQ, INT4OID, chunk_ids, ctx->num_chunks);
+	}
+
+	scanner_scan(&scanctx);
+}
+
+/*
+ * Read the replicas, compressed tables and seals of the collected chunks with
+ * one scan each.
+ */
+static void
+chunk_load_metadata(ChunkLoadCtx *ctx, bool index_scan)
+{
+	chunk_load_scan(ctx, CHUNK_REPLICA_NODE, CHUNK_REPLICA_NODE_ID_INDEX, index_scan,
+					chunk_load_replica_tuple_found);
+	chunk_load_scan(ctx, CHUNK_COMPRESSION, CHUNK_COMPRESSION_ID_INDEX, index_scan,
+					chunk_load_compression_tuple_found);
+	chunk_load_scan(ctx, CHUNK_SEAL, CHUNK_SEAL_ID_INDEX, index_scan,
+					chunk_load_seal_tuple_found);
+}
+
+/* Add the collected chunks to the chunk cache and the chunk table cache */
+static void
+chunk_load_end(ChunkLoadCtx *ctx, Cache *cache, Cache *table_cache)
+{
+	HASH_SEQ_STATUS status;
+	ChunkLoadEntry *entry;
+
+	hash_seq_init(&status, ctx->chunks);
+
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		ChunkCacheQuery query = {
+			.stub_chunk = entry->chunk,
+		};
+		ListCell   *lc;
+		int			i = 0;
+
+		if (entry->replicas == NIL)
+			continue;
+
+		entry->chunk->num_replicas = list_length(entry->replicas);
+		query.replicas = palloc(sizeof(ChunkReplica) * entry->chunk->num_replicas);
+
+		foreach(lc, entry->replicas)
+			query.replicas[i++] = *((ChunkReplica *) lfirst(lc));
+
+		cache_fetch(cache, &query.cq);
+
+		for (i = 0; i < entry->chunk->num_replicas; i++)
+		{
+			ChunkTableCacheQuery table_query = {
+				.table_relid = query.replicas[i].table_id,
+				.chunk = entry->chunk,
+				.compressed_relid = entry->compressed_relid,
+				.compressed_rows = entry->compressed_rows,
+				.sealed = entry->sealed,
+			};
+
+			if (OidIsValid(table_query.table_relid))
+				cache_fetch(table_cache, &table_query.cq);
+		}
+	}
+}
+
+static bool
+chunk_prewarm_tuple_found(TupleInfo *ti, void *data)
+{
+	ChunkLoadCtx *ctx = data;
+	PrewarmPartition *part;
+	Chunk		chunk;
+	bool		found;
+
+	chunk_from_tuple(ti, &chunk);
+
+	part = hash_search(ctx->partitions, &chunk.partition_id, HASH_ENTER, &found);
+
+	if (!found)
+	{
+		part->num_chunks = 0;
+		part->chunks = palloc(sizeof(Chunk) * ctx->chunks_per_partition);
+	}
+
+	if (part->num_chunks < ctx->chunks_per_partition)
+		part->chunks[part->num_chunks++] = chunk;
+	else
+	{
+		int			oldest = 0;
+		int			i;
+
+		/* Replace the oldest chunk if this one is more recent */
+		for (i = 1; i < part->num_chunks; i++)
+		{
+			if (part->chunks[i].start_time < part->chunks[oldest].start_time)
+				oldest = i;
+		}
+
+		if (part->chunks[oldest].start_time < chunk.start_time)
+			part->chunks[oldest] = chunk;
+	}
+
+	return true;
+}
+
+/*
+ * Fill the chunk cache and chunk table cache with the most recent chunks of
+ * each partition. Chunks and replicas are read in a single scan of the chunk
+ * and chunk_replica_node tables, respectively.
+ */
+void
+chunk_cache_prewarm(int chunks_per_partition)
+{
+	Catalog    *catalog = catalog_get();
+	ChunkLoadCtx ctx = {
+		.chunks_per_partition = chunks_per_partition,
+	};
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CHUNK].id,
+		.scantype = ScannerTypeHeap,
+		.data = &ctx,
+		.tuple_found = chunk_prewarm_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+	HASH_SEQ_STATUS status;
+	PrewarmPartition *part;
+	MemoryContext old;
+	Cache	   *cache;
+	Cache	   *table_cache;
+
+	chunk_load_begin(&ctx);
+	old = MemoryContextSwitchTo(ctx.mcxt);
+
+	ctx.partitions = chunk_load_hash_create("chunk cache prewarm partitions",
+											sizeof(PrewarmPartition), ctx.mcxt);
+	scanner_scan(&scanctx);
+
+	hash_seq_init(&status, ctx.partitions);
+
+	while ((part = hash_seq_search(&status)) != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < part->num_chunks; i++)
+			chunk_load_add(&ctx, &part->chunks[i]);
+	}
+
+	chunk_load_metadata(&ctx, false);
+
+	cache = cache_pin(chunk_cache_current);
+	table_cache = cache_pin(chunk_table_cache_current);
+	chunk_load_end(&ctx, cache, table_cache);
+	cache_release(table_cache);
+	cache_release(cache);
+
+	MemoryContextSwitchTo(old);
+	MemoryContextDelete(ctx.mcxt);
+}
+
+/* Maximum number of chunks to load on a cache miss */
+#define CHUNK_CACHE_LOAD_BATCH_SIZE 64
+
+static bool
+chunk_batch_tuple_found(TupleInfo *ti, void *data)
+{
+	ChunkLoadCtx *ctx = data;
+	Chunk	   *chunk = palloc(sizeof(Chunk));
+
+	chunk_from_tuple(ti, chunk);
+
+	if (hash_search(ctx->cache->htab, &chunk->id, HASH_FIND, NULL) == NULL)
+		chunk_load_add(ctx, chunk);
+
+	return ctx->num_chunks < ctx->max_chunks;
+}
+
+/*
+ * Load a chunk that is missing from the cache, along with the chunks that
+ * precede it in its partition. Inserts and queries tend to move through a
+ * partition's chunks in time order, so the preceding chunks are likely to be
+ * needed next.
+ */
+static void
+chunk_cache_load_batch(Cache *cache, Chunk *stub_chunk)
+{
+	Catalog    *catalog = catalog_get();
+	ChunkLoadCtx ctx = {
+		.max_chunks = CHUNK_CACHE_LOAD_BATCH_SIZE,
+		.cache = cache,
+	};
+	ScanKeyData scankey[2];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CHUNK].id,
+		.index = catalog->tables[CHUNK].index_ids[CHUNK_PARTITION_TIME_INDEX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 2,
+		.scankey = scankey,
+		.data = &ctx,
+		.tuple_found = chunk_batch_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = BackwardScanDirection,
+	};
+	MemoryContext old;
+	Cache	   *table_cache;
+
+	/* Chunks with an open start are NULL in the index */
+	if (stub_chunk->start_time == OPEN_START_TIME)
+		return;
+
+	ScanKeyInit(&scankey[0], Anum_chunk_partition_start_time_end_time_idx_partition_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(stub_chunk->partition_id));
+	ScanKeyInit(&scankey[1], Anum_chunk_partition_start_time_end_time_idx_start_time,
+				BTLessEqualStrategyNumber, F_INT8LE, Int64GetDatum(stub_chunk->start_time));
+
+	cache_pin(cache);
+	chunk_load_begin(&ctx);
+	old = MemoryContextSwitchTo(ctx.mcxt);
+
+	scanner_scan(&scanctx);
+
+	if (ctx.num_chunks > 1)
+	{
+		chunk_load_metadata(&ctx, true);
+		table_cache = cache_pin(chunk_table_cache_current);
+		chunk_load_end(&ctx, cache, table_cache);
+		cache_release(table_cache);
+	}
+
+	MemoryContextSwitchTo(old);
+	MemoryContextDelete(ctx.mcxt);
+	cache_release(cache);
 }
 
 static Chunk *
@@ -225,6 +1215,9 @@ chunk_cache_get_from_stub(Cache *cache, Chunk *stub_chunk)
 		cache = chunk_cache_current;
 	}
 
+	if (hash_search(cache->htab, &stub_chunk->id, HASH_FIND, NULL) == NULL)
+		chunk_cache_load_batch(cache, stub_chunk);
+
 	return cache_fetch(cache, &ctx.cq);
 }
 
@@ -305,6 +1298,14 @@ chunk_scan(int32 partition_id, int64 timepoint, bool tuplock)
 		},
 		.scandirection = ForwardScanDirection,
 	};
+	Chunk		snapshot_chunk;
+	bool		found;
+
+	/* Lookups that lock the chunk tuple need the catalog itself */
+	if (!tuplock &&
+		catalog_snapshot_chunk_lookup(partition_id, timepoint, &snapshot_chunk, &found))
+		return found ? chunk_create(snapshot_chunk.id, snapshot_chunk.partition_id,
+									snapshot_chunk.start_time, snapshot_chunk.end_time, 0) : NULL;
 
 	/*
 	 * Perform an index scan on epoch ID to find the partitions for the epoch.
@@ -351,10 +1352,12 @@ _chunk_cache_init(void)
 {
 	CreateCacheMemoryContext();
 	chunk_cache_current = chunk_cache_create();
+	chunk_table_cache_current = chunk_table_cache_create();
 }
 
 void
 _chunk_cache_fini(void)
 {
 	cache_invalidate(chunk_cache_current);
+	cache_invalidate(chunk_table_cache_current);
 }
@@ -12,8 +12,15 @@ typedef struct Chunk Chunk;
 
 extern Chunk *chunk_cache_get(Cache *cache, Partition *part, int16 num_replicas,
 				int64 timepoint);
+extern bool chunk_cache_get_time_range(Oid table_relid, int64 *start_time, int64 *end_time);
+extern bool chunk_cache_get_compression(Oid table_relid, Oid *compressed_relid,
+							int64 *compressed_rows);
+extern bool chunk_cache_is_sealed(Oid table_relid);
+extern List *chunk_cache_get_zone_maps(Oid table_relid, int32 *chunk_id, TransactionId *xmin);
 extern Cache *chunk_cache_pin(void);
 extern void chunk_cache_invalidate_callback(void);
+extern void chunk_cache_invalidate_table(Oid table_relid);
+extern void chunk_cache_prewarm(int chunks_per_partition);
 
 extern void _chunk_cache_init(void);
 extern void _chunk_cache_fini(void);
@@ -0,0 +1,294 @@
+#include <postgres.h>
+#include <access/xact.h>
+#include <catalog/pg_type.h>
+#include <executor/spi.h>
+#include <fmgr.h>
+#include <miscadmin.h>
+#include <pgstat.h>
+#include <postmaster/bgworker.h>
+#include <storage/ipc.h>
+#include <tcop/tcopprot.h>
+#include <tcop/utility.h>
+#include <utils/builtins.h>
+#include <utils/memutils.h>
+#include <utils/snapmgr.h>
+
+#include "bgw_scheduler.h"
+
+/*
+ * Building hypertable indexes on chunks in background workers.
+ *
+ * CREATE INDEX on a hypertable builds the index on every chunk in the
+ * creating transaction, so all chunks stay locked against writes until the
+ * last one is done. With timescaledb.defer_chunk_indexes, the index is only
+ * created on the hypertable and on new chunks, and build_chunk_indexes() (see
+ * sql/main/chunk_index.sql) builds it on the existing chunks in background
+ * workers:
+ *
+ * - Each worker claims the newest chunk that lacks the index, with an
+ *   advisory lock that other workers skip, builds the index on it and
+ *   commits, until all chunks have the index. A chunk is only locked against
+ *   writes while its own index builds, and finished chunks show up in the
+ *   chunk_index_progress view right away.
+ *
+ * - Concurrently, a worker builds each index with CREATE INDEX CONCURRENTLY,
+ *   which does not block writes to the chunk, and records it in the catalog
+ *   afterwards. Since such a build waits for all transactions older than it,
+ *   the calling backend does not wait for these workers.
+ */
+
+extern void chunk_index_build_main(Datum main_arg);
+
+/* Passed to the workers in bgw_extra */
+typedef struct ChunkIndexBuildArgs
+{
+	Oid			dboid;
+	Oid			useroid;
+	bool		concurrently;
+} ChunkIndexBuildArgs;
+
+/*
+ * Run a query in its own transaction and return the columns of its first row
+ * as strings allocated in the caller's memory context. Returns NULL if there
+ * is no row or its first column is NULL.
+ */
+static char **
+chunk_index_build_exec(const char *sql, int nargs, Oid *argtypes, Datum *values)
+{
+	MemoryContext buildcxt = CurrentMemoryContext;
+	char	  **result = NULL;
+
+	StartTransactionCommand();
+	SPI_connect();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, sql);
+
+	if (SPI_execute_with_args(sql, nargs, argtypes, values, NULL, false, 0) != SPI_OK_SELECT)
+		elog(ERROR, "could not execute \"%s\"", sql);
+
+	if (SPI_processed > 0 && SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1) != NULL)
+	{
+		TupleDesc	tupdesc = SPI_tuptable->tupdesc;
+		int			i;
+
+		result = MemoryContextAlloc(buildcxt, sizeof(char *) * tupdesc->natts);
+
+		for (i = 0; i < tupdesc->natts; i++)
+		{
+			char	   *value = SPI_getvalue(SPI_tuptable->vals[0], tupdesc, i + 1);
+
+			result[i] = value == NULL ? NULL : MemoryContextStrdup(buildcxt, value);
+		}
+	}
+
+	SPI_finish();
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+	MemoryContextSwitchTo(buildcxt);
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	return result;
+}
+
+/*
+ * Run a utility statement at the top level, like a statement from a client,
+ * which CREATE INDEX CONCURRENTLY requires. It commits and starts
+ * transactions of its own, so the statement is parsed into the caller's
+ * memory context rather than the first transaction's.
+ */
+static void
+chunk_index_build_utility(const char *sql)
+{
+	MemoryContext buildcxt = CurrentMemoryContext;
+	List	   *parsetrees;
+
+	StartTransactionCommand();
+	MemoryContextSwitchTo(buildcxt);
+	PushActiveSnapshot(GetTransactionSnapshot());
+	pgstat_report_activity(STATE_RUNNING, sql);
+
+	parsetrees = pg_parse_query(sql);
+
+	if (list_length(parsetrees) != 1)
+		elog(ERROR, "could not parse \"%s\"", sql);
+
+	ProcessUtility(linitial(parsetrees), sql, PROCESS_UTILITY_TOPLEVEL, NULL, None_Receiver, NULL);
+
+	if (ActiveSnapshotSet())
+		PopActiveSnapshot();
+
+	CommitTransactionCommand();
+	MemoryContextSwitchTo(buildcxt);
+	pgstat_report_activity(STATE_IDLE, NULL);
+}
+
+/*
+ * Build the index (arg) on the next chunk that lacks it with CREATE INDEX
+ * CONCURRENTLY. Returns false if all chunks have the index.
+ */
+static bool
+chunk_index_build_concurrently(Datum index_relid)
+{
+	Oid			argtypes[5] = {REGCLASSOID, TEXTOID, TEXTOID, TEXTOID, BOOLOID};
+	Datum		values[5] = {index_relid, (Datum) 0, (Datum) 0, (Datum) 0, BoolGetDatum(true)};
+	const char *finish_sql = "SELECT _timescaledb_internal.chunk_index_build_finish($1, $2::name, $3::name, $4::name, $5)";
+	MemoryContext buildcxt = CurrentMemoryContext;
+	char	  **claim;
+
+	claim = chunk_index_build_exec("SELECT schema_name, table_name, index_name, definition "
+		   "FROM _timescaledb_internal.chunk_index_build_claim_concurrently($1)",
+								   1, argtypes, values);
+
+	if (claim == NULL)
+		return false;
+
+	values[1] = CStringGetTextDatum(claim[0]);
+	values[2] = CStringGetTextDatum(claim[1]);
+	values[3] = CStringGetTextDatum(claim[2]);
+
+	PG_TRY();
+	{
+		chunk_index_build_utility(claim[3]);
+	}
+	PG_CATCH();
+	{
+		ErrorData  *edata;
+
+		/* Drop the invalid index that a failed build leaves behind */
+		MemoryContextSwitchTo(buildcxt);
+		edata = CopyErrorData();
+		FlushErrorState();
+		AbortCurrentTransaction();
+		MemoryContextSwitchTo(buildcxt);
+
+		values[4] = BoolGetDatum(false);
+		chunk_index_build_exec(finish_sql, 5, argtypes, values);
+
+		ReThrowError(edata);
+	}
+	PG_END_TRY();
+
+	chunk_index_build_exec(finish_sql, 5, argtypes, values);
+
+	return true;
+}
+
+/*
+ * Main function of a build worker. Builds the index (arg) on one chunk after
+ * the other until all chunks have it. A failed build ends the worker, with
+ * the error in the server log.
+ */
+void
+chunk_index_build_main(Datum main_arg)
+{
+	ChunkIndexBuildArgs args;
+	Oid			argtypes[1] = {REGCLASSOID};
+	MemoryContext buildcxt;
+
+	memcpy(&args, MyBgworkerEntry->bgw_extra, sizeof(ChunkIndexBuildArgs));
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+	BackgroundWorkerInitializeConnectionByOid(args.dboid, args.useroid);
+
+	buildcxt = AllocSetContextCreate(TopMemoryContext,
+									 "chunk index build",
+									 ALLOCSET_DEFAULT_SIZES);
+
+	for (;;)
+	{
+		bool		built;
+
+		MemoryContextSwitchTo(buildcxt);
+		MemoryContextReset(buildcxt);
+
+		if (args.concurrently)
+			built = chunk_index_build_concurrently(main_arg);
+		else
+			built = chunk_index_build_exec("SELECT _timescaledb_internal.chunk_index_build_next($1)",
+										   1, argtypes, &main_arg) != NULL;
+
+		if (!built)
+			break;
+	}
+
+	proc_exit(0);
+}
+
+PG_FUNCTION_INFO_V1(chunk_index_build_start);
+
+/*
+ * Start up to the given number (arg 1) of workers that build a hypertable
+ * index (arg 0) on the chunks that lack it, concurrently (arg 2) or not.
+ * Waits for the workers unless they build concurrently. Returns the number of
+ * workers started.
+ */
+Datum
+chunk_index_build_start(PG_FUNCTION_ARGS)
+{
+	Oid			index_relid = PG_GETARG_OID(0);
+	int32		max_workers = PG_GETARG_INT32(1);
+	ChunkIndexBuildArgs args;
+	BackgroundWorkerHandle **handles;
+	int			num_workers = 0;
+	int			i;
+
+	/* The workers only see committed indexes and chunks */
+	if (IsTransactionBlock())
+		ereport(ERROR,
+				(errcode(ERRCODE_ACTIVE_SQL_TRANSACTION),
+				 errmsg("cannot build chunk indexes inside a transaction block")));
+
+	memset(&args, 0, sizeof(ChunkIndexBuildArgs));
+	args.dboid = MyDatabaseId;
+	args.useroid = GetUserId();
+	args.concurrently = PG_GETARG_BOOL(2);
+
+	handles = palloc0(sizeof(BackgroundWorkerHandle *) * max_workers);
+
+	for (i = 0; i < max_workers; i++)
+	{
+		BackgroundWorker worker;
+
+		bgw_worker_init(&worker, "timescaledb chunk index build", "chunk_index_build_main",
+						ObjectIdGetDatum(index_relid));
+		memcpy(worker.bgw_extra, &args, sizeof(ChunkIndexBuildArgs));
+		worker.bgw_notify_pid = MyProcPid;
+
+		if (!RegisterDynamicBackgroundWorker(&worker, &handles[num_workers]))
+			break;
+
+		num_workers++;
+	}
+
+	if (num_workers == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+				 errmsg("could not start chunk index build workers"),
+				 errhint("Consider increasing max_worker_processes.")));
+
+	if (args.concurrently)
+		PG_RETURN_INT32(num_workers);
+
+	PG_TRY();
+	{
+		for (i = 0; i < num_workers; i++)
+		{
+			if (WaitForBackgroundWorkerShutdown(handles[i]) == BGWH_POSTMASTER_DIED)
+				ereport(ERROR,
+						(errcode(ERRCODE_ADMIN_SHUTDOWN),
+						 errmsg("postmaster exited during chunk index build")));
+		}
+	}
+	PG_CATCH();
+	{
+		/* Do not leave workers running when the wait is canceled */
+		for (i = 0; i < num_workers; i++)
+			TerminateBackgroundWorker(handles[i]);
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	PG_RETURN_INT32(num_workers);
+}
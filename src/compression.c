@@ -0,0 +1,1319 @@
+#include <postgres.h>
+#include <access/hash.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <catalog/pg_type.h>
+#include <executor/executor.h>
+#include <executor/tuptable.h>
+#include <lib/stringinfo.h>
+#include <miscadmin.h>
+#include <parser/parse_oper.h>
+#include <utils/builtins.h>
+#include <utils/datum.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <utils/tuplesort.h>
+
+#include "compression.h"
+
+/*
+ * Columnar compression of chunks.
+ *
+ * A compressed chunk stores its rows in a companion table, which has one row
+ * per group of up to COMPRESSION_MAX_GROUP_ROWS rows of the chunk. Rows are
+ * grouped by an optional segment-by column, which the compressed table stores
+ * as is, once per group. All other columns are stored as one bytea per group,
+ * which holds the values of the column in the group in compressed form:
+ *
+ * - integers, dates and timestamps are delta-of-delta encoded, so that
+ *   regularly spaced values take a byte for a whole run;
+ * - floating point values are XOR'ed with the previous value, and only the
+ *   meaningful bits of the result are stored, as in Facebook's Gorilla;
+ * - other values are stored in a dictionary of distinct values, with
+ *   run-length encoded indexes into the dictionary.
+ *
+ * Rows are sorted by the segment-by column and time before they are grouped,
+ * which makes the deltas regular and the runs long.
+ *
+ * Each compressed value starts with a header of the algorithm, the number of
+ * rows and an optional bitmap of NULLs, followed by the non-NULL values.
+ */
+
+/*
+ * Writing and reading bytes
+ */
+
+static void
+append_varint(StringInfo buf, uint64 value)
+{
+	while (value >= 0x80)
+	{
+		appendStringInfoCharMacro(buf, (char) ((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+
+	appendStringInfoCharMacro(buf, (char) value);
+}
+
+static uint64
+zigzag_encode(int64 value)
+{
+	return ((uint64) value << 1) ^ (uint64) (value >> 63);
+}
+
+static int64
+zigzag_decode(uint64 value)
+{
+	return (int64) (value >> 1) ^ -(int64) (value & 1);
+}
+
+typedef struct ByteReader
+{
+	const uint8 *data;
+	Size		len;
+	Size		pos;
+} ByteReader;
+
+static void
+reader_check(ByteReader *reader, Size nbytes)
+{
+	if (reader->pos + nbytes > reader->len)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("compressed data is corrupt")));
+}
+
+static uint8
+read_byte(ByteReader *reader)
+{
+	reader_check(reader, 1);
+	return reader->data[reader->pos++];
+}
+
+static const uint8 *
+read_bytes(ByteReader *reader, Size nbytes)
+{
+	const uint8 *bytes;
+
+	reader_check(reader, nbytes);
+	bytes = reader->data + reader->pos;
+	reader->pos += nbytes;
+
+	return bytes;
+}
+
+static uint64
+read_varint(ByteReader *reader)
+{
+	uint64		value = 0;
+	int			shift = 0;
+	uint8		byte;
+
+	do
+	{
+		if (shift >= 64)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("compressed data is corrupt")));
+
+		byte = read_byte(reader);
+		value |= (uint64) (byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	return value;
+}
+
+/*
+ * Writing and reading bits, most significant bit first
+ */
+
+typedef struct BitWriter
+{
+	StringInfo	buf;
+	uint8		current;
+	int			nbits;
+} BitWriter;
+
+static void
+bitwriter_put(BitWriter *writer, uint64 value, int nbits)
+{
+	while (nbits > 0)
+	{
+		int			n = Min(8 - writer->nbits, nbits);
+
+		writer->current = (writer->current << n) | ((value >> (nbits - n)) & ((1 << n) - 1));
+		writer->nbits += n;
+		nbits -= n;
+
+		if (writer->nbits == 8)
+		{
+			appendStringInfoCharMacro(writer->buf, (char) writer->current);
+			writer->current = 0;
+			writer->nbits = 0;
+		}
+	}
+}
+
+static void
+bitwriter_flush(BitWriter *writer)
+{
+	if (writer->nbits > 0)
+		bitwriter_put(writer, 0, 8 - writer->nbits);
+}
+
+typedef struct BitReader
+{
+	ByteReader *reader;
+	uint8		current;
+	int			nbits;
+} BitReader;
+
+static uint64
+bitreader_get(BitReader *br, int nbits)
+{
+	uint64		value = 0;
+
+	while (nbits > 0)
+	{
+		int			n;
+
+		if (br->nbits == 0)
+		{
+			br->current = read_byte(br->reader);
+			br->nbits = 8;
+		}
+
+		n = Min(br->nbits, nbits);
+		value = (value << n) | ((br->current >> (br->nbits - n)) & ((1 << n) - 1));
+		br->nbits -= n;
+		nbits -= n;
+	}
+
+	return value;
+}
+
+static int
+leading_zeros(uint64 value)
+{
+	int			n = 0;
+
+	while (n < 64 && !(value & (UINT64CONST(1) << 63)))
+	{
+		value <<= 1;
+		n++;
+	}
+
+	return n;
+}
+
+static int
+trailing_zeros(uint64 value)
+{
+	int			n = 0;
+
+	while (n < 64 && !(value & 1))
+	{
+		value >>= 1;
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * Types
+ */
+
+void
+compression_type_init(CompressionType *type, Oid typid)
+{
+	type->typid = typid;
+	get_typlenbyval(typid, &type->typlen, &type->typbyval);
+
+	switch (typid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+#ifdef HAVE_INT64_TIMESTAMP
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+#endif
+			type->algorithm = COMPRESSION_ALGORITHM_DELTADELTA;
+			break;
+		case FLOAT4OID:
+		case FLOAT8OID:
+#ifndef HAVE_INT64_TIMESTAMP
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+#endif
+			type->algorithm = COMPRESSION_ALGORITHM_GORILLA;
+			break;
+		default:
+			type->algorithm = COMPRESSION_ALGORITHM_DICTIONARY;
+			break;
+	}
+}
+
+/* Get the bits of an integer or floating point value */
+static uint64
+datum_get_bits(CompressionType *type, Datum value)
+{
+	switch (type->typid)
+	{
+		case INT2OID:
+			return (uint64) (int64) DatumGetInt16(value);
+		case INT4OID:
+		case DATEOID:
+			return (uint64) (int64) DatumGetInt32(value);
+		case FLOAT4OID:
+			{
+				float4		f = DatumGetFloat4(value);
+				uint32		bits;
+
+				memcpy(&bits, &f, sizeof(bits));
+				return bits;
+			}
+		case FLOAT8OID:
+#ifndef HAVE_INT64_TIMESTAMP
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+#endif
+			{
+				float8		f = DatumGetFloat8(value);
+				uint64		bits;
+
+				memcpy(&bits, &f, sizeof(bits));
+				return bits;
+			}
+		default:
+			return (uint64) DatumGetInt64(value);
+	}
+}
+
+static Datum
+bits_get_datum(CompressionType *type, uint64 bits)
+{
+	switch (type->typid)
+	{
+		case INT2OID:
+			return Int16GetDatum((int16) bits);
+		case INT4OID:
+		case DATEOID:
+			return Int32GetDatum((int32) bits);
+		case FLOAT4OID:
+			{
+				uint32		b = (uint32) bits;
+				float4		f;
+
+				memcpy(&f, &b, sizeof(f));
+				return Float4GetDatum(f);
+			}
+		case FLOAT8OID:
+#ifndef HAVE_INT64_TIMESTAMP
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+#endif
+			{
+				float8		f;
+
+				memcpy(&f, &bits, sizeof(f));
+				return Float8GetDatum(f);
+			}
+		default:
+			return Int64GetDatum((int64) bits);
+	}
+}
+
+/*
+ * Delta-of-delta encoding. Each value is encoded as the zigzag-encoded
+ * difference between its delta to the previous value and the previous delta.
+ * A run of zero differences, i.e., of regularly spaced values, is encoded as
+ * a zero followed by the length of the run.
+ */
+
+static void
+deltadelta_encode(StringInfo buf, uint64 *values, int count)
+{
+	uint64		prev = 0;
+	uint64		prev_delta = 0;
+	int			i = 0;
+
+	while (i < count)
+	{
+		uint64		delta = values[i] - prev;
+
+		if (delta == prev_delta)
+		{
+			int			run = 0;
+
+			while (i < count && values[i] - prev == prev_delta)
+			{
+				prev = values[i++];
+				run++;
+			}
+
+			append_varint(buf, 0);
+			append_varint(buf, run);
+		}
+		else
+		{
+			append_varint(buf, zigzag_encode((int64) (delta - prev_delta)));
+			prev = values[i++];
+			prev_delta = delta;
+		}
+	}
+}
+
+static void
+deltadelta_decode(ByteReader *reader, uint64 *values, int count)
+{
+	uint64		prev = 0;
+	uint64		prev_delta = 0;
+	int			i = 0;
+
+	while (i < count)
+	{
+		uint64		token = read_varint(reader);
+
+		if (token == 0)
+		{
+			uint64		run = read_varint(reader);
+
+			if (run > count - i)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("compressed data is corrupt")));
+
+			while (run-- > 0)
+			{
+				prev += prev_delta;
+				values[i++] = prev;
+			}
+		}
+		else
+		{
+			prev_delta += (uint64) zigzag_decode(token);
+			prev += prev_delta;
+			values[i++] = prev;
+		}
+	}
+}
+
+/*
+ * Gorilla encoding. A value equal to the previous one takes a single bit.
+ * Otherwise, the XOR with the previous value is stored without its leading
+ * and trailing zeros, reusing the previous number of leading and trailing
+ * zeros if the meaningful bits fit within them.
+ */
+
+static void
+gorilla_encode(StringInfo buf, uint64 *values, int count)
+{
+	BitWriter	writer = {
+		.buf = buf,
+	};
+	int			prev_leading = -1;
+	int			prev_trailing = 0;
+	int			i;
+
+	if (count == 0)
+		return;
+
+	bitwriter_put(&writer, values[0], 64);
+
+	for (i = 1; i < count; i++)
+	{
+		uint64		xor = values[i] ^ values[i - 1];
+		int			leading,
+					trailing;
+
+		if (xor == 0)
+		{
+			bitwriter_put(&writer, 0, 1);
+			continue;
+		}
+
+		bitwriter_put(&writer, 1, 1);
+		leading = Min(leading_zeros(xor), 63);
+		trailing = trailing_zeros(xor);
+
+		if (prev_leading >= 0 && leading >= prev_leading && trailing >= prev_trailing)
+		{
+			bitwriter_put(&writer, 0, 1);
+			bitwriter_put(&writer, xor >> prev_trailing, 64 - prev_leading - prev_trailing);
+		}
+		else
+		{
+			int			meaningful = 64 - leading - trailing;
+
+			bitwriter_put(&writer, 1, 1);
+			bitwriter_put(&writer, leading, 6);
+			bitwriter_put(&writer, meaningful - 1, 6);
+			bitwriter_put(&writer, xor >> trailing, meaningful);
+			prev_leading = leading;
+			prev_trailing = trailing;
+		}
+	}
+
+	bitwriter_flush(&writer);
+}
+
+static void
+gorilla_decode(ByteReader *reader, uint64 *values, int count)
+{
+	BitReader	br = {
+		.reader = reader,
+	};
+	int			leading = -1;
+	int			trailing = 0;
+	int			i;
+
+	if (count == 0)
+		return;
+
+	values[0] = bitreader_get(&br, 64);
+
+	for (i = 1; i < count; i++)
+	{
+		uint64		xor = 0;
+
+		if (bitreader_get(&br, 1) == 1)
+		{
+			if (bitreader_get(&br, 1) == 1)
+			{
+				int			meaningful;
+
+				leading = bitreader_get(&br, 6);
+				meaningful = bitreader_get(&br, 6) + 1;
+				trailing = 64 - leading - meaningful;
+
+				if (trailing < 0)
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("compressed data is corrupt")));
+			}
+			else if (leading < 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("compressed data is corrupt")));
+
+			xor = bitreader_get(&br, 64 - leading - trailing) << trailing;
+		}
+
+		values[i] = values[i - 1] ^ xor;
+	}
+}
+
+/*
+ * Dictionary encoding. Values are compared by their binary representation.
+ */
+
+static void
+datum_get_image(CompressionType *type, Datum value, const char **image, Size *len)
+{
+	if (type->typbyval)
+	{
+		char	   *copy = palloc(sizeof(Datum));
+
+		store_att_byval(copy, value, type->typlen);
+		*image = copy;
+		*len = type->typlen;
+	}
+	else if (type->typlen == -1)
+	{
+		struct varlena *varlena = PG_DETOAST_DATUM_PACKED(value);
+
+		*image = (const char *) varlena;
+		*len = VARSIZE_ANY(varlena);
+	}
+	else if (type->typlen == -2)
+	{
+		*image = DatumGetCString(value);
+		*len = strlen(*image) + 1;
+	}
+	else
+	{
+		*image = DatumGetPointer(value);
+		*len = type->typlen;
+	}
+}
+
+static Datum
+image_get_datum(CompressionType *type, const uint8 *image, Size len)
+{
+	if (type->typbyval)
+	{
+		union
+		{
+			Datum		datum;
+			int64		align;
+			char		bytes[sizeof(Datum)];
+		}			copy;
+
+		if (len != type->typlen)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("compressed data is corrupt")));
+
+		memcpy(copy.bytes, image, len);
+		return fetch_att(copy.bytes, true, type->typlen);
+	}
+
+	if (type->typlen == -1 && len > 0 && VARATT_IS_1B(image))
+	{
+		/* Restore the regular header of a short varlena */
+		Size		datalen = len - VARHDRSZ_SHORT;
+		struct varlena *varlena = palloc(datalen + VARHDRSZ);
+
+		SET_VARSIZE(varlena, datalen + VARHDRSZ);
+		memcpy(VARDATA(varlena), image + VARHDRSZ_SHORT, datalen);
+		return PointerGetDatum(varlena);
+	}
+	else
+	{
+		char	   *copy = palloc(len);
+
+		memcpy(copy, image, len);
+		return PointerGetDatum(copy);
+	}
+}
+
+static void
+dictionary_encode(StringInfo buf, CompressionType *type, Datum *values, int count)
+{
+	const char **images = palloc(sizeof(char *) * count);
+	Size	   *lens = palloc(sizeof(Size) * count);
+	int		   *indexes = palloc(sizeof(int) * count);
+	int		   *dictionary = palloc(sizeof(int) * count);
+	int			num_entries = 0;
+	int			capacity = 16;
+	int		   *slots;
+	int			i;
+
+	while (capacity < count * 2)
+		capacity *= 2;
+
+	slots = palloc(sizeof(int) * capacity);
+	memset(slots, -1, sizeof(int) * capacity);
+
+	for (i = 0; i < count; i++)
+	{
+		uint32		slot;
+
+		datum_get_image(type, values[i], &images[i], &lens[i]);
+		slot = DatumGetUInt32(hash_any((const unsigned char *) images[i], lens[i])) & (capacity - 1);
+
+		for (;;)
+		{
+			int			entry = slots[slot];
+
+			if (entry < 0)
+			{
+				slots[slot] = num_entries;
+				dictionary[num_entries] = i;
+				indexes[i] = num_entries++;
+				break;
+			}
+
+			if (lens[dictionary[entry]] == lens[i] &&
+				memcmp(images[dictionary[entry]], images[i], lens[i]) == 0)
+			{
+				indexes[i] = entry;
+				break;
+			}
+
+			slot = (slot + 1) & (capacity - 1);
+		}
+	}
+
+	append_varint(buf, num_entries);
+
+	for (i = 0; i < num_entries; i++)
+	{
+		int			first = dictionary[i];
+
+		append_varint(buf, lens[first]);
+		appendBinaryStringInfo(buf, images[first], lens[first]);
+	}
+
+	for (i = 0; i < count;)
+	{
+		int			run = 1;
+
+		while (i + run < count && indexes[i + run] == indexes[i])
+			run++;
+
+		append_varint(buf, run);
+		append_varint(buf, indexes[i]);
+		i += run;
+	}
+}
+
+static void
+dictionary_decode(ByteReader *reader, CompressionType *type, Datum *values, int count)
+{
+	uint64		num_entries = read_varint(reader);
+	Datum	   *dictionary;
+	uint64		i;
+	int			pos = 0;
+
+	if (num_entries > count)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("compressed data is corrupt")));
+
+	dictionary = palloc(sizeof(Datum) * Max(num_entries, 1));
+
+	for (i = 0; i < num_entries; i++)
+	{
+		uint64		len = read_varint(reader);
+
+		dictionary[i] = image_get_datum(type, read_bytes(reader, len), len);
+	}
+
+	while (pos < count)
+	{
+		uint64		run = read_varint(reader);
+		uint64		index = read_varint(reader);
+
+		if (run > count - pos || index >= num_entries)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("compressed data is corrupt")));
+
+		while (run-- > 0)
+			values[pos++] = dictionary[index];
+	}
+}
+
+/*
+ * Compress the values of a column in a group of rows.
+ */
+bytea *
+compression_compress(CompressionType *type, Datum *values, bool *nulls, int count)
+{
+	StringInfoData buf;
+	Datum	   *nonnull = palloc(sizeof(Datum) * Max(count, 1));
+	int			num_nonnull = 0;
+	bool		has_nulls = false;
+	int			i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (nulls[i])
+			has_nulls = true;
+		else
+			nonnull[num_nonnull++] = values[i];
+	}
+
+	initStringInfo(&buf);
+	appendStringInfoSpaces(&buf, VARHDRSZ);
+	appendStringInfoCharMacro(&buf, (char) type->algorithm);
+	append_varint(&buf, count);
+	appendStringInfoCharMacro(&buf, (char) has_nulls);
+
+	if (has_nulls)
+	{
+		int			nbytes = (count + 7) / 8;
+		uint8	   *bitmap = palloc0(nbytes);
+
+		for (i = 0; i < count; i++)
+		{
+			if (nulls[i])
+				bitmap[i / 8] |= 1 << (i % 8);
+		}
+
+		appendBinaryStringInfo(&buf, (char *) bitmap, nbytes);
+	}
+
+	switch (type->algorithm)
+	{
+		case COMPRESSION_ALGORITHM_DELTADELTA:
+		case COMPRESSION_ALGORITHM_GORILLA:
+			{
+				uint64	   *bits = palloc(sizeof(uint64) * Max(num_nonnull, 1));
+
+				for (i = 0; i < num_nonnull; i++)
+					bits[i] = datum_get_bits(type, nonnull[i]);
+
+				if (type->algorithm == COMPRESSION_ALGORITHM_DELTADELTA)
+					deltadelta_encode(&buf, bits, num_nonnull);
+				else
+					gorilla_encode(&buf, bits, num_nonnull);
+				break;
+			}
+		case COMPRESSION_ALGORITHM_DICTIONARY:
+			dictionary_encode(&buf, type, nonnull, num_nonnull);
+			break;
+	}
+
+	SET_VARSIZE(buf.data, buf.len);
+
+	return (bytea *) buf.data;
+}
+
+/*
+ * Decompress the values of a column in a group of rows. Returns the number of
+ * rows.
+ */
+int
+compression_decompress(CompressionType *type, bytea *data, Datum *values,
+					   bool *nulls, int max_count)
+{
+	ByteReader	reader = {
+		.data = (uint8 *) VARDATA_ANY(data),
+		.len = VARSIZE_ANY_EXHDR(data),
+	};
+	CompressionAlgorithm algorithm = read_byte(&reader);
+	uint64		stored_count = read_varint(&reader);
+	bool		has_nulls = read_byte(&reader);
+	Datum	   *nonnull;
+	int			num_nonnull = 0;
+	int			count;
+	int			i;
+
+	if (stored_count > max_count ||
+		(algorithm != type->algorithm && algorithm != COMPRESSION_ALGORITHM_DICTIONARY))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("compressed data is corrupt")));
+
+	count = (int) stored_count;
+
+	if (has_nulls)
+	{
+		const uint8 *bitmap = read_bytes(&reader, (count + 7) / 8);
+
+		for (i = 0; i < count; i++)
+		{
+			nulls[i] = (bitmap[i / 8] & (1 << (i % 8))) != 0;
+
+			if (!nulls[i])
+				num_nonnull++;
+		}
+	}
+	else
+	{
+		memset(nulls, 0, sizeof(bool) * count);
+		num_nonnull = count;
+	}
+
+	nonnull = palloc(sizeof(Datum) * Max(num_nonnull, 1));
+
+	switch (algorithm)
+	{
+		case COMPRESSION_ALGORITHM_DELTADELTA:
+		case COMPRESSION_ALGORITHM_GORILLA:
+			{
+				uint64	   *bits = palloc(sizeof(uint64) * Max(num_nonnull, 1));
+
+				if (algorithm == COMPRESSION_ALGORITHM_DELTADELTA)
+					deltadelta_decode(&reader, bits, num_nonnull);
+				else
+					gorilla_decode(&reader, bits, num_nonnull);
+
+				for (i = 0; i < num_nonnull; i++)
+					nonnull[i] = bits_get_datum(type, bits[i]);
+				break;
+			}
+		case COMPRESSION_ALGORITHM_DICTIONARY:
+			dictionary_decode(&reader, type, nonnull, num_nonnull);
+			break;
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("compressed data is corrupt")));
+	}
+
+	for (i = count - 1; i >= 0; i--)
+		values[i] = nulls[i] ? (Datum) 0 : nonnull[--num_nonnull];
+
+	return count;
+}
+
+/*
+ * Columns of a chunk and where they are stored in the compressed table.
+ */
+typedef struct CompressionColumn
+{
+	/* InvalidAttrNumber for dropped columns and columns added later */
+	AttrNumber	compressed_attno;
+	bool		is_segment_by;
+	CompressionType type;
+	Datum	   *values;
+	bool	   *nulls;
+} CompressionColumn;
+
+/*
+ * Map the columns of a chunk to the columns with the same names in its
+ * compressed table. The segment-by column has the same type in both tables,
+ * while the compressed columns are of type bytea.
+ */
+static CompressionColumn *
+compression_columns_create(TupleDesc desc, Relation compressed_rel)
+{
+	CompressionColumn *columns = palloc0(sizeof(CompressionColumn) * desc->natts);
+	TupleDesc	compressed_desc = RelationGetDescr(compressed_rel);
+	int			i;
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		Form_pg_attribute attr = desc->attrs[i];
+		CompressionColumn *column = &columns[i];
+		AttrNumber	attno;
+
+		column->values = palloc(sizeof(Datum) * COMPRESSION_MAX_GROUP_ROWS);
+		column->nulls = palloc(sizeof(bool) * COMPRESSION_MAX_GROUP_ROWS);
+
+		if (attr->attisdropped)
+			continue;
+
+		attno = get_attnum(RelationGetRelid(compressed_rel), NameStr(attr->attname));
+
+		if (attno == InvalidAttrNumber)
+			continue;
+
+		column->compressed_attno = attno;
+		column->is_segment_by = compressed_desc->attrs[AttrNumberGetAttrOffset(attno)]->atttypid != BYTEAOID;
+		compression_type_init(&column->type, attr->atttypid);
+	}
+
+	return columns;
+}
+
+/*
+ * Decompressing groups of rows
+ */
+struct GroupDecompressor
+{
+	TupleDesc	desc;
+	TupleDesc	compressed_desc;
+	CompressionColumn *columns;
+	AttrNumber	count_attno;
+	int			num_rows;
+	int			next_row;
+	Datum	   *row_values;
+	bool	   *row_nulls;
+	MemoryContext mcxt;
+};
+
+GroupDecompressor *
+group_decompressor_create(Relation rel, Relation compressed_rel)
+{
+	GroupDecompressor *gd = palloc0(sizeof(GroupDecompressor));
+
+	gd->desc = RelationGetDescr(rel);
+	gd->compressed_desc = RelationGetDescr(compressed_rel);
+	gd->columns = compression_columns_create(gd->desc, compressed_rel);
+	gd->count_attno = get_attnum(RelationGetRelid(compressed_rel), COMPRESSION_COUNT_COLUMN_NAME);
+	gd->row_values = palloc(sizeof(Datum) * gd->desc->natts);
+	gd->row_nulls = palloc(sizeof(bool) * gd->desc->natts);
+	gd->mcxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "Group decompression",
+									 ALLOCSET_DEFAULT_SIZES);
+
+	if (gd->count_attno == InvalidAttrNumber)
+		elog(ERROR, "compressed table \"%s\" has no column \"%s\"",
+			 RelationGetRelationName(compressed_rel), COMPRESSION_COUNT_COLUMN_NAME);
+
+	return gd;
+}
+
+/*
+ * Decompress a row of a compressed table, to return its rows with
+ * group_decompressor_next().
+ */
+void
+group_decompressor_load(GroupDecompressor *gd, HeapTuple compressed_tuple)
+{
+	MemoryContext old;
+	bool		isnull;
+	Datum		count;
+	int			i;
+
+	MemoryContextReset(gd->mcxt);
+	old = MemoryContextSwitchTo(gd->mcxt);
+
+	count = heap_getattr(compressed_tuple, gd->count_attno, gd->compressed_desc, &isnull);
+
+	if (isnull || DatumGetInt32(count) < 0 || DatumGetInt32(count) > COMPRESSION_MAX_GROUP_ROWS)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("compressed data is corrupt")));
+
+	gd->num_rows = DatumGetInt32(count);
+	gd->next_row = 0;
+
+	for (i = 0; i < gd->desc->natts; i++)
+	{
+		CompressionColumn *column = &gd->columns[i];
+		Datum		value = (Datum) 0;
+		int			row;
+
+		if (column->compressed_attno != InvalidAttrNumber)
+			value = heap_getattr(compressed_tuple, column->compressed_attno,
+								 gd->compressed_desc, &isnull);
+		else
+			isnull = true;
+
+		if (isnull || column->is_segment_by)
+		{
+			if (!isnull)
+				value = datumCopy(value, column->type.typbyval, column->type.typlen);
+
+			for (row = 0; row < gd->num_rows; row++)
+			{
+				column->values[row] = value;
+				column->nulls[row] = isnull;
+			}
+		}
+		else if (compression_decompress(&column->type, DatumGetByteaP(value),
+										column->values, column->nulls,
+										COMPRESSION_MAX_GROUP_ROWS) != gd->num_rows)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("compressed data is corrupt")));
+	}
+
+	MemoryContextSwitchTo(old);
+}
+
+/*
+ * Get the next row of the loaded group, or NULL if there are no more rows. The
+ * row is allocated in the current memory context.
+ */
+HeapTuple
+group_decompressor_next(GroupDecompressor *gd)
+{
+	int			i;
+
+	if (gd->next_row >= gd->num_rows)
+		return NULL;
+
+	for (i = 0; i < gd->desc->natts; i++)
+	{
+		gd->row_values[i] = gd->columns[i].values[gd->next_row];
+		gd->row_nulls[i] = gd->columns[i].nulls[gd->next_row];
+	}
+
+	gd->next_row++;
+
+	return heap_form_tuple(gd->desc, gd->row_values, gd->row_nulls);
+}
+
+void
+group_decompressor_reset(GroupDecompressor *gd)
+{
+	gd->num_rows = 0;
+	gd->next_row = 0;
+}
+
+void
+group_decompressor_destroy(GroupDecompressor *gd)
+{
+	MemoryContextDelete(gd->mcxt);
+}
+
+/*
+ * Compressing groups of rows
+ */
+typedef struct GroupCompressor
+{
+	TupleDesc	desc;
+	Relation	compressed_rel;
+	CompressionColumn *columns;
+	AttrNumber	count_attno;
+	int			num_rows;
+	MemoryContext mcxt;
+	CommandId	cid;
+	BulkInsertState bistate;
+} GroupCompressor;
+
+static void
+group_compressor_flush(GroupCompressor *gc)
+{
+	TupleDesc	compressed_desc = RelationGetDescr(gc->compressed_rel);
+	Datum	   *values = palloc0(sizeof(Datum) * compressed_desc->natts);
+	bool	   *nulls = palloc(sizeof(bool) * compressed_desc->natts);
+	MemoryContext old = MemoryContextSwitchTo(gc->mcxt);
+	HeapTuple	tuple;
+	int			i;
+
+	memset(nulls, true, sizeof(bool) * compressed_desc->natts);
+
+	for (i = 0; i < gc->desc->natts; i++)
+	{
+		CompressionColumn *column = &gc->columns[i];
+		int			offset = AttrNumberGetAttrOffset(column->compressed_attno);
+
+		if (column->compressed_attno == InvalidAttrNumber)
+			continue;
+
+		if (column->is_segment_by)
+		{
+			values[offset] = column->values[0];
+			nulls[offset] = column->nulls[0];
+		}
+		else
+		{
+			values[offset] = PointerGetDatum(compression_compress(&column->type, column->values,
+														   column->nulls, gc->num_rows));
+			nulls[offset] = false;
+		}
+	}
+
+	values[AttrNumberGetAttrOffset(gc->count_attno)] = Int32GetDatum(gc->num_rows);
+	nulls[AttrNumberGetAttrOffset(gc->count_attno)] = false;
+
+	tuple = heap_form_tuple(compressed_desc, values, nulls);
+	heap_insert(gc->compressed_rel, tuple, gc->cid, 0, gc->bistate);
+
+	MemoryContextSwitchTo(old);
+	MemoryContextReset(gc->mcxt);
+	pfree(values);
+	pfree(nulls);
+	gc->num_rows = 0;
+}
+
+static void
+group_compressor_append(GroupCompressor *gc, TupleTableSlot *slot)
+{
+	MemoryContext old = MemoryContextSwitchTo(gc->mcxt);
+	int			i;
+
+	for (i = 0; i < gc->desc->natts; i++)
+	{
+		CompressionColumn *column = &gc->columns[i];
+		Form_pg_attribute attr = gc->desc->attrs[i];
+
+		if (column->compressed_attno == InvalidAttrNumber)
+			continue;
+
+		column->nulls[gc->num_rows] = slot->tts_isnull[i];
+		column->values[gc->num_rows] = slot->tts_isnull[i] ? (Datum) 0 :
+			datumCopy(slot->tts_values[i], attr->attbyval, attr->attlen);
+	}
+
+	gc->num_rows++;
+	MemoryContextSwitchTo(old);
+}
+
+/* Check if the segment-by value of a row differs from that of the group */
+static bool
+group_compressor_new_segment(GroupCompressor *gc, TupleTableSlot *slot,
+							 AttrNumber segment_by, FmgrInfo *eq_func)
+{
+	CompressionColumn *column;
+	int			offset = AttrNumberGetAttrOffset(segment_by);
+
+	if (segment_by == InvalidAttrNumber)
+		return false;
+
+	column = &gc->columns[offset];
+
+	if (column->nulls[0] || slot->tts_isnull[offset])
+		return column->nulls[0] != slot->tts_isnull[offset];
+
+	return !DatumGetBool(FunctionCall2Coll(eq_func, gc->desc->attrs[offset]->attcollation,
+										   column->values[0], slot->tts_values[offset]));
+}
+
+static AttrNumber
+get_column_attnum(Relation rel, const char *column_name)
+{
+	AttrNumber	attno = get_attnum(RelationGetRelid(rel), column_name);
+
+	if (attno == InvalidAttrNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("column \"%s\" of relation \"%s\" does not exist",
+						column_name, RelationGetRelationName(rel))));
+
+	return attno;
+}
+
+PG_FUNCTION_INFO_V1(compress_chunk_data);
+
+/*
+ * Compress the rows of a chunk (arg 0) into its compressed table (arg 1),
+ * grouping them by a segment-by column (arg 2, may be NULL) and sorting them
+ * by the segment-by column and the time column (arg 3). The chunk table must
+ * be locked against writes by the caller. Returns the number of rows.
+ */
+Datum
+compress_chunk_data(PG_FUNCTION_ARGS)
+{
+	Relation	rel = heap_open(PG_GETARG_OID(0), ExclusiveLock);
+	Relation	compressed_rel = heap_open(PG_GETARG_OID(1), RowExclusiveLock);
+	AttrNumber	segment_by = PG_ARGISNULL(2) ? InvalidAttrNumber :
+	get_column_attnum(rel, NameStr(*PG_GETARG_NAME(2)));
+	AttrNumber	time_column = get_column_attnum(rel, NameStr(*PG_GETARG_NAME(3)));
+	TupleDesc	desc = RelationGetDescr(rel);
+	AttrNumber	sort_keys[2];
+	Oid			sort_ops[2];
+	Oid			sort_collations[2];
+	bool		nulls_first[2];
+	int			num_keys = 0;
+	FmgrInfo	eq_func;
+	GroupCompressor gc = {
+		.desc = desc,
+		.compressed_rel = compressed_rel,
+		.cid = GetCurrentCommandId(true),
+		.bistate = GetBulkInsertState(),
+	};
+	Tuplesortstate *sort;
+	TupleTableSlot *slot;
+	Snapshot	snapshot;
+	HeapScanDesc scan;
+	HeapTuple	tuple;
+	int64		num_rows = 0;
+
+	gc.columns = compression_columns_create(desc, compressed_rel);
+	gc.count_attno = get_column_attnum(compressed_rel, COMPRESSION_COUNT_COLUMN_NAME);
+	gc.mcxt = AllocSetContextCreate(CurrentMemoryContext,
+									"Group compression",
+									ALLOCSET_DEFAULT_SIZES);
+
+	if (segment_by != InvalidAttrNumber)
+	{
+		Form_pg_attribute attr = desc->attrs[AttrNumberGetAttrOffset(segment_by)];
+		Oid			eq_op;
+
+		get_sort_group_operators(attr->atttypid, true, true, false,
+								 &sort_ops[num_keys], &eq_op, NULL, NULL);
+		fmgr_info(get_opcode(eq_op), &eq_func);
+		sort_keys[num_keys] = segment_by;
+		sort_collations[num_keys] = attr->attcollation;
+		nulls_first[num_keys] = false;
+		num_keys++;
+	}
+
+	get_sort_group_operators(desc->attrs[AttrNumberGetAttrOffset(time_column)]->atttypid,
+							 true, false, false, &sort_ops[num_keys], NULL, NULL, NULL);
+	sort_keys[num_keys] = time_column;
+	sort_collations[num_keys] = InvalidOid;
+	nulls_first[num_keys] = false;
+	num_keys++;
+
+	sort = tuplesort_begin_heap(desc, num_keys, sort_keys, sort_ops, sort_collations,
+								nulls_first, maintenance_work_mem, false);
+	slot = MakeSingleTupleTableSlot(desc);
+
+	/* The chunk is locked against writes, so read all committed rows */
+	snapshot = RegisterSnapshot(GetLatestSnapshot());
+	scan = heap_beginscan(rel, snapshot, 0, NULL);
+
+	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		CHECK_FOR_INTERRUPTS();
+		ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+		tuplesort_puttupleslot(sort, slot);
+	}
+
+	heap_endscan(scan);
+	UnregisterSnapshot(snapshot);
+
+	tuplesort_performsort(sort);
+
+	while (tuplesort_gettupleslot(sort, true, slot, NULL))
+	{
+		CHECK_FOR_INTERRUPTS();
+		slot_getallattrs(slot);
+
+		if (gc.num_rows > 0 &&
+			(gc.num_rows >= COMPRESSION_MAX_GROUP_ROWS ||
+			 group_compressor_new_segment(&gc, slot, segment_by, &eq_func)))
+			group_compressor_flush(&gc);
+
+		group_compressor_append(&gc, slot);
+		num_rows++;
+	}
+
+	if (gc.num_rows > 0)
+		group_compressor_flush(&gc);
+
+	tuplesort_end(sort);
+	ExecDropSingleTupleTableSlot(slot);
+	FreeBulkInsertState(gc.bistate);
+	MemoryContextDelete(gc.mcxt);
+
+	heap_close(compressed_rel, NoLock);
+	heap_close(rel, NoLock);
+
+	PG_RETURN_INT64(num_rows);
+}
+
+PG_FUNCTION_INFO_V1(decompress_chunk_data);
+
+/*
+ * Insert the rows of a compressed table (arg 1) back into its chunk (arg 0),
+ * updating the chunk's indexes. Returns the number of rows.
+ */
+Datum
+decompress_chunk_data(PG_FUNCTION_ARGS)
+{
+	Relation	rel = heap_open(PG_GETARG_OID(0), RowExclusiveLock);
+	Relation	compressed_rel = heap_open(PG_GETARG_OID(1), AccessShareLock);
+	EState	   *estate = CreateExecutorState();
+	ResultRelInfo *result_rel_info = makeNode(ResultRelInfo);
+	GroupDecompressor *gd = group_decompressor_create(rel, compressed_rel);
+	CommandId	cid = GetCurrentCommandId(true);
+	BulkInsertState bistate = GetBulkInsertState();
+	TupleTableSlot *slot;
+	HeapScanDesc scan;
+	HeapTuple	compressed_tuple;
+	int64		num_rows = 0;
+
+	InitResultRelInfo(result_rel_info, rel, 1, 0);
+	ExecOpenIndices(result_rel_info, false);
+	estate->es_result_relations = result_rel_info;
+	estate->es_num_result_relations = 1;
+	estate->es_result_relation_info = result_rel_info;
+
+	slot = ExecInitExtraTupleSlot(estate);
+	ExecSetSlotDescriptor(slot, RelationGetDescr(rel));
+
+	scan = heap_beginscan(compressed_rel, GetActiveSnapshot(), 0, NULL);
+
+	while ((compressed_tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		HeapTuple	tuple;
+
+		group_decompressor_load(gd, compressed_tuple);
+
+		while ((tuple = group_decompressor_next(gd)) != NULL)
+		{
+			CHECK_FOR_INTERRUPTS();
+			heap_insert(rel, tuple, cid, 0, bistate);
+
+			if (result_rel_info->ri_NumIndices > 0)
+			{
+				ExecStoreTuple(tuple, slot, InvalidBuffer, false);
+				list_free(ExecInsertIndexTuples(slot, &tuple->t_self, estate,
+												false, NULL, NIL));
+				ResetPerTupleExprContext(estate);
+			}
+
+			heap_freetuple(tuple);
+			num_rows++;
+		}
+	}
+
+	heap_endscan(scan);
+	group_decompressor_destroy(gd);
+	FreeBulkInsertState(bistate);
+	ExecCloseIndices(result_rel_info);
+	ExecResetTupleTable(estate->es_tupleTable, false);
+	FreeExecutorState(estate);
+
+	heap_close(compressed_rel, NoLock);
+	heap_close(rel, NoLock);
+
+	PG_RETURN_INT64(num_rows);
+}
@@ -0,0 +1,46 @@
+#ifndef TIMESCALEDB_COMPRESSION_H
+#define TIMESCALEDB_COMPRESSION_H
+
+#include <postgres.h>
+#include <access/htup.h>
+#include <utils/relcache.h>
+
+/* Maximum number of rows compressed into one row of a compressed table */
+#define COMPRESSION_MAX_GROUP_ROWS 1000
+
+/* Name of the column holding the number of rows in a compressed row */
+#define COMPRESSION_COUNT_COLUMN_NAME "_ts_count"
+
+typedef enum CompressionAlgorithm
+{
+	/* Delta-of-delta encoding of integers and integer timestamps */
+	COMPRESSION_ALGORITHM_DELTADELTA = 1,
+	/* XOR encoding of floating point values, as in Facebook's Gorilla */
+	COMPRESSION_ALGORITHM_GORILLA,
+	/* Dictionary of distinct values with run-length encoded indexes */
+	COMPRESSION_ALGORITHM_DICTIONARY,
+} CompressionAlgorithm;
+
+typedef struct CompressionType
+{
+	Oid			typid;
+	int16		typlen;
+	bool		typbyval;
+	CompressionAlgorithm algorithm;
+} CompressionType;
+
+extern void compression_type_init(CompressionType *type, Oid typid);
+extern bytea *compression_compress(CompressionType *type, Datum *values,
+					 bool *nulls, int count);
+extern int compression_decompress(CompressionType *type, bytea *data,
+					   Datum *values, bool *nulls, int max_count);
+
+typedef struct GroupDecompressor GroupDecompressor;
+
+extern GroupDecompressor *group_decompressor_create(Relation rel, Relation compressed_rel);
+extern void group_decompressor_load(GroupDecompressor *gd, HeapTuple compressed_tuple);
+extern HeapTuple group_decompressor_next(GroupDecompressor *gd);
+extern void group_decompressor_reset(GroupDecompressor *gd);
+extern void group_decompressor_destroy(GroupDecompressor *gd);
+
+#endif   /* TIMESCALEDB_COMPRESSION_H */
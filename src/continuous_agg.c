@@ -0,0 +1,211 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/nbtree.h>
+#include <catalog/indexing.h>
+#include <lib/stringinfo.h>
+#include <nodes/parsenodes.h>
+#include <parser/parser.h>
+#include <utils/builtins.h>
+#include <utils/fmgroids.h>
+#include <utils/rel.h>
+
+#include "catalog.h"
+#include "continuous_agg.h"
+#include "errors.h"
+#include "scanner.h"
+#include "utils.h"
+
+/*
+ * Invalidation of continuous aggregates.
+ *
+ * A continuous aggregate materializes the buckets of its hypertable's data
+ * below its watermark (see sql/main/continuous_agg.sql). Rows inserted below
+ * the watermark change buckets that are already materialized, so insert
+ * statements log the range of time they inserted into for the continuous
+ * aggregates of the hypertable that materialized any of it, and the next
+ * refresh of those aggregates recomputes the buckets in the range.
+ *
+ * The watermark is read with a share lock on the continuous aggregate's
+ * catalog row, which a refresh locks for update before it reads the raw
+ * data. An insert that a refresh cannot see thus either logs its range or
+ * waits for the refresh, and then reads the new watermark.
+ */
+
+typedef struct ContinuousAggInvalidation
+{
+	int32		continuous_agg_id;
+	int64		greatest;
+} ContinuousAggInvalidation;
+
+typedef struct ContinuousAggInvalidateCtx
+{
+	int64		lowest;
+	int64		greatest;
+	List	   *invalidations;
+	bool		retry;
+} ContinuousAggInvalidateCtx;
+
+static bool
+continuous_agg_tuple_found(TupleInfo *ti, void *data)
+{
+	ContinuousAggInvalidateCtx *ctx = data;
+	Datum		values[Natts_continuous_agg];
+	bool		isnull[Natts_continuous_agg];
+	int64		watermark;
+
+	/*
+	 * A refresh moved the watermark, or the continuous aggregate was dropped,
+	 * so look for the new version of the row in another scan.
+	 */
+	if (ti->lockresult == HeapTupleUpdated)
+	{
+		ctx->retry = true;
+		return false;
+	}
+
+	if (ti->lockresult != HeapTupleMayBeUpdated)
+		elog(ERROR, "could not lock continuous aggregate tuple (%d)", ti->lockresult);
+
+	heap_deform_tuple(ti->tuple, ti->desc, values, isnull);
+
+	watermark = DatumGetInt64(DATUM_GET(values, Anum_continuous_agg_watermark));
+
+	if (ctx->lowest < watermark)
+	{
+		ContinuousAggInvalidation *inval = palloc(sizeof(ContinuousAggInvalidation));
+
+		inval->continuous_agg_id = DatumGetInt32(DATUM_GET(values, Anum_continuous_agg_id));
+		/* Buckets above the watermark are not materialized */
+		inval->greatest = Min(ctx->greatest, watermark - 1);
+		ctx->invalidations = lappend(ctx->invalidations, inval);
+	}
+
+	return true;
+}
+
+static void
+continuous_agg_invalidation_insert(Relation rel, ContinuousAggInvalidation *inval, int64 lowest)
+{
+	TupleDesc	desc = RelationGetDescr(rel);
+	Datum		values[Natts_continuous_agg_invalidation];
+	bool		nulls[Natts_continuous_agg_invalidation] = {false};
+	HeapTuple	tuple;
+
+	values[Anum_continuous_agg_invalidation_continuous_agg_id - 1] = Int32GetDatum(inval->continuous_agg_id);
+	values[Anum_continuous_agg_invalidation_lowest_modified_value - 1] = Int64GetDatum(lowest);
+	values[Anum_continuous_agg_invalidation_greatest_modified_value - 1] = Int64GetDatum(inval->greatest);
+
+	tuple = heap_form_tuple(desc, values, nulls);
+	simple_heap_insert(rel, tuple);
+	CatalogUpdateIndexes(rel, tuple);
+	heap_freetuple(tuple);
+}
+
+/*
+ * Log that an insert statement inserted rows into the given range of time
+ * (in the internal representation) of a hypertable, for each continuous
+ * aggregate of the hypertable that materialized part of the range.
+ */
+void
+continuous_agg_invalidate(int32 hypertable_id, int64 lowest, int64 greatest)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[1];
+	ContinuousAggInvalidateCtx ctx = {
+		.lowest = lowest,
+		.greatest = greatest,
+	};
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CONTINUOUS_AGG].id,
+		.index = catalog->tables[CONTINUOUS_AGG].index_ids[CONTINUOUS_AGG_RAW_HYPERTABLE_INDEX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.data = &ctx,
+		.tuple_found = continuous_agg_tuple_found,
+		.lockmode = RowShareLock,
+		.tuplock = {
+			.lockmode = LockTupleShare,
+			.waitpolicy = LockWaitBlock,
+			.enabled = true,
+		},
+		.scandirection = ForwardScanDirection,
+	};
+	Relation	rel;
+	ListCell   *lc;
+
+	ScanKeyInit(&scankey[0], Anum_continuous_agg_raw_hypertable_id_idx_raw_hypertable_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(hypertable_id));
+
+	do
+	{
+		list_free_deep(ctx.invalidations);
+		ctx.invalidations = NIL;
+		ctx.retry = false;
+		scanner_scan(&scanctx);
+	} while (ctx.retry);
+
+	if (ctx.invalidations == NIL)
+		return;
+
+	rel = heap_open(catalog->tables[CONTINUOUS_AGG_INVALIDATION].id, RowExclusiveLock);
+
+	foreach(lc, ctx.invalidations)
+		continuous_agg_invalidation_insert(rel, lfirst(lc), lowest);
+
+	heap_close(rel, RowExclusiveLock);
+
+	list_free_deep(ctx.invalidations);
+}
+
+/* The table that the aggregates are checked against */
+#define CONTINUOUS_AGG_CHECK_TABLE "continuous_agg_raw_data"
+
+PG_FUNCTION_INFO_V1(continuous_agg_check_aggregates);
+
+/*
+ * Check that the aggregates of a continuous aggregate (arg 0) are only a
+ * select list. The aggregates are pasted into the queries that create and
+ * refresh the continuous aggregate, so they must not end the select list,
+ * e.g., with a FROM clause, a comment or another statement.
+ */
+Datum
+continuous_agg_check_aggregates(PG_FUNCTION_ARGS)
+{
+	char	   *aggregates = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	StringInfoData sql;
+	List	   *parsetree;
+	SelectStmt *select = NULL;
+	RangeVar   *from = NULL;
+
+	initStringInfo(&sql);
+	appendStringInfo(&sql, "SELECT %s FROM " CONTINUOUS_AGG_CHECK_TABLE, aggregates);
+
+	parsetree = raw_parser(sql.data);
+
+	if (list_length(parsetree) == 1 && IsA(linitial(parsetree), SelectStmt))
+		select = linitial(parsetree);
+
+	if (select != NULL && select->op == SETOP_NONE && select->targetList != NIL &&
+		select->distinctClause == NIL && select->intoClause == NULL &&
+		select->whereClause == NULL && select->groupClause == NIL &&
+		select->havingClause == NULL && select->windowClause == NIL &&
+		select->valuesLists == NIL && select->sortClause == NIL &&
+		select->limitOffset == NULL && select->limitCount == NULL &&
+		select->lockingClause == NIL && select->withClause == NULL &&
+		list_length(select->fromClause) == 1 && IsA(linitial(select->fromClause), RangeVar))
+		from = linitial(select->fromClause);
+
+	if (from == NULL || from->catalogname != NULL || from->schemaname != NULL ||
+		from->alias != NULL || from->inhOpt != INH_DEFAULT ||
+		strcmp(from->relname, CONTINUOUS_AGG_CHECK_TABLE) != 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("invalid aggregates \"%s\" for a continuous aggregate", aggregates),
+				 errhint("The aggregates must be a select list, e.g., \"count(*), max(value)\".")));
+
+	pfree(sql.data);
+
+	PG_RETURN_VOID();
+}
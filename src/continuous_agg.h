@@ -0,0 +1,8 @@
+#ifndef TIMESCALEDB_CONTINUOUS_AGG_H
+#define TIMESCALEDB_CONTINUOUS_AGG_H
+
+#include <postgres.h>
+
+extern void continuous_agg_invalidate(int32 hypertable_id, int64 lowest, int64 greatest);
+
+#endif   /* TIMESCALEDB_CONTINUOUS_AGG_H */
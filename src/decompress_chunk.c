@@ -0,0 +1,280 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/relscan.h>
+#include <executor/executor.h>
+#include <nodes/extensible.h>
+#include <nodes/relation.h>
+#include <optimizer/cost.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/planmain.h>
+#include <optimizer/prep.h>
+#include <optimizer/restrictinfo.h>
+#include <parser/parsetree.h>
+#include <storage/bufmgr.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+
+#include "chunk_cache.h"
+#include "compression.h"
+#include "errors.h"
+
+/*
+ * Scans of compressed chunks.
+ *
+ * The rows of a compressed chunk live in its compressed table, apart from
+ * rows inserted after the chunk was compressed, which live in the chunk
+ * table itself. The DecompressChunk node replaces all other scans of a
+ * compressed chunk that is part of a hypertable expansion. It returns the
+ * rows of the chunk table first, followed by the decompressed rows of the
+ * compressed table, one group at a time.
+ *
+ * The chunk's indexes only cover the rows in the chunk table, so there are
+ * no index scans of compressed chunks. The decompressed rows have no
+ * physical location, so updates, deletes and row locks are not supported on
+ * compressed chunks.
+ */
+
+extern void decompress_chunk_set_rel_size(PlannerInfo *root, RelOptInfo *rel, Oid relid);
+extern void decompress_chunk_optimization(PlannerInfo *root, RelOptInfo *rel, Index rti);
+
+typedef struct DecompressChunkState
+{
+	CustomScanState css;
+	Relation	compressed_rel;
+	HeapScanDesc scan;
+	HeapScanDesc compressed_scan;
+	GroupDecompressor *gd;
+	/* Set once the rows in the chunk table have been returned */
+	bool		scan_done;
+} DecompressChunkState;
+
+static Plan *decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *best_path,
+							 List *tlist, List *clauses, List *custom_plans);
+static Node *decompress_chunk_state_create(CustomScan *cscan);
+static void decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags);
+static TupleTableSlot *decompress_chunk_exec(CustomScanState *node);
+static void decompress_chunk_end(CustomScanState *node);
+static void decompress_chunk_rescan(CustomScanState *node);
+
+static CustomPathMethods decompress_chunk_path_methods = {
+	.CustomName = "DecompressChunk",
+	.PlanCustomPath = decompress_chunk_plan_create,
+};
+
+static CustomScanMethods decompress_chunk_plan_methods = {
+	.CustomName = "DecompressChunk",
+	.CreateCustomScanState = decompress_chunk_state_create,
+};
+
+static CustomExecMethods decompress_chunk_state_methods = {
+	.CustomName = "DecompressChunk",
+	.BeginCustomScan = decompress_chunk_begin,
+	.ExecCustomScan = decompress_chunk_exec,
+	.EndCustomScan = decompress_chunk_end,
+	.ReScanCustomScan = decompress_chunk_rescan,
+};
+
+static TupleTableSlot *
+decompress_chunk_next(ScanState *node)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+	TupleTableSlot *slot = node->ss_ScanTupleSlot;
+
+	for (;;)
+	{
+		HeapTuple	tuple;
+
+		if (!state->scan_done)
+		{
+			tuple = heap_getnext(state->scan, ForwardScanDirection);
+
+			if (tuple != NULL)
+				return ExecStoreTuple(tuple, slot, state->scan->rs_cbuf, false);
+
+			state->scan_done = true;
+		}
+
+		tuple = group_decompressor_next(state->gd);
+
+		if (tuple != NULL)
+		{
+			tuple->t_tableOid = RelationGetRelid(node->ss_currentRelation);
+			return ExecStoreTuple(tuple, slot, InvalidBuffer, true);
+		}
+
+		tuple = heap_getnext(state->compressed_scan, ForwardScanDirection);
+
+		if (tuple == NULL)
+			return ExecClearTuple(slot);
+
+		group_decompressor_load(state->gd, tuple);
+	}
+}
+
+static bool
+decompress_chunk_recheck(ScanState *node, TupleTableSlot *slot)
+{
+	return true;
+}
+
+static TupleTableSlot *
+decompress_chunk_exec(CustomScanState *node)
+{
+	return ExecScan(&node->ss, decompress_chunk_next, decompress_chunk_recheck);
+}
+
+static void
+decompress_chunk_begin(CustomScanState *node, EState *estate, int eflags)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+	Relation	rel = node->ss.ss_currentRelation;
+
+	state->compressed_rel = heap_open(linitial_oid(cscan->custom_private), AccessShareLock);
+	state->scan = heap_beginscan(rel, estate->es_snapshot, 0, NULL);
+	state->compressed_scan = heap_beginscan(state->compressed_rel, estate->es_snapshot, 0, NULL);
+	state->gd = group_decompressor_create(rel, state->compressed_rel);
+	state->scan_done = false;
+}
+
+static void
+decompress_chunk_end(CustomScanState *node)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+
+	group_decompressor_destroy(state->gd);
+	heap_endscan(state->compressed_scan);
+	heap_endscan(state->scan);
+	heap_close(state->compressed_rel, NoLock);
+}
+
+static void
+decompress_chunk_rescan(CustomScanState *node)
+{
+	DecompressChunkState *state = (DecompressChunkState *) node;
+
+	heap_rescan(state->scan, NULL);
+	heap_rescan(state->compressed_scan, NULL);
+	group_decompressor_reset(state->gd);
+	state->scan_done = false;
+}
+
+static Node *
+decompress_chunk_state_create(CustomScan *cscan)
+{
+	DecompressChunkState *state = (DecompressChunkState *) newNode(sizeof(DecompressChunkState), T_CustomScanState);
+
+	state->css.methods = &decompress_chunk_state_methods;
+
+	return (Node *) state;
+}
+
+static Plan *
+decompress_chunk_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *best_path,
+							 List *tlist, List *clauses, List *custom_plans)
+{
+	CustomScan *cscan = makeNode(CustomScan);
+
+	cscan->scan.plan.targetlist = tlist;
+	cscan->scan.plan.qual = extract_actual_clauses(clauses, false);
+	cscan->scan.scanrelid = rel->relid;
+	cscan->custom_plans = NIL;
+	cscan->custom_scan_tlist = NIL;
+	cscan->custom_private = best_path->custom_private;
+	cscan->methods = &decompress_chunk_plan_methods;
+
+	return &cscan->scan.plan;
+}
+
+static CustomPath *
+decompress_chunk_path_create(PlannerInfo *root, RelOptInfo *rel, Oid compressed_relid)
+{
+	CustomPath *path = makeNode(CustomPath);
+	QualCost	qual_cost;
+	Cost		cpu_per_tuple;
+
+	cost_qual_eval(&qual_cost, rel->baserestrictinfo, root);
+
+	/*
+	 * Like a sequential scan, plus decompressing every column of every row.
+	 * The pages of the compressed table are included in the relation's size.
+	 */
+	cpu_per_tuple = cpu_tuple_cost + qual_cost.per_tuple +
+		cpu_operator_cost * list_length(rel->reltarget->exprs);
+
+	path->path.pathtype = T_CustomScan;
+	path->path.parent = rel;
+	path->path.pathtarget = rel->reltarget;
+	path->path.param_info = NULL;
+	path->path.parallel_aware = false;
+	path->path.parallel_safe = false;
+	path->path.parallel_workers = 0;
+	path->path.rows = rel->rows;
+	path->path.startup_cost = qual_cost.startup;
+	path->path.total_cost = qual_cost.startup + seq_page_cost * rel->pages +
+		cpu_per_tuple * rel->tuples;
+	path->path.pathkeys = NIL;
+	path->flags = 0;
+	path->custom_paths = NIL;
+	path->custom_private = list_make1_oid(compressed_relid);
+	path->methods = &decompress_chunk_path_methods;
+
+	return path;
+}
+
+/*
+ * Add the rows and pages of a compressed chunk's compressed table to the
+ * chunk's size estimates. Called when the chunk's relation is built, so that
+ * the estimates are in place before the chunk's paths are costed.
+ */
+void
+decompress_chunk_set_rel_size(PlannerInfo *root, RelOptInfo *rel, Oid relid)
+{
+	Oid			compressed_relid;
+	int64		compressed_rows;
+	Relation	compressed_rel;
+
+	if (!chunk_cache_get_compression(relid, &compressed_relid, &compressed_rows))
+		return;
+
+	compressed_rel = heap_open(compressed_relid, AccessShareLock);
+	rel->pages += RelationGetNumberOfBlocks(compressed_rel);
+	rel->tuples += compressed_rows;
+	rel->allvisfrac = 0;
+	heap_close(compressed_rel, NoLock);
+}
+
+/*
+ * Replace the paths of a compressed chunk with a DecompressChunk path. This
+ * is required for correct results, so it is done even if optimizations are
+ * disabled.
+ */
+void
+decompress_chunk_optimization(PlannerInfo *root, RelOptInfo *rel, Index rti)
+{
+	RangeTblEntry *rte = planner_rt_fetch(rti, root);
+	Oid			compressed_relid;
+	int64		compressed_rows;
+
+	if (IS_DUMMY_REL(rel) || rte->rtekind != RTE_RELATION ||
+		!chunk_cache_get_compression(rte->relid, &compressed_relid, &compressed_rows))
+		return;
+
+	if (rti == root->parse->resultRelation)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("cannot update or delete rows of compressed chunk \"%s\"",
+						get_rel_name(rte->relid)),
+				 errhint("Decompress the chunk with decompress_chunk() first.")));
+
+	if (get_plan_rowmark(root->rowMarks, rti) != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+				 errmsg("cannot lock or reference rows of compressed chunk \"%s\"",
+						get_rel_name(rte->relid)),
+				 errhint("Decompress the chunk with decompress_chunk() first.")));
+
+	rel->pathlist = NIL;
+	rel->partial_pathlist = NIL;
+	add_path(rel, (Path *) decompress_chunk_path_create(root, rel, compressed_relid));
+}
@@ -0,0 +1,625 @@
+#include <postgres.h>
+#include <access/genam.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/xact.h>
+#include <catalog/dependency.h>
+#include <catalog/namespace.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_constraint.h>
+#include <catalog/pg_type.h>
+#include <fmgr.h>
+#include <miscadmin.h>
+#include <nodes/bitmapset.h>
+#include <nodes/makefuncs.h>
+#include <storage/lmgr.h>
+#include <utils/acl.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/fmgroids.h>
+#include <utils/inval.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/syscache.h>
+
+#include "catalog.h"
+#include "catalog_snapshot.h"
+#include "scanner.h"
+#include "shared_cache.h"
+
+/*
+ * Dropping chunks older than a point in time.
+ *
+ * Deleting the rows of the chunk catalog table fires row triggers that
+ * cascade to the chunk's replicas, drop each chunk table and invalidate
+ * cache entries one chunk at a time. With many chunks, this holds locks for
+ * a long time. Instead, drop_chunks_older_than() finds all chunks to drop
+ * with a single scan of the chunk table, locks their tables in OID order,
+ * drops the tables together, deletes the catalog rows directly and
+ * invalidates the chunk caches once.
+ *
+ * Catalog rows are deleted without firing triggers, so this only works when
+ * no other node holds a copy of the catalog. Otherwise, the SQL function
+ * _timescaledb_meta.drop_chunks_older_than() falls back to deleting the chunk
+ * rows through the triggers. Since ON DELETE CASCADE does not fire either,
+ * the rows that reference the chunks are found through the foreign keys on
+ * the chunk table and deleted along with the chunks.
+ */
+
+/* Rows of a catalog table that reference the chunks to drop */
+typedef struct DropChunksReferencing
+{
+	Oid			table;
+	AttrNumber	chunk_id_attno;
+	List	   *tids;
+} DropChunksReferencing;
+
+typedef struct DropChunksCtx
+{
+	char	   *current_database;
+	/* Partitions of the hypertables to drop chunks from, unless all_partitions */
+	bool		all_partitions;
+	Bitmapset  *hypertables;
+	Bitmapset  *epochs;
+	Bitmapset  *partitions;
+	int64		older_than;
+	/* Chunks to drop */
+	List	   *chunk_ids;
+	Bitmapset  *chunk_set;
+	/* Catalog rows to delete */
+	List	   *chunk_tids;
+	List	   *referencing;
+	List	   *index_tids;
+	/* Tables to drop, as RangeVars, and local chunk tables with indexes */
+	List	   *tables;
+	List	   *local_tables;
+} DropChunksCtx;
+
+static ItemPointer
+tid_copy(HeapTuple tuple)
+{
+	ItemPointer tid = palloc(sizeof(ItemPointerData));
+
+	ItemPointerCopy(&tuple->t_self, tid);
+	return tid;
+}
+
+static bool
+drop_chunks_hypertable_tuple_found(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+	bool		isnull;
+	Datum		id = heap_getattr(ti->tuple, Anum_hypertable_id, ti->desc, &isnull);
+
+	ctx->hypertables = bms_add_member(ctx->hypertables, DatumGetInt32(id));
+	return true;
+}
+
+static bool
+drop_chunks_epoch_tuple_found(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+	bool		isnull;
+	Datum		id = heap_getattr(ti->tuple, Anum_partition_epoch_id, ti->desc, &isnull);
+	Datum		hypertable_id = heap_getattr(ti->tuple, Anum_partition_epoch_hypertable_id, ti->desc, &isnull);
+
+	if (bms_is_member(DatumGetInt32(hypertable_id), ctx->hypertables))
+		ctx->epochs = bms_add_member(ctx->epochs, DatumGetInt32(id));
+	return true;
+}
+
+static bool
+drop_chunks_partition_tuple_found(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+	bool		isnull;
+	Datum		id = heap_getattr(ti->tuple, Anum_partition_id, ti->desc, &isnull);
+	Datum		epoch_id = heap_getattr(ti->tuple, Anum_partition_partition_epoch_id, ti->desc, &isnull);
+
+	if (bms_is_member(DatumGetInt32(epoch_id), ctx->epochs))
+		ctx->partitions = bms_add_member(ctx->partitions, DatumGetInt32(id));
+	return true;
+}
+
+/*
+ * Find the partitions of the hypertables matching the given schema and table
+ * names.
+ */
+static void
+drop_chunks_find_partitions(DropChunksCtx *ctx, Name table_name, Name schema_name)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[2];
+	int			nkeys = 0;
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[HYPERTABLE].id,
+		.scantype = ScannerTypeHeap,
+		.scankey = scankey,
+		.data = ctx,
+		.tuple_found = drop_chunks_hypertable_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	if (schema_name != NULL)
+		ScanKeyInit(&scankey[nkeys++], Anum_hypertable_schema_name,
+					BTEqualStrategyNumber, F_NAMEEQ, NameGetDatum(schema_name));
+
+	if (table_name != NULL)
+		ScanKeyInit(&scankey[nkeys++], Anum_hypertable_table_name,
+					BTEqualStrategyNumber, F_NAMEEQ, NameGetDatum(table_name));
+
+	scanctx.nkeys = nkeys;
+
+	if (scanner_scan(&scanctx) == 0)
+		return;
+
+	scanctx.table = catalog->tables[PARTITION_EPOCH].id;
+	scanctx.nkeys = 0;
+	scanctx.tuple_found = drop_chunks_epoch_tuple_found;
+	scanner_scan(&scanctx);
+
+	scanctx.table = catalog->tables[PARTITION].id;
+	scanctx.tuple_found = drop_chunks_partition_tuple_found;
+	scanner_scan(&scanctx);
+}
+
+static bool
+drop_chunks_chunk_filter(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+	bool		isnull;
+	Datum		partition_id;
+
+	if (ctx->all_partitions)
+		return true;
+
+	partition_id = heap_getattr(ti->tuple, Anum_chunk_partition_id, ti->desc, &isnull);
+
+	return bms_is_member(DatumGetInt32(partition_id), ctx->partitions);
+}
+
+static bool
+drop_chunks_chunk_tuple_found(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+	bool		isnull;
+	Datum		id;
+
+	/* Skip chunks that a concurrent transaction dropped */
+	if (ti->lockresult != HeapTupleMayBeUpdated)
+		return true;
+
+	id = heap_getattr(ti->tuple, Anum_chunk_id, ti->desc, &isnull);
+	ctx->chunk_ids = lappend_int(ctx->chunk_ids, DatumGetInt32(id));
+	ctx->chunk_set = bms_add_member(ctx->chunk_set, DatumGetInt32(id));
+	ctx->chunk_tids = lappend(ctx->chunk_tids, tid_copy(ti->tuple));
+	return true;
+}
+
+/*
+ * Find the chunks to drop with one scan of the chunk table. The rows of the
+ * chunks are locked, so that concurrent drops of the same chunks wait for
+ * this transaction.
+ */
+static void
+drop_chunks_find_chunks(DropChunksCtx *ctx)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[1];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CHUNK].id,
+		.scantype = ScannerTypeHeap,
+		.nkeys = 1,
+		.scankey = scankey,
+		.data = ctx,
+		.filter = drop_chunks_chunk_filter,
+		.tuple_found = drop_chunks_chunk_tuple_found,
+		.lockmode = RowExclusiveLock,
+		.tuplock = {
+			.lockmode = LockTupleExclusive,
+			.waitpolicy = LockWaitBlock,
+			.enabled = true,
+		},
+		.scandirection = ForwardScanDirection,
+	};
+
+	ScanKeyInit(&scankey[0], Anum_chunk_end_time, BTLessStrategyNumber,
+				F_INT8LT, Int64GetDatum(ctx->older_than));
+
+	scanner_scan(&scanctx);
+}
+
+static bool
+drop_chunks_replica_tuple_found(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+	bool		isnull;
+	Datum		database_name = heap_getattr(ti->tuple, Anum_chunk_replica_node_database_name, ti->desc, &isnull);
+	Datum		schema_name = heap_getattr(ti->tuple, Anum_chunk_replica_node_schema_name, ti->desc, &isnull);
+	Datum		table_name = heap_getattr(ti->tuple, Anum_chunk_replica_node_table_name, ti->desc, &isnull);
+	RangeVar   *rv = makeRangeVar(pstrdup(NameStr(*DatumGetName(schema_name))),
+								  pstrdup(NameStr(*DatumGetName(table_name))), -1);
+
+	/* Like the chunk_replica_node trigger, drop remote (foreign) tables too */
+	ctx->tables = lappend(ctx->tables, rv);
+
+	if (namestrcmp(DatumGetName(database_name), ctx->current_database) == 0)
+		ctx->local_tables = lappend(ctx->local_tables, rv);
+
+	return true;
+}
+
+static bool
+drop_chunks_compression_tuple_found(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+	bool		isnull;
+	Datum		database_name = heap_getattr(ti->tuple, Anum_chunk_compression_database_name, ti->desc, &isnull);
+	Datum		schema_name = heap_getattr(ti->tuple, Anum_chunk_compression_compressed_schema_name, ti->desc, &isnull);
+	Datum		table_name = heap_getattr(ti->tuple, Anum_chunk_compression_compressed_table_name, ti->desc, &isnull);
+
+	if (namestrcmp(DatumGetName(database_name), ctx->current_database) == 0)
+		ctx->tables = lappend(ctx->tables,
+				 makeRangeVar(pstrdup(NameStr(*DatumGetName(schema_name))),
+							  pstrdup(NameStr(*DatumGetName(table_name))), -1));
+
+	return true;
+}
+
+static bool
+drop_chunks_index_tuple_found(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+
+	ctx->index_tids = lappend(ctx->index_tids, tid_copy(ti->tuple));
+	return true;
+}
+
+static bool
+drop_chunks_referencing_filter(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+	DropChunksReferencing *ref = llast(ctx->referencing);
+	bool		isnull;
+	Datum		chunk_id = heap_getattr(ti->tuple, ref->chunk_id_attno, ti->desc, &isnull);
+
+	return !isnull && bms_is_member(DatumGetInt32(chunk_id), ctx->chunk_set);
+}
+
+static bool
+drop_chunks_referencing_tuple_found(TupleInfo *ti, void *data)
+{
+	DropChunksCtx *ctx = data;
+	DropChunksReferencing *ref = llast(ctx->referencing);
+
+	ref->tids = lappend(ref->tids, tid_copy(ti->tuple));
+	return true;
+}
+
+/* Find a btree index of a table whose first column is the given column */
+static Oid
+drop_chunks_find_index(Oid table, AttrNumber attno)
+{
+	Relation	rel = heap_open(table, AccessShareLock);
+	List	   *indexes = RelationGetIndexList(rel);
+	Oid			index_relid = InvalidOid;
+	ListCell   *lc;
+
+	foreach(lc, indexes)
+	{
+		Relation	index = index_open(lfirst_oid(lc), AccessShareLock);
+
+		if (index->rd_rel->relam == BTREE_AM_OID &&
+			index->rd_index->indkey.values[0] == attno)
+			index_relid = RelationGetRelid(index);
+
+		index_close(index, AccessShareLock);
+
+		if (OidIsValid(index_relid))
+			break;
+	}
+
+	list_free(indexes);
+	heap_close(rel, AccessShareLock);
+
+	return index_relid;
+}
+
+/*
+ * Find the rows of a catalog table that reference the chunks to drop through
+ * the given column. The table is scanned with an index on the column if it
+ * has one.
+ */
+static void
+drop_chunks_find_referencing(DropChunksCtx *ctx, Oid table, AttrNumber attno,
+							 Datum *chunk_ids, int num_chunks)
+{
+	DropChunksReferencing *ref = palloc(sizeof(DropChunksReferencing));
+	ScanKeyData scankey[1];
+	ScannerCtx	scanctx = {
+		.table = table,
+		.index = drop_chunks_find_index(table, attno),
+		.scantype = ScannerTypeHeap,
+		.scankey = scankey,
+		.data = ctx,
+		.filter = drop_chunks_referencing_filter,
+		.tuple_found = drop_chunks_referencing_tuple_found,
+		.lockmode = RowExclusiveLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	ref->table = table;
+	ref->chunk_id_attno = attno;
+	ref->tids = NIL;
+	ctx->referencing = lappend(ctx->referencing, ref);
+
+	if (OidIsValid(scanctx.index))
+	{
+		scanctx.scantype = ScannerTypeIndex;
+		scanctx.nkeys = 1;
+		scanner_scankey_init_array(&scankey[0], 1, BTEqualStrategyNumber,
+								   F_INT4EQ, INT4OID, chunk_ids, num_chunks);
+	}
+
+	scanner_scan(&scanctx);
+}
+
+/*
+ * Find the rows that ON DELETE CASCADE would delete along with the chunks,
+ * i.e., the rows of all tables with a foreign key on the chunk table.
+ */
+static void
+drop_chunks_find_all_referencing(DropChunksCtx *ctx, Datum *chunk_ids, int num_chunks)
+{
+	Oid			chunk_table = catalog_get()->tables[CHUNK].id;
+	Relation	conrel = heap_open(ConstraintRelationId, AccessShareLock);
+	SysScanDesc scan = systable_beginscan(conrel, InvalidOid, false, NULL, 0, NULL);
+	HeapTuple	tuple;
+
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Form_pg_constraint con = (Form_pg_constraint) GETSTRUCT(tuple);
+		bool		isnull;
+		Datum		conkey;
+		ArrayType  *keys;
+
+		if (con->contype != CONSTRAINT_FOREIGN || con->confrelid != chunk_table)
+			continue;
+
+		conkey = heap_getattr(tuple, Anum_pg_constraint_conkey,
+							  RelationGetDescr(conrel), &isnull);
+
+		if (isnull)
+			elog(ERROR, "foreign key %s has no columns", NameStr(con->conname));
+
+		/* The chunk table's only key is its ID */
+		keys = DatumGetArrayTypeP(conkey);
+
+		if (ARR_NDIM(keys) != 1 || ARR_DIMS(keys)[0] != 1)
+			elog(ERROR, "unexpected foreign key %s on the chunk table", NameStr(con->conname));
+
+		drop_chunks_find_referencing(ctx, con->conrelid, ((int16 *) ARR_DATA_PTR(keys))[0],
+									 chunk_ids, num_chunks);
+	}
+
+	systable_endscan(scan);
+	heap_close(conrel, AccessShareLock);
+}
+
+/*
+ * Find the tables of the replicas and compressed tables of the chunks to
+ * drop, the rows that reference the chunks and the chunk index rows of the
+ * local chunk tables.
+ */
+static void
+drop_chunks_find_dependents(DropChunksCtx *ctx)
+{
+	Catalog    *catalog = catalog_get();
+	int			num_chunks = list_length(ctx->chunk_ids);
+	Datum	   *chunk_ids = palloc(sizeof(Datum) * num_chunks);
+	ScanKeyData scankey[2];
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CHUNK_REPLICA_NODE].id,
+		.index = catalog->tables[CHUNK_REPLICA_NODE].index_ids[CHUNK_REPLICA_NODE_ID_INDEX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.data = ctx,
+		.tuple_found = drop_chunks_replica_tuple_found,
+		.lockmode = RowExclusiveLock,
+		.scandirection = ForwardScanDirection,
+	};
+	ListCell   *lc;
+	int			i = 0;
+
+	foreach(lc, ctx->chunk_ids)
+		chunk_ids[i++] = Int32GetDatum(lfirst_int(lc));
+
+	scanner_scankey_init_array(&scankey[0], Anum_chunk_replica_node_pkey_idx_chunk_id,
+							   BTEqualStrategyNumber, F_INT4EQ, INT4OID,
+							   chunk_ids, num_chunks);
+	scanner_scan(&scanctx);
+
+	scanctx.table = catalog->tables[CHUNK_COMPRESSION].id;
+	scanctx.index = catalog->tables[CHUNK_COMPRESSION].index_ids[CHUNK_COMPRESSION_ID_INDEX];
+	scanctx.tuple_found = drop_chunks_compression_tuple_found;
+	scanner_scankey_init_array(&scankey[0], Anum_chunk_compression_pkey_idx_chunk_id,
+							   BTEqualStrategyNumber, F_INT4EQ, INT4OID,
+							   chunk_ids, num_chunks);
+	scanner_scan(&scanctx);
+
+	drop_chunks_find_all_referencing(ctx, chunk_ids, num_chunks);
+
+	/*
+	 * Chunk index rows reference the replicas by table name rather than the
+	 * chunks, so they are not found through the chunk table's foreign keys.
+	 */
+	scanctx.table = catalog->tables[CHUNK_REPLICA_NODE_INDEX].id;
+	scanctx.index = catalog->tables[CHUNK_REPLICA_NODE_INDEX].index_ids[CHUNK_REPLICA_NODE_INDEX_ID_INDEX];
+	scanctx.nkeys = 2;
+	scanctx.tuple_found = drop_chunks_index_tuple_found;
+
+	scanner_keep_open_begin();
+
+	foreach(lc, ctx->local_tables)
+	{
+		RangeVar   *rv = lfirst(lc);
+
+		ScanKeyInit(&scankey[0], Anum_chunk_replica_node_index_pkey_idx_schema_name,
+					BTEqualStrategyNumber, F_NAMEEQ, CStringGetDatum(rv->schemaname));
+		ScanKeyInit(&scankey[1], Anum_chunk_replica_node_index_pkey_idx_table_name,
+					BTEqualStrategyNumber, F_NAMEEQ, CStringGetDatum(rv->relname));
+		scanner_scan(&scanctx);
+	}
+
+	scanner_keep_open_end();
+}
+
+static int
+oid_compare(const void *a, const void *b)
+{
+	Oid			oa = *((const Oid *) a);
+	Oid			ob = *((const Oid *) b);
+
+	if (oa == ob)
+		return 0;
+	return oa < ob ? -1 : 1;
+}
+
+/*
+ * Lock the tables to drop in OID order, so that concurrent drops do not
+ * deadlock, and drop them together.
+ */
+static void
+drop_chunks_drop_tables(DropChunksCtx *ctx)
+{
+	Oid		   *relids = palloc(sizeof(Oid) * list_length(ctx->tables));
+	ObjectAddresses *objects = new_object_addresses();
+	int			num_relids = 0;
+	ListCell   *lc;
+	int			i;
+
+	foreach(lc, ctx->tables)
+	{
+		Oid			relid = RangeVarGetRelid((RangeVar *) lfirst(lc), NoLock, true);
+
+		if (OidIsValid(relid))
+			relids[num_relids++] = relid;
+	}
+
+	qsort(relids, num_relids, sizeof(Oid), oid_compare);
+
+	for (i = 0; i < num_relids; i++)
+	{
+		ObjectAddress object = {
+			.classId = RelationRelationId,
+			.objectId = relids[i],
+			.objectSubId = 0,
+		};
+
+		LockRelationOid(relids[i], AccessExclusiveLock);
+
+		/* The table might have been dropped while we waited for the lock */
+		if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(relids[i])))
+			continue;
+
+		if (!pg_class_ownercheck(relids[i], GetUserId()))
+			aclcheck_error(ACLCHECK_NOT_OWNER, ACL_KIND_CLASS,
+						   get_rel_name(relids[i]));
+
+		add_exact_object_address(&object, objects);
+	}
+
+	performMultipleDeletions(objects, DROP_RESTRICT, 0);
+	free_object_addresses(objects);
+}
+
+/* Delete catalog rows without firing triggers */
+static void
+drop_chunks_delete_rows(Oid table, List *tids)
+{
+	Relation	rel;
+	ListCell   *lc;
+
+	if (tids == NIL)
+		return;
+
+	rel = heap_open(table, RowExclusiveLock);
+
+	foreach(lc, tids)
+		simple_heap_delete(rel, (ItemPointer) lfirst(lc));
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+Datum		drop_chunks_older_than(PG_FUNCTION_ARGS);
+
+PG_FUNCTION_INFO_V1(drop_chunks_older_than);
+
+/*
+ * Drop the chunks that end before the given time, optionally only those of
+ * the hypertables with the given table and schema names. Returns the number
+ * of chunks dropped.
+ */
+Datum
+drop_chunks_older_than(PG_FUNCTION_ARGS)
+{
+	Catalog    *catalog = catalog_get();
+	Name		table_name = PG_ARGISNULL(1) ? NULL : PG_GETARG_NAME(1);
+	Name		schema_name = PG_ARGISNULL(2) ? NULL : PG_GETARG_NAME(2);
+	DropChunksCtx ctx = {
+		.current_database = catalog->database_name,
+		.all_partitions = (table_name == NULL && schema_name == NULL),
+	};
+	AclResult	aclresult;
+	ListCell   *lc;
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT32(0);
+
+	ctx.older_than = PG_GETARG_INT64(0);
+
+	/* Dropping chunks used to require deleting rows of the chunk table */
+	aclresult = pg_class_aclcheck(catalog->tables[CHUNK].id, GetUserId(), ACL_DELETE);
+
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, ACL_KIND_CLASS, get_rel_name(catalog->tables[CHUNK].id));
+
+	if (!ctx.all_partitions)
+	{
+		drop_chunks_find_partitions(&ctx, table_name, schema_name);
+
+		if (bms_is_empty(ctx.partitions))
+			PG_RETURN_INT32(0);
+	}
+
+	drop_chunks_find_chunks(&ctx);
+
+	if (ctx.chunk_ids == NIL)
+		PG_RETURN_INT32(0);
+
+	drop_chunks_find_dependents(&ctx);
+	drop_chunks_drop_tables(&ctx);
+
+	drop_chunks_delete_rows(catalog->tables[CHUNK_REPLICA_NODE_INDEX].id, ctx.index_tids);
+
+	foreach(lc, ctx.referencing)
+	{
+		DropChunksReferencing *ref = lfirst(lc);
+
+		drop_chunks_delete_rows(ref->table, ref->tids);
+	}
+
+	drop_chunks_delete_rows(catalog->tables[CHUNK].id, ctx.chunk_tids);
+
+	CommandCounterIncrement();
+
+	/* A single invalidation of the chunk caches for all dropped chunks */
+	CacheInvalidateRelcacheByRelid(catalog_get_cache_proxy_id(catalog, CACHE_TYPE_CHUNK));
+	shared_cache_invalidate_at_commit(CACHE_TYPE_CHUNK);
+	catalog_snapshot_invalidate_at_commit();
+
+	PG_RETURN_INT32(list_length(ctx.chunk_ids));
+}
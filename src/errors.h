@@ -19,6 +19,8 @@
 --IO110 - hypertable already exists
 --I0120 - node already exists
 --I0130 - user already exists
+--IO140 - policy already exists
+--IO150 - chunk is sealed
 */
 #define ERRCODE_IO_DDL_ERRORS MAKE_SQLSTATE('I','O','1','0','0')
 #define ERRCODE_IO_OPERATION_NOT_SUPPORTED MAKE_SQLSTATE('I','O','1','0','1')
@@ -27,6 +29,8 @@
 #define ERRCODE_IO_HYPERTABLE_EXISTS MAKE_SQLSTATE('I','O','1','1','0')
 #define ERRCODE_IO_NODE_EXISTS MAKE_SQLSTATE('I','O','1','2','0')
 #define ERRCODE_IO_USER_EXISTS MAKE_SQLSTATE('I','O','1','3','0')
+#define ERRCODE_IO_POLICY_EXISTS MAKE_SQLSTATE('I','O','1','4','0')
+#define ERRCODE_IO_CHUNK_SEALED MAKE_SQLSTATE('I','O','1','5','0')
 
 /*
 --IO500 - GROUP: internal error
@@ -0,0 +1,152 @@
+#include <postgres.h>
+#include <postmaster/postmaster.h>
+#include <utils/guc.h>
+
+#include "guc.h"
+
+/*
+ * Configuration parameters of the extension.
+ *
+ * The parameters are defined as real GUCs backed by C variables, so that
+ * checking them in the planner hooks costs a variable read rather than a
+ * lookup of the option by name.
+ */
+
+bool		guc_disable_optimizations = false;
+bool		guc_print_parse = false;
+int			guc_shared_cache_entries = 0;
+int			guc_catalog_snapshot_chunks = 0;
+int			guc_chunk_cache_size = 8192;
+bool		guc_cache_prewarm = false;
+int			guc_cache_prewarm_chunks = 1;
+int			guc_max_background_workers = 0;
+int			guc_seal_cost_delay = 20;
+bool		guc_defer_chunk_indexes = false;
+
+void
+_guc_init(void)
+{
+	DefineCustomBoolVariable("timescaledb.disable_optimizations",
+							 "Disable all timescale query optimizations",
+							 NULL,
+							 &guc_disable_optimizations,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("io.print_parse",
+							 "Print the parse tree of the next query planned on a hypertable",
+							 NULL,
+							 &guc_print_parse,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("timescaledb.shared_cache_entries",
+							"Number of metadata cache entries shared across backends",
+	  "Requires timescaledb in shared_preload_libraries. Zero disables the cache.",
+							&guc_shared_cache_entries,
+							0,
+							0,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("timescaledb.catalog_snapshot_chunks",
+							"Maximum number of chunks in the catalog snapshot shared across backends",
+	  "Requires timescaledb in shared_preload_libraries. Zero disables the snapshot.",
+							&guc_catalog_snapshot_chunks,
+							0,
+							0,
+							INT_MAX / 64,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("timescaledb.chunk_cache_size",
+							"Maximum memory used by the chunk cache of a backend",
+							"Least recently used chunks are evicted beyond this size.",
+							&guc_chunk_cache_size,
+							8192,
+							64,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("timescaledb.cache_prewarm",
+							 "Load the metadata of all hypertables when the caches are empty",
+							 "The caches are loaded on the first access to a hypertable "
+							 "in a new backend or after the caches were invalidated.",
+							 &guc_cache_prewarm,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("timescaledb.cache_prewarm_chunks",
+							"Number of most recent chunks per partition to load when prewarming",
+							NULL,
+							&guc_cache_prewarm_chunks,
+							1,
+							0,
+							INT_MAX / 2,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("timescaledb.max_background_workers",
+							"Maximum number of background jobs running at a time in each database",
+	  "Requires timescaledb in shared_preload_libraries. Zero disables background jobs.",
+							&guc_max_background_workers,
+							0,
+							0,
+							MAX_BACKENDS,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("timescaledb.seal_cost_delay",
+							"Cost-based delay when sealing chunks",
+							"Like vacuum_cost_delay, with the costs and limit of VACUUM. "
+							"Zero disables the delay.",
+							&guc_seal_cost_delay,
+							20,
+							0,
+							100,
+							PGC_USERSET,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("timescaledb.defer_chunk_indexes",
+							 "Create hypertable indexes on new chunks only",
+							 "The existing chunks get the index with build_chunk_indexes().",
+							 &guc_defer_chunk_indexes,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+}
@@ -0,0 +1,19 @@
+#ifndef TIMESCALEDB_GUC_H
+#define TIMESCALEDB_GUC_H
+
+#include <postgres.h>
+
+extern bool guc_disable_optimizations;
+extern bool guc_print_parse;
+extern int	guc_shared_cache_entries;
+extern int	guc_catalog_snapshot_chunks;
+extern int	guc_chunk_cache_size;
+extern bool guc_cache_prewarm;
+extern int	guc_cache_prewarm_chunks;
+extern int	guc_max_background_workers;
+extern int	guc_seal_cost_delay;
+extern bool guc_defer_chunk_indexes;
+
+void		_guc_init(void);
+
+#endif   /* TIMESCALEDB_GUC_H */
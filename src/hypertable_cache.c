@@ -1,5 +1,6 @@
 #include <postgres.h>
 #include <access/relscan.h>
+#include <access/xact.h>
 #include <catalog/namespace.h>
 #include <utils/catcache.h>
 #include <utils/rel.h>
@@ -16,6 +17,10 @@
 #include "utils.h"
 #include "scanner.h"
 #include "partitioning.h"
+#include "shared_cache.h"
+#include "chunk_cache.h"
+#include "extension.h"
+#include "guc.h"
 
 static void *hypertable_cache_create_entry(Cache *cache, CacheQuery *query);
 
@@ -25,6 +30,8 @@ typedef struct HypertableCacheQuery
 	Oid			relid;
 	const char *schema;
 	const char *table;
+	/* Set if the hypertable was already scanned, e.g., when prewarming */
+	Hypertable *hypertable;
 } HypertableCacheQuery;
 
 static void *
@@ -39,6 +46,24 @@ typedef struct
 	Hypertable *hypertable;
 } HypertableNameCacheEntry;
 
+static void
+hypertable_cache_free_entry(Cache *cache, void *entry)
+{
+	Hypertable *he = ((HypertableNameCacheEntry *) entry)->hypertable;
+	int			i;
+
+	if (NULL == he)
+		return;
+
+	if (NULL != he->epochs)
+	{
+		for (i = 0; i < he->num_epochs; i++)
+			partition_epoch_free(he->epochs[i]);
+		pfree(he->epochs);
+	}
+
+	pfree(he);
+}
 
 static Cache *
 hypertable_cache_create()
@@ -61,6 +86,7 @@ hypertable_cache_create()
 		.flags = HASH_ELEM | HASH_CONTEXT | HASH_BLOBS,
 		.get_key = hypertable_cache_get_key,
 		.create_entry = hypertable_cache_create_entry,
+		.free_entry = hypertable_cache_free_entry,
 	};
 
 	*cache = template;
@@ -73,6 +99,9 @@ hypertable_cache_create()
 
 static Cache *hypertable_cache_current = NULL;
 
+/* Whether the current cache instance still needs to be prewarmed */
+static bool hypertable_cache_prewarm_pending = true;
+
 /* Column numbers for 'hypertable' table in  sql/common/tables.sql */
 
 static bool
@@ -93,6 +122,7 @@ hypertable_tuple_found(TupleInfo *ti, void *data)
 	id = DatumGetInt32(DATUM_GET(values, Anum_hypertable_id));
 
 	he->num_epochs = 0;
+	he->epochs = NULL;
 	he->id = id;
 	strncpy(he->schema,
 			DatumGetCString(DATUM_GET(values, Anum_hypertable_schema_name)),
@@ -116,6 +146,68 @@ hypertable_tuple_found(TupleInfo *ti, void *data)
 	return false;
 }
 
+/*
+ * The fixed-size part of a hypertable cache entry, as stored in the shared
+ * cache. Partition epochs are looked up separately.
+ */
+typedef struct SharedHypertable
+{
+	bool		is_hypertable;
+	int32		id;
+	NameData	schema;
+	NameData	table;
+	Oid			root_table;
+	Oid			replica_table;
+	NameData	time_column_name;
+	Oid			time_column_type;
+	int64		chunk_size_bytes;
+	int16		num_replicas;
+} SharedHypertable;
+
+static void
+hypertable_to_shared(Hypertable *he, SharedHypertable *shared)
+{
+	memset(shared, 0, sizeof(SharedHypertable));
+
+	if (NULL == he)
+		return;
+
+	shared->is_hypertable = true;
+	shared->id = he->id;
+	namestrcpy(&shared->schema, he->schema);
+	namestrcpy(&shared->table, he->table);
+	shared->root_table = he->root_table;
+	shared->replica_table = he->replica_table;
+	namestrcpy(&shared->time_column_name, he->time_column_name);
+	shared->time_column_type = he->time_column_type;
+	shared->chunk_size_bytes = he->chunk_size_bytes;
+	shared->num_replicas = he->num_replicas;
+}
+
+static Hypertable *
+hypertable_from_shared(SharedHypertable *shared)
+{
+	Hypertable *he;
+
+	if (!shared->is_hypertable)
+		return NULL;
+
+	he = palloc(sizeof(Hypertable));
+	he->num_epochs = 0;
+	he->epochs = NULL;
+	he->id = shared->id;
+	strncpy(he->schema, NameStr(shared->schema), NAMEDATALEN);
+	strncpy(he->table, NameStr(shared->table), NAMEDATALEN);
+	he->root_table = shared->root_table;
+	he->replica_table = shared->replica_table;
+	strncpy(he->time_column_name, NameStr(shared->time_column_name), NAMEDATALEN);
+	he->time_column_type = shared->time_column_type;
+	he->chunk_size_bytes = shared->chunk_size_bytes;
+	he->num_replicas = shared->num_replicas;
+
+	return he;
+}
+
 static void *
 hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 {
@@ -123,6 +215,8 @@ hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 	Catalog    *catalog = catalog_get();
 	HypertableNameCacheEntry *cache_entry = query->result;
 	int			number_found;
+	SharedHypertable shared;
+	uint32		generation = shared_cache_generation(CACHE_TYPE_HYPERTABLE);
 	ScanKeyData scankey[2];
 	ScannerCtx	scanCtx = {
 		.table = catalog->tables[HYPERTABLE].id,
@@ -136,6 +230,18 @@ hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 		.scandirection = ForwardScanDirection,
 	};
 
+	if (NULL != hq->hypertable)
+	{
+		cache_entry->hypertable = hq->hypertable;
+		return query->result;
+	}
+
+	if (shared_cache_lookup(CACHE_TYPE_HYPERTABLE, hq->relid, &shared, sizeof(SharedHypertable)))
+	{
+		cache_entry->hypertable = hypertable_from_shared(&shared);
+		return query->result;
+	}
+
 	if (NULL == hq->schema)
 	{
 		hq->schema = get_namespace_name(get_rel_namespace(hq->relid));
@@ -169,6 +275,11 @@ hypertable_cache_create_entry(Cache *cache, CacheQuery *query)
 			break;
 
 	}
+
+	hypertable_to_shared(cache_entry->hypertable, &shared);
+	shared_cache_insert(CACHE_TYPE_HYPERTABLE, hq->relid, generation,
+						&shared, sizeof(SharedHypertable));
+
 	return query->result;
 }
 
@@ -178,6 +289,32 @@ hypertable_cache_invalidate_callback(void)
 	CACHE1_elog(WARNING, "DESTROY hypertable_cache");
 	cache_invalidate(hypertable_cache_current);
 	hypertable_cache_current = hypertable_cache_create();
+	hypertable_cache_prewarm_pending = true;
+}
+
+/*
+ * Invalidate the entry of a single hypertable, identified by the relid of its
+ * main table.
+ */
+void
+hypertable_cache_invalidate_entry(Oid relid)
+{
+	cache_invalidate_entry(hypertable_cache_current, &relid);
+}
+
+/*
+ * Check if the cache knows that a relation is not a hypertable. This only
+ * probes the current cache and never scans the catalog, so that callers can
+ * rule out regular tables cheaply before doing a full lookup.
+ */
+bool
+hypertable_cache_is_negative(Oid relid)
+{
+	HypertableNameCacheEntry *entry = hash_search(hypertable_cache_current->htab,
+												  &relid, HASH_FIND, NULL);
+
+	return entry != NULL && entry->hypertable == NULL &&
+		!cache_entry_is_stale(hypertable_cache_current, &relid);
 }
 
 /* Get hypertable cache entry. If the entry is not in the cache, add it. */
@@ -200,6 +337,15 @@ hypertable_cache_get_entry_with_table(Cache *cache, Oid relid, const char *schem
 	return entry->hypertable;
 }
 
+static void
+hypertable_cache_load_epochs(Cache *cache, Hypertable *hce, Oid relid)
+{
+	MemoryContext old = cache_switch_to_memory_context(cache);
+
+	hce->epochs = partition_epoch_scan_all(hce->id, relid, &hce->num_epochs);
+	MemoryContextSwitchTo(old);
+}
+
 /* function to compare epochs */
 static int
 cmp_epochs(const void *time_pt_pointer, const void *test)
@@ -220,13 +366,18 @@ cmp_epochs(const void *time_pt_pointer, const void *test)
 	return -1;
 }
 
+/*
+ * Get the partition epoch for a time point. All epochs of the hypertable are
+ * loaded on first use, so lookups do not need to scan the catalog.
+ */
 PartitionEpoch *
 hypertable_cache_get_partition_epoch(Cache *cache, Hypertable *hce, int64 time_pt, Oid relid)
 {
-	MemoryContext old;
 	PartitionEpoch *epoch,
 			  **cache_entry;
-	int			j;
+
+	if (hce->epochs == NULL)
+		hypertable_cache_load_epochs(cache, hce, relid);
 
 	/* fastpath: check latest entry */
 	if (hce->num_epochs > 0)
@@ -242,40 +393,86 @@ hypertable_cache_get_partition_epoch(Cache *cache, Hypertable *hce, int64 time_p
 	cache_entry = bsearch(&time_pt, hce->epochs, hce->num_epochs,
 						  sizeof(PartitionEpoch *), cmp_epochs);
 
-	if (cache_entry != NULL)
+	if (cache_entry == NULL)
 	{
-		return (*cache_entry);
+		return NULL;
 	}
 
+	return *cache_entry;
+}
+
+static bool
+hypertable_prewarm_tuple_found(TupleInfo *ti, void *data)
+{
+	Cache	   *cache = data;
+	HypertableNameCacheEntry entry;
+	HypertableCacheQuery query = {
+		.relid = InvalidOid,
+	};
+	MemoryContext old;
+	Oid			namespace_oid;
+
 	old = cache_switch_to_memory_context(cache);
-	epoch = partition_epoch_scan(hce->id, time_pt, relid);
+	hypertable_tuple_found(ti, &entry);
+	MemoryContextSwitchTo(old);
 
-	/* check if full */
-	if (hce->num_epochs == MAX_EPOCHS_PER_HYPERTABLE)
-	{
-		/* remove last */
-		partition_epoch_free(hce->epochs[MAX_EPOCHS_PER_HYPERTABLE - 1]);
-		hce->epochs[MAX_EPOCHS_PER_HYPERTABLE - 1] = NULL;
-		hce->num_epochs--;
-	}
+	query.hypertable = entry.hypertable;
+	namespace_oid = get_namespace_oid(query.hypertable->schema, true);
+
+	if (OidIsValid(namespace_oid))
+		query.relid = get_relname_relid(query.hypertable->table, namespace_oid);
 
-	/* ordered insert */
-	for (j = hce->num_epochs - 1; j >= 0 && cmp_epochs(&time_pt, hce->epochs + j) < 0; j--)
+	if (!OidIsValid(query.relid) ||
+		hash_search(cache->htab, &query.relid, HASH_FIND, NULL) != NULL)
 	{
-		hce->epochs[j + 1] = hce->epochs[j];
+		pfree(query.hypertable);
+		return true;
 	}
-	hce->epochs[j + 1] = epoch;
-	hce->num_epochs++;
 
-	MemoryContextSwitchTo(old);
+	hypertable_cache_load_epochs(cache, query.hypertable, query.relid);
+	cache_fetch(cache, &query.q);
+
+	return true;
+}
+
+/*
+ * Fill the hypertable cache with all hypertables and their partition epochs,
+ * so that the first queries and inserts on a hypertable do not have to wait
+ * for catalog scans. Hypertables are read in a single scan of the hypertable
+ * table. The most recent chunks are loaded into the chunk cache.
+ */
+static void
+hypertable_cache_prewarm(Cache *cache)
+{
+	Catalog    *catalog = catalog_get();
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[HYPERTABLE].id,
+		.scantype = ScannerTypeHeap,
+		.data = cache,
+		.tuple_found = hypertable_prewarm_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
 
-	return epoch;
+	scanner_scan(&scanctx);
+
+	if (guc_cache_prewarm_chunks > 0)
+		chunk_cache_prewarm(guc_cache_prewarm_chunks);
 }
 
 extern Cache *
 hypertable_cache_pin()
 {
-	return cache_pin(hypertable_cache_current);
+	Cache	   *cache = cache_pin(hypertable_cache_current);
+
+	if (guc_cache_prewarm && hypertable_cache_prewarm_pending &&
+		IsTransactionState() && extension_is_loaded())
+	{
+		hypertable_cache_prewarm_pending = false;
+		hypertable_cache_prewarm(cache);
+	}
+
+	return cache;
 }
 
 void
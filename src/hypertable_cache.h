@@ -7,8 +7,6 @@
 
 typedef struct PartitionEpoch PartitionEpoch;
 
-#define MAX_EPOCHS_PER_HYPERTABLE 20
-
 typedef struct Hypertable
 {
 	int32		id;
@@ -18,20 +16,22 @@ typedef struct Hypertable
 	Oid			replica_table;
 	char		time_column_name[NAMEDATALEN];
 	Oid			time_column_type;
-	int			num_epochs;
 	int64		chunk_size_bytes;
 	int16		num_replicas;
-	/* Array of PartitionEpoch. Order by start_time */
-	PartitionEpoch *epochs[MAX_EPOCHS_PER_HYPERTABLE];
+	/* All epochs of the hypertable, latest first. NULL until loaded */
+	int			num_epochs;
+	PartitionEpoch **epochs;
 } Hypertable;
 
 
 extern Hypertable *hypertable_cache_get_entry(Cache *cache, Oid relid);
 extern Hypertable *hypertable_cache_get_entry_with_table(Cache *cache, Oid relid, const char *schema, const char *table);
+extern bool hypertable_cache_is_negative(Oid relid);
 
 extern PartitionEpoch *hypertable_cache_get_partition_epoch(Cache *cache, Hypertable *hce, int64 time_pt, Oid relid);
 
 extern void hypertable_cache_invalidate_callback(void);
+extern void hypertable_cache_invalidate_entry(Oid relid);
 
 extern Cache *hypertable_cache_pin(void);
 
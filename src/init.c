@@ -14,9 +14,26 @@
 PG_MODULE_MAGIC;
 #endif
 
+extern void _guc_init(void);
+
+extern void _shared_cache_init(void);
+extern void _shared_cache_fini(void);
+
+extern void _catalog_snapshot_init(void);
+extern void _catalog_snapshot_fini(void);
+
+extern void _scanner_init(void);
+extern void _scanner_fini(void);
+
+extern void _cache_stats_init(void);
+extern void _cache_stats_fini(void);
+
 extern void _hypertable_cache_init(void);
 extern void _hypertable_cache_fini(void);
 
+extern void _monotonic_function_cache_init(void);
+extern void _monotonic_function_cache_fini(void);
+
 extern void _chunk_cache_init(void);
 extern void _chunk_cache_fini(void);
 
@@ -29,6 +46,11 @@ extern void _planner_fini(void);
 extern void _process_utility_init(void);
 extern void _process_utility_fini(void);
 
+extern void _zone_map_init(void);
+extern void _zone_map_fini(void);
+
+extern void _bgw_scheduler_init(void);
+
 extern void _PG_init(void);
 extern void _PG_fini(void);
 
@@ -36,19 +58,33 @@ void
 _PG_init(void)
 {
 	elog(INFO, "timescaledb loaded");
+	_guc_init();
+	_shared_cache_init();
+	_catalog_snapshot_init();
+	_scanner_init();
+	_cache_stats_init();
 	_hypertable_cache_init();
+	_monotonic_function_cache_init();
 	_chunk_cache_init();
 	_cache_invalidate_init();
 	_planner_init();
 	_process_utility_init();
+	_zone_map_init();
+	_bgw_scheduler_init();
 }
 
 void
 _PG_fini(void)
 {
+	_zone_map_fini();
 	_process_utility_fini();
 	_planner_fini();
 	_cache_invalidate_fini();
 	_hypertable_cache_fini();
+	_monotonic_function_cache_fini();
 	_chunk_cache_fini();
+	_cache_stats_fini();
+	_scanner_fini();
+	_catalog_snapshot_fini();
+	_shared_cache_fini();
 }
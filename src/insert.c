@@ -116,6 +116,9 @@ insert_main_table_trigger(PG_FUNCTION_ARGS)
 		epoch = hypertable_cache_get_partition_epoch(insert_statement_state->hypertable_cache, insert_statement_state->hypertable,
 													 timepoint, relid);
 
+		if (epoch == NULL)
+			elog(ERROR, "No partition epoch for time point " INT64_FORMAT, timepoint);
+
 		/* Find correct partition */
 		if (epoch->num_partitions > 1)
 		{
@@ -159,6 +162,9 @@ insert_main_table_trigger_after(PG_FUNCTION_ARGS)
 		if (!TRIGGER_FIRED_BY_UPDATE(trigdata->tg_event) &&
 			!TRIGGER_FIRED_BY_INSERT(trigdata->tg_event))
 			elog(ERROR, "Unsupported event for trigger");
+
+		if (insert_statement_state != NULL)
+			insert_statement_state_flush(insert_statement_state);
 	}
 	PG_CATCH();
 	{
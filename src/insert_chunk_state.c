@@ -31,6 +31,8 @@
 #include "catalog.h"
 #include "chunk.h"
 #include "insert_chunk_state.h"
+#include "seal.h"
+#include "zone_map.h"
 
 /*
  * State and helper functions for inserting tuples into chunk tables
@@ -43,6 +45,8 @@ typedef struct InsertChunkStateRel
 	EState	   *estate;
 	ResultRelInfo *resultRelInfo;
 	BulkInsertState bistate;
+	/* NULL if the chunk has no zone maps */
+	ZoneMapInsertState *zone_maps;
 } InsertChunkStateRel;
 
 static InsertChunkStateRel *
@@ -65,6 +69,7 @@ insert_chunk_state_rel_new(Relation rel, ResultRelInfo *resultRelInfo, List *ran
 	rel_state->rel = rel;
 	rel_state->resultRelInfo = resultRelInfo;
 	rel_state->bistate = GetBulkInsertState();
+	rel_state->zone_maps = zone_map_insert_begin(rel);
 	return rel_state;
 }
 
@@ -95,6 +100,9 @@ insert_chunk_state_rel_insert_tuple(InsertChunkStateRel *rel_state, HeapTuple tu
 	if (rel_state->rel->rd_att->constr)
 		ExecConstraints(rel_state->resultRelInfo, rel_state->slot, rel_state->estate);
 
+	if (rel_state->zone_maps != NULL)
+		zone_map_insert_tuple(rel_state->zone_maps, tuple);
+
 	/* OK, store the tuple and create index entries for it */
 	heap_insert(rel_state->rel, tuple, mycid, hi_options, rel_state->bistate);
 
@@ -123,6 +131,7 @@ insert_chunk_state_new(Chunk *chunk)
 		InsertChunkStateRel *rel_state;;
 
 		rel = heap_open(cr->table_id, RowExclusiveLock);
+		seal_check_insert(rel);
 
 		/* permission check */
 		rte = makeNode(RangeTblEntry);
@@ -197,6 +206,29 @@ insert_chunk_state_destroy(InsertChunkState *state)
 	}
 }
 
+/*
+ * Write what the inserts did to the chunk's metadata, such as its zone maps.
+ * Must be called before the state is destroyed, unless the insert failed.
+ */
+extern void
+insert_chunk_state_flush(InsertChunkState *state)
+{
+	ListCell   *lc;
+
+	if (state == NULL)
+	{
+		return;
+	}
+
+	foreach(lc, state->replica_states)
+	{
+		InsertChunkStateRel *rel_state = lfirst(lc);
+
+		if (rel_state->zone_maps != NULL)
+			zone_map_insert_end(rel_state->zone_maps);
+	}
+}
+
 extern void
 insert_chunk_state_insert_tuple(InsertChunkState *state, HeapTuple tup)
 {
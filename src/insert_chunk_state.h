@@ -14,6 +14,8 @@ typedef struct InsertChunkState
 
 extern InsertChunkState *insert_chunk_state_new(Chunk *chunk);
 
+extern void insert_chunk_state_flush(InsertChunkState *state);
+
 extern void insert_chunk_state_destroy(InsertChunkState *state);
 
 extern void insert_chunk_state_insert_tuple(InsertChunkState *state, HeapTuple tup);
@@ -6,8 +6,10 @@
 #include "chunk_cache.h"
 #include "chunk.h"
 #include "cache.h"
+#include "continuous_agg.h"
 #include "hypertable_cache.h"
 #include "partitioning.h"
+#include "scanner.h"
 
 InsertStatementState *
 insert_statement_state_new(Oid relid)
@@ -23,6 +25,9 @@ insert_statement_state_new(Oid relid)
 	state = palloc(sizeof(InsertStatementState));
 	state->mctx = mctx;
 
+	/* Keep the catalog relations open for the chunk lookups of the statement */
+	scanner_keep_open_begin();
+
 	state->chunk_cache = chunk_cache_pin();
 	state->hypertable_cache = hypertable_cache_pin();
 
@@ -31,11 +36,38 @@ insert_statement_state_new(Oid relid)
 	state->time_attno = get_attnum(relid, state->hypertable->time_column_name);
 
 	state->num_partitions = 0;
+	state->min_time = PG_INT64_MAX;
+	state->max_time = PG_INT64_MIN;
 
 	MemoryContextSwitchTo(oldctx);
 	return state;
 }
 
+/*
+ * Write the metadata of the chunks inserted into, e.g., their zone maps, and
+ * invalidate the continuous aggregates of the time inserted into.
+ */
+void
+insert_statement_state_flush(InsertStatementState *state)
+{
+	int			i;
+
+	for (i = 0; i < state->num_partitions; i++)
+	{
+		if (state->cstates[i] != NULL)
+		{
+			insert_chunk_state_flush(state->cstates[i]);
+		}
+	}
+
+	if (state->min_time <= state->max_time)
+	{
+		continuous_agg_invalidate(state->hypertable->id, state->min_time, state->max_time);
+		state->min_time = PG_INT64_MAX;
+		state->max_time = PG_INT64_MIN;
+	}
+}
+
 void
 insert_statement_state_destroy(InsertStatementState *state)
 {
@@ -45,12 +77,14 @@ insert_statement_state_destroy(InsertStatementState *state)
 	{
 		if (state->cstates[i] != NULL)
 		{
+			cache_release_entry(state->chunk_cache, state->cstates[i]->chunk);
 			insert_chunk_state_destroy(state->cstates[i]);
 		}
 	}
 
 	cache_release(state->chunk_cache);
 	cache_release(state->hypertable_cache);
+	scanner_keep_open_end();
 
 	MemoryContextDelete(state->mctx);
 }
@@ -62,11 +96,20 @@ set_or_update_new_entry(InsertStatementState *state, Partition *partition, int64
 
 	if (state->cstates[partition->index] != NULL)
 	{
+		insert_chunk_state_flush(state->cstates[partition->index]);
+		cache_release_entry(state->chunk_cache, state->cstates[partition->index]->chunk);
 		insert_chunk_state_destroy(state->cstates[partition->index]);
+		state->cstates[partition->index] = NULL;
 	}
 
 	chunk = chunk_cache_get(state->chunk_cache, partition, state->hypertable->num_replicas, timepoint);
 	state->cstates[partition->index] = insert_chunk_state_new(chunk);
+
+	/*
+	 * The chunk cache stays pinned for the whole statement and evicts other
+	 * chunks as the insert moves on, so pin the chunk inserted into.
+	 */
+	cache_pin_entry(state->chunk_cache, chunk);
 }
 
 /*
@@ -76,6 +119,9 @@ set_or_update_new_entry(InsertStatementState *state, Partition *partition, int64
 extern InsertChunkState *
 insert_statement_state_get_insert_chunk_state(InsertStatementState *state, Partition *partition, PartitionEpoch *epoch, int64 timepoint)
 {
+	state->min_time = Min(state->min_time, timepoint);
+	state->max_time = Max(state->max_time, timepoint);
+
 	/* First call, set up mem */
 	if (state->num_partitions == 0)
 	{
@@ -17,9 +17,13 @@ typedef struct
 	Hypertable *hypertable;
 	AttrNumber	time_attno;
 	int			num_partitions;
+	/* The range of time inserted into, for continuous aggregates */
+	int64		min_time;
+	int64		max_time;
 } InsertStatementState;
 
 InsertStatementState *insert_statement_state_new(Oid);
+void		insert_statement_state_flush(InsertStatementState *);
 void		insert_statement_state_destroy(InsertStatementState *);
 InsertChunkState *insert_statement_state_get_insert_chunk_state(InsertStatementState *cache, Partition *partition, PartitionEpoch *epoch, int64 timepoint);
 
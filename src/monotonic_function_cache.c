@@ -0,0 +1,165 @@
+#include <postgres.h>
+#include <utils/catcache.h>
+#include <utils/fmgroids.h>
+#include <utils/memutils.h>
+
+#include "monotonic_function_cache.h"
+#include "catalog.h"
+#include "cache.h"
+#include "extension.h"
+#include "scanner.h"
+#include "utils.h"
+
+/*
+ * Monotonic function cache.
+ *
+ * Caches the contents of the monotonic_function catalog table by function
+ * OID. Functions that are not registered get a negative entry, so that the
+ * planner only scans the catalog once per function and not once for every
+ * sort expression it tries to transform.
+ *
+ * The catalog table is attached to the hypertable cache's invalidation proxy
+ * (see sql/common/cache.sql), so this cache is invalidated along with the
+ * hypertable cache.
+ */
+static Cache *monotonic_function_cache_current = NULL;
+
+typedef struct MonotonicFunctionCacheQuery
+{
+	CacheQuery	q;
+	Oid			funcid;
+} MonotonicFunctionCacheQuery;
+
+typedef struct MonotonicFunctionCacheEntry
+{
+	Oid			funcid;
+	/* 0 if the function is not monotonic */
+	int16		order_argument;
+} MonotonicFunctionCacheEntry;
+
+static void *
+monotonic_function_cache_get_key(CacheQuery *query)
+{
+	return &((MonotonicFunctionCacheQuery *) query)->funcid;
+}
+
+static void *monotonic_function_cache_create_entry(Cache *cache, CacheQuery *query);
+
+static Cache *
+monotonic_function_cache_create()
+{
+	MemoryContext ctx = AllocSetContextCreate(CacheMemoryContext,
+											  "monotonic_function_cache",
+											  ALLOCSET_DEFAULT_SIZES);
+
+	Cache	   *cache = MemoryContextAlloc(ctx, sizeof(Cache));
+	Cache		template =
+	{
+		.hctl =
+		{
+			.keysize = sizeof(Oid),
+			.entrysize = sizeof(MonotonicFunctionCacheEntry),
+			.hcxt = ctx,
+		},
+		.name = "monotonic_function_cache",
+		.numelements = 16,
+		.flags = HASH_ELEM | HASH_CONTEXT | HASH_BLOBS,
+		.get_key = monotonic_function_cache_get_key,
+		.create_entry = monotonic_function_cache_create_entry,
+	};
+
+	*cache = template;
+
+	cache_init(cache);
+
+	return cache;
+}
+
+static bool
+monotonic_function_tuple_found(TupleInfo *ti, void *data)
+{
+	MonotonicFunctionCacheEntry *entry = data;
+	bool		isnull;
+	Datum		order_argument = heap_getattr(ti->tuple, Anum_monotonic_function_order_argument,
+											  ti->desc, &isnull);
+
+	entry->order_argument = DatumGetInt16(order_argument);
+
+	return false;
+}
+
+static void *
+monotonic_function_cache_create_entry(Cache *cache, CacheQuery *query)
+{
+	MonotonicFunctionCacheQuery *mq = (MonotonicFunctionCacheQuery *) query;
+	MonotonicFunctionCacheEntry *cache_entry = query->result;
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[1];
+	ScannerCtx	scanCtx = {
+		.table = catalog->tables[MONOTONIC_FUNCTION].id,
+		.index = catalog->tables[MONOTONIC_FUNCTION].index_ids[MONOTONIC_FUNCTION_ID_INDEX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.data = query->result,
+		.tuple_found = monotonic_function_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	/* Negative cache entry unless the function is found */
+	cache_entry->order_argument = 0;
+
+	ScanKeyInit(&scankey[0], Anum_monotonic_function_pkey_idx_function_id,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(mq->funcid));
+
+	scanner_scan(&scanCtx);
+
+	return query->result;
+}
+
+int16
+monotonic_function_get_order_argument(Oid funcid)
+{
+	MonotonicFunctionCacheQuery query = {
+		.funcid = funcid,
+	};
+	MonotonicFunctionCacheEntry *entry;
+	Cache	   *cache;
+	int16		order_argument;
+
+	if (!extension_is_loaded())
+		return 0;
+
+	/*
+	 * Pin the cache since scanning the catalog takes locks, which might
+	 * process invalidation messages.
+	 */
+	cache = cache_pin(monotonic_function_cache_current);
+	entry = cache_fetch(cache, &query.q);
+	order_argument = entry->order_argument;
+	cache_release(cache);
+
+	return order_argument;
+}
+
+void
+monotonic_function_cache_invalidate_callback(void)
+{
+	CACHE1_elog(WARNING, "DESTROY monotonic_function_cache");
+	cache_invalidate(monotonic_function_cache_current);
+	monotonic_function_cache_current = monotonic_function_cache_create();
+}
+
+void
+_monotonic_function_cache_init(void)
+{
+	CreateCacheMemoryContext();
+	monotonic_function_cache_current = monotonic_function_cache_create();
+}
+
+void
+_monotonic_function_cache_fini(void)
+{
+	cache_invalidate(monotonic_function_cache_current);
+}
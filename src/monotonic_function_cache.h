@@ -0,0 +1,17 @@
+#ifndef TIMESCALEDB_MONOTONIC_FUNCTION_CACHE_H
+#define TIMESCALEDB_MONOTONIC_FUNCTION_CACHE_H
+
+#include <postgres.h>
+
+/*
+ * Get the (1-based) position of the argument whose ordering is preserved by
+ * the given function, or 0 if the function is not registered as monotonic.
+ */
+extern int16 monotonic_function_get_order_argument(Oid funcid);
+
+extern void monotonic_function_cache_invalidate_callback(void);
+
+extern void _monotonic_function_cache_init(void);
+extern void _monotonic_function_cache_fini(void);
+
+#endif   /* TIMESCALEDB_MONOTONIC_FUNCTION_CACHE_H */
@@ -0,0 +1,172 @@
+#include <postgres.h>
+#include <access/stratnum.h>
+#include <nodes/relation.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+
+#include "chunk_cache.h"
+
+/*
+ * Ordered append of chunks.
+ *
+ * An ordered scan of a hypertable (e.g., ORDER BY time DESC LIMIT 1) is
+ * normally planned as a MergeAppend of ordered scans of all chunks. A
+ * MergeAppend must fetch the first tuple of every chunk before returning
+ * anything, so each such query probes the index of every chunk.
+ *
+ * Chunks with the same partition do not overlap in time, however. If the
+ * ordering is on the time column, and no two chunks overlap in time, an Append
+ * of the chunk scans in time order produces the same ordering as the
+ * MergeAppend. With a LIMIT, the executor then stops once enough tuples are
+ * found, without ever starting the scans of older chunks.
+ *
+ * The time ranges of chunks are taken from the chunk table cache.
+ */
+
+extern void ordered_append_optimization(PlannerInfo *root, RelOptInfo *rel, AttrNumber time_attno);
+
+typedef struct ChunkPath
+{
+	Path	   *path;
+	int64		start_time;
+	int64		end_time;
+} ChunkPath;
+
+static int
+chunk_path_cmp_asc(const void *left, const void *right)
+{
+	const ChunkPath *l = left;
+	const ChunkPath *r = right;
+
+	if (l->start_time < r->start_time)
+		return -1;
+	if (l->start_time > r->start_time)
+		return 1;
+	return 0;
+}
+
+static int
+chunk_path_cmp_desc(const void *left, const void *right)
+{
+	return chunk_path_cmp_asc(right, left);
+}
+
+/*
+ * Check if the pathkey orders by the given column of the relation.
+ */
+static bool
+pathkey_is_on_column(PathKey *pk, Index relid, AttrNumber attno)
+{
+	ListCell   *lc;
+
+	if (pk->pk_eclass->ec_has_volatile)
+		return false;
+
+	foreach(lc, pk->pk_eclass->ec_members)
+	{
+		EquivalenceMember *em = lfirst(lc);
+		Var		   *var = (Var *) em->em_expr;
+
+		if (IsA(var, Var) &&
+			var->varno == relid &&
+			var->varattno == attno &&
+			var->varlevelsup == 0)
+			return true;
+	}
+
+	return false;
+}
+
+void
+ordered_append_optimization(PlannerInfo *root, RelOptInfo *rel, AttrNumber time_attno)
+{
+	List	   *pathkeys = root->query_pathkeys;
+	PathKey    *pk;
+	ChunkPath  *chunks;
+	List	   *other_paths = NIL;
+	List	   *subpaths = NIL;
+	AppendPath *append;
+	ListCell   *lc;
+	int			num_chunks = 0;
+	int			i;
+
+	/* Only worth the chunk lookups when the scan can stop early */
+	if (pathkeys == NIL || root->limit_tuples < 0)
+		return;
+
+	pk = linitial(pathkeys);
+
+	if (!pathkey_is_on_column(pk, rel->relid, time_attno))
+		return;
+
+	chunks = palloc(sizeof(ChunkPath) * list_length(root->append_rel_list));
+
+	foreach(lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = lfirst(lc);
+		RelOptInfo *childrel;
+		RangeTblEntry *childrte;
+		ChunkPath  *chunk = &chunks[num_chunks];
+
+		if (appinfo->parent_relid != rel->relid)
+			continue;
+
+		childrel = root->simple_rel_array[appinfo->child_relid];
+		childrte = root->simple_rte_array[appinfo->child_relid];
+
+		/* Chunks excluded by constraints */
+		if (IS_DUMMY_REL(childrel))
+			continue;
+
+		if (!chunk_cache_get_time_range(childrte->relid, &chunk->start_time, &chunk->end_time))
+		{
+			/*
+			 * The hypertable's replica and partition tables are part of the
+			 * inheritance tree, but never hold any data themselves.
+			 */
+			other_paths = lappend(other_paths, childrel->cheapest_total_path);
+			continue;
+		}
+
+		chunk->path = get_cheapest_path_for_pathkeys(childrel->pathlist, pathkeys,
+													 NULL, TOTAL_COST);
+
+		/* The chunk cannot produce the ordering without a sort */
+		if (NULL == chunk->path)
+			return;
+
+		num_chunks++;
+	}
+
+	/* Nothing to gain unless there are chunks to skip */
+	if (num_chunks < 2)
+		return;
+
+	qsort(chunks, num_chunks, sizeof(ChunkPath),
+		  pk->pk_strategy == BTLessStrategyNumber ? chunk_path_cmp_asc : chunk_path_cmp_desc);
+
+	/*
+	 * Chunks in different partitions can cover the same time range, in which
+	 * case only a MergeAppend can produce the ordering.
+	 */
+	for (i = 1; i < num_chunks; i++)
+	{
+		ChunkPath  *earlier = (pk->pk_strategy == BTLessStrategyNumber) ? &chunks[i - 1] : &chunks[i];
+		ChunkPath  *later = (pk->pk_strategy == BTLessStrategyNumber) ? &chunks[i] : &chunks[i - 1];
+
+		if (earlier->end_time >= later->start_time)
+			return;
+	}
+
+	if (other_paths != NIL)
+		subpaths = lappend(subpaths,
+						   create_merge_append_path(root, rel, other_paths, pathkeys, NULL));
+
+	for (i = 0; i < num_chunks; i++)
+		subpaths = lappend(subpaths, chunks[i].path);
+
+	append = create_append_path(rel, subpaths, NULL, 0);
+	append->path.pathkeys = pathkeys;
+
+	add_path(rel, &append->path);
+}
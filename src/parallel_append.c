@@ -0,0 +1,152 @@
+#include <limits.h>
+
+#include <postgres.h>
+#include <nodes/relation.h>
+#include <optimizer/cost.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+
+/*
+ * Parallel scans of hypertables.
+ *
+ * A hypertable is expanded into an inheritance tree of (typically many)
+ * chunk tables. Postgres builds a partial Append path for such a tree when
+ * every child has a partial path, which is the case for chunks since
+ * inheritance children always get a parallel sequential scan path. However,
+ * the number of workers requested by the Append is the maximum requested by
+ * any single child. Since each chunk is sized by the hypertable's
+ * chunk_time_interval, a scan over months of medium-sized chunks is planned
+ * with one or two workers, regardless of how much data there is in total.
+ *
+ * The Append in this version of Postgres is not parallel aware, i.e., all
+ * workers cooperate on one chunk at a time through the chunk's parallel
+ * sequential scan. This means that workers scale with the total amount of
+ * data to scan rather than with the size of any one chunk. This optimization
+ * therefore sizes the worker pool of the hypertable's partial Append using the
+ * total size of all chunks, following the same logarithmic scale that
+ * Postgres uses for a single relation.
+ */
+
+extern void parallel_append_optimization(PlannerInfo *root, RelOptInfo *rel);
+
+/*
+ * Compute the number of workers to use for a scan of the given number of
+ * pages. This mirrors create_plain_partial_paths() in Postgres.
+ */
+static int
+parallel_workers_for_pages(double pages)
+{
+	int			parallel_workers = 1;
+	double		parallel_threshold = Max(min_parallel_relation_size, 1);
+
+	if (pages < parallel_threshold)
+		return 0;
+
+	while (pages >= parallel_threshold * 3)
+	{
+		parallel_workers++;
+		parallel_threshold *= 3;
+		if (parallel_threshold > INT_MAX / 3)
+			break;
+	}
+
+	return Min(parallel_workers, max_parallel_workers_per_gather);
+}
+
+/*
+ * The divisor by which a partial path's rows and run cost are scaled,
+ * accounting for the leader's participation. This mirrors
+ * get_parallel_divisor() in Postgres.
+ */
+static double
+parallel_divisor(int parallel_workers)
+{
+	double		divisor = parallel_workers;
+	double		leader_contribution = 1.0 - (0.3 * parallel_workers);
+
+	if (leader_contribution > 0)
+		divisor += leader_contribution;
+
+	return divisor;
+}
+
+static AppendPath *
+get_partial_append_path(RelOptInfo *rel)
+{
+	ListCell   *lc;
+
+	foreach(lc, rel->partial_pathlist)
+	{
+		Path	   *path = lfirst(lc);
+
+		if (IsA(path, AppendPath))
+			return (AppendPath *) path;
+	}
+
+	return NULL;
+}
+
+void
+parallel_append_optimization(PlannerInfo *root, RelOptInfo *rel)
+{
+	AppendPath *append;
+	ListCell   *lc;
+	double		total_pages = 0;
+	double		scale;
+	Cost		run_cost;
+	int			parallel_workers;
+
+	if (!rel->consider_parallel ||
+		rel->rel_parallel_workers != -1 ||
+		max_parallel_workers_per_gather <= 0)
+		return;
+
+	append = get_partial_append_path(rel);
+
+	if (NULL == append)
+		return;
+
+	foreach(lc, append->subpaths)
+	{
+		Path	   *subpath = lfirst(lc);
+
+		total_pages += subpath->parent->pages;
+	}
+
+	parallel_workers = parallel_workers_for_pages(total_pages);
+
+	if (parallel_workers <= append->path.parallel_workers)
+		return;
+
+	/*
+	 * The subpaths were costed for the number of workers each child asked
+	 * for, so rescale the per-worker rows and run cost of the Append to the
+	 * new number of workers.
+	 */
+	scale = parallel_divisor(append->path.parallel_workers) /
+		parallel_divisor(parallel_workers);
+	run_cost = append->path.total_cost - append->path.startup_cost;
+
+	append->path.parallel_workers = parallel_workers;
+	append->path.rows = clamp_row_est(append->path.rows * scale);
+	append->path.total_cost = append->path.startup_cost + run_cost * scale;
+
+	/*
+	 * Gather paths for the Append were already generated before we got here,
+	 * so replace them with a new one that uses the updated Append. The old
+	 * path is removed from the pathlist before adding the new one so that
+	 * add_path() keeps the list ordered by cost.
+	 */
+	foreach(lc, rel->pathlist)
+	{
+		Path	   *path = lfirst(lc);
+
+		if (IsA(path, GatherPath) && ((GatherPath *) path)->subpath == &append->path)
+		{
+			rel->pathlist = list_delete_ptr(rel->pathlist, path);
+			add_path(rel, (Path *) create_gather_path(root, rel, &append->path,
+													  rel->reltarget, NULL, NULL));
+			break;
+		}
+	}
+}
@@ -98,18 +98,18 @@ partitioning_func_apply_tuple(PartitioningInfo *pinfo, HeapTuple tuple, TupleDes
 typedef struct
 {
 	PartitionEpoch *pe;
+	List	   *epochs;
 	int16		num_partitions;
 	int32		hypertable_id;
 	int64		starttime,
-				endtime,
-				timepoint;
+				endtime;
 	Oid			relid;
 } PartitionEpochCtx;
 
 static int
 			partition_scan(PartitionEpochCtx *pctx);
 
-/* Filter partition epoch tuples based on hypertable ID and start/end time. */
+/* Filter partition epoch tuples based on hypertable ID. */
 static bool
 partition_epoch_filter(TupleInfo *ti, void *arg)
 {
@@ -127,8 +127,7 @@ partition_epoch_filter(TupleInfo *ti, void *arg)
 		pctx->starttime = starttime_is_null ? OPEN_START_TIME : DatumGetInt64(starttime);
 		pctx->endtime = endtime_is_null ? OPEN_END_TIME : DatumGetInt64(endtime);
 
-		return (starttime_is_null || pctx->timepoint >= pctx->starttime) &&
-			(endtime_is_null || pctx->timepoint <= pctx->endtime);
+		return true;
 	}
 	return false;
 }
@@ -212,6 +211,8 @@ partition_epoch_tuple_found(TupleInfo *ti, void *arg)
 	/* Scan for the epoch's partitions */
 	partition_scan(pctx);
 
+	pctx->epochs = lappend(pctx->epochs, pe);
+
 	return true;
 }
 
@@ -280,15 +281,34 @@ partition_scan(PartitionEpochCtx *pctx)
 	return num_partitions;
 }
 
-PartitionEpoch *
-partition_epoch_scan(int32 hypertable_id, int64 timepoint, Oid relid)
+/* Order epochs by time, latest first */
+static int
+cmp_epochs_desc(const void *left, const void *right)
+{
+	const PartitionEpoch *l = *((PartitionEpoch **) left);
+	const PartitionEpoch *r = *((PartitionEpoch **) right);
+
+	if (l->start_time > r->start_time)
+		return -1;
+	if (l->start_time < r->start_time)
+		return 1;
+	return 0;
+}
+
+/*
+ * Scan all partition epochs of a hypertable, along with their partitions.
+ *
+ * Returns an array of the epochs ordered by time, with the latest epoch first.
+ */
+PartitionEpoch **
+partition_epoch_scan_all(int32 hypertable_id, Oid relid, int *num_epochs)
 {
 	ScanKeyData scankey[1];
 	Catalog    *catalog = catalog_get();
 	PartitionEpochCtx pctx = {
 		.hypertable_id = hypertable_id,
-		.timepoint = timepoint,
 		.relid = relid,
+		.epochs = NIL,
 	};
 	ScannerCtx	scanctx = {
 		.table = catalog->tables[PARTITION_EPOCH].id,
@@ -302,10 +322,12 @@ partition_epoch_scan(int32 hypertable_id, int64 timepoint, Oid relid)
 		.lockmode = AccessShareLock,
 		.scandirection = ForwardScanDirection,
 	};
+	PartitionEpoch **epochs;
+	ListCell   *lc;
+	int			i = 0;
 
 	/*
-	 * Perform an index scan on hypertable ID. We filter on start and end
-	 * time.
+	 * Perform an index scan on hypertable ID.
 	 */
 	ScanKeyInit(&scankey[0],
 	   Anum_partition_epoch_hypertable_start_time_end_time_idx_hypertable_id,
@@ -315,7 +337,17 @@ partition_epoch_scan(int32 hypertable_id, int64 timepoint, Oid relid)
 
 	scanner_scan(&scanctx);
 
-	return pctx.pe;
+	*num_epochs = list_length(pctx.epochs);
+	epochs = palloc(sizeof(PartitionEpoch *) * Max(*num_epochs, 1));
+
+	foreach(lc, pctx.epochs)
+		epochs[i++] = lfirst(lc);
+
+	list_free(pctx.epochs);
+
+	qsort(epochs, *num_epochs, sizeof(PartitionEpoch *), cmp_epochs_desc);
+
+	return epochs;
 }
 
 
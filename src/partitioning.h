@@ -59,7 +59,7 @@ typedef struct PartitionEpoch
 } PartitionEpoch;
 
 
-PartitionEpoch *partition_epoch_scan(int32 hypertable_id, int64 timepoint, Oid relid);
+PartitionEpoch **partition_epoch_scan_all(int32 hypertable_id, Oid relid, int *num_epochs);
 int16		partitioning_func_apply(PartitioningInfo *pinfo, Datum value);
 int16		partitioning_func_apply_tuple(PartitioningInfo *pinfo, HeapTuple tuple, TupleDesc desc);
 
@@ -14,16 +14,35 @@
 #include <catalog/namespace.h>
 #include <catalog/pg_type.h>
 #include <optimizer/paths.h>
+#include <optimizer/plancat.h>
+#include <utils/lsyscache.h>
+#include <catalog/pg_class.h>
+#include <access/transam.h>
 
 #include "hypertable_cache.h"
 #include "partitioning.h"
 #include "extension.h"
+#include "guc.h"
 
 void		_planner_init(void);
 void		_planner_fini(void);
 
 static planner_hook_type prev_planner_hook;
 static set_rel_pathlist_hook_type prev_set_rel_pathlist_hook;
+static get_relation_info_hook_type prev_get_relation_info_hook;
+
+/*
+ * Hypertables in the query that is currently being planned, identified by the
+ * replica tables they were replaced with. Used to identify hypertable
+ * expansions in later stages of planning.
+ */
+typedef struct PlannedHypertable
+{
+	Oid			replica_table;
+	char		time_column_name[NAMEDATALEN];
+} PlannedHypertable;
+
+static List *planned_hypertables = NIL;
 
 typedef struct ChangeTableNameCtx
 {
@@ -31,6 +50,7 @@ typedef struct ChangeTableNameCtx
 	CmdType		commandType;
 	Cache	   *hcache;
 	Hypertable *hentry;
+	List	   *hypertables;
 } ChangeTableNameCtx;
 
 typedef struct AddPartFuncQualCtx
@@ -40,6 +60,20 @@ typedef struct AddPartFuncQualCtx
 	Hypertable *hentry;
 } AddPartFuncQualCtx;
 
+/*
+ * Check whether a range table entry can refer to a hypertable, without
+ * looking it up. Hypertables are regular user tables, and scans with ONLY
+ * are not redirected to the replica table.
+ */
+static inline bool
+rte_may_be_hypertable(RangeTblEntry *rte)
+{
+	return rte->rtekind == RTE_RELATION &&
+		rte->inh &&
+		rte->relkind == RELKIND_RELATION &&
+		rte->relid >= FirstNormalObjectId;
+}
+
 /*
  * Change all main tables to one of the replicas in the parse tree.
  *
@@ -57,15 +91,19 @@ change_table_name_walker(Node *node, void *context)
 		RangeTblEntry *rangeTableEntry = (RangeTblEntry *) node;
 		ChangeTableNameCtx *ctx = (ChangeTableNameCtx *) context;
 
-		if (rangeTableEntry->rtekind == RTE_RELATION && rangeTableEntry->inh
-			&& ctx->commandType != CMD_INSERT
-			)
+		if (rte_may_be_hypertable(rangeTableEntry) && ctx->commandType != CMD_INSERT)
 		{
 			Hypertable *hentry = hypertable_cache_get_entry(ctx->hcache, rangeTableEntry->relid);
 
 			if (hentry != NULL)
 			{
+				PlannedHypertable *planned = palloc(sizeof(PlannedHypertable));
+
+				planned->replica_table = hentry->replica_table;
+				strncpy(planned->time_column_name, hentry->time_column_name, NAMEDATALEN);
+
 				ctx->hentry = hentry;
+				ctx->hypertables = lappend(ctx->hypertables, planned);
 				rangeTableEntry->relid = hentry->replica_table;
 			}
 		}
@@ -107,7 +145,7 @@ get_partitioning_info_for_partition_column_var(Var *var_expr, Query *parse, Cach
 		/* get latest partition epoch: TODO scan all pe */
 		PartitionEpoch *eps = hypertable_cache_get_partition_epoch(hcache, hentry, OPEN_END_TIME - 1, rte->relid);
 
-		if (eps->partitioning != NULL &&
+		if (eps != NULL && eps->partitioning != NULL &&
 			strncmp(eps->partitioning->column, varname, NAMEDATALEN) == 0)
 		{
 			return eps->partitioning;
@@ -277,33 +315,73 @@ add_partitioning_func_qual(Query *parse, Cache *hcache, Hypertable *hentry)
 	parse->jointree->quals = add_partitioning_func_qual_mutator(parse->jointree->quals, &context);
 }
 
-static PlannedStmt *
-timescaledb_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
+extern bool agg_bookend_optimization(Query *parse, Hypertable *ht);
+
+/*
+ * Quick check for whether a query might reference a hypertable, to avoid
+ * pinning the hypertable cache and rewriting the query for queries that
+ * cannot. Relations that the hypertable cache knows not to be hypertables are
+ * ruled out with a hash lookup. The first query on a relation still goes
+ * through the full check, which adds the cache entry.
+ */
+static bool
+may_reference_hypertable_walker(Node *node, void *context)
 {
-	PlannedStmt *rv = NULL;
+	if (node == NULL)
+		return false;
 
-	if (extension_is_loaded())
+	if (IsA(node, RangeTblEntry))
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) node;
+
+		return rte_may_be_hypertable(rte) &&
+			!hypertable_cache_is_negative(rte->relid);
+	}
+
+	if (IsA(node, Query))
+		return query_tree_walker((Query *) node, may_reference_hypertable_walker,
+								 context, QTW_EXAMINE_RTES);
+
+	return expression_tree_walker(node, may_reference_hypertable_walker, context);
+}
+
+static bool
+query_may_reference_hypertable(Query *parse)
+{
+	return may_reference_hypertable_walker((Node *) parse, NULL);
+}
+
+static PlannedStmt *
+timescaledb_plan_query(Query *parse, int cursorOptions, ParamListInfo boundParams)
+{
+	if (extension_is_loaded() && query_may_reference_hypertable(parse))
 	{
 		ChangeTableNameCtx context;
-		char	   *printParse = GetConfigOptionByName("io.print_parse", NULL, true);
+		bool		print_parse = guc_print_parse;
 
 		/* set to false to not print all internal actions */
-		SetConfigOption("io.print_parse", "false", PGC_USERSET, PGC_S_SESSION);
+		if (print_parse)
+			SetConfigOption("io.print_parse", "false", PGC_USERSET, PGC_S_SESSION);
 
 		/* replace call to main table with call to the replica table */
 		context.hcache = hypertable_cache_pin();
 		context.parse = parse;
 		context.commandType = parse->commandType;
 		context.hentry = NULL;
+		context.hypertables = NIL;
 		change_table_name_walker((Node *) parse, &context);
+		planned_hypertables = context.hypertables;
 		/* note assumes 1 hypertable per query */
 		if (context.hentry != NULL)
 		{
 			add_partitioning_func_qual(parse, context.hcache, context.hentry);
+
+			if (!guc_disable_optimizations)
+				agg_bookend_optimization(parse, context.hentry);
 		}
 		cache_release(context.hcache);
 
-		if (printParse != NULL && strcmp(printParse, "true") == 0)
+		if (print_parse)
 		{
 			pprint(parse);
 		}
@@ -312,32 +390,166 @@ timescaledb_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
 	if (prev_planner_hook != NULL)
 	{
 		/* Call any earlier hooks */
-		rv = (prev_planner_hook) (parse, cursorOptions, boundParams);
+		return (prev_planner_hook) (parse, cursorOptions, boundParams);
 	}
-	else
+
+	/* Call the standard planner */
+	return standard_planner(parse, cursorOptions, boundParams);
+}
+
+static PlannedStmt *
+timescaledb_planner(Query *parse, int cursorOptions, ParamListInfo boundParams)
+{
+	PlannedStmt *rv = NULL;
+	List	   *prev_planned_hypertables = planned_hypertables;
+
+	planned_hypertables = NIL;
+
+	/*
+	 * Restore the hypertables of an enclosing query also when planning fails,
+	 * so that they do not leak into the planning of later queries.
+	 */
+	PG_TRY();
 	{
-		/* Call the standard planner */
-		rv = standard_planner(parse, cursorOptions, boundParams);
+		rv = timescaledb_plan_query(parse, cursorOptions, boundParams);
 	}
+	PG_CATCH();
+	{
+		planned_hypertables = prev_planned_hypertables;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	planned_hypertables = prev_planned_hypertables;
 
 	return rv;
 }
 
 
 extern void sort_transform_optimization(PlannerInfo *root, RelOptInfo *rel);
+extern void parallel_append_optimization(PlannerInfo *root, RelOptInfo *rel);
+extern void ordered_append_optimization(PlannerInfo *root, RelOptInfo *rel, AttrNumber time_attno);
+extern void skip_scan_optimization(PlannerInfo *root, RelOptInfo *rel, AppendRelInfo *appinfo);
+extern void decompress_chunk_set_rel_size(PlannerInfo *root, RelOptInfo *rel, Oid relid);
+extern void decompress_chunk_optimization(PlannerInfo *root, RelOptInfo *rel, Index rti);
+extern bool zone_map_exclude_chunk(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte);
+extern void seal_check_modified(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte);
+
+/*
+ * Get the hypertable that a relation is the expansion of (i.e., the parent of
+ * an append relation over the hypertable's chunks), or NULL.
+ */
+static PlannedHypertable *
+get_hypertable_expansion(RelOptInfo *rel, RangeTblEntry *rte)
+{
+	ListCell   *lc;
+
+	if (!rte->inh || rel->reloptkind != RELOPT_BASEREL)
+		return NULL;
+
+	foreach(lc, planned_hypertables)
+	{
+		PlannedHypertable *planned = lfirst(lc);
+
+		if (planned->replica_table == rte->relid)
+			return planned;
+	}
+
+	return NULL;
+}
+
+/*
+ * Get the append relation info of a relation that is a member (e.g., a chunk)
+ * of a hypertable expansion, or NULL.
+ */
+static AppendRelInfo *
+get_hypertable_member(PlannerInfo *root, RelOptInfo *rel)
+{
+	ListCell   *lc;
+
+	if (rel->reloptkind != RELOPT_OTHER_MEMBER_REL)
+		return NULL;
+
+	foreach(lc, root->append_rel_list)
+	{
+		AppendRelInfo *appinfo = lfirst(lc);
+
+		if (appinfo->child_relid == rel->relid)
+		{
+			RangeTblEntry *parent_rte = planner_rt_fetch(appinfo->parent_relid, root);
+
+			if (get_hypertable_expansion(root->simple_rel_array[appinfo->parent_relid],
+										 parent_rte) != NULL)
+				return appinfo;
+
+			return NULL;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+timescaledb_get_relation_info(PlannerInfo *root,
+							  Oid relation_objectid,
+							  bool inhparent,
+							  RelOptInfo *rel)
+{
+	if (prev_get_relation_info_hook != NULL)
+		prev_get_relation_info_hook(root, relation_objectid, inhparent, rel);
+
+	if (planned_hypertables != NIL && !inhparent && extension_is_loaded() &&
+		get_hypertable_member(root, rel) != NULL)
+		decompress_chunk_set_rel_size(root, rel, relation_objectid);
+}
+
 static void
 timescaledb_set_rel_pathlist(PlannerInfo *root,
 							 RelOptInfo *rel,
 							 Index rti,
 							 RangeTblEntry *rte)
 {
-	char	   *disable_optimizations = GetConfigOptionByName("timescaledb.disable_optimizations", NULL, true);
-
-	if (extension_is_loaded() && (disable_optimizations == NULL || strncmp(disable_optimizations, "true", 4) != 0))
+	if (!guc_disable_optimizations && extension_is_loaded())
 	{
 		sort_transform_optimization(root, rel);
+
+		/* Nothing more to do for queries that reference no hypertables */
+		if (planned_hypertables != NIL)
+		{
+			PlannedHypertable *ht = get_hypertable_expansion(rel, rte);
+			AppendRelInfo *appinfo = get_hypertable_member(root, rel);
+
+			if (ht != NULL)
+			{
+				parallel_append_optimization(root, rel);
+				ordered_append_optimization(root, rel,
+											get_attnum(rte->relid, ht->time_column_name));
+			}
+
+			/* Chunks excluded by their zone maps need no further planning */
+			if (appinfo != NULL && !zone_map_exclude_chunk(root, rel, rte))
+				skip_scan_optimization(root, rel, appinfo);
+		}
 	}
 
+	/*
+	 * A chunk that an UPDATE or DELETE modifies is planned on its own. Unless
+	 * the zone maps show that it modifies no rows of the chunk, the chunk
+	 * must not be sealed. The zone maps of the columns that an UPDATE sets
+	 * are dropped when it runs (see zone_map.c).
+	 */
+	if (planned_hypertables != NIL && extension_is_loaded() &&
+		rti == root->parse->resultRelation && !zone_map_exclude_chunk(root, rel, rte))
+		seal_check_modified(root, rel, rte);
+
+	/*
+	 * Chunks of a hypertable, and chunks that an UPDATE or DELETE on a
+	 * hypertable modifies, might be compressed.
+	 */
+	if (planned_hypertables != NIL && extension_is_loaded() &&
+		(rti == root->parse->resultRelation || get_hypertable_member(root, rel) != NULL))
+		decompress_chunk_optimization(root, rel, rti);
+
 	if (prev_set_rel_pathlist_hook != NULL)
 	{
 		(void) (*prev_set_rel_pathlist_hook) (root, rel, rti, rte);
@@ -351,6 +563,8 @@ _planner_init(void)
 	planner_hook = timescaledb_planner;
 	prev_set_rel_pathlist_hook = set_rel_pathlist_hook;
 	set_rel_pathlist_hook = timescaledb_set_rel_pathlist;
+	prev_get_relation_info_hook = get_relation_info_hook;
+	get_relation_info_hook = timescaledb_get_relation_info;
 
 }
 
@@ -359,4 +573,5 @@ _planner_fini(void)
 {
 	planner_hook = prev_planner_hook;
 	set_rel_pathlist_hook = prev_set_rel_pathlist_hook;
+	get_relation_info_hook = prev_get_relation_info_hook;
 }
@@ -0,0 +1,426 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/visibilitymap.h>
+#include <access/xact.h>
+#include <catalog/index.h>
+#include <catalog/indexing.h>
+#include <catalog/pg_am.h>
+#include <catalog/pg_class.h>
+#include <catalog/pg_index.h>
+#include <catalog/pg_type.h>
+#include <commands/cluster.h>
+#include <commands/vacuum.h>
+#include <miscadmin.h>
+#include <storage/bufmgr.h>
+#include <storage/predicate.h>
+#include <utils/array.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <utils/syscache.h>
+#include <utils/tuplesort.h>
+
+#include "errors.h"
+#include "guc.h"
+
+/*
+ * Reordering of chunks.
+ *
+ * CLUSTER rewrites a table in index order while holding an exclusive lock
+ * that blocks reads for the whole rewrite. A chunk is instead reordered in
+ * steps (see reorder_chunk() in sql/main/reorder.sql):
+ *
+ * 1. With the chunk locked against writes, its rows are sorted by the index
+ *    and copied into a new heap with the same columns (reorder_chunk_copy()).
+ * 2. The chunk's indexes are created on the new heap.
+ * 3. With the chunk locked exclusively, the storage of the chunk, its TOAST
+ *    table and its indexes is swapped with that of the new heap and its
+ *    indexes (reorder_chunk_swap()). The new heap, now holding the old
+ *    storage, is dropped.
+ *
+ * Reads of the chunk only wait for the swap, which does not touch any data.
+ * Like other table rewrites, the reordered rows are not visible to
+ * transactions with a snapshot taken before the reorder.
+ *
+ * Chunks are moved to another tablespace the same way (see move_chunk() in
+ * sql/main/tablespace.sql), with the new heap and indexes created in the
+ * other tablespace and the rows copied in their current order.
+ *
+ * Chunks are sealed (see seal_chunk() in sql/main/seal.sql) by copying their
+ * rows frozen, like COPY FREEZE into a table created in the same transaction,
+ * and marking all pages of the new heap all-visible and all-frozen in the
+ * visibility map. VACUUM then skips the pages of the chunk, even when it has
+ * to freeze old rows to prevent transaction ID wraparound. The copy is
+ * throttled by the cost-based delay of timescaledb.seal_cost_delay.
+ */
+
+/* Insert a copy of a row of the chunk into the new heap */
+static void
+reorder_copy_tuple(Relation new_rel, TupleDesc desc, HeapTuple tuple, Datum *values,
+				   bool *isnull, CommandId cid, int options, BulkInsertState bistate)
+{
+	HeapTuple	copy;
+	int			i;
+
+	/* Values of dropped columns are not copied */
+	heap_deform_tuple(tuple, desc, values, isnull);
+
+	for (i = 0; i < desc->natts; i++)
+	{
+		if (desc->attrs[i]->attisdropped)
+			isnull[i] = true;
+	}
+
+	copy = heap_form_tuple(desc, values, isnull);
+	heap_insert(new_rel, copy, cid, options, bistate);
+	heap_freetuple(copy);
+
+	vacuum_delay_point();
+}
+
+/*
+ * Mark all pages of a heap with frozen rows all-visible and all-frozen. The
+ * heap must have been created in the current transaction.
+ */
+static void
+reorder_set_all_frozen(Relation rel)
+{
+	BlockNumber nblocks = RelationGetNumberOfBlocks(rel);
+	BlockNumber blkno;
+	Buffer		vmbuffer = InvalidBuffer;
+
+	for (blkno = 0; blkno < nblocks; blkno++)
+	{
+		Buffer		buffer;
+		Page		page;
+
+		CHECK_FOR_INTERRUPTS();
+		vacuum_delay_point();
+
+		buffer = ReadBuffer(rel, blkno);
+		visibilitymap_pin(rel, blkno, &vmbuffer);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		if (!PageIsNew(page) && !PageIsAllVisible(page))
+		{
+			PageSetAllVisible(page);
+			MarkBufferDirty(buffer);
+
+			/* Frozen rows need no cutoff for conflicts on standbys */
+			visibilitymap_set(rel, blkno, buffer, InvalidXLogRecPtr, vmbuffer,
+							  InvalidTransactionId,
+							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+		}
+
+		UnlockReleaseBuffer(buffer);
+	}
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+}
+
+/*
+ * Copy the rows of a chunk into the new heap, sorted by the index if it is
+ * not NULL.
+ */
+static void
+reorder_copy_rows(Relation rel, Relation new_rel, Relation index_rel, int options)
+{
+	TupleDesc	desc = RelationGetDescr(rel);
+	Datum	   *values = palloc(sizeof(Datum) * desc->natts);
+	bool	   *isnull = palloc(sizeof(bool) * desc->natts);
+	BulkInsertState bistate = GetBulkInsertState();
+	CommandId	cid = GetCurrentCommandId(true);
+	Tuplesortstate *sort = NULL;
+	Snapshot	snapshot;
+	HeapScanDesc scan;
+	HeapTuple	tuple;
+	bool		should_free;
+
+	if (index_rel != NULL)
+		sort = tuplesort_begin_cluster(desc, index_rel, maintenance_work_mem, false);
+
+	/* The chunk is locked against writes, so read all committed rows */
+	snapshot = RegisterSnapshot(GetLatestSnapshot());
+	scan = heap_beginscan(rel, snapshot, 0, NULL);
+
+	while ((tuple = heap_getnext(scan, ForwardScanDirection)) != NULL)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (sort != NULL)
+			tuplesort_putheaptuple(sort, tuple);
+		else
+			reorder_copy_tuple(new_rel, desc, tuple, values, isnull, cid, options, bistate);
+	}
+
+	heap_endscan(scan);
+	UnregisterSnapshot(snapshot);
+
+	if (sort != NULL)
+	{
+		tuplesort_performsort(sort);
+
+		while ((tuple = tuplesort_getheaptuple(sort, true, &should_free)) != NULL)
+		{
+			CHECK_FOR_INTERRUPTS();
+			reorder_copy_tuple(new_rel, desc, tuple, values, isnull, cid, options, bistate);
+
+			if (should_free)
+				heap_freetuple(tuple);
+		}
+
+		tuplesort_end(sort);
+	}
+
+	FreeBulkInsertState(bistate);
+}
+
+PG_FUNCTION_INFO_V1(reorder_chunk_copy);
+
+/*
+ * Copy the rows of a chunk (arg 0) into a new heap in the order of an index
+ * on the chunk (arg 1), or in their current order if the index is NULL. The
+ * new heap is created in the chunk's schema and in the given tablespace (arg
+ * 2), or the chunk's tablespace if that is NULL. If arg 3 is true, the rows
+ * are copied frozen (see above). The chunk must be locked against writes by
+ * the caller. Returns the new heap.
+ */
+Datum
+reorder_chunk_copy(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	Relation	rel = heap_open(relid, ExclusiveLock);
+	Relation	index_rel = NULL;
+	Oid			tablespace = rel->rd_rel->reltablespace;
+	bool		freeze = !PG_ARGISNULL(3) && PG_GETARG_BOOL(3);
+	int			options = HEAP_INSERT_SKIP_FSM;
+	int			save_cost_delay = VacuumCostDelay;
+	Oid			new_relid;
+	Relation	new_rel;
+
+	if (!PG_ARGISNULL(1))
+	{
+		index_rel = index_open(PG_GETARG_OID(1), AccessShareLock);
+
+		if (index_rel->rd_index->indrelid != relid)
+			elog(ERROR, "index \"%s\" is not an index on chunk \"%s\"",
+				 RelationGetRelationName(index_rel), RelationGetRelationName(rel));
+
+		if (index_rel->rd_rel->relam != BTREE_AM_OID || !IndexIsValid(index_rel->rd_index))
+			ereport(ERROR,
+					(errcode(ERRCODE_IO_OPERATION_NOT_SUPPORTED),
+					 errmsg("cannot reorder chunk \"%s\" by index \"%s\"",
+						RelationGetRelationName(rel), RelationGetRelationName(index_rel)),
+					 errhint("Chunks can only be reordered by valid btree indexes.")));
+	}
+
+	if (!PG_ARGISNULL(2))
+		tablespace = PG_GETARG_OID(2);
+
+	new_relid = make_new_heap(relid, tablespace, rel->rd_rel->relpersistence, ExclusiveLock);
+	new_rel = heap_open(new_relid, AccessExclusiveLock);
+
+	/*
+	 * TOAST pointers of the copied rows refer to the chunk's TOAST table,
+	 * which gets the storage of the new heap's TOAST table in the swap.
+	 */
+	new_rel->rd_toastoid = rel->rd_rel->reltoastrelid;
+
+	if (freeze)
+	{
+		options |= HEAP_INSERT_FROZEN;
+		VacuumCostDelay = guc_seal_cost_delay;
+		VacuumCostActive = (VacuumCostDelay > 0);
+		VacuumCostBalance = 0;
+	}
+
+	PG_TRY();
+	{
+		reorder_copy_rows(rel, new_rel, index_rel, options);
+
+		if (freeze)
+		{
+			reorder_set_all_frozen(new_rel);
+
+			if (OidIsValid(new_rel->rd_rel->reltoastrelid))
+			{
+				Relation	toast_rel = heap_open(new_rel->rd_rel->reltoastrelid,
+												  AccessExclusiveLock);
+
+				reorder_set_all_frozen(toast_rel);
+				heap_close(toast_rel, NoLock);
+			}
+		}
+	}
+	PG_CATCH();
+	{
+		VacuumCostActive = false;
+		VacuumCostDelay = save_cost_delay;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	VacuumCostActive = false;
+	VacuumCostDelay = save_cost_delay;
+
+	new_rel->rd_toastoid = InvalidOid;
+
+	heap_close(new_rel, NoLock);
+	if (index_rel != NULL)
+		index_close(index_rel, NoLock);
+	heap_close(rel, NoLock);
+
+	PG_RETURN_OID(new_relid);
+}
+
+/*
+ * Swap the storage of two relations in pg_class, including the tablespaces
+ * that the storage is in.
+ */
+static void
+reorder_swap_relfilenodes(Relation class_rel, Oid relid1, Oid relid2)
+{
+	HeapTuple	tuple1 = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(relid1));
+	HeapTuple	tuple2 = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(relid2));
+	Form_pg_class form1;
+	Form_pg_class form2;
+	FormData_pg_class tmp;
+
+	if (!HeapTupleIsValid(tuple1) || !HeapTupleIsValid(tuple2))
+		elog(ERROR, "cache lookup failed for relation %u or %u", relid1, relid2);
+
+	form1 = (Form_pg_class) GETSTRUCT(tuple1);
+	form2 = (Form_pg_class) GETSTRUCT(tuple2);
+
+	if (form1->relfilenode == InvalidOid || form2->relfilenode == InvalidOid)
+		elog(ERROR, "cannot swap the storage of relations %u and %u", relid1, relid2);
+
+	memcpy(&tmp, form1, sizeof(FormData_pg_class));
+
+	form1->relfilenode = form2->relfilenode;
+	form1->reltablespace = form2->reltablespace;
+	form1->relpages = form2->relpages;
+	form1->reltuples = form2->reltuples;
+	form1->relallvisible = form2->relallvisible;
+	form1->relfrozenxid = form2->relfrozenxid;
+	form1->relminmxid = form2->relminmxid;
+
+	form2->relfilenode = tmp.relfilenode;
+	form2->reltablespace = tmp.reltablespace;
+	form2->relpages = tmp.relpages;
+	form2->reltuples = tmp.reltuples;
+	form2->relallvisible = tmp.relallvisible;
+	form2->relfrozenxid = tmp.relfrozenxid;
+	form2->relminmxid = tmp.relminmxid;
+
+	simple_heap_update(class_rel, &tuple1->t_self, tuple1);
+	CatalogUpdateIndexes(class_rel, tuple1);
+	simple_heap_update(class_rel, &tuple2->t_self, tuple2);
+	CatalogUpdateIndexes(class_rel, tuple2);
+
+	heap_freetuple(tuple1);
+	heap_freetuple(tuple2);
+}
+
+/* Get the index of a TOAST table */
+static Oid
+reorder_toast_index(Oid toast_relid)
+{
+	Relation	toast_rel = heap_open(toast_relid, AccessExclusiveLock);
+	List	   *indexes = RelationGetIndexList(toast_rel);
+	Oid			index_relid;
+
+	if (list_length(indexes) != 1)
+		elog(ERROR, "TOAST table \"%s\" does not have exactly one index",
+			 RelationGetRelationName(toast_rel));
+
+	index_relid = linitial_oid(indexes);
+	list_free(indexes);
+	heap_close(toast_rel, NoLock);
+
+	return index_relid;
+}
+
+PG_FUNCTION_INFO_V1(reorder_chunk_swap);
+
+/*
+ * Swap the storage of a chunk (arg 0) and its TOAST table with that of the
+ * heap created by reorder_chunk_copy() (arg 1), along with the storage of
+ * each of the chunk's indexes (arg 2) with that of the index at the same
+ * position in arg 3, which are on the new heap. Marks the index the chunk
+ * was reordered by (arg 4) as clustered.
+ */
+Datum
+reorder_chunk_swap(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	Oid			new_relid = PG_GETARG_OID(1);
+	ArrayType  *indexes = PG_GETARG_ARRAYTYPE_P(2);
+	ArrayType  *new_indexes = PG_GETARG_ARRAYTYPE_P(3);
+	Relation	rel = heap_open(relid, AccessExclusiveLock);
+	Relation	new_rel = heap_open(new_relid, AccessExclusiveLock);
+	Oid			toast_relid = rel->rd_rel->reltoastrelid;
+	Oid			new_toast_relid = new_rel->rd_rel->reltoastrelid;
+	Relation	class_rel;
+	Datum	   *index_datums;
+	Datum	   *new_index_datums;
+	int			num_indexes;
+	int			num_new_indexes;
+	int			i;
+
+	deconstruct_array(indexes, REGCLASSOID, sizeof(Oid), true, 'i',
+					  &index_datums, NULL, &num_indexes);
+	deconstruct_array(new_indexes, REGCLASSOID, sizeof(Oid), true, 'i',
+					  &new_index_datums, NULL, &num_new_indexes);
+
+	if (num_indexes != num_new_indexes ||
+		num_indexes != list_length(RelationGetIndexList(rel)))
+		elog(ERROR, "the indexes of chunk \"%s\" do not match the indexes of its copy",
+			 RelationGetRelationName(rel));
+
+	if (OidIsValid(toast_relid) != OidIsValid(new_toast_relid))
+		elog(ERROR, "the TOAST table of chunk \"%s\" does not match that of its copy",
+			 RelationGetRelationName(rel));
+
+	/* Serializable transactions that read the chunk now conflict on the table */
+	TransferPredicateLocksToHeapRelation(rel);
+
+	class_rel = heap_open(RelationRelationId, RowExclusiveLock);
+
+	reorder_swap_relfilenodes(class_rel, relid, new_relid);
+
+	if (OidIsValid(toast_relid))
+	{
+		reorder_swap_relfilenodes(class_rel, toast_relid, new_toast_relid);
+		reorder_swap_relfilenodes(class_rel, reorder_toast_index(toast_relid),
+								  reorder_toast_index(new_toast_relid));
+	}
+
+	for (i = 0; i < num_indexes; i++)
+	{
+		Oid			index_relid = DatumGetObjectId(index_datums[i]);
+		Oid			new_index_relid = DatumGetObjectId(new_index_datums[i]);
+
+		if (IndexGetRelation(index_relid, false) != relid ||
+			IndexGetRelation(new_index_relid, false) != new_relid)
+			elog(ERROR, "index %u or %u is not an index of the chunk or its copy",
+				 index_relid, new_index_relid);
+
+		reorder_swap_relfilenodes(class_rel, index_relid, new_index_relid);
+	}
+
+	heap_close(class_rel, RowExclusiveLock);
+
+	CommandCounterIncrement();
+
+	if (!PG_ARGISNULL(4))
+		mark_index_clustered(rel, PG_GETARG_OID(4), true);
+
+	heap_close(new_rel, NoLock);
+	heap_close(rel, NoLock);
+
+	PG_RETURN_VOID();
+}
@@ -3,11 +3,109 @@
 #include <access/xact.h>
 #include <storage/lmgr.h>
 #include <storage/bufmgr.h>
+#include <utils/array.h>
+#include <utils/lsyscache.h>
 #include <utils/rel.h>
 #include <utils/tqual.h>
 
 #include "scanner.h"
 
+/*
+ * Catalog relations kept open across scans.
+ *
+ * Every scan opens the scanned table and index and closes them again, which
+ * takes a relcache lookup and a lock manager round trip for each relation.
+ * Between scanner_keep_open_begin() and scanner_keep_open_end(), e.g., for
+ * the duration of an insert statement, relations stay open and locked after a
+ * scan, so that later scans of the same relations reuse them.
+ */
+#define SCANNER_MAX_OPEN_RELATIONS 16
+
+typedef struct OpenRelation
+{
+	Oid			relid;
+	LOCKMODE	lockmode;
+	bool		is_index;
+	Relation	rel;
+	SubTransactionId subid;
+} OpenRelation;
+
+static OpenRelation open_relations[SCANNER_MAX_OPEN_RELATIONS];
+static int	num_open_relations = 0;
+static int	keep_open_level = 0;
+
+static Relation
+scanner_relation_open(Oid relid, LOCKMODE lockmode, bool is_index)
+{
+	OpenRelation *open;
+	int			i;
+
+	for (i = 0; i < num_open_relations; i++)
+	{
+		if (open_relations[i].relid == relid &&
+			open_relations[i].lockmode == lockmode)
+			return open_relations[i].rel;
+	}
+
+	if (keep_open_level == 0 || num_open_relations >= SCANNER_MAX_OPEN_RELATIONS)
+		return is_index ? index_open(relid, lockmode) : heap_open(relid, lockmode);
+
+	open = &open_relations[num_open_relations++];
+	open->relid = relid;
+	open->lockmode = lockmode;
+	open->is_index = is_index;
+	open->rel = is_index ? index_open(relid, lockmode) : heap_open(relid, lockmode);
+	open->subid = GetCurrentSubTransactionId();
+
+	return open->rel;
+}
+
+static void
+scanner_relation_close(Relation rel, LOCKMODE lockmode, bool is_index)
+{
+	int			i;
+
+	for (i = 0; i < num_open_relations; i++)
+	{
+		if (open_relations[i].rel == rel)
+			return;
+	}
+
+	if (is_index)
+		index_close(rel, lockmode);
+	else
+		heap_close(rel, lockmode);
+}
+
+static void
+scanner_close_all(void)
+{
+	while (num_open_relations > 0)
+	{
+		OpenRelation *open = &open_relations[--num_open_relations];
+
+		if (open->is_index)
+			index_close(open->rel, open->lockmode);
+		else
+			heap_close(open->rel, open->lockmode);
+	}
+}
+
+void
+scanner_keep_open_begin(void)
+{
+	keep_open_level++;
+}
+
+void
+scanner_keep_open_end(void)
+{
+	Assert(keep_open_level > 0);
+
+	if (--keep_open_level == 0)
+		scanner_close_all();
+}
+
 typedef union ScanDesc
 {
 	IndexScanDesc index_scan;
@@ -40,11 +138,17 @@ typedef struct Scanner
 	void		(*close) (InternalScannerCtx *ctx);
 } Scanner;
 
+static Snapshot
+scanner_snapshot(ScannerCtx *sctx)
+{
+	return sctx->snapshot != NULL ? sctx->snapshot : SnapshotSelf;
+}
+
 /* Functions implementing heap scans */
 static Relation
 heap_scanner_open(InternalScannerCtx *ctx)
 {
-	ctx->tablerel = heap_open(ctx->sctx->table, ctx->sctx->lockmode);
+	ctx->tablerel = scanner_relation_open(ctx->sctx->table, ctx->sctx->lockmode, false);
 	return ctx->tablerel;
 }
 
@@ -53,7 +157,7 @@ heap_scanner_beginscan(InternalScannerCtx *ctx)
 {
 	ScannerCtx *sctx = ctx->sctx;
 
-	ctx->scan.heap_scan = heap_beginscan(ctx->tablerel, SnapshotSelf,
+	ctx->scan.heap_scan = heap_beginscan(ctx->tablerel, scanner_snapshot(sctx),
 										 sctx->nkeys, sctx->scankey);
 	return ctx->scan;
 }
@@ -74,15 +178,15 @@ heap_scanner_endscan(InternalScannerCtx *ctx)
 static void
 heap_scanner_close(InternalScannerCtx *ctx)
 {
-	heap_close(ctx->tablerel, ctx->sctx->lockmode);
+	scanner_relation_close(ctx->tablerel, ctx->sctx->lockmode, false);
 }
 
 /* Functions implementing index scans */
 static Relation
 index_scanner_open(InternalScannerCtx *ctx)
 {
-	ctx->tablerel = heap_open(ctx->sctx->table, ctx->sctx->lockmode);
-	ctx->indexrel = index_open(ctx->sctx->index, ctx->sctx->lockmode);
+	ctx->tablerel = scanner_relation_open(ctx->sctx->table, ctx->sctx->lockmode, false);
+	ctx->indexrel = scanner_relation_open(ctx->sctx->index, ctx->sctx->lockmode, true);
 	return ctx->indexrel;
 }
 
@@ -92,7 +196,7 @@ index_scanner_beginscan(InternalScannerCtx *ctx)
 	ScannerCtx *sctx = ctx->sctx;
 
 	ctx->scan.index_scan = index_beginscan(ctx->tablerel, ctx->indexrel,
-										   SnapshotSelf, sctx->nkeys,
+										   scanner_snapshot(sctx), sctx->nkeys,
 										   sctx->norderbys);
 	ctx->scan.index_scan->xs_want_itup = ctx->sctx->want_itup;
 	index_rescan(ctx->scan.index_scan, sctx->scankey,
@@ -118,8 +222,8 @@ index_scanner_endscan(InternalScannerCtx *ctx)
 static void
 index_scanner_close(InternalScannerCtx *ctx)
 {
-	heap_close(ctx->tablerel, ctx->sctx->lockmode);
-	index_close(ctx->indexrel, ctx->sctx->lockmode);
+	scanner_relation_close(ctx->tablerel, ctx->sctx->lockmode, false);
+	scanner_relation_close(ctx->indexrel, ctx->sctx->lockmode, true);
 }
 
 /*
@@ -216,3 +320,77 @@ scanner_scan(ScannerCtx *ctx)
 
 	return num_tuples;
 }
+
+/*
+ * Initialize a scan key that matches any of the given values, like a
+ * ScalarArrayOpExpr in a query, e.g., to look up many IDs with a single index
+ * scan. Only works with index scans.
+ */
+void
+scanner_scankey_init_array(ScanKey key, AttrNumber attno, StrategyNumber strategy,
+						   RegProcedure procedure, Oid elemtype,
+						   Datum *values, int num_values)
+{
+	int16		typlen;
+	bool		typbyval;
+	char		typalign;
+	ArrayType  *array;
+
+	get_typlenbyvalalign(elemtype, &typlen, &typbyval, &typalign);
+	array = construct_array(values, num_values, elemtype, typlen, typbyval, typalign);
+
+	ScanKeyEntryInitialize(key, SK_SEARCHARRAY, attno, strategy, InvalidOid,
+						   InvalidOid, procedure, PointerGetDatum(array));
+}
+
+static void
+scanner_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+			scanner_close_all();
+			keep_open_level = 0;
+			break;
+		case XACT_EVENT_ABORT:
+			/* The resource owner releases the relations */
+			num_open_relations = 0;
+			keep_open_level = 0;
+			break;
+		default:
+			break;
+	}
+}
+
+static void
+scanner_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						 SubTransactionId parentSubid, void *arg)
+{
+	int			i = 0;
+
+	if (event != SUBXACT_EVENT_ABORT_SUB)
+		return;
+
+	/* Forget the relations that the subtransaction's resource owner releases */
+	while (i < num_open_relations)
+	{
+		if (open_relations[i].subid == mySubid)
+			open_relations[i] = open_relations[--num_open_relations];
+		else
+			i++;
+	}
+}
+
+void
+_scanner_init(void)
+{
+	RegisterXactCallback(scanner_xact_callback, NULL);
+	RegisterSubXactCallback(scanner_subxact_callback, NULL);
+}
+
+void
+_scanner_fini(void)
+{
+	UnregisterXactCallback(scanner_xact_callback, NULL);
+	UnregisterSubXactCallback(scanner_subxact_callback, NULL);
+}
@@ -47,6 +47,8 @@ typedef struct ScannerCtx
 		bool		enabled;
 	}			tuplock;
 	ScanDirection scandirection;
+	Snapshot	snapshot;		/* Snapshot to scan with, or NULL for
+								 * SnapshotSelf */
 	void	   *data;			/* User-provided data passed on to filter()
 								 * and tuple_found() */
 
@@ -79,4 +81,15 @@ typedef struct ScannerCtx
  * tuples. */
 int			scanner_scan(ScannerCtx *ctx);
 
+void		scanner_scankey_init_array(ScanKey key, AttrNumber attno, StrategyNumber strategy,
+						   RegProcedure procedure, Oid elemtype,
+						   Datum *values, int num_values);
+
+/* Keep scanned relations open until the matching call to end */
+void		scanner_keep_open_begin(void);
+void		scanner_keep_open_end(void);
+
+void		_scanner_init(void);
+void		_scanner_fini(void);
+
 #endif   /* TIMESCALEDB_SCANNER_H */
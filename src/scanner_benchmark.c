@@ -0,0 +1,117 @@
+#include <postgres.h>
+#include <catalog/pg_type.h>
+#include <fmgr.h>
+#include <portability/instr_time.h>
+#include <utils/builtins.h>
+
+#include "catalog.h"
+#include "scanner.h"
+
+/*
+ * Micro-benchmark of catalog lookups through the scanner.
+ *
+ * Looks up the replicas of the existing chunks by chunk ID, the same lookup
+ * that a chunk cache miss does, and returns the average time per lookup in
+ * microseconds. The mode is one of:
+ *
+ * single    - one scan per lookup that opens and closes the catalog relations
+ * keep_open - one scan per lookup with the relations kept open
+ * batch     - one scan per batch of lookups, using an array scan key
+ */
+
+#define BENCHMARK_MAX_CHUNKS 1000
+#define BENCHMARK_BATCH_SIZE 64
+
+static bool
+benchmark_tuple_found(TupleInfo *ti, void *data)
+{
+	return true;
+}
+
+static bool
+benchmark_collect_tuple_found(TupleInfo *ti, void *data)
+{
+	List	  **chunk_ids = data;
+	bool		is_null;
+	Datum		chunk_id = heap_getattr(ti->tuple, Anum_chunk_replica_node_id, ti->desc, &is_null);
+
+	*chunk_ids = lappend_int(*chunk_ids, DatumGetInt32(chunk_id));
+
+	return list_length(*chunk_ids) < BENCHMARK_MAX_CHUNKS;
+}
+
+PG_FUNCTION_INFO_V1(scanner_benchmark);
+
+Datum
+scanner_benchmark(PG_FUNCTION_ARGS)
+{
+	int32		iterations = PG_GETARG_INT32(0);
+	char	   *mode = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	Catalog    *catalog = catalog_get();
+	List	   *chunk_ids = NIL;
+	ScanKeyData scankey[1];
+	ScannerCtx	ctx = {
+		.table = catalog->tables[CHUNK_REPLICA_NODE].id,
+		.scantype = ScannerTypeHeap,
+		.data = &chunk_ids,
+		.tuple_found = benchmark_collect_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+	};
+	Datum		batch[BENCHMARK_BATCH_SIZE];
+	bool		keep_open = strcmp(mode, "keep_open") == 0;
+	bool		batched = strcmp(mode, "batch") == 0;
+	instr_time	start,
+				duration;
+	int			i;
+
+	if (!keep_open && !batched && strcmp(mode, "single") != 0)
+		elog(ERROR, "Unknown benchmark mode \"%s\"", mode);
+
+	scanner_scan(&ctx);
+
+	if (chunk_ids == NIL || iterations <= 0)
+		PG_RETURN_NULL();
+
+	ctx.index = catalog->tables[CHUNK_REPLICA_NODE].index_ids[CHUNK_REPLICA_NODE_ID_INDEX];
+	ctx.scantype = ScannerTypeIndex;
+	ctx.nkeys = 1;
+	ctx.scankey = scankey;
+	ctx.data = NULL;
+	ctx.tuple_found = benchmark_tuple_found;
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	if (keep_open)
+		scanner_keep_open_begin();
+
+	for (i = 0; i < iterations; i++)
+	{
+		int32		chunk_id = list_nth_int(chunk_ids, i % list_length(chunk_ids));
+
+		if (batched)
+		{
+			batch[i % BENCHMARK_BATCH_SIZE] = Int32GetDatum(chunk_id);
+
+			if ((i + 1) % BENCHMARK_BATCH_SIZE != 0 && i + 1 < iterations)
+				continue;
+
+			scanner_scankey_init_array(&scankey[0], Anum_chunk_replica_node_pkey_idx_chunk_id,
+									   BTEqualStrategyNumber, F_INT4EQ, INT4OID,
+									   batch, i % BENCHMARK_BATCH_SIZE + 1);
+		}
+		else
+			ScanKeyInit(&scankey[0], Anum_chunk_replica_node_pkey_idx_chunk_id,
+						BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(chunk_id));
+
+		scanner_scan(&ctx);
+	}
+
+	if (keep_open)
+		scanner_keep_open_end();
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	PG_RETURN_FLOAT8(INSTR_TIME_GET_MICROSEC(duration) / iterations);
+}
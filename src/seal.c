@@ -0,0 +1,57 @@
+#include <postgres.h>
+#include <nodes/relation.h>
+#include <optimizer/pathnode.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+
+#include "chunk_cache.h"
+#include "errors.h"
+#include "seal.h"
+
+/*
+ * Sealed chunks.
+ *
+ * A sealed chunk has its rows frozen when it is sealed (see seal_chunk() in
+ * sql/main/seal.sql), so that VACUUM skips its pages instead of freezing
+ * them, and anti-wraparound vacuums have nothing to do for it. To keep it
+ * that way, inserts, updates and deletes of the chunk through its hypertable
+ * fail. Rows written to chunk tables directly are not checked.
+ */
+
+extern void seal_check_modified(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte);
+
+/*
+ * Fail an insert into a sealed chunk. The chunk must be locked, so that
+ * inserts that waited for the chunk to be sealed see the seal.
+ */
+void
+seal_check_insert(Relation rel)
+{
+	if (chunk_cache_is_sealed(RelationGetRelid(rel)))
+		ereport(ERROR,
+				(errcode(ERRCODE_IO_CHUNK_SEALED),
+				 errmsg("cannot insert into sealed chunk \"%s\"",
+						RelationGetRelationName(rel)),
+				 errhint("Unseal the chunk with unseal_chunk() to write to it.")));
+}
+
+/*
+ * Fail an UPDATE or DELETE that modifies a sealed chunk. Called when planning
+ * the chunk as the result relation, so chunks that constraints or zone maps
+ * exclude, and that the statement therefore does not modify, pass.
+ */
+void
+seal_check_modified(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	if ((root->parse->commandType != CMD_UPDATE && root->parse->commandType != CMD_DELETE) ||
+		rte->rtekind != RTE_RELATION || IS_DUMMY_REL(rel) ||
+		!chunk_cache_is_sealed(rte->relid))
+		return;
+
+	ereport(ERROR,
+			(errcode(ERRCODE_IO_CHUNK_SEALED),
+			 errmsg("cannot %s sealed chunk \"%s\"",
+					root->parse->commandType == CMD_DELETE ? "delete from" : "update",
+					get_rel_name(rte->relid)),
+			 errhint("Unseal the chunk with unseal_chunk() to write to it.")));
+}
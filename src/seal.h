@@ -0,0 +1,9 @@
+#ifndef TIMESCALEDB_SEAL_H
+#define TIMESCALEDB_SEAL_H
+
+#include <postgres.h>
+#include <utils/relcache.h>
+
+extern void seal_check_insert(Relation rel);
+
+#endif   /* TIMESCALEDB_SEAL_H */
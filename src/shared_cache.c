@@ -0,0 +1,334 @@
+#include <postgres.h>
+#include <access/hash.h>
+#include <access/xact.h>
+#include <miscadmin.h>
+#include <port/atomics.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <storage/spin.h>
+
+#include "shared_cache.h"
+#include "guc.h"
+
+/*
+ * Shared metadata cache.
+ *
+ * The hypertable and chunk caches are local to each backend, so every new
+ * backend has to fill them with catalog scans. The shared cache keeps copies
+ * of fixed-size cache entries in shared memory, so that a backend can fill its
+ * local caches from entries that other backends have already looked up. The
+ * local caches remain the primary caches and look up the shared cache on a
+ * miss, before scanning the catalog.
+ *
+ * The cache is an open-addressing hash table of fixed-size slots, with the
+ * number of slots set by timescaledb.shared_cache_entries. The memory is only
+ * available when the extension is in shared_preload_libraries.
+ *
+ * Readers do not take locks. Each slot has a version counter that is odd while
+ * the slot is being written. A reader copies the entry and retries the next
+ * slot if the version changed in the meantime. Writers serialize on a
+ * spinlock.
+ *
+ * Each cache type has a generation number, and an entry is only valid if it
+ * was written under the current generation of its type. A backend that
+ * modifies the catalog increments the generation when its transaction ends,
+ * which invalidates all entries of the type in all databases. Entries are
+ * tagged with the generation read before the catalog scan that produced them,
+ * so entries produced by scans that raced with a catalog change are never
+ * valid. A backend with pending catalog changes does not use the shared cache,
+ * since it sees its own uncommitted changes.
+ */
+
+/* Number of slots to probe on lookup and insert */
+#define SHARED_CACHE_PROBES 8
+
+typedef struct SharedCacheKey
+{
+	Oid			dbid;
+	Oid			relid;
+	int32		type;
+} SharedCacheKey;
+
+typedef struct SharedCacheSlot
+{
+	pg_atomic_uint32 version;
+	uint32		generation;
+	SharedCacheKey key;
+	Size		size;
+	char		data[SHARED_CACHE_MAX_DATA_SIZE];
+} SharedCacheSlot;
+
+typedef struct SharedCacheControl
+{
+	slock_t		mutex;
+	pg_atomic_uint32 generations[_MAX_CACHE_TYPES];
+	int			num_slots;
+	SharedCacheSlot slots[FLEXIBLE_ARRAY_MEMBER];
+} SharedCacheControl;
+
+static SharedCacheControl *shared_cache = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+/* Cache types that the current transaction has modified the catalog for */
+static bool pending_invalidations[_MAX_CACHE_TYPES];
+
+static Size
+shared_cache_shmem_size(void)
+{
+	return add_size(offsetof(SharedCacheControl, slots),
+					mul_size(guc_shared_cache_entries, sizeof(SharedCacheSlot)));
+}
+
+static void
+shared_cache_shmem_startup(void)
+{
+	bool		found;
+	int			i;
+
+	if (prev_shmem_startup_hook != NULL)
+		prev_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	shared_cache = ShmemInitStruct("timescaledb shared cache",
+								   shared_cache_shmem_size(), &found);
+
+	if (!found)
+	{
+		SpinLockInit(&shared_cache->mutex);
+
+		/* Generation 0 marks empty slots, so start at 1 */
+		for (i = 0; i < _MAX_CACHE_TYPES; i++)
+			pg_atomic_init_u32(&shared_cache->generations[i], 1);
+
+		shared_cache->num_slots = guc_shared_cache_entries;
+
+		for (i = 0; i < shared_cache->num_slots; i++)
+		{
+			SharedCacheSlot *slot = &shared_cache->slots[i];
+
+			pg_atomic_init_u32(&slot->version, 0);
+			slot->generation = 0;
+			memset(&slot->key, 0, sizeof(SharedCacheKey));
+			slot->size = 0;
+		}
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+bool
+shared_cache_enabled(void)
+{
+	return shared_cache != NULL && shared_cache->num_slots > 0;
+}
+
+/*
+ * Get the current generation of a cache type. Callers read the generation
+ * before scanning the catalog and pass it to shared_cache_insert().
+ */
+uint32
+shared_cache_generation(CacheType type)
+{
+	if (!shared_cache_enabled())
+		return 0;
+
+	return pg_atomic_read_u32(&shared_cache->generations[type]);
+}
+
+static void
+shared_cache_key_init(SharedCacheKey *key, CacheType type, Oid relid)
+{
+	memset(key, 0, sizeof(SharedCacheKey));
+	key->dbid = MyDatabaseId;
+	key->relid = relid;
+	key->type = type;
+}
+
+static SharedCacheSlot *
+shared_cache_slot(uint32 hash, int probe)
+{
+	return &shared_cache->slots[(hash + probe) % shared_cache->num_slots];
+}
+
+/*
+ * Look up an entry in the shared cache and copy its data. Returns false if
+ * there is no valid entry.
+ */
+bool
+shared_cache_lookup(CacheType type, Oid relid, void *data, Size size)
+{
+	SharedCacheKey key;
+	uint32		hash;
+	uint32		generation;
+	int			i;
+
+	if (!shared_cache_enabled() || pending_invalidations[type])
+		return false;
+
+	shared_cache_key_init(&key, type, relid);
+	hash = DatumGetUInt32(hash_any((unsigned char *) &key, sizeof(SharedCacheKey)));
+	generation = pg_atomic_read_u32(&shared_cache->generations[type]);
+
+	for (i = 0; i < SHARED_CACHE_PROBES; i++)
+	{
+		SharedCacheSlot *slot = shared_cache_slot(hash, i);
+		uint32		version = pg_atomic_read_u32(&slot->version);
+
+		/* Slot is being written */
+		if (version & 1)
+			continue;
+
+		pg_read_barrier();
+
+		if (slot->generation != generation ||
+			slot->size != size ||
+			memcmp(&slot->key, &key, sizeof(SharedCacheKey)) != 0)
+			continue;
+
+		memcpy(data, slot->data, size);
+
+		pg_read_barrier();
+
+		if (pg_atomic_read_u32(&slot->version) == version)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Add an entry to the shared cache, replacing any existing entry for the same
+ * key. If all probed slots hold valid entries, the first one is evicted.
+ */
+void
+shared_cache_insert(CacheType type, Oid relid, uint32 generation,
+					const void *data, Size size)
+{
+	SharedCacheKey key;
+	SharedCacheSlot *victim = NULL;
+	uint32		hash;
+	int			i;
+
+	Assert(size <= SHARED_CACHE_MAX_DATA_SIZE);
+
+	if (!shared_cache_enabled() || pending_invalidations[type])
+		return;
+
+	shared_cache_key_init(&key, type, relid);
+	hash = DatumGetUInt32(hash_any((unsigned char *) &key, sizeof(SharedCacheKey)));
+
+	SpinLockAcquire(&shared_cache->mutex);
+
+	for (i = 0; i < SHARED_CACHE_PROBES; i++)
+	{
+		SharedCacheSlot *slot = shared_cache_slot(hash, i);
+
+		if (memcmp(&slot->key, &key, sizeof(SharedCacheKey)) == 0)
+		{
+			victim = slot;
+			break;
+		}
+
+		/* Empty or invalidated slot */
+		if (victim == NULL &&
+			slot->generation != pg_atomic_read_u32(&shared_cache->generations[slot->key.type]))
+			victim = slot;
+	}
+
+	if (victim == NULL)
+		victim = shared_cache_slot(hash, 0);
+
+	pg_atomic_fetch_add_u32(&victim->version, 1);
+
+	victim->generation = generation;
+	victim->key = key;
+	victim->size = size;
+	memcpy(victim->data, data, size);
+
+	pg_write_barrier();
+	pg_atomic_fetch_add_u32(&victim->version, 1);
+
+	SpinLockRelease(&shared_cache->mutex);
+}
+
+/*
+ * Invalidate the shared entries of a cache type when the current transaction
+ * ends. Until then, the backend does not use the shared cache for the type.
+ */
+void
+shared_cache_invalidate_at_commit(CacheType type)
+{
+	pending_invalidations[type] = true;
+}
+
+static void
+shared_cache_xact_callback(XactEvent event, void *arg)
+{
+	int			i;
+
+	switch (event)
+	{
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_ABORT:
+
+			/*
+			 * Entries are never written while invalidations are pending, so
+			 * the shared cache does not hold any uncommitted state to discard
+			 * on abort.
+			 */
+			for (i = 0; i < _MAX_CACHE_TYPES; i++)
+			{
+				if (pending_invalidations[i] && event == XACT_EVENT_COMMIT && shared_cache_enabled())
+					pg_atomic_fetch_add_u32(&shared_cache->generations[i], 1);
+
+				pending_invalidations[i] = false;
+			}
+			break;
+		case XACT_EVENT_PRE_PREPARE:
+
+			/*
+			 * A prepared transaction is committed by COMMIT PREPARED, possibly
+			 * in another backend, which does not know about the pending
+			 * invalidations and would not bump the generations. Refuse to
+			 * prepare the transaction instead.
+			 */
+			for (i = 0; i < _MAX_CACHE_TYPES; i++)
+			{
+				if (pending_invalidations[i] && shared_cache_enabled())
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("cannot PREPARE a transaction that has modified TimescaleDB metadata")));
+			}
+			break;
+		case XACT_EVENT_PREPARE:
+			for (i = 0; i < _MAX_CACHE_TYPES; i++)
+				pending_invalidations[i] = false;
+			break;
+		default:
+			break;
+	}
+}
+
+void
+_shared_cache_init(void)
+{
+	RegisterXactCallback(shared_cache_xact_callback, NULL);
+
+	if (!process_shared_preload_libraries_in_progress || guc_shared_cache_entries == 0)
+		return;
+
+	RequestAddinShmemSpace(shared_cache_shmem_size());
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = shared_cache_shmem_startup;
+}
+
+void
+_shared_cache_fini(void)
+{
+	UnregisterXactCallback(shared_cache_xact_callback, NULL);
+
+	if (shmem_startup_hook == shared_cache_shmem_startup)
+		shmem_startup_hook = prev_shmem_startup_hook;
+}
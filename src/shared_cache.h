@@ -0,0 +1,21 @@
+#ifndef TIMESCALEDB_SHARED_CACHE_H
+#define TIMESCALEDB_SHARED_CACHE_H
+
+#include <postgres.h>
+
+#include "catalog.h"
+
+/* Maximum size of the data of a shared cache entry */
+#define SHARED_CACHE_MAX_DATA_SIZE 256
+
+extern bool shared_cache_enabled(void);
+extern uint32 shared_cache_generation(CacheType type);
+extern bool shared_cache_lookup(CacheType type, Oid relid, void *data, Size size);
+extern void shared_cache_insert(CacheType type, Oid relid, uint32 generation,
+					const void *data, Size size);
+extern void shared_cache_invalidate_at_commit(CacheType type);
+
+extern void _shared_cache_init(void);
+extern void _shared_cache_fini(void);
+
+#endif   /* TIMESCALEDB_SHARED_CACHE_H */
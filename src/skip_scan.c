@@ -0,0 +1,510 @@
+#include <postgres.h>
+#include <access/genam.h>
+#include <access/relscan.h>
+#include <access/skey.h>
+#include <access/stratnum.h>
+#include <catalog/pg_am.h>
+#include <executor/executor.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <nodes/relation.h>
+#include <optimizer/cost.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/tlist.h>
+#include <utils/datum.h>
+#include <utils/lsyscache.h>
+#include <utils/selfuncs.h>
+
+/*
+ * Skip scan of chunks.
+ *
+ * A query like SELECT DISTINCT device_id FROM hypertable only needs the
+ * distinct values of device_id, but is normally planned as a scan of every
+ * row of every chunk followed by a Unique or HashAggregate. If a chunk has a
+ * btree index with device_id as the leading column, the distinct values can
+ * instead be found by repeatedly descending the index to the first entry that
+ * is greater than the previous value (a "loose index scan").
+ *
+ * The SkipScan node wraps an ordinary (index-only) index scan of a chunk. A
+ * placeholder "device_id IS NOT NULL" qual is added to the index scan so that
+ * it has a scan key for the leading column. Btree requires the scan keys to
+ * be ordered by index column, so the placeholder goes after any quals on the
+ * leading column and before those on later columns. After each returned
+ * tuple, this scan key is replaced with "device_id > <previous value>" and the
+ * index scan is restarted. Once the non-NULL values are exhausted, the key is
+ * replaced with "device_id IS NULL" to return a NULL value, if one exists. The
+ * index scan itself evaluates all other quals of the chunk.
+ *
+ * The skip scans of chunks produce sorted output, so the planner merges them
+ * with a MergeAppend and removes duplicates across chunks with a Unique node.
+ */
+
+extern void skip_scan_optimization(PlannerInfo *root, RelOptInfo *rel, AppendRelInfo *appinfo);
+
+typedef enum SkipScanStage
+{
+	SKIP_SCAN_BEGIN,
+	SKIP_SCAN_SKIPPING,
+	SKIP_SCAN_NULLS,
+	SKIP_SCAN_DONE,
+} SkipScanStage;
+
+typedef struct SkipScanState
+{
+	CustomScanState css;
+	PlanState  *child;
+	SkipScanStage stage;
+	/* Position of the distinct column in the output */
+	AttrNumber	distinct_col;
+	/* Position of the placeholder among the scan keys of the index scan */
+	int			skip_key;
+	/* Comparison function and types for the skip scan key */
+	Oid			gt_proc;
+	Oid			collation;
+	Oid			type;
+	int16		typlen;
+	bool		typbyval;
+	/* Last value returned */
+	Datum		prev;
+	ScanKey		skip_keys;
+} SkipScanState;
+
+static Plan *skip_scan_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *best_path,
+					  List *tlist, List *clauses, List *custom_plans);
+static Node *skip_scan_state_create(CustomScan *cscan);
+static void skip_scan_begin(CustomScanState *node, EState *estate, int eflags);
+static TupleTableSlot *skip_scan_exec(CustomScanState *node);
+static void skip_scan_end(CustomScanState *node);
+static void skip_scan_rescan(CustomScanState *node);
+
+static CustomPathMethods skip_scan_path_methods = {
+	.CustomName = "SkipScan",
+	.PlanCustomPath = skip_scan_plan_create,
+};
+
+static CustomScanMethods skip_scan_plan_methods = {
+	.CustomName = "SkipScan",
+	.CreateCustomScanState = skip_scan_state_create,
+};
+
+static CustomExecMethods skip_scan_state_methods = {
+	.CustomName = "SkipScan",
+	.BeginCustomScan = skip_scan_begin,
+	.ExecCustomScan = skip_scan_exec,
+	.EndCustomScan = skip_scan_end,
+	.ReScanCustomScan = skip_scan_rescan,
+};
+
+/*
+ * Get the scan keys and scan descriptor of the wrapped index scan.
+ */
+static void
+skip_scan_get_index_scan(PlanState *child, IndexScanDesc *scandesc,
+						 ScanKey *keys, int *nkeys,
+						 ScanKey *orderbykeys, int *norderbykeys)
+{
+	if (IsA(child, IndexScanState))
+	{
+		IndexScanState *iss = (IndexScanState *) child;
+
+		*scandesc = iss->iss_ScanDesc;
+		*keys = iss->iss_ScanKeys;
+		*nkeys = iss->iss_NumScanKeys;
+		*orderbykeys = iss->iss_OrderByKeys;
+		*norderbykeys = iss->iss_NumOrderByKeys;
+	}
+	else if (IsA(child, IndexOnlyScanState))
+	{
+		IndexOnlyScanState *ioss = (IndexOnlyScanState *) child;
+
+		*scandesc = ioss->ioss_ScanDesc;
+		*keys = ioss->ioss_ScanKeys;
+		*nkeys = ioss->ioss_NumScanKeys;
+		*orderbykeys = ioss->ioss_OrderByKeys;
+		*norderbykeys = ioss->ioss_NumOrderByKeys;
+	}
+	else
+		elog(ERROR, "unexpected child node %d in skip scan", (int) nodeTag(child));
+}
+
+/*
+ * Restart the index scan, replacing the placeholder scan key with a key that
+ * skips past the previous value or searches for NULLs.
+ */
+static void
+skip_scan_restart_index_scan(SkipScanState *state)
+{
+	IndexScanDesc scandesc;
+	ScanKey		keys,
+				orderbykeys;
+	int			nkeys,
+				norderbykeys;
+	ScanKey		skip_key;
+
+	skip_scan_get_index_scan(state->child, &scandesc, &keys, &nkeys,
+							 &orderbykeys, &norderbykeys);
+
+	Assert(state->skip_key < nkeys);
+
+	if (NULL == state->skip_keys)
+		state->skip_keys = palloc(sizeof(ScanKeyData) * nkeys);
+
+	memcpy(state->skip_keys, keys, sizeof(ScanKeyData) * nkeys);
+	skip_key = &state->skip_keys[state->skip_key];
+
+	if (state->stage == SKIP_SCAN_NULLS)
+		ScanKeyEntryInitialize(skip_key, SK_ISNULL | SK_SEARCHNULL, 1,
+							   InvalidStrategy, InvalidOid, InvalidOid,
+							   InvalidOid, (Datum) 0);
+	else
+		ScanKeyEntryInitialize(skip_key, 0, 1, BTGreaterStrategyNumber,
+							   state->type, state->collation,
+							   state->gt_proc, state->prev);
+
+	index_rescan(scandesc, state->skip_keys, nkeys, orderbykeys, norderbykeys);
+}
+
+static void
+skip_scan_reset_prev(SkipScanState *state)
+{
+	if (!state->typbyval && DatumGetPointer(state->prev) != NULL)
+		pfree(DatumGetPointer(state->prev));
+
+	state->prev = (Datum) 0;
+}
+
+static void
+skip_scan_set_prev(SkipScanState *state, Datum value)
+{
+	skip_scan_reset_prev(state);
+	state->prev = datumCopy(value, state->typbyval, state->typlen);
+}
+
+static TupleTableSlot *
+skip_scan_exec(CustomScanState *node)
+{
+	SkipScanState *state = (SkipScanState *) node;
+
+	for (;;)
+	{
+		TupleTableSlot *slot;
+		Datum		value;
+		bool		isnull;
+
+		switch (state->stage)
+		{
+			case SKIP_SCAN_DONE:
+				return NULL;
+			case SKIP_SCAN_BEGIN:
+				/* The first scan uses the IS NOT NULL placeholder as is */
+				break;
+			case SKIP_SCAN_SKIPPING:
+			case SKIP_SCAN_NULLS:
+				skip_scan_restart_index_scan(state);
+				break;
+		}
+
+		slot = ExecProcNode(state->child);
+
+		if (TupIsNull(slot))
+		{
+			/* No more non-NULL values, so look for a NULL value */
+			state->stage = (state->stage == SKIP_SCAN_NULLS) ? SKIP_SCAN_DONE : SKIP_SCAN_NULLS;
+			continue;
+		}
+
+		if (state->stage == SKIP_SCAN_NULLS)
+		{
+			state->stage = SKIP_SCAN_DONE;
+			return slot;
+		}
+
+		value = slot_getattr(slot, state->distinct_col, &isnull);
+		Assert(!isnull);
+
+		skip_scan_set_prev(state, value);
+		state->stage = SKIP_SCAN_SKIPPING;
+
+		return slot;
+	}
+}
+
+static void
+skip_scan_begin(CustomScanState *node, EState *estate, int eflags)
+{
+	SkipScanState *state = (SkipScanState *) node;
+	CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+	List	   *positions = linitial(cscan->custom_private);
+	List	   *info = lsecond(cscan->custom_private);
+
+	state->distinct_col = linitial_int(positions);
+	state->skip_key = lsecond_int(positions);
+	state->gt_proc = linitial_oid(info);
+	state->collation = lsecond_oid(info);
+	state->type = lthird_oid(info);
+	get_typlenbyval(state->type, &state->typlen, &state->typbyval);
+
+	state->child = ExecInitNode(linitial(cscan->custom_plans), estate, eflags);
+	node->custom_ps = list_make1(state->child);
+	state->stage = SKIP_SCAN_BEGIN;
+}
+
+static void
+skip_scan_end(CustomScanState *node)
+{
+	SkipScanState *state = (SkipScanState *) node;
+
+	ExecEndNode(state->child);
+}
+
+static void
+skip_scan_rescan(CustomScanState *node)
+{
+	SkipScanState *state = (SkipScanState *) node;
+
+	state->stage = SKIP_SCAN_BEGIN;
+	skip_scan_reset_prev(state);
+	ExecReScan(state->child);
+}
+
+static Node *
+skip_scan_state_create(CustomScan *cscan)
+{
+	SkipScanState *state = (SkipScanState *) newNode(sizeof(SkipScanState), T_CustomScanState);
+
+	state->css.methods = &skip_scan_state_methods;
+
+	return (Node *) state;
+}
+
+/* Insert an element into a list before the element at the given position */
+static List *
+skip_scan_list_insert(List *list, int pos, void *elem)
+{
+	List	   *result = NIL;
+	ListCell   *lc;
+	int			i = 0;
+
+	foreach(lc, list)
+	{
+		if (i++ == pos)
+			result = lappend(result, elem);
+		result = lappend(result, lfirst(lc));
+	}
+
+	if (pos >= list_length(list))
+		result = lappend(result, elem);
+
+	return result;
+}
+
+static Plan *
+skip_scan_plan_create(PlannerInfo *root, RelOptInfo *rel, CustomPath *best_path,
+					  List *tlist, List *clauses, List *custom_plans)
+{
+	CustomScan *cscan = makeNode(CustomScan);
+	IndexPath  *index_path = linitial(best_path->custom_paths);
+	IndexOptInfo *index = index_path->indexinfo;
+	Plan	   *child = linitial(custom_plans);
+	AttrNumber	attno = index->indexkeys[0];
+	TargetEntry *distinct_tle = NULL;
+	NullTest   *index_ntest = makeNode(NullTest);
+	NullTest   *heap_ntest;
+	Var		   *var = NULL;
+	int			skip_key = 0;
+	ListCell   *lc;
+
+	foreach(lc, tlist)
+	{
+		TargetEntry *tle = lfirst(lc);
+		Var		   *tvar = (Var *) tle->expr;
+
+		if (IsA(tvar, Var) && tvar->varno == rel->relid && tvar->varattno == attno)
+		{
+			distinct_tle = tle;
+			var = tvar;
+			break;
+		}
+	}
+
+	if (NULL == distinct_tle)
+		elog(ERROR, "skip scan column not found in target list");
+
+	/* Add the placeholder scan key on the leading index column */
+	index_ntest->arg = (Expr *) makeVar(INDEX_VAR, 1, var->vartype, var->vartypmod,
+										var->varcollid, 0);
+	index_ntest->nulltesttype = IS_NOT_NULL;
+	index_ntest->argisrow = false;
+	index_ntest->location = -1;
+
+	heap_ntest = copyObject(index_ntest);
+	heap_ntest->arg = (Expr *) copyObject(var);
+
+	/*
+	 * The index quals of the plan are in the order of the path's, which is
+	 * the order of the index columns they are on.
+	 */
+	foreach(lc, index_path->indexqualcols)
+	{
+		if (lfirst_int(lc) != 0)
+			break;
+		skip_key++;
+	}
+
+	if (IsA(child, IndexScan))
+	{
+		IndexScan  *scan = (IndexScan *) child;
+
+		scan->indexqual = skip_scan_list_insert(scan->indexqual, skip_key, index_ntest);
+		scan->indexqualorig = skip_scan_list_insert(scan->indexqualorig, skip_key, heap_ntest);
+	}
+	else if (IsA(child, IndexOnlyScan))
+	{
+		IndexOnlyScan *scan = (IndexOnlyScan *) child;
+
+		scan->indexqual = skip_scan_list_insert(scan->indexqual, skip_key, index_ntest);
+	}
+	else
+		elog(ERROR, "unexpected child plan %d in skip scan", (int) nodeTag(child));
+
+	cscan->scan.plan.targetlist = tlist;
+	cscan->scan.plan.qual = NIL;
+	cscan->scan.scanrelid = rel->relid;
+	cscan->custom_plans = custom_plans;
+	cscan->custom_scan_tlist = NIL;
+	cscan->custom_private = list_make2(list_make2_int(distinct_tle->resno, skip_key),
+									   list_make3_oid(get_opcode(get_opfamily_member(index->opfamily[0],
+															   index->opcintype[0],
+															   index->opcintype[0],
+												   BTGreaterStrategyNumber)),
+													  index->indexcollations[0],
+													  index->opcintype[0]));
+	cscan->methods = &skip_scan_plan_methods;
+
+	return &cscan->scan.plan;
+}
+
+/*
+ * Check if an index path can be turned into a skip scan over the given column
+ * with the given ordering.
+ */
+static bool
+index_path_is_skippable(IndexPath *path, Var *var, PathKey *pk)
+{
+	IndexOptInfo *index = path->indexinfo;
+
+	return index->relam == BTREE_AM_OID &&
+		index->indexkeys[0] == var->varattno &&
+		!index->reverse_sort[0] &&
+		!index->nulls_first[0] &&
+		path->indexorderbys == NIL &&
+		path->indexscandir == ForwardScanDirection &&
+		path->path.param_info == NULL &&
+		path->path.pathkeys != NIL &&
+		linitial(path->path.pathkeys) == pk &&
+		OidIsValid(get_opfamily_member(index->opfamily[0], index->opcintype[0],
+									   index->opcintype[0], BTGreaterStrategyNumber));
+}
+
+static CustomPath *
+skip_scan_path_create(PlannerInfo *root, RelOptInfo *rel, IndexPath *index_path, Var *var, PathKey *pk)
+{
+	CustomPath *path = makeNode(CustomPath);
+	IndexOptInfo *index = index_path->indexinfo;
+	double		ndistinct = estimate_num_groups(root, list_make1(var), index_path->path.rows, NULL);
+	Cost		descent_cost;
+
+	ndistinct = clamp_row_est(Min(ndistinct, index_path->path.rows));
+
+	/*
+	 * Each value requires a descent of the index, similar to what
+	 * btcostestimate charges for a single index scan, plus a leaf page.
+	 */
+	descent_cost = random_page_cost +
+		(Max(index->tree_height, 0) + 1) * 50.0 * cpu_operator_cost +
+		cpu_tuple_cost;
+
+	path->path.pathtype = T_CustomScan;
+	path->path.parent = rel;
+	path->path.pathtarget = rel->reltarget;
+	path->path.param_info = NULL;
+	path->path.parallel_aware = false;
+	path->path.parallel_safe = false;
+	path->path.parallel_workers = 0;
+	path->path.rows = ndistinct;
+	path->path.startup_cost = index_path->path.startup_cost;
+	path->path.total_cost = index_path->path.startup_cost + ndistinct * descent_cost;
+	path->path.pathkeys = list_make1(pk);
+	path->flags = 0;
+	path->custom_paths = list_make1(index_path);
+	path->custom_private = NIL;
+	path->methods = &skip_scan_path_methods;
+
+	return path;
+}
+
+/*
+ * Add skip scan paths to a chunk of a hypertable, if the query only asks for
+ * the distinct values of one column of the hypertable.
+ */
+void
+skip_scan_optimization(PlannerInfo *root, RelOptInfo *rel, AppendRelInfo *appinfo)
+{
+	Query	   *parse = root->parse;
+	TargetEntry *tle;
+	Var		   *parent_var;
+	Var		   *var;
+	PathKey    *pk;
+	List	   *index_paths = NIL;
+	ListCell   *lc;
+
+	if (list_length(parse->distinctClause) != 1 ||
+		parse->hasDistinctOn ||
+		parse->hasAggs ||
+		parse->groupClause != NIL ||
+		parse->groupingSets != NIL ||
+		parse->hasWindowFuncs ||
+		parse->rowMarks != NIL ||
+		list_length(root->distinct_pathkeys) != 1 ||
+		bms_num_members(root->all_baserels) != 1)
+		return;
+
+	tle = get_sortgroupclause_tle(linitial(parse->distinctClause), parse->targetList);
+	parent_var = (Var *) tle->expr;
+
+	if (!IsA(parent_var, Var) ||
+		parent_var->varno != appinfo->parent_relid ||
+		parent_var->varlevelsup != 0 ||
+		parent_var->varattno <= 0)
+		return;
+
+	/* Nothing but the distinct column may be returned */
+	foreach(lc, parse->targetList)
+	{
+		if (!equal(((TargetEntry *) lfirst(lc))->expr, parent_var))
+			return;
+	}
+
+	var = list_nth(appinfo->translated_vars, parent_var->varattno - 1);
+
+	if (NULL == var || !IsA(var, Var))
+		return;
+
+	pk = linitial(root->distinct_pathkeys);
+
+	if (pk->pk_strategy != BTLessStrategyNumber || pk->pk_nulls_first)
+		return;
+
+	foreach(lc, rel->pathlist)
+	{
+		IndexPath  *path = lfirst(lc);
+
+		if (IsA(path, IndexPath) && index_path_is_skippable(path, var, pk))
+			index_paths = lappend(index_paths, path);
+	}
+
+	/* add_path() modifies the pathlist, so add paths after iterating it */
+	foreach(lc, index_paths)
+		add_path(rel, (Path *) skip_scan_path_create(root, rel, lfirst(lc), var, pk));
+}
@@ -8,6 +8,16 @@
 #include <optimizer/planner.h>
 #include <optimizer/paths.h>
 #include <utils/lsyscache.h>
+#include <utils/builtins.h>
+#include <utils/datetime.h>
+#include <utils/fmgroids.h>
+#include <parser/scansup.h>
+#include <commands/defrem.h>
+#include <catalog/pg_am.h>
+#include <access/stratnum.h>
+#include <pgtime.h>
+
+#include "monotonic_function_cache.h"
 
 /* This optimizations allows GROUP BY clauses that transform time in
  * order-preserving ways to use indexes on the time field. It works
@@ -17,77 +27,85 @@
  *
  * For example, an ordering on date_trunc('minute', time) can be transformed
  * to an ordering on time.
+ *
+ * Order-preserving functions are declared in the monotonic_function catalog
+ * table (see sql/main/monotonic_function.sql), while order-preserving
+ * operators on constants are recognized here.
  */
 
 extern void sort_transform_optimization(PlannerInfo *root, RelOptInfo *rel);
 static Expr *sort_transform_expr(Expr *orig_expr);
 
-static Expr *
-transform_date_trunc(FuncExpr *func)
+/*
+ * AT TIME ZONE, i.e., timezone(text, ...), only preserves ordering for zones
+ * with a fixed UTC offset. Zones with daylight saving time map an hour of
+ * local time onto two different hours of UTC time. This mirrors the zone
+ * lookup in timestamptz_zone().
+ */
+static bool
+timezone_is_fixed_offset(Const *zone)
 {
-	/*
-	 * date_trunc (const, var) => var
-	 *
-	 * proof: date_trunc(c, time1) > date_trunc(c,time2) iff time1 > time2
-	 */
-	Expr	   *second;
-
-	if (list_length(func->args) != 2 || !IsA(linitial(func->args), Const))
-		return (Expr *) func;
-
-	second = sort_transform_expr(lsecond(func->args));
-	if (!IsA(second, Var))
-		return (Expr *) func;
+	char		tzname[TZ_STRLEN_MAX + 1];
+	char	   *lowzone;
+	int			type,
+				val;
+	long		gmtoff;
+	pg_tz	   *tzp;
 
-	return (Expr *) copyObject(second);
-}
+	if (zone->constisnull || zone->consttype != TEXTOID)
+		return false;
 
-static Expr *
-transform_time_bucket(FuncExpr *func)
-{
-	/*
-	 * time_bucket(const, var, const) => var
-	 *
-	 * proof: time_bucket(const1, time1) > time_bucket(const1,time2) iff time1
-	 * > time2
-	 */
-	Expr	   *second;
+	text_to_cstring_buffer(DatumGetTextPP(zone->constvalue), tzname, sizeof(tzname));
+	lowzone = downcase_truncate_identifier(tzname, strlen(tzname), false);
+	type = DecodeTimezoneAbbrev(0, lowzone, &val, &tzp);
 
-	if (list_length(func->args) != 2 || !IsA(linitial(func->args), Const))
-		return (Expr *) func;
+	if (type == TZ || type == DTZ)
+		return true;
 
-	second = sort_transform_expr(lsecond(func->args));
-	if (!IsA(second, Var))
-		return (Expr *) func;
+	if (type != DYNTZ)
+		tzp = pg_tzset(tzname);
 
-	return (Expr *) copyObject(second);
+	return tzp != NULL && pg_get_timezone_offset(tzp, &gmtoff);
 }
 
 static Expr *
-transform_timestamp_cast(FuncExpr *func)
+transform_monotonic_func(FuncExpr *func)
 {
 	/*
-	 * transform cast from timestamptz to timestamp
+	 * f(const, ..., var, ..., const) => var
 	 *
-	 * timestamp(var) => var
-	 *
-	 * proof: timestamp(time1) > timestamp(time2) iff time1 > time2
+	 * for any function f registered as monotonic in var's position.
 	 *
+	 * proof: f(c, time1) > f(c, time2) iff time1 > time2 (by registration)
 	 */
+	int16		order_argument = monotonic_function_get_order_argument(func->funcid);
+	Expr	   *transformed;
+	ListCell   *lc;
+	int			argno = 0;
 
-	Expr	   *first;
+	if (order_argument <= 0 || order_argument > list_length(func->args))
+		return (Expr *) func;
 
-	if (list_length(func->args) != 1)
+	foreach(lc, func->args)
+	{
+		argno++;
+
+		if (argno != order_argument && !IsA(lfirst(lc), Const))
+			return (Expr *) func;
+	}
+
+	if ((func->funcid == F_TIMESTAMPTZ_ZONE || func->funcid == F_TIMESTAMP_ZONE) &&
+		!timezone_is_fixed_offset(linitial(func->args)))
 		return (Expr *) func;
 
-	first = sort_transform_expr(linitial(func->args));
-	if (!IsA(first, Var))
+	transformed = sort_transform_expr(list_nth(func->args, order_argument - 1));
+
+	if (!IsA(transformed, Var))
 		return (Expr *) func;
 
-	return (Expr *) copyObject(first);
+	return (Expr *) copyObject(transformed);
 }
 
-
 static inline Expr *
 transform_time_op_const_interval(OpExpr *op)
 {
@@ -205,17 +223,7 @@ static Expr *
 sort_transform_expr(Expr *orig_expr)
 {
 	if (IsA(orig_expr, FuncExpr))
-	{
-		FuncExpr   *func = (FuncExpr *) orig_expr;
-		char	   *func_name = get_func_name(func->funcid);
-
-		if (strncmp(func_name, "date_trunc", NAMEDATALEN) == 0)
-			return transform_date_trunc(func);
-		if (strncmp(func_name, "time_bucket", NAMEDATALEN) == 0)
-			return transform_time_bucket(func);
-		if (strncmp(func_name, "timestamp", NAMEDATALEN) == 0)
-			return transform_timestamp_cast(func);
-	}
+		return transform_monotonic_func((FuncExpr *) orig_expr);
 	if (IsA(orig_expr, OpExpr))
 	{
 		OpExpr	   *op = (OpExpr *) orig_expr;
@@ -233,6 +241,35 @@ sort_transform_expr(Expr *orig_expr)
 	return orig_expr;
 }
 
+/*
+ * Get the btree operator families to sort by a transformed expression of the
+ * given type. The original families are kept if they support the type (e.g.,
+ * timestamp and timestamptz share a family). Otherwise, e.g., for
+ * to_timestamp(double precision), the default family of the type is used.
+ */
+static List *
+sort_transform_opfamilies(List *orig_opfamilies, Oid type)
+{
+	ListCell   *lc;
+	Oid			opclass;
+
+	foreach(lc, orig_opfamilies)
+	{
+		if (!OidIsValid(get_opfamily_member(lfirst_oid(lc), type, type, BTLessStrategyNumber)))
+			break;
+	}
+
+	if (lc == NULL)
+		return list_copy(orig_opfamilies);
+
+	opclass = GetDefaultOpClass(type, BTREE_AM_OID);
+
+	if (!OidIsValid(opclass))
+		return NIL;
+
+	return list_make1_oid(get_opclass_family(opclass));
+}
+
 /*	sort_transform_ec creates a new EquivalenceClass with transformed
  *	expressions if any of the members of the original EC can be transformed for the sort.
  */
@@ -253,17 +290,23 @@ sort_transform_ec(PlannerInfo *root, EquivalenceClass *orig)
 		{
 			EquivalenceMember *em;
 			Oid			type = exprType((Node *) transformed_expr);
-			List	   *opfamilies = list_copy(orig->ec_opfamilies);
+			Oid			collation = exprCollation((Node *) transformed_expr);
+			List	   *opfamilies = sort_transform_opfamilies(orig->ec_opfamilies, type);
+			EquivalenceClass *exist;
+
+			/* members of an ec must be sortable by the same families */
+			if (opfamilies == NIL ||
+				(newec != NULL && !equal(opfamilies, newec->ec_opfamilies)))
+				continue;
 
 			/*
 			 * if the transform already exists for even one member, assume
 			 * exists for all
 			 */
-			EquivalenceClass *exist =
-			get_eclass_for_sort_expr(root, transformed_expr, ec_mem->em_nullable_relids,
-									 opfamilies, type,
-									 orig->ec_collation, orig->ec_sortref,
-									 ec_mem->em_relids, false);
+			exist = get_eclass_for_sort_expr(root, transformed_expr, ec_mem->em_nullable_relids,
+											 opfamilies, type,
+											 collation, orig->ec_sortref,
+											 ec_mem->em_relids, false);
 
 			if (exist != NULL)
 			{
@@ -284,7 +327,7 @@ sort_transform_ec(PlannerInfo *root, EquivalenceClass *orig)
 				/* lazy create the ec. */
 				newec = makeNode(EquivalenceClass);
 				newec->ec_opfamilies = opfamilies;
-				newec->ec_collation = orig->ec_collation;
+				newec->ec_collation = collation;
 				newec->ec_members = NIL;
 				newec->ec_sources = list_copy(orig->ec_sources);
 				newec->ec_derives = list_copy(orig->ec_derives);
@@ -342,8 +385,10 @@ sort_transform_optimization(PlannerInfo *root, RelOptInfo *rel)
 
 		if (transformed != NULL)
 		{
+			Oid			opfamily = list_member_oid(transformed->ec_opfamilies, pk->pk_opfamily) ?
+			pk->pk_opfamily : linitial_oid(transformed->ec_opfamilies);
 			PathKey    *newpk = make_canonical_pathkey(root,
-													   transformed, pk->pk_opfamily, pk->pk_strategy, pk->pk_nulls_first);
+										transformed, opfamily, pk->pk_strategy, pk->pk_nulls_first);
 
 			was_transformed = true;
 			transformed_query_pathkey = lappend(transformed_query_pathkey, newpk);
@@ -0,0 +1,1195 @@
+#include <postgres.h>
+#include <access/heapam.h>
+#include <access/htup_details.h>
+#include <access/nbtree.h>
+#include <access/sysattr.h>
+#include <access/transam.h>
+#include <access/xact.h>
+#include <catalog/indexing.h>
+#include <executor/executor.h>
+#include <nodes/relation.h>
+#include <optimizer/pathnode.h>
+#include <parser/parsetree.h>
+#include <utils/builtins.h>
+#include <utils/datum.h>
+#include <utils/guc.h>
+#include <utils/inval.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/snapmgr.h>
+#include <utils/typcache.h>
+
+#include "catalog.h"
+#include "chunk_cache.h"
+#include "extension.h"
+#include "scanner.h"
+#include "utils.h"
+#include "zone_map.h"
+
+/*
+ * Zone maps of chunks.
+ *
+ * The planner excludes chunks by their time range and, through constraints,
+ * their partition. A zone map records the smallest and largest value that a
+ * chunk holds in some other column, along with the number of NULLs, so that
+ * chunks can also be excluded on conditions on columns that correlate with
+ * time, such as sequence numbers or versions.
+ *
+ * Zone maps are kept for the columns added with add_zone_map_column(). A new
+ * chunk starts out with empty zone maps. Inserts through the hypertable widen
+ * them when the insert statement is done with the chunk. An UPDATE of a zone
+ * map column drops the zone maps of the chunks it modifies when it starts
+ * executing, since the new values are not known in advance, until
+ * update_chunk_zone_maps() computes them again. Deletes leave zone maps wider
+ * than needed, which is still correct. Rows written to chunk tables directly
+ * are not tracked.
+ *
+ * Widening a zone map locks its tuple in chunk_zone_map until the end of the
+ * transaction. Inserts that find the tuple locked widen a delta of the zone
+ * map in chunk_zone_map_delta instead, at most one per transaction. Reading
+ * a zone map merges its deltas into it, and the next insert that locks the
+ * tuple folds them into it.
+ *
+ * Since the zone maps are updated along with the rows they describe, a query
+ * only excludes chunks by the zone maps that its snapshot sees. A newer zone
+ * map, e.g., one computed again after a concurrent UPDATE, may not cover the
+ * rows that the query sees.
+ *
+ * Values are stored in the text form of the column's type, written with
+ * settings that make the text independent of the session reading it back.
+ */
+
+extern bool zone_map_exclude_chunk(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte);
+
+extern void _zone_map_init(void);
+extern void _zone_map_fini(void);
+
+static ExecutorStart_hook_type prev_ExecutorStart_hook;
+
+typedef struct ZoneMapScanCtx
+{
+	List	   *zone_maps;
+	/* The newest transaction that wrote the zone maps or their deltas */
+	TransactionId xmin;
+} ZoneMapScanCtx;
+
+/* Reads a tuple of chunk_zone_map or chunk_zone_map_delta */
+static bool
+zone_map_tuple_found(TupleInfo *ti, void *data)
+{
+	ZoneMapScanCtx *ctx = data;
+	TransactionId xmin = HeapTupleHeaderGetXmin(ti->tuple->t_data);
+	Datum		values[Natts_chunk_zone_map];
+	bool		isnull[Natts_chunk_zone_map];
+	ZoneMap    *zm = palloc0(sizeof(ZoneMap));
+
+	heap_deform_tuple(ti->tuple, ti->desc, values, isnull);
+
+	namecpy(&zm->column_name, DatumGetName(DATUM_GET(values, Anum_chunk_zone_map_column_name)));
+
+	if (!isnull[Anum_chunk_zone_map_min_value - 1])
+		zm->min_value = TextDatumGetCString(DATUM_GET(values, Anum_chunk_zone_map_min_value));
+
+	if (!isnull[Anum_chunk_zone_map_max_value - 1])
+		zm->max_value = TextDatumGetCString(DATUM_GET(values, Anum_chunk_zone_map_max_value));
+
+	zm->null_count = DatumGetInt64(DATUM_GET(values, Anum_chunk_zone_map_null_count));
+
+	ctx->zone_maps = lappend(ctx->zone_maps, zm);
+
+	if (!TransactionIdIsValid(ctx->xmin) || TransactionIdFollows(xmin, ctx->xmin))
+		ctx->xmin = xmin;
+
+	return true;
+}
+
+/*
+ * Read the tuples of a chunk from chunk_zone_map or chunk_zone_map_delta,
+ * whose indexes both start with (chunk_id, column_name).
+ */
+static void
+zone_map_scan_table(enum CatalogTable table, int index, int32 chunk_id, Snapshot snapshot,
+					ZoneMapScanCtx *scanctx)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[1];
+	ScannerCtx	ctx = {
+		.table = catalog->tables[table].id,
+		.index = catalog->tables[table].index_ids[index],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 1,
+		.scankey = scankey,
+		.data = scanctx,
+		.tuple_found = zone_map_tuple_found,
+		.lockmode = AccessShareLock,
+		.scandirection = ForwardScanDirection,
+		.snapshot = snapshot,
+	};
+
+	ScanKeyInit(&scankey[0], Anum_chunk_zone_map_pkey_idx_chunk_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(chunk_id));
+
+	scanner_scan(&ctx);
+}
+
+static ZoneMap *
+zone_map_find(List *zone_maps, const char *column_name)
+{
+	ListCell   *lc;
+
+	if (column_name == NULL)
+		return NULL;
+
+	foreach(lc, zone_maps)
+	{
+		ZoneMap    *zm = lfirst(lc);
+
+		if (namestrcmp(&zm->column_name, column_name) == 0)
+			return zm;
+	}
+
+	return NULL;
+}
+
+static Datum
+zone_map_value_in(Oid typid, const char *value)
+{
+	Oid			typinput;
+	Oid			typioparam;
+
+	getTypeInputInfo(typid, &typinput, &typioparam);
+
+	return OidInputFunctionCall(typinput, (char *) value, typioparam, -1);
+}
+
+static void
+zone_map_free(ZoneMap *zm)
+{
+	if (zm->min_value != NULL)
+		pfree(zm->min_value);
+	if (zm->max_value != NULL)
+		pfree(zm->max_value);
+	pfree(zm);
+}
+
+/*
+ * Widen a zone map of a column of the given table by a delta. Returns false
+ * if the values cannot be compared, e.g., since the column was dropped.
+ */
+static bool
+zone_map_merge_delta(Oid table_relid, ZoneMap *zm, ZoneMap *delta)
+{
+	AttrNumber	attnum;
+	Oid			typid;
+	int32		typmod;
+	Oid			collation;
+	TypeCacheEntry *tce;
+
+	zm->null_count += delta->null_count;
+
+	if (delta->min_value == NULL)
+		return true;
+
+	if (zm->min_value == NULL)
+	{
+		zm->min_value = pstrdup(delta->min_value);
+		zm->max_value = pstrdup(delta->max_value);
+		return true;
+	}
+
+	attnum = get_attnum(table_relid, NameStr(zm->column_name));
+
+	if (attnum <= 0)
+		return false;
+
+	get_atttypetypmodcoll(table_relid, attnum, &typid, &typmod, &collation);
+	tce = lookup_type_cache(typid, TYPECACHE_CMP_PROC_FINFO);
+
+	if (!OidIsValid(tce->cmp_proc))
+		return false;
+
+	if (DatumGetInt32(FunctionCall2Coll(&tce->cmp_proc_finfo, collation,
+										zone_map_value_in(typid, delta->min_value),
+										zone_map_value_in(typid, zm->min_value))) < 0)
+	{
+		pfree(zm->min_value);
+		zm->min_value = pstrdup(delta->min_value);
+	}
+
+	if (DatumGetInt32(FunctionCall2Coll(&tce->cmp_proc_finfo, collation,
+										zone_map_value_in(typid, delta->max_value),
+										zone_map_value_in(typid, zm->max_value))) > 0)
+	{
+		pfree(zm->max_value);
+		zm->max_value = pstrdup(delta->max_value);
+	}
+
+	return true;
+}
+
+/*
+ * Read the zone maps of a chunk table from the catalog, merged with their
+ * deltas, as seen by the snapshot, or the latest ones if the snapshot is
+ * NULL. Sets xmin to the newest transaction that wrote them, or
+ * InvalidTransactionId if there are none.
+ */
+List *
+zone_map_scan(Oid table_relid, int32 chunk_id, Snapshot snapshot, TransactionId *xmin)
+{
+	ZoneMapScanCtx scanctx = {
+		.zone_maps = NIL,
+		.xmin = InvalidTransactionId,
+	};
+	List	   *zone_maps;
+	ListCell   *lc;
+
+	zone_map_scan_table(CHUNK_ZONE_MAP, CHUNK_ZONE_MAP_ID_INDEX, chunk_id, snapshot, &scanctx);
+	zone_maps = scanctx.zone_maps;
+
+	if (zone_maps != NIL)
+	{
+		scanctx.zone_maps = NIL;
+		zone_map_scan_table(CHUNK_ZONE_MAP_DELTA, CHUNK_ZONE_MAP_DELTA_ID_INDEX, chunk_id,
+							snapshot, &scanctx);
+
+		foreach(lc, scanctx.zone_maps)
+		{
+			ZoneMap    *delta = lfirst(lc);
+			ZoneMap    *zm = zone_map_find(zone_maps, NameStr(delta->column_name));
+
+			/* Deltas of dropped zone maps are left until they are recomputed */
+			if (zm != NULL && !zone_map_merge_delta(table_relid, zm, delta))
+			{
+				zone_maps = list_delete_ptr(zone_maps, zm);
+				zone_map_free(zm);
+			}
+		}
+
+		zone_map_list_free(scanctx.zone_maps);
+	}
+
+	*xmin = scanctx.xmin;
+
+	return zone_maps;
+}
+
+List *
+zone_map_list_copy(List *zone_maps)
+{
+	List	   *copy = NIL;
+	ListCell   *lc;
+
+	foreach(lc, zone_maps)
+	{
+		ZoneMap    *zm = lfirst(lc);
+		ZoneMap    *zm_copy = palloc(sizeof(ZoneMap));
+
+		*zm_copy = *zm;
+		zm_copy->min_value = zm->min_value == NULL ? NULL : pstrdup(zm->min_value);
+		zm_copy->max_value = zm->max_value == NULL ? NULL : pstrdup(zm->max_value);
+		copy = lappend(copy, zm_copy);
+	}
+
+	return copy;
+}
+
+void
+zone_map_list_free(List *zone_maps)
+{
+	ListCell   *lc;
+
+	foreach(lc, zone_maps)
+		zone_map_free(lfirst(lc));
+
+	list_free(zone_maps);
+}
+
+/*
+ * Get the text form of a value. Must match the settings of
+ * _timescaledb_internal.compute_chunk_zone_map().
+ */
+static char *
+zone_map_value_out(Oid typid, Datum value)
+{
+	int			save_nestlevel = NewGUCNestLevel();
+	Oid			typoutput;
+	bool		typisvarlena;
+	char	   *str;
+
+	(void) set_config_option("DateStyle", "ISO", PGC_USERSET, PGC_S_SESSION,
+							 GUC_ACTION_SAVE, true, 0, false);
+	(void) set_config_option("IntervalStyle", "postgres", PGC_USERSET, PGC_S_SESSION,
+							 GUC_ACTION_SAVE, true, 0, false);
+	(void) set_config_option("extra_float_digits", "3", PGC_USERSET, PGC_S_SESSION,
+							 GUC_ACTION_SAVE, true, 0, false);
+
+	getTypeOutputInfo(typid, &typoutput, &typisvarlena);
+	str = OidOutputFunctionCall(typoutput, value);
+
+	AtEOXact_GUC(true, save_nestlevel);
+
+	return str;
+}
+
+/*
+ * Widening of zone maps on insert.
+ */
+
+/* The values that an insert statement wrote to a zone map column of a chunk */
+typedef struct ZoneMapColumn
+{
+	NameData	column_name;
+	AttrNumber	attnum;
+	Oid			typid;
+	Oid			collation;
+	int16		typlen;
+	bool		typbyval;
+	FmgrInfo   *cmp_proc;
+	bool		has_values;
+	Datum		min;
+	Datum		max;
+	int64		null_count;
+} ZoneMapColumn;
+
+struct ZoneMapInsertState
+{
+	Relation	rel;
+	int32		chunk_id;
+	List	   *columns;
+};
+
+static int
+zone_map_compare(ZoneMapColumn *col, Datum a, Datum b)
+{
+	return DatumGetInt32(FunctionCall2Coll(col->cmp_proc, col->collation, a, b));
+}
+
+static void
+zone_map_set_value(ZoneMapColumn *col, Datum *bound, Datum value)
+{
+	if (!col->typbyval)
+		pfree(DatumGetPointer(*bound));
+
+	*bound = datumCopy(value, col->typbyval, col->typlen);
+}
+
+/*
+ * Start tracking the values inserted into a chunk table. Returns NULL if the
+ * chunk has no zone maps.
+ */
+ZoneMapInsertState *
+zone_map_insert_begin(Relation rel)
+{
+	ZoneMapInsertState *state;
+	int32		chunk_id;
+	TransactionId xmin;
+	List	   *zone_maps = chunk_cache_get_zone_maps(RelationGetRelid(rel), &chunk_id, &xmin);
+	ListCell   *lc;
+
+	if (zone_maps == NIL)
+		return NULL;
+
+	state = palloc(sizeof(ZoneMapInsertState));
+	state->rel = rel;
+	state->chunk_id = chunk_id;
+	state->columns = NIL;
+
+	foreach(lc, zone_maps)
+	{
+		ZoneMap    *zm = lfirst(lc);
+		AttrNumber	attnum = get_attnum(RelationGetRelid(rel), NameStr(zm->column_name));
+		Form_pg_attribute attr;
+		TypeCacheEntry *tce;
+		ZoneMapColumn *col;
+
+		if (attnum <= 0)
+			continue;
+
+		attr = RelationGetDescr(rel)->attrs[attnum - 1];
+		tce = lookup_type_cache(attr->atttypid, TYPECACHE_CMP_PROC_FINFO);
+
+		if (!OidIsValid(tce->cmp_proc))
+			continue;
+
+		col = palloc0(sizeof(ZoneMapColumn));
+		col->column_name = zm->column_name;
+		col->attnum = attnum;
+		col->typid = attr->atttypid;
+		col->collation = attr->attcollation;
+		col->typlen = attr->attlen;
+		col->typbyval = attr->attbyval;
+		col->cmp_proc = &tce->cmp_proc_finfo;
+		state->columns = lappend(state->columns, col);
+	}
+
+	zone_map_list_free(zone_maps);
+
+	return state;
+}
+
+void
+zone_map_insert_tuple(ZoneMapInsertState *state, HeapTuple tuple)
+{
+	TupleDesc	desc = RelationGetDescr(state->rel);
+	ListCell   *lc;
+
+	foreach(lc, state->columns)
+	{
+		ZoneMapColumn *col = lfirst(lc);
+		bool		isnull;
+		Datum		value = heap_getattr(tuple, col->attnum, desc, &isnull);
+
+		if (isnull)
+			col->null_count++;
+		else if (!col->has_values)
+		{
+			col->min = datumCopy(value, col->typbyval, col->typlen);
+			col->max = datumCopy(value, col->typbyval, col->typlen);
+			col->has_values = true;
+		}
+		else if (zone_map_compare(col, value, col->min) < 0)
+			zone_map_set_value(col, &col->min, value);
+		else if (zone_map_compare(col, value, col->max) > 0)
+			zone_map_set_value(col, &col->max, value);
+	}
+}
+
+/*
+ * Get a copy of a tuple of chunk_zone_map or chunk_zone_map_delta widened by
+ * the values of a column, or NULL if it already covers them.
+ */
+static HeapTuple
+zone_map_widen_tuple(ZoneMapColumn *col, HeapTuple tuple, TupleDesc desc)
+{
+	Datum		values[Natts_chunk_zone_map];
+	bool		isnull[Natts_chunk_zone_map];
+	bool		replace[Natts_chunk_zone_map] = {false};
+
+	heap_deform_tuple(tuple, desc, values, isnull);
+
+	if (col->has_values)
+	{
+		if (isnull[Anum_chunk_zone_map_min_value - 1] ||
+			zone_map_compare(col, col->min,
+							 zone_map_value_in(col->typid,
+				TextDatumGetCString(DATUM_GET(values, Anum_chunk_zone_map_min_value)))) < 0)
+		{
+			values[Anum_chunk_zone_map_min_value - 1] =
+				CStringGetTextDatum(zone_map_value_out(col->typid, col->min));
+			isnull[Anum_chunk_zone_map_min_value - 1] = false;
+			replace[Anum_chunk_zone_map_min_value - 1] = true;
+		}
+
+		if (isnull[Anum_chunk_zone_map_max_value - 1] ||
+			zone_map_compare(col, col->max,
+							 zone_map_value_in(col->typid,
+				TextDatumGetCString(DATUM_GET(values, Anum_chunk_zone_map_max_value)))) > 0)
+		{
+			values[Anum_chunk_zone_map_max_value - 1] =
+				CStringGetTextDatum(zone_map_value_out(col->typid, col->max));
+			isnull[Anum_chunk_zone_map_max_value - 1] = false;
+			replace[Anum_chunk_zone_map_max_value - 1] = true;
+		}
+	}
+
+	if (col->null_count > 0)
+	{
+		values[Anum_chunk_zone_map_null_count - 1] =
+			Int64GetDatum(DatumGetInt64(DATUM_GET(values, Anum_chunk_zone_map_null_count)) +
+						  col->null_count);
+		replace[Anum_chunk_zone_map_null_count - 1] = true;
+	}
+
+	if (!replace[Anum_chunk_zone_map_min_value - 1] &&
+		!replace[Anum_chunk_zone_map_max_value - 1] &&
+		!replace[Anum_chunk_zone_map_null_count - 1])
+		return NULL;
+
+	return heap_modify_tuple(tuple, desc, values, isnull, replace);
+}
+
+/* Add the values of a delta to those of a column */
+static void
+zone_map_column_add_delta(ZoneMapColumn *col, HeapTuple tuple, TupleDesc desc)
+{
+	Datum		values[Natts_chunk_zone_map];
+	bool		isnull[Natts_chunk_zone_map];
+	Datum		min;
+	Datum		max;
+
+	heap_deform_tuple(tuple, desc, values, isnull);
+
+	col->null_count += DatumGetInt64(DATUM_GET(values, Anum_chunk_zone_map_null_count));
+
+	if (isnull[Anum_chunk_zone_map_min_value - 1])
+		return;
+
+	min = zone_map_value_in(col->typid,
+			TextDatumGetCString(DATUM_GET(values, Anum_chunk_zone_map_min_value)));
+	max = zone_map_value_in(col->typid,
+			TextDatumGetCString(DATUM_GET(values, Anum_chunk_zone_map_max_value)));
+
+	if (!col->has_values)
+	{
+		col->min = datumCopy(min, col->typbyval, col->typlen);
+		col->max = datumCopy(max, col->typbyval, col->typlen);
+		col->has_values = true;
+		return;
+	}
+
+	if (zone_map_compare(col, min, col->min) < 0)
+		zone_map_set_value(col, &col->min, min);
+
+	if (zone_map_compare(col, max, col->max) > 0)
+		zone_map_set_value(col, &col->max, max);
+}
+
+static ScannerCtx
+zone_map_delta_scanner(ScanKeyData *scankey, int32 chunk_id, Name column_name)
+{
+	Catalog    *catalog = catalog_get();
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CHUNK_ZONE_MAP_DELTA].id,
+		.index = catalog->tables[CHUNK_ZONE_MAP_DELTA].index_ids[CHUNK_ZONE_MAP_DELTA_ID_INDEX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 2,
+		.scankey = scankey,
+		.lockmode = RowExclusiveLock,
+		.scandirection = ForwardScanDirection,
+	};
+
+	ScanKeyInit(&scankey[0], Anum_chunk_zone_map_delta_idx_chunk_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(chunk_id));
+	ScanKeyInit(&scankey[1], Anum_chunk_zone_map_delta_idx_column_name,
+				BTEqualStrategyNumber, F_NAMEEQ, NameGetDatum(column_name));
+
+	return scanctx;
+}
+
+typedef struct ZoneMapDeltaCtx
+{
+	/* The values to widen the zone map by, or NULL to drop the zone map */
+	ZoneMapColumn *column;
+	bool		found;
+	bool		changed;
+} ZoneMapDeltaCtx;
+
+static bool
+zone_map_fold_delta_tuple_found(TupleInfo *ti, void *data)
+{
+	ZoneMapDeltaCtx *ctx = data;
+
+	if (ctx->column != NULL)
+		zone_map_column_add_delta(ctx->column, ti->tuple, ti->desc);
+
+	simple_heap_delete(ti->scanrel, &ti->tuple->t_self);
+	ctx->changed = true;
+
+	return true;
+}
+
+/*
+ * Delete the deltas of a zone map, after adding their values to the column's
+ * values unless column is NULL. Only transactions that hold the lock on the
+ * zone map's tuple delete its deltas, so none of them is deleted concurrently.
+ * Deltas of transactions that are still in progress are not seen and are left
+ * for later. Returns true if there were deltas.
+ */
+static bool
+zone_map_fold_deltas(int32 chunk_id, Name column_name, ZoneMapColumn *column)
+{
+	ScanKeyData scankey[2];
+	ZoneMapDeltaCtx ctx = {
+		.column = column,
+	};
+	ScannerCtx	scanctx = zone_map_delta_scanner(scankey, chunk_id, column_name);
+
+	scanctx.data = &ctx;
+	scanctx.tuple_found = zone_map_fold_delta_tuple_found;
+	scanner_scan(&scanctx);
+
+	return ctx.changed;
+}
+
+static bool
+zone_map_delta_is_own(TupleInfo *ti, void *data)
+{
+	return TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetXmin(ti->tuple->t_data));
+}
+
+static bool
+zone_map_widen_delta_tuple_found(TupleInfo *ti, void *data)
+{
+	ZoneMapDeltaCtx *ctx = data;
+	HeapTuple	new_tuple = zone_map_widen_tuple(ctx->column, ti->tuple, ti->desc);
+
+	ctx->found = true;
+
+	if (new_tuple != NULL)
+	{
+		simple_heap_update(ti->scanrel, &ti->tuple->t_self, new_tuple);
+		CatalogUpdateIndexes(ti->scanrel, new_tuple);
+		heap_freetuple(new_tuple);
+		ctx->changed = true;
+	}
+
+	return false;
+}
+
+static void
+zone_map_delta_insert(int32 chunk_id, int32 hypertable_id, Name column_name, ZoneMapColumn *col)
+{
+	Catalog    *catalog = catalog_get();
+	Relation	rel = heap_open(catalog->tables[CHUNK_ZONE_MAP_DELTA].id, RowExclusiveLock);
+	Datum		values[Natts_chunk_zone_map];
+	bool		nulls[Natts_chunk_zone_map] = {false};
+	HeapTuple	tuple;
+
+	values[Anum_chunk_zone_map_chunk_id - 1] = Int32GetDatum(chunk_id);
+	values[Anum_chunk_zone_map_hypertable_id - 1] = Int32GetDatum(hypertable_id);
+	values[Anum_chunk_zone_map_column_name - 1] = NameGetDatum(column_name);
+	values[Anum_chunk_zone_map_null_count - 1] = Int64GetDatum(col->null_count);
+
+	if (col->has_values)
+	{
+		values[Anum_chunk_zone_map_min_value - 1] =
+			CStringGetTextDatum(zone_map_value_out(col->typid, col->min));
+		values[Anum_chunk_zone_map_max_value - 1] =
+			CStringGetTextDatum(zone_map_value_out(col->typid, col->max));
+	}
+	else
+	{
+		nulls[Anum_chunk_zone_map_min_value - 1] = true;
+		nulls[Anum_chunk_zone_map_max_value - 1] = true;
+	}
+
+	tuple = heap_form_tuple(RelationGetDescr(rel), values, nulls);
+	simple_heap_insert(rel, tuple);
+	CatalogUpdateIndexes(rel, tuple);
+	heap_freetuple(tuple);
+
+	heap_close(rel, RowExclusiveLock);
+}
+
+/*
+ * Widen a zone map by the values of a column through this transaction's
+ * delta, which no other transaction writes. Returns true if the delta
+ * changed.
+ */
+static bool
+zone_map_widen_delta(int32 chunk_id, int32 hypertable_id, Name column_name, ZoneMapColumn *column)
+{
+	ScanKeyData scankey[2];
+	ZoneMapDeltaCtx ctx = {
+		.column = column,
+	};
+	ScannerCtx	scanctx = zone_map_delta_scanner(scankey, chunk_id, column_name);
+
+	scanctx.data = &ctx;
+	scanctx.filter = zone_map_delta_is_own;
+	scanctx.tuple_found = zone_map_widen_delta_tuple_found;
+	scanner_scan(&scanctx);
+
+	if (ctx.found)
+		return ctx.changed;
+
+	zone_map_delta_insert(chunk_id, hypertable_id, column_name, column);
+
+	return true;
+}
+
+typedef struct ZoneMapUpdateCtx
+{
+	int32		chunk_id;
+	Name		column_name;
+	/* The values to widen the zone map by, or NULL to drop the zone map */
+	ZoneMapColumn *column;
+	bool		retry;
+	/* Set if the values go to a delta since another transaction holds the lock */
+	bool		widen_delta;
+	int32		hypertable_id;
+	bool		changed;
+} ZoneMapUpdateCtx;
+
+static bool
+zone_map_update_tuple_found(TupleInfo *ti, void *data)
+{
+	ZoneMapUpdateCtx *ctx = data;
+	HeapTuple	new_tuple;
+
+	/*
+	 * A concurrent transaction updated or dropped the zone map, so look for
+	 * its new version in another scan, unless this scan finds it.
+	 */
+	if (ti->lockresult == HeapTupleUpdated)
+	{
+		ctx->retry = true;
+		return true;
+	}
+
+	ctx->retry = false;
+
+	/*
+	 * Another transaction widens or drops the zone map. The zone map only
+	 * gets wider until the lock is released, so there is nothing to do if it
+	 * already covers the values. Otherwise, widen it through a delta.
+	 */
+	if (ti->lockresult == HeapTupleWouldBlock)
+	{
+		new_tuple = zone_map_widen_tuple(ctx->column, ti->tuple, ti->desc);
+
+		if (new_tuple != NULL)
+		{
+			bool		isnull;
+
+			ctx->widen_delta = true;
+			ctx->hypertable_id =
+				DatumGetInt32(heap_getattr(ti->tuple, Anum_chunk_zone_map_hypertable_id,
+										   ti->desc, &isnull));
+			heap_freetuple(new_tuple);
+		}
+
+		return false;
+	}
+
+	if (ti->lockresult != HeapTupleMayBeUpdated)
+		elog(ERROR, "could not lock zone map tuple (%d)", ti->lockresult);
+
+	ctx->changed |= zone_map_fold_deltas(ctx->chunk_id, ctx->column_name, ctx->column);
+
+	if (ctx->column == NULL)
+	{
+		simple_heap_delete(ti->scanrel, &ti->tuple->t_self);
+		ctx->changed = true;
+		return false;
+	}
+
+	new_tuple = zone_map_widen_tuple(ctx->column, ti->tuple, ti->desc);
+
+	if (new_tuple == NULL)
+		return false;
+
+	simple_heap_update(ti->scanrel, &ti->tuple->t_self, new_tuple);
+	CatalogUpdateIndexes(ti->scanrel, new_tuple);
+	heap_freetuple(new_tuple);
+	ctx->changed = true;
+
+	return false;
+}
+
+/*
+ * Widen the zone map of a column of a chunk by the given values, or drop it
+ * if column is NULL. Returns true if the zone map changed.
+ *
+ * The zone map's tuple stays locked until the end of the transaction that
+ * widens it. So that inserts into a chunk do not wait for each other, or
+ * deadlock when they insert into chunks in different orders, an insert does
+ * not wait for the lock but widens its own delta of the zone map instead.
+ * The next insert that gets the lock folds the deltas into the zone map. An
+ * UPDATE waits for the lock to drop the zone map and its deltas.
+ */
+static bool
+zone_map_update(int32 chunk_id, Name column_name, ZoneMapColumn *column)
+{
+	Catalog    *catalog = catalog_get();
+	ScanKeyData scankey[2];
+	ZoneMapUpdateCtx ctx = {
+		.chunk_id = chunk_id,
+		.column_name = column_name,
+		.column = column,
+	};
+	ScannerCtx	scanctx = {
+		.table = catalog->tables[CHUNK_ZONE_MAP].id,
+		.index = catalog->tables[CHUNK_ZONE_MAP].index_ids[CHUNK_ZONE_MAP_ID_INDEX],
+		.scantype = ScannerTypeIndex,
+		.nkeys = 2,
+		.scankey = scankey,
+		.data = &ctx,
+		.tuple_found = zone_map_update_tuple_found,
+		.lockmode = RowExclusiveLock,
+		.tuplock = {
+			.lockmode = LockTupleExclusive,
+			.waitpolicy = column == NULL ? LockWaitBlock : LockWaitSkip,
+			.enabled = true,
+		},
+		.scandirection = ForwardScanDirection,
+	};
+
+	ScanKeyInit(&scankey[0], Anum_chunk_zone_map_pkey_idx_chunk_id,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(chunk_id));
+	ScanKeyInit(&scankey[1], Anum_chunk_zone_map_pkey_idx_column_name,
+				BTEqualStrategyNumber, F_NAMEEQ, NameGetDatum(column_name));
+
+	do
+	{
+		ctx.retry = false;
+		scanner_scan(&scanctx);
+	} while (ctx.retry);
+
+	if (ctx.widen_delta)
+		ctx.changed |= zone_map_widen_delta(chunk_id, ctx.hypertable_id, column_name, column);
+
+	return ctx.changed;
+}
+
+/*
+ * Widen the zone maps of the chunk by the values inserted since the last
+ * call. The zone maps are written to the catalog without firing the cache
+ * invalidation triggers, so the chunk's cache entries and cached plans that
+ * use the chunk are invalidated here.
+ */
+void
+zone_map_insert_end(ZoneMapInsertState *state)
+{
+	bool		changed = false;
+	ListCell   *lc;
+
+	foreach(lc, state->columns)
+	{
+		ZoneMapColumn *col = lfirst(lc);
+
+		if (col->has_values || col->null_count > 0)
+			changed |= zone_map_update(state->chunk_id, &col->column_name, col);
+
+		if (col->has_values && !col->typbyval)
+		{
+			pfree(DatumGetPointer(col->min));
+			pfree(DatumGetPointer(col->max));
+		}
+
+		col->has_values = false;
+		col->null_count = 0;
+	}
+
+	if (changed)
+	{
+		CacheInvalidateRelcacheByRelid(RelationGetRelid(state->rel));
+
+		/* Later updates of the same zone maps must see this one */
+		CommandCounterIncrement();
+	}
+}
+
+/*
+ * Planning with zone maps.
+ */
+
+/* Get the strategy of a btree operator with its arguments swapped */
+static StrategyNumber
+zone_map_commute_strategy(StrategyNumber strategy)
+{
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+			return BTGreaterStrategyNumber;
+		case BTLessEqualStrategyNumber:
+			return BTGreaterEqualStrategyNumber;
+		case BTGreaterEqualStrategyNumber:
+			return BTLessEqualStrategyNumber;
+		case BTGreaterStrategyNumber:
+			return BTLessStrategyNumber;
+		default:
+			return strategy;
+	}
+}
+
+/*
+ * Check "bound <op> value" for the operator of the given strategy in an
+ * operator family. Returns true if there is no such operator.
+ */
+static bool
+zone_map_check_bound(Oid opfamily, StrategyNumber strategy, Oid lefttype, Oid righttype,
+					 Oid collation, Datum bound, Datum value)
+{
+	Oid			opno = get_opfamily_member(opfamily, lefttype, righttype, strategy);
+
+	if (!OidIsValid(opno))
+		return true;
+
+	return DatumGetBool(OidFunctionCall2Coll(get_opcode(opno), collation, bound, value));
+}
+
+static Node *
+zone_map_strip_relabel(Node *node)
+{
+	while (node != NULL && IsA(node, RelabelType))
+		node = (Node *) ((RelabelType *) node)->arg;
+
+	return node;
+}
+
+/* Get the zone map of a column of the relation that a Var references */
+static ZoneMap *
+zone_map_for_var(Node *node, Index varno, Oid relid, List *zone_maps)
+{
+	Var		   *var = (Var *) node;
+
+	if (node == NULL || !IsA(node, Var) || var->varno != varno ||
+		var->varlevelsup != 0 || var->varattno <= 0)
+		return NULL;
+
+	return zone_map_find(zone_maps, get_attname(relid, var->varattno));
+}
+
+/*
+ * Check whether the zone maps of a chunk show that no row of the chunk
+ * matches a restriction clause. Handles IS [NOT] NULL and comparisons of a
+ * column with a constant by an operator of the btree operator family that
+ * the zone map was computed with.
+ */
+static bool
+zone_map_refutes_clause(Expr *clause, Index varno, Oid relid, List *zone_maps)
+{
+	OpExpr	   *op = (OpExpr *) clause;
+	Node	   *left;
+	Node	   *right;
+	Var		   *var;
+	Const	   *c;
+	ZoneMap    *zm;
+	bool		var_on_left;
+	Oid			lefttype;
+	Oid			righttype;
+	Oid			vartype;
+	Oid			consttype;
+	TypeCacheEntry *tce;
+	StrategyNumber strategy;
+	Datum		min;
+	Datum		max;
+
+	if (IsA(clause, NullTest))
+	{
+		NullTest   *nt = (NullTest *) clause;
+
+		if (nt->argisrow)
+			return false;
+
+		zm = zone_map_for_var((Node *) nt->arg, varno, relid, zone_maps);
+
+		if (zm == NULL)
+			return false;
+
+		if (nt->nulltesttype == IS_NULL)
+			return zm->null_count == 0;
+
+		return zm->min_value == NULL;
+	}
+
+	if (!IsA(clause, OpExpr) || list_length(op->args) != 2)
+		return false;
+
+	left = zone_map_strip_relabel(linitial(op->args));
+	right = zone_map_strip_relabel(lsecond(op->args));
+
+	if (IsA(left, Var) && IsA(right, Const))
+	{
+		var = (Var *) left;
+		c = (Const *) right;
+		var_on_left = true;
+	}
+	else if (IsA(right, Var) && IsA(left, Const))
+	{
+		var = (Var *) right;
+		c = (Const *) left;
+		var_on_left = false;
+	}
+	else
+		return false;
+
+	zm = zone_map_for_var((Node *) var, varno, relid, zone_maps);
+
+	if (zm == NULL || c->constisnull)
+		return false;
+
+	/* A strict operator matches no row if the column is always NULL */
+	if (zm->min_value == NULL)
+		return op_strict(op->opno);
+
+	/* The zone map is ordered by the column's collation */
+	if (op->inputcollid != var->varcollid)
+		return false;
+
+	op_input_types(op->opno, &lefttype, &righttype);
+	vartype = var_on_left ? lefttype : righttype;
+	consttype = var_on_left ? righttype : lefttype;
+
+	tce = lookup_type_cache(vartype, TYPECACHE_BTREE_OPFAMILY);
+
+	if (!OidIsValid(tce->btree_opf))
+		return false;
+
+	strategy = get_op_opfamily_strategy(op->opno, tce->btree_opf);
+
+	if (strategy == InvalidStrategy)
+		return false;
+
+	if (!var_on_left)
+		strategy = zone_map_commute_strategy(strategy);
+
+	min = zone_map_value_in(var->vartype, zm->min_value);
+	max = zone_map_value_in(var->vartype, zm->max_value);
+
+#define CHECK_BOUND(strat, bound) \
+	zone_map_check_bound(tce->btree_opf, strat, vartype, consttype, \
+						 op->inputcollid, bound, c->constvalue)
+
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+			return !CHECK_BOUND(BTLessStrategyNumber, min);
+		case BTLessEqualStrategyNumber:
+			return !CHECK_BOUND(BTLessEqualStrategyNumber, min);
+		case BTEqualStrategyNumber:
+			return !CHECK_BOUND(BTLessEqualStrategyNumber, min) ||
+				!CHECK_BOUND(BTGreaterEqualStrategyNumber, max);
+		case BTGreaterEqualStrategyNumber:
+			return !CHECK_BOUND(BTGreaterEqualStrategyNumber, max);
+		case BTGreaterStrategyNumber:
+			return !CHECK_BOUND(BTGreaterStrategyNumber, max);
+		default:
+			return false;
+	}
+
+#undef CHECK_BOUND
+}
+
+/*
+ * Exclude a chunk that is part of a hypertable expansion if its zone maps
+ * show that none of its rows match the restrictions of the query. The chunk
+ * is marked dummy, like relations excluded by constraints, so that the
+ * expansion skips it. Returns true if the chunk was excluded.
+ */
+bool
+zone_map_exclude_chunk(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
+{
+	Snapshot	snapshot;
+	int32		chunk_id;
+	TransactionId xmin;
+	List	   *zone_maps;
+	ListCell   *lc;
+	bool		excluded = false;
+
+	if (IS_DUMMY_REL(rel) || rte->rtekind != RTE_RELATION || rel->baserestrictinfo == NIL ||
+		!ActiveSnapshotSet())
+		return false;
+
+	snapshot = GetActiveSnapshot();
+	zone_maps = chunk_cache_get_zone_maps(rte->relid, &chunk_id, &xmin);
+
+	/*
+	 * The cached zone maps are the latest ones. The query's snapshot sees
+	 * them if they were written before the snapshot was taken, or by this
+	 * transaction. Otherwise, read the ones that the snapshot sees. The plan
+	 * is then only valid while the snapshots of this backend see the same
+	 * zone maps, like plans that use indexes that are not yet valid for all
+	 * transactions.
+	 */
+	if (TransactionIdIsNormal(xmin) && !TransactionIdPrecedes(xmin, snapshot->xmin) &&
+		!TransactionIdIsCurrentTransactionId(xmin))
+	{
+		zone_map_list_free(zone_maps);
+		zone_maps = zone_map_scan(rte->relid, chunk_id, snapshot, &xmin);
+		root->glob->transientPlan = true;
+	}
+
+	foreach(lc, rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst(lc);
+
+		if (zone_map_refutes_clause(rinfo->clause, rel->relid, rte->relid, zone_maps))
+		{
+			excluded = true;
+			break;
+		}
+	}
+
+	zone_map_list_free(zone_maps);
+
+	if (!excluded)
+		return false;
+
+	rel->rows = 0;
+	rel->pathlist = NIL;
+	rel->partial_pathlist = NIL;
+	add_path(rel, (Path *) create_append_path(rel, NIL, NULL, 0));
+
+	return true;
+}
+
+/*
+ * Drop the zone maps of the columns that an UPDATE sets in a table it
+ * modifies. Chunks that constraints or zone maps exclude are not among the
+ * result relations of the plan, so their zone maps are kept.
+ */
+static void
+zone_map_drop_updated(RangeTblEntry *rte)
+{
+	int32		chunk_id;
+	TransactionId xmin;
+	List	   *zone_maps;
+	int			col = -1;
+	bool		changed = false;
+
+	if (rte->rtekind != RTE_RELATION || bms_is_empty(rte->updatedCols))
+		return;
+
+	zone_maps = chunk_cache_get_zone_maps(rte->relid, &chunk_id, &xmin);
+
+	if (zone_maps == NIL)
+		return;
+
+	while ((col = bms_next_member(rte->updatedCols, col)) >= 0)
+	{
+		AttrNumber	attno = col + FirstLowInvalidHeapAttributeNumber;
+		ZoneMap    *zm;
+
+		if (attno <= 0)
+			continue;
+
+		zm = zone_map_find(zone_maps, get_attname(rte->relid, attno));
+
+		if (zm != NULL)
+			changed |= zone_map_update(chunk_id, &zm->column_name, NULL);
+	}
+
+	zone_map_list_free(zone_maps);
+
+	if (changed)
+		CacheInvalidateRelcacheByRelid(rte->relid);
+}
+
+/*
+ * Drop the zone maps that an UPDATE invalidates when it starts executing, in
+ * the transaction and after the checks that the UPDATE is allowed, rather
+ * than when it is planned, since plans can be cached, explained or never run.
+ */
+static void
+zone_map_executor_start(QueryDesc *queryDesc, int eflags)
+{
+	if (prev_ExecutorStart_hook != NULL)
+		prev_ExecutorStart_hook(queryDesc, eflags);
+	else
+		standard_ExecutorStart(queryDesc, eflags);
+
+	if (queryDesc->operation == CMD_UPDATE && (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0 &&
+		extension_is_loaded())
+	{
+		PlannedStmt *stmt = queryDesc->plannedstmt;
+		ListCell   *lc;
+
+		foreach(lc, stmt->resultRelations)
+			zone_map_drop_updated(rt_fetch(lfirst_int(lc), stmt->rtable));
+	}
+}
+
+void
+_zone_map_init(void)
+{
+	prev_ExecutorStart_hook = ExecutorStart_hook;
+	ExecutorStart_hook = zone_map_executor_start;
+}
+
+void
+_zone_map_fini(void)
+{
+	ExecutorStart_hook = prev_ExecutorStart_hook;
+}
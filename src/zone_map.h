@@ -0,0 +1,31 @@
+#ifndef TIMESCALEDB_ZONE_MAP_H
+#define TIMESCALEDB_ZONE_MAP_H
+
+#include <postgres.h>
+#include <access/htup.h>
+#include <nodes/pg_list.h>
+#include <utils/relcache.h>
+#include <utils/snapshot.h>
+
+/* The range of a column's values in a chunk (see sql/main/zone_map.sql) */
+typedef struct ZoneMap
+{
+	NameData	column_name;
+	/* In the text form of the column's type, NULL if there are no values */
+	char	   *min_value;
+	char	   *max_value;
+	int64		null_count;
+} ZoneMap;
+
+typedef struct ZoneMapInsertState ZoneMapInsertState;
+
+extern List *zone_map_scan(Oid table_relid, int32 chunk_id, Snapshot snapshot,
+			  TransactionId *xmin);
+extern List *zone_map_list_copy(List *zone_maps);
+extern void zone_map_list_free(List *zone_maps);
+
+extern ZoneMapInsertState *zone_map_insert_begin(Relation rel);
+extern void zone_map_insert_tuple(ZoneMapInsertState *state, HeapTuple tuple);
+extern void zone_map_insert_end(ZoneMapInsertState *state);
+
+#endif   /* TIMESCALEDB_ZONE_MAP_H */
@@ -7,10 +7,12 @@ PG_REGRESS_PSQL=$1
 shift
 PSQL=${PSQL:-$PG_REGRESS_PSQL}
 TEST_TABLESPACE_PATH=${TEST_TABLESPACE_PATH:-/tmp/tspace1}
+TEST_TABLESPACE2_PATH=${TEST_TABLESPACE2_PATH:-/tmp/tspace2}
 
 cd test/sql
 PG_PROC_USER=$(ps u | awk '/postgres/ { print $1; exit }')
 mkdir -p ${TEST_TABLESPACE_PATH}
+mkdir -p ${TEST_TABLESPACE2_PATH}
 mkdir -p dump
 
-exec ${PSQL} -v ON_ERROR_STOP=1 -v VERBOSITY=terse -v ECHO=all -v TEST_TABLESPACE_PATH=\'${TEST_TABLESPACE_PATH}\' $@
+exec ${PSQL} -v ON_ERROR_STOP=1 -v VERBOSITY=terse -v ECHO=all -v TEST_TABLESPACE_PATH=\'${TEST_TABLESPACE_PATH}\' -v TEST_TABLESPACE2_PATH=\'${TEST_TABLESPACE2_PATH}\' $@
@@ -0,0 +1,47 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.bookend (
+  time BIGINT NOT NULL,
+  device TEXT NOT NULL,
+  temp DOUBLE PRECISION NULL
+);
+CREATE INDEX ON PUBLIC.bookend (time DESC);
+SELECT * FROM create_hypertable('"public"."bookend"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 10);
+
+INSERT INTO bookend VALUES (1, 'dev1', 1.0), (5, 'dev2', 5.0), (12, 'dev1', 12.0), (25, 'dev2', 25.0), (27, 'dev1', 27.0);
+
+--queries with only first/last aggregates are rewritten to ordered scans
+SELECT first(temp, time), last(temp, time) FROM bookend;
+SELECT last(temp, time) FROM bookend WHERE device = 'dev2';
+SELECT first(device, time), last(device, time) FROM bookend WHERE time > 3 AND time < 26;
+SELECT last(temp, time) FROM bookend HAVING last(temp, time) > 100;
+EXPLAIN (costs off) SELECT last(temp, time) FROM bookend;
+
+CREATE TABLE PUBLIC.bookend_many (
+  time BIGINT NOT NULL,
+  device INT NOT NULL,
+  temp DOUBLE PRECISION NULL
+);
+CREATE INDEX ON PUBLIC.bookend_many (device, time DESC);
+SELECT * FROM create_hypertable('"public"."bookend_many"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+
+INSERT INTO bookend_many SELECT t, t % 4, t FROM generate_series(0, 2999) t;
+--analyze the chunks too
+ANALYZE;
+
+--grouped queries are rewritten to an ordered scan per group
+SELECT device, first(temp, time), last(temp, time) FROM bookend GROUP BY device ORDER BY device;
+SELECT device, last(temp, time) FROM bookend WHERE time < 20 GROUP BY device HAVING last(temp, time) > 10 ORDER BY device;
+SELECT device, last(temp, time) FROM bookend_many GROUP BY device ORDER BY device;
+--the groups are found with a skip scan
+EXPLAIN (costs off) SELECT device, last(temp, time) FROM bookend_many GROUP BY device ORDER BY device;
+--groups on columns that can be NULL are computed by the aggregates
+EXPLAIN (costs off) SELECT temp, last(device, time) FROM bookend GROUP BY temp;
+
+SET timescaledb.disable_optimizations = 'true';
+SELECT first(temp, time), last(temp, time) FROM bookend;
+SELECT first(device, time), last(device, time) FROM bookend WHERE time > 3 AND time < 26;
+SELECT device, last(temp, time) FROM bookend_many GROUP BY device ORDER BY device;
+EXPLAIN (costs off) SELECT last(temp, time) FROM bookend;
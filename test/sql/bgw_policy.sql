@@ -0,0 +1,94 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.policy_test (
+  time TIMESTAMPTZ NOT NULL,
+  device INT NULL,
+  temp DOUBLE PRECISION NULL
+);
+CREATE TABLE PUBLIC.policy_test_int (
+  time BIGINT NOT NULL,
+  temp DOUBLE PRECISION NULL
+);
+SELECT * FROM create_hypertable('"public"."policy_test"'::regclass, 'time'::name, number_partitions => 1,
+                                chunk_time_interval => _timescaledb_internal.interval_to_usec('1 day'));
+SELECT * FROM create_hypertable('"public"."policy_test_int"'::regclass, 'time'::name, number_partitions => 1);
+INSERT INTO policy_test VALUES ('2000-01-01 12:00 UTC', 1, 1.0), ('2000-01-02 12:00 UTC', 2, 2.0), (now(), 1, 3.0);
+
+SELECT add_retention_policy('policy_test', interval '1 year');
+SELECT add_compression_policy('policy_test', interval '1 month', 'device', schedule_interval => interval '12 hours');
+SELECT add_chunk_precreation_policy('policy_test', interval '2 days', max_jitter => interval '5 minutes');
+
+SELECT id, hypertable_id, policy_type, schedule_interval, max_jitter, older_than, ahead, segment_by,
+       next_start <= now() AS due
+FROM _timescaledb_catalog.bgw_policy ORDER BY id;
+
+\set ON_ERROR_STOP 0
+SELECT add_retention_policy('policy_test', interval '1 week');
+SELECT add_retention_policy('policy_test_int', interval '1 week');
+SELECT add_retention_policy('pg_class', interval '1 week');
+SELECT run_policy(100);
+SELECT remove_policy(100);
+\set ON_ERROR_STOP 1
+
+--policies run on demand, independent of their schedule
+SELECT run_policy(2);
+SELECT count(*) FROM _timescaledb_catalog.chunk_compression;
+SELECT run_policy(1);
+SELECT count(*) FROM _timescaledb_catalog.chunk;
+SELECT * FROM policy_test WHERE time < '2001-01-01';
+SELECT run_policy(3);
+SELECT count(*) AS chunks,
+       count(*) FILTER (WHERE c.start_time <= _timescaledb_internal.to_unix_microseconds(now())) AS now,
+       count(*) FILTER (WHERE c.end_time >= _timescaledb_internal.to_unix_microseconds(now() + interval '2 days')) AS ahead
+FROM _timescaledb_catalog.chunk c;
+
+SELECT alter_policy_schedule(1, schedule_interval => interval '2 days', next_start => '2030-01-01 UTC');
+SELECT schedule_interval, max_jitter, next_start = '2030-01-01 UTC' AS moved
+FROM _timescaledb_catalog.bgw_policy WHERE id = 1;
+
+--the scheduler gets the due policies that are not running, with the owners to run them as,
+--and moves them to their next start
+SELECT id, pg_get_userbyid(owner) = current_user AS owned FROM _timescaledb_internal.bgw_policies_due('{3}', 10);
+SELECT id, pg_get_userbyid(owner) = current_user AS owned FROM _timescaledb_internal.bgw_policies_due('{}', 10);
+SELECT id, pg_get_userbyid(owner) = current_user AS owned FROM _timescaledb_internal.bgw_policies_due('{}', 10);
+SELECT id, next_start > now() AS scheduled FROM _timescaledb_catalog.bgw_policy ORDER BY id;
+SELECT _timescaledb_internal.bgw_next_start() > now();
+
+SELECT _timescaledb_internal.bgw_job_start(2);
+SELECT _timescaledb_internal.bgw_job_finish(1, false, 'chunk is locked');
+SELECT _timescaledb_internal.bgw_job_start(3);
+SELECT _timescaledb_internal.bgw_job_finish(2, true, NULL);
+SELECT policy_id, policy_type, hypertable_schema, hypertable_name, duration >= '0' AS finished, succeeded, message
+FROM policy_job_history;
+
+--removing a policy removes its run history
+SELECT remove_policy(2);
+SELECT policy_id, policy_type, succeeded FROM policy_job_history;
+SELECT id, policy_type FROM _timescaledb_catalog.bgw_policy ORDER BY id;
+
+--reorder policies reorder chunks that ended before now by an index of the hypertable
+CREATE INDEX ON policy_test (device, time);
+SELECT add_reorder_policy('policy_test', 'policy_test_device_time_idx');
+SELECT run_policy(4);
+SELECT id, policy_type, index_name FROM _timescaledb_catalog.bgw_policy ORDER BY id;
+\set ON_ERROR_STOP 0
+SELECT add_reorder_policy('policy_test', 'pg_class_oid_index');
+\set ON_ERROR_STOP 1
+
+--policies run as the user that added them, who must own the hypertable
+SELECT id, owner = current_user AS owned FROM _timescaledb_catalog.bgw_policy ORDER BY id;
+DO $$
+BEGIN
+    CREATE ROLE policy_usr;
+EXCEPTION
+    WHEN duplicate_object THEN
+        --mute error
+END$$;
+SET ROLE policy_usr;
+\set ON_ERROR_STOP 0
+SELECT add_retention_policy('policy_test', interval '2 years');
+SELECT run_policy(4);
+\set ON_ERROR_STOP 1
+RESET ROLE;
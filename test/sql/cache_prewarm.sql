@@ -0,0 +1,25 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.prewarm (
+  time BIGINT NOT NULL,
+  device INT NULL
+);
+SELECT * FROM create_hypertable('"public"."prewarm"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+INSERT INTO prewarm SELECT t, t % 4 FROM generate_series(0, 2999) t;
+
+--a new backend only fills its caches on demand
+\c single
+SELECT count(*) FROM prewarm WHERE time < 10;
+SELECT cache_name, entries FROM cache_stats()
+WHERE cache_name IN ('chunk_cache', 'chunk_table_cache') ORDER BY cache_name;
+
+--with prewarming, the first access loads the most recent chunks of each partition
+\c single
+SET timescaledb.cache_prewarm = 'true';
+SET timescaledb.cache_prewarm_chunks = 2;
+SELECT count(*) FROM prewarm WHERE time < 10;
+SELECT cache_name, entries FROM cache_stats()
+WHERE cache_name IN ('chunk_cache', 'chunk_table_cache') ORDER BY cache_name;
+SELECT count(*) FROM prewarm;
@@ -0,0 +1,68 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.stats (
+  time BIGINT NOT NULL,
+  device INT NULL
+);
+SELECT * FROM create_hypertable('"public"."stats"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+
+INSERT INTO stats SELECT t, t % 4 FROM generate_series(0, 2999) t;
+
+--the insert filled the hypertable and chunk caches of this backend
+SELECT cache_name, entries > 0 AS has_entries, memory_bytes > 0 AS uses_memory,
+       misses > 0 AS has_misses, hit_ratio BETWEEN 0 AND 1 AS valid_ratio
+FROM cache_stats()
+WHERE cache_name IN ('hypertable_cache', 'chunk_cache')
+ORDER BY cache_name;
+
+CREATE TEMP TABLE stats_before AS SELECT * FROM cache_stats();
+
+--repeated inserts into the same chunks hit the cache
+INSERT INTO stats SELECT t, t % 4 FROM generate_series(0, 2999) t;
+
+SELECT a.cache_name, a.hits > b.hits AS more_hits
+FROM cache_stats() a INNER JOIN stats_before b ON (a.cache_name = b.cache_name)
+WHERE a.cache_name = 'chunk_cache';
+
+--inserting into more chunks than fit in the chunk cache evicts chunks while
+--the insert still has the cache pinned
+CREATE TABLE PUBLIC.stats_many (
+  time BIGINT NOT NULL,
+  device INT NULL
+);
+SELECT * FROM create_hypertable('"public"."stats_many"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1);
+INSERT INTO stats_many SELECT t, 0 FROM generate_series(0, 399) t;
+
+SET timescaledb.chunk_cache_size = '64kB';
+CREATE TEMP TABLE stats_before_many AS SELECT * FROM cache_stats();
+INSERT INTO stats_many SELECT t, 1 FROM generate_series(0, 399) t;
+
+SELECT a.cache_name, a.evictions > b.evictions AS evicted, a.memory_bytes <= 64 * 1024 AS within_budget
+FROM cache_stats() a INNER JOIN stats_before_many b ON (a.cache_name = b.cache_name)
+WHERE a.cache_name = 'chunk_cache';
+RESET timescaledb.chunk_cache_size;
+
+--a change to one chunk only invalidates the entries of that chunk, even while
+--an insert has the chunk cache pinned, and leaves the other entries cached
+SELECT add_zone_map_column('stats', 'device');
+INSERT INTO stats VALUES (500, 0), (1500, 0), (2500, 0);
+CREATE TEMP TABLE stats_before_chunk AS SELECT * FROM cache_stats();
+--widening the zone map of the chunk inserted into invalidates it mid-insert
+INSERT INTO stats VALUES (1500, 7);
+
+SELECT a.cache_name, a.invalidations = b.invalidations AS not_flushed,
+       a.entries >= b.entries - 1 AS others_cached
+FROM cache_stats() a INNER JOIN stats_before_chunk b ON (a.cache_name = b.cache_name)
+WHERE a.cache_name IN ('chunk_cache', 'chunk_table_cache')
+ORDER BY a.cache_name;
+
+--the same holds for a change to one hypertable
+CREATE TEMP TABLE stats_before_hypertable AS SELECT * FROM cache_stats();
+SELECT _timescaledb_cache.invalidate_cache_entry('cache_inval_hypertable', 'stats');
+
+SELECT a.cache_name, a.invalidations = b.invalidations AS not_flushed,
+       a.entries >= b.entries - 1 AS others_cached
+FROM cache_stats() a INNER JOIN stats_before_hypertable b ON (a.cache_name = b.cache_name)
+WHERE a.cache_name = 'hypertable_cache';
@@ -0,0 +1,61 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.index_test (
+  time TIMESTAMPTZ NOT NULL,
+  device INTEGER NOT NULL,
+  value DOUBLE PRECISION NULL
+);
+SELECT * FROM create_hypertable('"public"."index_test"'::regclass, 'time'::name, number_partitions => 1,
+                                chunk_time_interval => _timescaledb_internal.interval_to_usec('1 day'));
+CREATE INDEX ON index_test (time DESC);
+INSERT INTO index_test
+SELECT '2017-01-01 00:00 UTC'::timestamptz + h * interval '1 hour', h % 4, h
+FROM generate_series(0, 47) h;
+INSERT INTO index_test VALUES (now(), 0, 48);
+CREATE INDEX ON index_test (device, time DESC) WHERE device IS NOT NULL;
+
+CREATE VIEW index_test_methods AS
+SELECT crni.table_name, crni.main_index_name, substring(pg_get_indexdef(c.oid) FROM 'USING .*') AS index_def
+FROM _timescaledb_catalog.chunk_replica_node_index crni
+INNER JOIN pg_class c ON (c.oid = format('%I.%I', crni.schema_name, crni.index_name)::regclass);
+SELECT * FROM index_test_methods ORDER BY 1, 2;
+
+--closed chunks can keep a BRIN index instead of a B-tree
+SELECT set_chunk_index_method(format('%I.%I', crni.schema_name, crni.index_name)::regclass)
+FROM _timescaledb_catalog.chunk_replica_node_index crni
+WHERE crni.table_name = '_hyper_1_1_0_1_data' AND crni.main_index_name = 'index_test_time_idx';
+SELECT * FROM index_test_methods ORDER BY 1, 2;
+
+--the planner uses the index that the chunk has
+SET enable_seqscan = off;
+EXPLAIN (costs off) SELECT * FROM _timescaledb_internal._hyper_1_1_0_1_data WHERE time < now();
+SELECT count(*), sum(value) FROM index_test WHERE time < '2017-01-01 12:00 UTC';
+RESET enable_seqscan;
+
+--index policies rebuild the indexes of old chunks, the newest chunk keeps its B-tree
+SELECT add_index_policy('index_test', 'index_test_time_idx', interval '1 day');
+SELECT run_policy(1);
+SELECT * FROM index_test_methods ORDER BY 1, 2;
+
+--the columns and predicate of the index are kept, and the hypertable's
+--access method restores the original definition
+SELECT set_chunk_index_method(format('%I.%I', crni.schema_name, crni.index_name)::regclass)
+FROM _timescaledb_catalog.chunk_replica_node_index crni
+WHERE crni.table_name = '_hyper_1_1_0_1_data' AND crni.main_index_name = 'index_test_device_time_idx';
+SELECT * FROM index_test_methods WHERE table_name = '_hyper_1_1_0_1_data' ORDER BY 1, 2;
+SELECT set_chunk_index_method(format('%I.%I', crni.schema_name, crni.index_name)::regclass, 'btree')
+FROM _timescaledb_catalog.chunk_replica_node_index crni
+WHERE crni.table_name = '_hyper_1_1_0_1_data' AND crni.main_index_name = 'index_test_device_time_idx';
+SELECT * FROM index_test_methods WHERE table_name = '_hyper_1_1_0_1_data' ORDER BY 1, 2;
+SELECT count(*), sum(value) FROM index_test;
+
+\set ON_ERROR_STOP 0
+SELECT set_chunk_index_method('pg_class_oid_index');
+SELECT set_chunk_index_method(format('%I.%I', crni.schema_name, crni.index_name)::regclass, 'no_such_method')
+FROM _timescaledb_catalog.chunk_replica_node_index crni
+WHERE crni.table_name = '_hyper_1_1_0_3_data' AND crni.main_index_name = 'index_test_time_idx';
+SELECT add_index_policy('index_test', 'pg_class_oid_index', interval '1 day');
+SELECT add_index_policy('index_test', 'index_test_device_time_idx', interval '1 day', 'no_such_method');
+\set ON_ERROR_STOP 1
@@ -0,0 +1,57 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.build_test (
+  time TIMESTAMPTZ NOT NULL,
+  device INTEGER NOT NULL,
+  value DOUBLE PRECISION NULL
+);
+SELECT * FROM create_hypertable('"public"."build_test"'::regclass, 'time'::name, number_partitions => 1,
+                                chunk_time_interval => _timescaledb_internal.interval_to_usec('1 day'));
+INSERT INTO build_test
+SELECT '2017-01-01 00:00 UTC'::timestamptz + h * interval '1 hour', h % 4, h
+FROM generate_series(0, 71) h;
+
+--deferred indexes are only created on the hypertable
+SET timescaledb.defer_chunk_indexes = on;
+CREATE INDEX ON build_test (device, time DESC);
+RESET timescaledb.defer_chunk_indexes;
+SELECT * FROM chunk_index_progress;
+SELECT count(*) FROM _timescaledb_catalog.chunk_replica_node_index;
+
+--background workers build the index on the chunks
+SELECT build_chunk_indexes('build_test_device_time_idx', 2);
+SELECT * FROM chunk_index_progress;
+SELECT crni.table_name, crni.main_index_name, substring(pg_get_indexdef(c.oid) FROM 'USING .*') AS index_def
+FROM _timescaledb_catalog.chunk_replica_node_index crni
+INNER JOIN pg_class c ON (c.oid = format('%I.%I', crni.schema_name, crni.index_name)::regclass)
+ORDER BY 1, 2;
+SELECT build_chunk_indexes('build_test_device_time_idx');
+
+SET enable_seqscan = off;
+SELECT count(*), sum(value) FROM build_test WHERE device = 1;
+RESET enable_seqscan;
+
+--indexes are created on new chunks, so only the existing chunks lack them
+SET timescaledb.defer_chunk_indexes = on;
+CREATE INDEX ON build_test (value);
+RESET timescaledb.defer_chunk_indexes;
+INSERT INTO build_test VALUES ('2017-01-05 00:00 UTC', 0, 72);
+SELECT * FROM chunk_index_progress ORDER BY index_name;
+
+--concurrent builds return before the workers finish, which they do once
+--this transaction ends
+SELECT build_chunk_indexes('build_test_value_idx', 2, concurrently => true);
+\! for i in $(seq 60); do test "$(psql -h localhost -U postgres -d single -Atc "SELECT bool_and(chunks = chunks_done) FROM chunk_index_progress")" = t && break; sleep 1; done
+SELECT * FROM chunk_index_progress ORDER BY index_name;
+SELECT crni.table_name, i.indisvalid
+FROM _timescaledb_catalog.chunk_replica_node_index crni
+INNER JOIN pg_index i ON (i.indexrelid = format('%I.%I', crni.schema_name, crni.index_name)::regclass)
+WHERE crni.main_index_name = 'build_test_value_idx'
+ORDER BY 1;
+
+\set ON_ERROR_STOP 0
+SELECT build_chunk_indexes('pg_class_oid_index');
+SELECT build_chunk_indexes('build_test_device_time_idx', 0);
+\set ON_ERROR_STOP 1
@@ -0,0 +1,61 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.compress_test (
+  time BIGINT NOT NULL,
+  device INT NULL,
+  temp DOUBLE PRECISION NULL,
+  note TEXT NULL
+);
+SELECT * FROM create_hypertable('"public"."compress_test"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+INSERT INTO compress_test
+SELECT t, t % 4, t * 0.5, CASE WHEN t % 10 = 0 THEN NULL ELSE 'note ' || t % 3 END
+FROM generate_series(0, 2999) t;
+
+SELECT count(*) AS rows, sum(time) AS time, sum(device) AS device, sum(temp) AS temp,
+       count(note) AS notes, count(DISTINCT note) AS distinct_notes
+FROM compress_test;
+
+SELECT compress_chunk('_timescaledb_internal._hyper_1_1_0_1_data', 'device');
+SELECT compress_chunk('_timescaledb_internal._hyper_1_1_0_2_data');
+
+SELECT chunk_id, compressed_table_name, segment_by, uncompressed_rows,
+       compressed_bytes < uncompressed_bytes AS smaller
+FROM _timescaledb_catalog.chunk_compression ORDER BY chunk_id;
+
+--the rows moved to the compressed tables, in groups by segment_by column
+SELECT count(*) FROM _timescaledb_internal._hyper_1_1_0_1_data;
+SELECT device, _ts_count FROM _timescaledb_internal._compressed_chunk_1 ORDER BY device;
+SELECT _ts_count FROM _timescaledb_internal._compressed_chunk_2;
+
+--queries on the hypertable decompress the compressed chunks
+EXPLAIN (costs off) SELECT * FROM compress_test;
+SELECT count(*) AS rows, sum(time) AS time, sum(device) AS device, sum(temp) AS temp,
+       count(note) AS notes, count(DISTINCT note) AS distinct_notes
+FROM compress_test;
+SELECT * FROM compress_test WHERE time >= 997 AND time < 1002 ORDER BY time;
+
+--rows inserted into a compressed chunk are not compressed
+INSERT INTO compress_test VALUES (5, 9, 1.5, 'late');
+SELECT count(*) FROM _timescaledb_internal._hyper_1_1_0_1_data;
+SELECT * FROM compress_test WHERE device = 9;
+
+\set ON_ERROR_STOP 0
+UPDATE compress_test SET temp = 0 WHERE time = 5;
+DELETE FROM compress_test WHERE time = 5;
+SELECT * FROM compress_test WHERE time = 5 FOR UPDATE;
+SELECT compress_chunk('_timescaledb_internal._hyper_1_1_0_1_data');
+SELECT decompress_chunk('_timescaledb_internal._hyper_1_1_0_3_data');
+SELECT compress_chunk('compress_test');
+\set ON_ERROR_STOP 1
+
+--decompressing moves the rows back and drops the compressed table
+SELECT decompress_chunk('_timescaledb_internal._hyper_1_1_0_1_data');
+SELECT count(*) FROM _timescaledb_internal._hyper_1_1_0_1_data;
+SELECT chunk_id FROM _timescaledb_catalog.chunk_compression;
+SELECT to_regclass('_timescaledb_internal._compressed_chunk_1');
+UPDATE compress_test SET temp = 0 WHERE time = 5;
+SELECT count(*) AS rows, sum(time) AS time, sum(device) AS device, sum(temp) AS temp,
+       count(note) AS notes, count(DISTINCT note) AS distinct_notes
+FROM compress_test;
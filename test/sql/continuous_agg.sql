@@ -0,0 +1,81 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.cagg_test (
+  time BIGINT NOT NULL,
+  device INTEGER NOT NULL,
+  value DOUBLE PRECISION NULL
+);
+CREATE INDEX ON cagg_test (time);
+SELECT * FROM create_hypertable('"public"."cagg_test"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+
+INSERT INTO cagg_test
+SELECT t, t % 2, t
+FROM generate_series(0, 2499) t;
+
+--the buckets below the bucket of the newest data are materialized
+SELECT create_continuous_aggregate('cagg_test_agg', 'cagg_test', 500,
+  'count(*) AS readings, sum(value) AS total, max(value) AS max_value', '{device}');
+SELECT id, view_schema, view_name, raw_hypertable_id, mat_hypertable_id, bucket_width, group_by, watermark
+FROM _timescaledb_catalog.continuous_agg;
+SELECT * FROM _timescaledb_internal._materialized_hypertable_1 ORDER BY time, device;
+SELECT * FROM cagg_test_agg ORDER BY time, device;
+
+--inserts below the watermark invalidate materialized buckets
+INSERT INTO cagg_test VALUES (700, 0, 10000), (1200, 1, 10000);
+INSERT INTO cagg_test VALUES (2600, 0, 10000);
+SELECT * FROM _timescaledb_catalog.continuous_agg_invalidation;
+SELECT * FROM cagg_test_agg WHERE time >= 500 AND time < 1500 ORDER BY time, device;
+
+SELECT refresh_continuous_aggregate('cagg_test_agg');
+SELECT watermark FROM _timescaledb_catalog.continuous_agg;
+SELECT count(*) FROM _timescaledb_catalog.continuous_agg_invalidation;
+SELECT * FROM cagg_test_agg ORDER BY time, device;
+SELECT count(*) FROM (
+  SELECT * FROM cagg_test_agg
+  EXCEPT
+  SELECT time_bucket(500, time), device, count(*), sum(value), max(value) FROM cagg_test GROUP BY 1, 2
+) diff;
+
+DO $$
+BEGIN
+    CREATE ROLE cagg_usr;
+EXCEPTION
+    WHEN duplicate_object THEN
+        --mute error
+END$$;
+
+\set ON_ERROR_STOP 0
+SELECT create_continuous_aggregate('cagg_test_agg', 'cagg_test', 500, 'count(*)');
+SELECT create_continuous_aggregate('cagg_test_bad', 'cagg_test', 0, 'count(*)');
+SELECT create_continuous_aggregate('cagg_test_bad', 'cagg_test', interval '1 hour', 'count(*)');
+SELECT create_continuous_aggregate('cagg_test_bad', 'pg_class', 500, 'count(*)');
+SELECT refresh_continuous_aggregate('cagg_test');
+SELECT add_refresh_policy('cagg_test_agg');
+--the aggregates are only a select list, and only the owner refreshes
+SELECT create_continuous_aggregate('cagg_test_bad', 'cagg_test', 500, 'count(*) FROM pg_authid --');
+SELECT create_continuous_aggregate('cagg_test_bad', 'cagg_test', 500, 'count(*) FROM cagg_test; DROP TABLE cagg_test; SELECT 1');
+SET ROLE cagg_usr;
+SELECT refresh_continuous_aggregate('cagg_test_agg');
+RESET ROLE;
+\set ON_ERROR_STOP 1
+
+--refresh policies refresh continuous aggregates in the background
+CREATE TABLE PUBLIC.cagg_test_tz (
+  time TIMESTAMPTZ NOT NULL,
+  value DOUBLE PRECISION NULL
+);
+SELECT * FROM create_hypertable('"public"."cagg_test_tz"'::regclass, 'time'::name);
+SELECT create_continuous_aggregate('cagg_test_tz_agg', 'cagg_test_tz', interval '1 hour', 'sum(value) AS total');
+INSERT INTO cagg_test_tz
+SELECT t, 1
+FROM generate_series('2017-01-01 00:00 UTC'::timestamptz, '2017-01-01 05:59 UTC', '1 minute') t;
+SELECT add_refresh_policy('cagg_test_tz_agg');
+SELECT run_policy(1);
+SELECT count(*), sum(total) FROM _timescaledb_internal._materialized_hypertable_2;
+SELECT count(*), sum(total) FROM cagg_test_tz_agg;
+
+SELECT drop_continuous_aggregate('cagg_test_agg');
+SELECT view_name FROM _timescaledb_catalog.continuous_agg;
+SELECT count(*) FROM _timescaledb_catalog.hypertable;
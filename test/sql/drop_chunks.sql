@@ -66,3 +66,19 @@ WHERE h.schema_name = 'public' AND (h.table_name = 'drop_chunk_test1' OR h.table
 
 SELECT * FROM _timescaledb_catalog.chunk_replica_node;
 \dt "_timescaledb_internal".*
+
+--chunk indexes are dropped along with the chunks
+CREATE INDEX ON PUBLIC.drop_chunk_test2(time DESC);
+SELECT _timescaledb_meta.drop_chunks_older_than(4, 'drop_chunk_test2');
+
+SELECT table_name FROM _timescaledb_catalog.chunk_replica_node_index ORDER BY table_name;
+\dt "_timescaledb_internal".*
+
+--rows that reference the dropped chunks, e.g., seals, are deleted too
+SET timescaledb.seal_cost_delay = 0;
+SELECT seal_chunk('_timescaledb_internal._hyper_1_1_0_3_data');
+SELECT chunk_id, hypertable_id FROM _timescaledb_catalog.chunk_seal ORDER BY chunk_id;
+SELECT _timescaledb_meta.drop_chunks_older_than(4, 'drop_chunk_test1');
+
+SELECT chunk_id, hypertable_id FROM _timescaledb_catalog.chunk_seal ORDER BY chunk_id;
+SELECT table_name FROM _timescaledb_catalog.chunk_replica_node WHERE chunk_id = 3;
@@ -0,0 +1,41 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.mono_test (
+  time BIGINT NOT NULL,
+  value DOUBLE PRECISION NULL
+);
+CREATE INDEX ON mono_test (time);
+INSERT INTO mono_test
+SELECT t, t
+FROM generate_series(0, 9999) t;
+ANALYZE mono_test;
+
+CREATE FUNCTION mono_div(t BIGINT) RETURNS BIGINT LANGUAGE PLPGSQL IMMUTABLE AS
+$BODY$
+BEGIN
+    RETURN t / 100;
+END
+$BODY$;
+
+--the extension's functions are registered by default
+SELECT count(*) FROM _timescaledb_catalog.monotonic_function WHERE builtin;
+EXPLAIN (costs off) SELECT * FROM mono_test ORDER BY time_bucket(100, time) LIMIT 5;
+
+--unregistered functions are sorted
+EXPLAIN (costs off) SELECT * FROM mono_test ORDER BY mono_div(time) LIMIT 5;
+
+--registered functions use the index on their ordering argument
+SELECT register_monotonic_function('mono_div(bigint)');
+SELECT function_id, order_argument, builtin FROM _timescaledb_catalog.monotonic_function WHERE NOT builtin;
+EXPLAIN (costs off) SELECT * FROM mono_test ORDER BY mono_div(time) LIMIT 5;
+EXPLAIN (costs off) SELECT * FROM mono_test ORDER BY mono_div(time) DESC LIMIT 5;
+SELECT mono_div(time), value FROM mono_test ORDER BY mono_div(time) DESC, value DESC LIMIT 5;
+
+SELECT unregister_monotonic_function('mono_div(bigint)');
+EXPLAIN (costs off) SELECT * FROM mono_test ORDER BY mono_div(time) LIMIT 5;
+
+\set ON_ERROR_STOP 0
+SELECT register_monotonic_function('mono_div(bigint)', 2);
+\set ON_ERROR_STOP 1
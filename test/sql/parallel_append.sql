@@ -0,0 +1,34 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.parallel_test (
+  time TIMESTAMPTZ NOT NULL,
+  device INTEGER NOT NULL,
+  value DOUBLE PRECISION NULL
+);
+SELECT * FROM create_hypertable('"public"."parallel_test"'::regclass, 'time'::name, number_partitions => 1,
+                                chunk_time_interval => _timescaledb_internal.interval_to_usec('1 day'));
+INSERT INTO parallel_test
+SELECT '2017-01-01 00:00 UTC'::timestamptz + i * interval '36 seconds', i % 4, i
+FROM generate_series(0, 23999) i;
+
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_relation_size = '8kB';
+SET max_parallel_workers_per_gather = 8;
+
+--the workers are sized by the largest chunk
+SET timescaledb.disable_optimizations = true;
+EXPLAIN (costs off) SELECT * FROM parallel_test;
+
+--the workers are sized by all chunks together
+RESET timescaledb.disable_optimizations;
+EXPLAIN (costs off) SELECT * FROM parallel_test;
+SELECT count(*), sum(value) FROM parallel_test;
+
+--a failed plan does not affect the plans of later queries
+\set ON_ERROR_STOP 0
+SELECT * FROM parallel_test WHERE value > 1 / 0;
+\set ON_ERROR_STOP 1
+EXPLAIN (costs off) SELECT * FROM parallel_test;
@@ -0,0 +1,45 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.epochs (
+  time BIGINT NOT NULL,
+  value INT NULL
+);
+SELECT * FROM create_hypertable('"public"."epochs"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+
+--split time into more epochs than the hypertable cache used to keep, leaving
+--no epoch from 12000 to 12999 and from 26000 on
+UPDATE _timescaledb_catalog.partition_epoch SET end_time = 999;
+\o /dev/null
+SELECT add_partition_epoch(1, ARRAY[]::SMALLINT[], 1::SMALLINT, NULL, NULL, NULL, NULL)
+FROM generate_series(1, 24);
+\o
+UPDATE _timescaledb_catalog.partition_epoch pe
+SET start_time = e.start_time, end_time = e.start_time + 999
+FROM (SELECT id, (n + CASE WHEN n >= 12 THEN 1 ELSE 0 END) * 1000 AS start_time
+      FROM (SELECT id, row_number() OVER (ORDER BY id) AS n
+            FROM _timescaledb_catalog.partition_epoch
+            WHERE start_time IS NULL AND end_time IS NULL) epochs) e
+WHERE pe.id = e.id;
+SELECT count(*), min(end_time), max(start_time) FROM _timescaledb_catalog.partition_epoch;
+
+--each row is inserted into a chunk of the epoch that covers its time
+INSERT INTO epochs SELECT t, t / 1000 FROM generate_series(0, 25999, 1000) t WHERE t NOT BETWEEN 12000 AND 12999;
+SELECT count(*) AS chunks, count(DISTINCT p.epoch_id) AS epochs,
+       bool_and(c.start_time >= coalesce(pe.start_time, 0) AND c.end_time <= pe.end_time) AS within_epochs
+FROM _timescaledb_catalog.chunk c
+INNER JOIN _timescaledb_catalog.partition p ON (p.id = c.partition_id)
+INNER JOIN _timescaledb_catalog.partition_epoch pe ON (pe.id = p.epoch_id);
+SELECT count(*), min(time), max(time) FROM epochs;
+
+--time points without an epoch
+\set ON_ERROR_STOP 0
+INSERT INTO epochs VALUES (12500, 12);
+INSERT INTO epochs VALUES (30000, 30);
+\set ON_ERROR_STOP 1
+
+--changing an epoch reloads the epochs of the hypertable
+UPDATE _timescaledb_catalog.partition_epoch SET end_time = NULL WHERE start_time = 25000;
+INSERT INTO epochs VALUES (30000, 30);
+SELECT count(*), min(time), max(time) FROM epochs WHERE time >= 25000;
@@ -0,0 +1,30 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.plan_test (
+  time BIGINT NOT NULL,
+  value DOUBLE PRECISION NULL
+);
+SELECT * FROM create_hypertable('"public"."plan_test"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 10);
+INSERT INTO plan_test VALUES (1, 1.0), (11, 11.0);
+
+CREATE TABLE PUBLIC.plain_test (
+  time BIGINT NOT NULL,
+  value DOUBLE PRECISION NULL
+);
+INSERT INTO plain_test VALUES (1, 1.0);
+
+--plain queries on a hypertable are redirected to its chunks
+EXPLAIN (costs off) SELECT * FROM plan_test;
+SELECT * FROM plan_test ORDER BY time;
+
+--also from subqueries and CTEs
+EXPLAIN (costs off) SELECT * FROM (SELECT * FROM plan_test) t;
+EXPLAIN (costs off) WITH t AS (SELECT * FROM plan_test) SELECT * FROM t;
+WITH t AS (SELECT * FROM plan_test) SELECT count(*) FROM t;
+
+--queries on other tables, and with ONLY, are not changed
+EXPLAIN (costs off) SELECT * FROM plain_test;
+EXPLAIN (costs off) SELECT * FROM plain_test;
+EXPLAIN (costs off) SELECT * FROM ONLY plan_test;
@@ -0,0 +1,49 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.reorder_test (
+  time BIGINT NOT NULL,
+  device INT NOT NULL,
+  note TEXT NULL
+);
+SELECT * FROM create_hypertable('"public"."reorder_test"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+CREATE INDEX ON reorder_test (device, time);
+INSERT INTO reorder_test
+SELECT t, t % 4, CASE WHEN t = 5 THEN (SELECT string_agg(md5(i::text), '') FROM generate_series(1, 200) i) END
+FROM generate_series(0, 1999) t;
+
+--rows are stored in insert order
+SELECT ctid, time, device FROM _timescaledb_internal._hyper_1_1_0_1_data LIMIT 5;
+
+SELECT reorder_chunk('_timescaledb_internal._hyper_1_1_0_1_data', format('%I.%I', crni.schema_name, crni.index_name)::regclass)
+FROM _timescaledb_catalog.chunk_replica_node_index crni
+WHERE crni.table_name = '_hyper_1_1_0_1_data' AND crni.main_index_name = 'reorder_test_device_time_idx';
+
+--the rows of each device are stored together
+SELECT ctid, time, device FROM _timescaledb_internal._hyper_1_1_0_1_data LIMIT 5;
+SELECT count(*), sum(time), sum(device), sum(length(note)) FROM reorder_test;
+SELECT count(*) FILTER (WHERE i.indisclustered) AS clustered, count(*) FILTER (WHERE i.indisvalid) AS valid
+FROM pg_index i WHERE i.indrelid = '_timescaledb_internal._hyper_1_1_0_1_data'::regclass;
+SELECT count(*) FROM pg_class WHERE relname LIKE 'pg_temp_%';
+
+--the indexes of the chunk point to the reordered rows
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT time, device, length(note) FROM reorder_test WHERE device = 1 AND time < 10 ORDER BY device, time;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+CREATE INDEX reorder_brin ON _timescaledb_internal._hyper_1_1_0_2_data USING brin (time);
+
+\set ON_ERROR_STOP 0
+SELECT reorder_chunk('reorder_test', 'pg_class_oid_index');
+SELECT reorder_chunk('_timescaledb_internal._hyper_1_1_0_1_data', 'pg_class_oid_index');
+SELECT reorder_chunk('_timescaledb_internal._hyper_1_1_0_2_data', '_timescaledb_internal.reorder_brin');
+\set ON_ERROR_STOP 1
+
+--compressed chunks cannot be reordered
+SELECT compress_chunk('_timescaledb_internal._hyper_1_1_0_2_data');
+\set ON_ERROR_STOP 0
+SELECT reorder_chunk('_timescaledb_internal._hyper_1_1_0_2_data', '_timescaledb_internal.reorder_brin');
+\set ON_ERROR_STOP 1
@@ -0,0 +1,82 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.seal_test (
+  time BIGINT NOT NULL,
+  value INT NOT NULL,
+  note TEXT NULL
+);
+SELECT * FROM create_hypertable('"public"."seal_test"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+CREATE INDEX ON seal_test (time);
+INSERT INTO seal_test
+SELECT t, t, CASE WHEN t = 5 THEN (SELECT string_agg(md5(i::text), '') FROM generate_series(1, 200) i) END
+FROM generate_series(0, 2999) t;
+
+--the number of rows that an index-only scan looks up in the heap
+CREATE FUNCTION heap_fetches(query TEXT) RETURNS TEXT LANGUAGE PLPGSQL AS
+$BODY$
+DECLARE
+    line TEXT;
+BEGIN
+    FOR line IN EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF) ' || query LOOP
+        IF line LIKE '%Heap Fetches%' THEN
+            RETURN trim(line);
+        END IF;
+    END LOOP;
+    RETURN NULL;
+END
+$BODY$;
+
+SET timescaledb.seal_cost_delay = 0;
+SELECT seal_chunk('_timescaledb_internal._hyper_1_1_0_1_data');
+SELECT chunk_id, hypertable_id FROM _timescaledb_catalog.chunk_seal ORDER BY chunk_id;
+SELECT count(*), sum(time), sum(value), sum(length(note)) FROM seal_test;
+SELECT count(*) FROM pg_class WHERE relname LIKE 'pg_temp_%';
+
+--the pages of sealed chunks are all-visible, so index-only scans skip the heap
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT heap_fetches('SELECT time FROM _timescaledb_internal._hyper_1_1_0_1_data WHERE time < 1000');
+SELECT heap_fetches('SELECT time FROM _timescaledb_internal._hyper_1_1_0_2_data WHERE time < 2000');
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+--writes to sealed chunks through the hypertable fail
+\set ON_ERROR_STOP 0
+INSERT INTO seal_test VALUES (10, 10, NULL);
+UPDATE seal_test SET value = 0 WHERE time = 10;
+DELETE FROM seal_test WHERE value < 500;
+SELECT seal_chunk('_timescaledb_internal._hyper_1_1_0_1_data');
+SELECT compress_chunk('_timescaledb_internal._hyper_1_1_0_1_data');
+SELECT unseal_chunk('_timescaledb_internal._hyper_1_1_0_2_data');
+SELECT seal_chunk('seal_test');
+\set ON_ERROR_STOP 1
+
+--other chunks can still be written to
+UPDATE seal_test SET value = 0 WHERE time >= 2000 AND time < 2010;
+INSERT INTO seal_test VALUES (1500, 1500, NULL);
+SELECT count(*), sum(value) FROM seal_test WHERE time >= 1000;
+
+SELECT unseal_chunk('_timescaledb_internal._hyper_1_1_0_1_data');
+INSERT INTO seal_test VALUES (10, 10, NULL);
+SELECT count(*) FROM seal_test WHERE time = 10;
+
+--sealing policies seal the chunks that ended more than a lag before the
+--start of the newest chunk
+CREATE TABLE PUBLIC.seal_policy_test (
+  time TIMESTAMPTZ NOT NULL,
+  value INT NOT NULL
+);
+SELECT * FROM create_hypertable('"public"."seal_policy_test"'::regclass, 'time'::name, number_partitions => 1,
+                                chunk_time_interval => _timescaledb_internal.interval_to_usec('1 day'));
+INSERT INTO seal_policy_test VALUES ('2000-01-01 12:00 UTC', 1), ('2000-01-02 12:00 UTC', 2),
+                                    ('2000-01-03 12:00 UTC', 3), ('2000-01-04 12:00 UTC', 4);
+SELECT add_sealing_policy('seal_policy_test', interval '1 day');
+SELECT run_policy(1);
+SELECT chunk_id, hypertable_id FROM _timescaledb_catalog.chunk_seal ORDER BY chunk_id;
+
+--seals are dropped with their chunks
+SELECT seal_chunk('_timescaledb_internal._hyper_1_1_0_2_data');
+SELECT _timescaledb_meta.drop_chunks_older_than(2000, 'seal_test');
+SELECT chunk_id, hypertable_id FROM _timescaledb_catalog.chunk_seal ORDER BY chunk_id;
@@ -0,0 +1,31 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.skip (
+  time BIGINT NOT NULL,
+  device INT NULL,
+  temp DOUBLE PRECISION NULL
+);
+CREATE INDEX ON PUBLIC.skip (device, time DESC);
+SELECT * FROM create_hypertable('"public"."skip"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+
+INSERT INTO skip SELECT t, t % 4, t FROM generate_series(0, 2999) t;
+INSERT INTO skip VALUES (2999, NULL, 0), (2999, 7, 0);
+--analyze the chunks too
+ANALYZE;
+
+--distinct queries on the leading index column skip between values in each chunk
+SELECT DISTINCT device FROM skip ORDER BY device;
+EXPLAIN (costs off) SELECT DISTINCT device FROM skip ORDER BY device;
+SELECT DISTINCT device FROM skip WHERE time > 1500 ORDER BY device;
+EXPLAIN (costs off) SELECT DISTINCT device FROM skip WHERE time > 1500 ORDER BY device;
+--the placeholder key goes after the quals on the leading index column and before the others
+SELECT DISTINCT device FROM skip WHERE device > 0 AND time > 1500 ORDER BY device;
+EXPLAIN (costs off) SELECT DISTINCT device FROM skip WHERE device > 0 AND time > 1500 ORDER BY device;
+SELECT DISTINCT device FROM skip WHERE temp > 2000 AND device <> 2 ORDER BY device;
+SELECT DISTINCT device FROM skip WHERE time < 0;
+
+SET timescaledb.disable_optimizations = 'true';
+SELECT DISTINCT device FROM skip ORDER BY device;
+SELECT DISTINCT device FROM skip WHERE temp > 2000 AND device <> 2 ORDER BY device;
@@ -17,6 +17,49 @@ insert into test_tspace values ('2017-01-20T09:00:02', 22.3, 'dev7');
 --verify that the table chunk has the correct tablespace
 \d+ _timescaledb_internal.*
 
+--test hypertable with chunks placed round-robin in tablespaces
+SET client_min_messages = ERROR;
+drop tablespace if exists tspace2;
+SET client_min_messages = NOTICE;
+create tablespace tspace2 location :TEST_TABLESPACE2_PATH;
+create table test_stripe(time timestamptz not null, temp float);
+select create_hypertable('test_stripe', 'time', number_partitions => 1,
+                         chunk_time_interval => _timescaledb_internal.interval_to_usec('1 day'));
+create index on test_stripe (time);
+select set_chunk_tablespaces('test_stripe', array['tspace1', 'tspace2']);
+insert into test_stripe values ('2000-01-01 12:00 UTC', 1.0), ('2000-01-02 12:00 UTC', 2.0),
+                               ('2000-01-03 12:00 UTC', 3.0), ('2000-01-04 12:00 UTC', 4.0);
+
+--chunks and their indexes are in the tablespaces of the catalog
+create view test_stripe_placement as
+select ct.chunk_id, ct.tablespace_name, t.spcname as table_tablespace, it.spcname as index_tablespace
+from _timescaledb_catalog.chunk_tablespace ct
+inner join _timescaledb_catalog.chunk_replica_node crn on (crn.chunk_id = ct.chunk_id)
+inner join pg_class c on (c.oid = format('%I.%I', crn.schema_name, crn.table_name)::regclass)
+left join pg_tablespace t on (t.oid = c.reltablespace)
+inner join pg_index i on (i.indrelid = c.oid)
+inner join pg_class ic on (ic.oid = i.indexrelid)
+left join pg_tablespace it on (it.oid = ic.reltablespace)
+where ct.hypertable_id = 2;
+select * from test_stripe_placement order by chunk_id;
+
+select move_chunk('_timescaledb_internal._hyper_2_3_0_3_data', 'tspace2');
+select * from test_stripe_placement order by chunk_id;
+
+--tiering policies move old chunks to another tablespace
+select add_tiering_policy('test_stripe', interval '1 year', 'pg_default');
+select run_policy(1);
+select * from test_stripe_placement order by chunk_id;
+select count(*), sum(temp) from test_stripe;
+
+select set_chunk_tablespaces('test_stripe', array['tspace1', 'tspace1']);
+select set_chunk_tablespaces('test_stripe', array['tspace3']);
+select add_tiering_policy('test_tspace', interval '1 year', 'tspace3');
+select move_chunk('test_stripe', 'tspace1');
+
 --cleanup
+drop view test_stripe_placement;
+drop table test_stripe;
 drop table test_tspace;
 drop tablespace tspace1;
+drop tablespace tspace2;
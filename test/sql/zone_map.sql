@@ -0,0 +1,72 @@
+\o /dev/null
+\ir include/create_single_db.sql
+\o
+
+CREATE TABLE PUBLIC.zone_map_test (
+  time BIGINT NOT NULL,
+  seq BIGINT NULL,
+  temp DOUBLE PRECISION NULL
+);
+SELECT * FROM create_hypertable('"public"."zone_map_test"'::regclass, 'time'::name, number_partitions => 1, chunk_time_interval => 1000);
+SELECT add_zone_map_column('zone_map_test', 'seq');
+
+--inserts widen the zone maps of the chunks they insert into
+INSERT INTO zone_map_test
+SELECT t, t + 10000, CASE WHEN t < 2000 THEN t / 2.0 END
+FROM generate_series(0, 2999) t;
+SELECT chunk_id, column_name, min_value, max_value, null_count
+FROM _timescaledb_catalog.chunk_zone_map ORDER BY chunk_id, column_name;
+
+--the zone maps of existing chunks are computed when a column is added
+SELECT add_zone_map_column('zone_map_test', 'temp');
+SELECT chunk_id, column_name, min_value, max_value, null_count
+FROM _timescaledb_catalog.chunk_zone_map ORDER BY chunk_id, column_name;
+
+--chunks are excluded by their zone maps
+EXPLAIN (costs off) SELECT * FROM zone_map_test WHERE seq >= 11500;
+EXPLAIN (costs off) SELECT * FROM zone_map_test WHERE temp IS NULL;
+EXPLAIN (costs off) SELECT * FROM zone_map_test WHERE temp > 600;
+SELECT count(*), min(seq), max(seq) FROM zone_map_test WHERE seq >= 11500;
+
+INSERT INTO zone_map_test VALUES (500, 20000, NULL);
+SELECT chunk_id, column_name, min_value, max_value, null_count
+FROM _timescaledb_catalog.chunk_zone_map WHERE chunk_id = 1 ORDER BY column_name;
+SELECT * FROM zone_map_test WHERE seq > 15000;
+
+--explaining an UPDATE keeps the zone maps, which are only dropped when the UPDATE runs
+\o /dev/null
+EXPLAIN (costs off) UPDATE zone_map_test SET seq = seq + 100000 WHERE time >= 2000;
+\o
+SELECT count(*) FROM _timescaledb_catalog.chunk_zone_map WHERE column_name = 'seq';
+
+--an UPDATE drops the zone maps of the columns it sets in the chunks it modifies
+UPDATE zone_map_test SET seq = seq + 100000 WHERE time >= 2000;
+SELECT chunk_id, column_name, min_value, max_value, null_count
+FROM _timescaledb_catalog.chunk_zone_map ORDER BY chunk_id, column_name;
+SELECT count(*) FROM zone_map_test WHERE seq > 112990;
+SELECT update_chunk_zone_maps('_timescaledb_internal._hyper_1_1_0_3_data');
+SELECT chunk_id, column_name, min_value, max_value, null_count
+FROM _timescaledb_catalog.chunk_zone_map WHERE chunk_id = 3 ORDER BY column_name;
+
+\set ON_ERROR_STOP 0
+SELECT add_zone_map_column('zone_map_test', 'seq');
+SELECT add_zone_map_column('zone_map_test', 'missing');
+SELECT add_zone_map_column('pg_class', 'relname');
+SELECT remove_zone_map_column('zone_map_test', 'time');
+\set ON_ERROR_STOP 1
+
+SELECT remove_zone_map_column('zone_map_test', 'temp');
+SELECT chunk_id, column_name FROM _timescaledb_catalog.chunk_zone_map ORDER BY chunk_id, column_name;
+
+--zone maps are dropped with their chunks
+SELECT _timescaledb_meta.drop_chunks_older_than(1000, 'zone_map_test');
+SELECT chunk_id, column_name FROM _timescaledb_catalog.chunk_zone_map ORDER BY chunk_id, column_name;
+
+--inserts that find a zone map locked widen a delta of it instead, which is
+--merged when the zone map is read and folded into it by the next insert
+INSERT INTO _timescaledb_catalog.chunk_zone_map_delta VALUES (2, 1, 'seq', '30000', '30000', 0);
+EXPLAIN (costs off) SELECT * FROM zone_map_test WHERE seq = 30000;
+INSERT INTO zone_map_test VALUES (1500, 11500, NULL);
+SELECT chunk_id, column_name, min_value, max_value, null_count
+FROM _timescaledb_catalog.chunk_zone_map WHERE chunk_id = 2;
+SELECT count(*) FROM _timescaledb_catalog.chunk_zone_map_delta;